@@ -59,8 +59,8 @@
 #   See './mkChangelog -h' for help.
 #
 SET(LIBZYPP_MAJOR "17")
-SET(LIBZYPP_COMPATMINOR "2")
-SET(LIBZYPP_MINOR "6")
+SET(LIBZYPP_COMPATMINOR "7")
+SET(LIBZYPP_MINOR "7")
 SET(LIBZYPP_PATCH "0")
 #
 # LAST RELEASED: 17.6.0 (2)
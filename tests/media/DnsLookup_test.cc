@@ -0,0 +1,70 @@
+#include <poll.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <iostream>
+#include <vector>
+#include <boost/test/auto_unit_test.hpp>
+
+#include "zypp/media/DnsLookup_p.h"
+
+using namespace std;
+using namespace zypp;
+using namespace zypp::media;
+
+namespace
+{
+  /** Wait for \a lookup_r to be done (at most 60 seconds). */
+  bool done( const DnsLookup & lookup_r )
+  {
+    struct pollfd pfd;
+    pfd.fd = lookup_r.fd();
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return ::poll( &pfd, 1, 60 * 1000 ) == 1;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(lookup_success)
+{
+  DnsLookup lookup( "localhost" );
+  BOOST_REQUIRE( lookup.pending() );
+  BOOST_REQUIRE( done( lookup ) );
+  BOOST_CHECK_EQUAL( lookup.result(), 0 );
+  BOOST_CHECK( ! lookup.pending() );
+  BOOST_CHECK_EQUAL( lookup.fd(), -1 );
+  BOOST_CHECK_EQUAL( lookup.result(), 0 );	// remembered
+}
+
+BOOST_AUTO_TEST_CASE(lookup_failure)
+{
+  // RFC 6761: names in .invalid never resolve
+  DnsLookup lookup( "no-such-host.invalid" );
+  BOOST_REQUIRE( lookup.pending() );
+  BOOST_REQUIRE( done( lookup ) );
+  int err = lookup.result();
+  BOOST_CHECK( err != 0 );
+  BOOST_CHECK( err != EAI_CANCELED );
+  BOOST_CHECK_EQUAL( lookup.result(), err );
+}
+
+BOOST_AUTO_TEST_CASE(lookup_cancel)
+{
+  {
+    DnsLookup lookup( "localhost" );
+    BOOST_REQUIRE( lookup.pending() );
+    lookup.cancel();
+    BOOST_CHECK( ! lookup.pending() );
+    BOOST_CHECK_EQUAL( lookup.result(), EAI_CANCELED );
+  }
+  {
+    // Lookups destroyed while pending clean up after themselves,
+    // and their late notification must not harm the process.
+    for ( unsigned i = 0; i < 32; ++i )
+      DnsLookup lookup( i % 2 ? "localhost" : "no-such-host.invalid" );
+  }
+  // the resolver is still usable
+  DnsLookup lookup( "localhost" );
+  BOOST_REQUIRE( lookup.pending() );
+  BOOST_REQUIRE( done( lookup ) );
+  BOOST_CHECK_EQUAL( lookup.result(), 0 );
+}
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <boost/test/auto_unit_test.hpp>
+
+#include "zypp/media/MediaBlockList.h"
+#include "zypp/base/String.h"
+#include "zypp/Digest.h"
+#include "zypp/TmpPath.h"
+#include "zypp/PathInfo.h"
+
+using namespace std;
+using namespace zypp;
+using namespace zypp::media;
+
+namespace
+{
+  const size_t blksize = 4096;
+
+  /** Reproducible pseudo random bytes. */
+  struct Random
+  {
+    Random( unsigned seed_r ) : _s( seed_r ) {}
+    unsigned char operator()()
+    {
+      _s ^= _s << 13;
+      _s ^= _s >> 17;
+      _s ^= _s << 5;
+      return _s;
+    }
+    unsigned _s;
+  };
+
+  string randomData( size_t len_r, unsigned seed_r )
+  {
+    Random rnd( seed_r );
+    string ret( len_r, '\0' );
+    for ( size_t i = 0; i < len_r; ++i )
+      ret[i] = rnd();
+    return ret;
+  }
+
+  void writeFile( const Pathname & file_r, const string & data_r )
+  {
+    ofstream out( file_r.c_str(), ios::binary );
+    out.write( data_r.data(), data_r.size() );
+  }
+
+  string readFile( const Pathname & file_r )
+  {
+    ifstream in( file_r.c_str(), ios::binary );
+    return string( istreambuf_iterator<char>( in ), istreambuf_iterator<char>() );
+  }
+
+  /** Blocklist of \a data_r like a metalink file describes it (SHA1 truncated
+   * to \a chksumlen_r, zsync rsums of \a rsumlen_r bytes or none).
+   */
+  MediaBlockList blockList( const string & data_r, int chksumlen_r, int rsumlen_r )
+  {
+    MediaBlockList bl( data_r.size() );
+    for ( size_t off = 0; off < data_r.size(); off += blksize )
+    {
+      size_t size = data_r.size() - off < blksize ? data_r.size() - off : blksize;
+      size_t blkno = bl.addBlock( off, size );
+
+      Digest dig;
+      dig.create( "SHA1" );
+      dig.update( data_r.data() + off, size );
+      vector<unsigned char> sum( dig.digestVector() );
+      bl.setChecksum( blkno, "SHA1", chksumlen_r, &sum[0] );
+
+      if ( rsumlen_r )
+      {
+        string block( data_r, off, size );
+        block.resize( blksize, '\0' );	// zsync pads the last block
+        unsigned int rs = bl.updateRsum( 0, block.data(), blksize );
+        if ( rsumlen_r < 4 )
+          rs &= ( 1U << ( 8 * rsumlen_r ) ) - 1;
+        bl.setRsum( blkno, rsumlen_r, rs, blksize );
+      }
+    }
+    return bl;
+  }
+
+  struct Result
+  {
+    string blocks;	///< the blocks still to download
+    string file;	///< the reused blocks written
+  };
+
+  Result reuse( const string & target_r, const string & seed_r, int chksumlen_r, int rsumlen_r, unsigned threads_r )
+  {
+    filesystem::TmpFile seed;
+    filesystem::TmpFile out;
+    writeFile( seed.path(), seed_r );
+
+    setenv( "ZYPP_MEDIA_BLOCKLIST_SCANTHREADS", str::numstring( threads_r ).c_str(), 1 );
+    MediaBlockList bl( blockList( target_r, chksumlen_r, rsumlen_r ) );
+    FILE * wfp = fopen( out.path().c_str(), "w" );
+    BOOST_REQUIRE( wfp );
+    bl.reuseBlocks( wfp, seed.path().asString() );
+    fclose( wfp );
+    unsetenv( "ZYPP_MEDIA_BLOCKLIST_SCANTHREADS" );
+
+    Result ret;
+    ret.blocks = bl.asString();
+    ret.file = readFile( out.path() );
+    return ret;
+  }
+
+  /** Threaded and serial scan must leave the same blocks and write the same file. */
+  void checkSame( const string & target_r, const string & seed_r, int chksumlen_r, int rsumlen_r, bool reused_r )
+  {
+    Result serial( reuse( target_r, seed_r, chksumlen_r, rsumlen_r, 1 ) );
+    for ( unsigned threads : { 2U, 3U, 7U } )
+    {
+      Result threaded( reuse( target_r, seed_r, chksumlen_r, rsumlen_r, threads ) );
+      BOOST_CHECK_EQUAL( threaded.blocks, serial.blocks );
+      BOOST_CHECK( threaded.file == serial.file );
+    }
+    // anything reused must be the targets data
+    BOOST_CHECK_EQUAL( ! serial.file.empty(), reused_r );
+    for ( size_t i = 0; i < serial.file.size(); ++i )
+    {
+      if ( serial.file[i] != '\0' && serial.file[i] != target_r[i] )
+      {
+        BOOST_ERROR( "reused data differ at offset " << i );
+        break;
+      }
+    }
+  }
+} // namespace
+
+BOOST_AUTO_TEST_CASE(reuse_blocks_threaded_same_as_serial)
+{
+  // 300 blocks and a partial last block
+  string target( randomData( 300 * blksize + 1234, 42 ) );
+
+  // The seed holds shifted and partly damaged pieces of the target and
+  // ends with its last (partial) block.
+  string seed( randomData( 777, 4711 ) );
+  seed += target.substr( 0, 100 * blksize );
+  seed += randomData( 3 * blksize + 5, 815 );
+  seed += target.substr( 120 * blksize + 17, 150 * blksize );
+  seed += target.substr( 299 * blksize );
+
+  checkSame( target, seed, 20, 4, true );	// sha1, zsync rsum
+  checkSame( target, seed, 8, 4, true );	// short checksum: sequence matching
+  checkSame( target, seed, 20, 2, true );	// short rsum: many candidates
+
+  {
+    // the last partial block is reused
+    Result serial( reuse( target, seed, 20, 4, 1 ) );
+    BOOST_CHECK( serial.file.size() == target.size() );
+    BOOST_CHECK( serial.file.substr( 300 * blksize ) == target.substr( 300 * blksize ) );
+  }
+
+  // checksums only: blocks at the same offset
+  string damaged( target );
+  for ( size_t off = 0; off < damaged.size(); off += 7 * blksize )
+    damaged[off] ^= 0xff;
+  checkSame( target, damaged, 20, 0, true );
+  checkSame( target, damaged.substr( 0, damaged.size() - 1 ), 20, 0, true );	// last block truncated
+}
+
+BOOST_AUTO_TEST_CASE(reuse_blocks_short_seed)
+{
+  string target( randomData( 20 * blksize + 99, 1 ) );
+
+  // seed shorter than one block
+  string seed( target.substr( 5 * blksize, blksize - 1 ) );
+  checkSame( target, seed, 20, 4, false );
+  checkSame( target, seed, 8, 4, false );
+  checkSame( target, seed, 20, 2, false );
+  checkSame( target, seed, 20, 0, false );
+
+  // but long enough for a target of one partial block
+  string small( target.substr( 0, 1000 ) );
+  checkSame( small, small, 20, 4, true );
+  checkSame( small, small, 20, 0, true );
+}
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <boost/test/auto_unit_test.hpp>
+
+#include "zypp/media/OrderedFileDigest_p.h"
+#include "zypp/media/MediaBlockList.h"
+#include "zypp/Digest.h"
+#include "zypp/TmpPath.h"
+
+using namespace std;
+using namespace zypp;
+using namespace zypp::media;
+
+namespace
+{
+  const size_t blksize = 4096;
+
+  string testData( size_t len_r )
+  {
+    string ret( len_r, '\0' );
+    unsigned s = 4711;
+    for ( size_t i = 0; i < len_r; ++i )
+    {
+      s = s * 1103515245 + 12345;
+      ret[i] = s >> 16;
+    }
+    return ret;
+  }
+
+  vector<unsigned char> oneShot( const string & data_r )
+  {
+    Digest dig;
+    dig.create( "SHA256" );
+    dig.update( data_r.data(), data_r.size() );
+    return dig.digestVector();
+  }
+
+  void writeAt( FILE * fp_r, off_t off_r, const string & data_r )
+  {
+    BOOST_REQUIRE( fseeko( fp_r, off_r, SEEK_SET ) == 0 );
+    BOOST_REQUIRE( fwrite( data_r.data(), data_r.size(), 1, fp_r ) == 1 );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(out_of_order_with_retry)
+{
+  // 50 full blocks and a partial last one
+  string data( testData( 50 * blksize + 777 ) );
+  vector<unsigned char> sum( oneShot( data ) );
+
+  // blocks 3, 4 and 20 are reused from an old file, so they are
+  // already in place and not part of the blocklist
+  MediaBlockList blklist( data.size() );
+  for ( size_t off = 0; off < data.size(); off += blksize )
+  {
+    size_t blk = off / blksize;
+    if ( blk == 3 || blk == 4 || blk == 20 )
+      continue;
+    blklist.addBlock( off, min( blksize, data.size() - off ) );
+  }
+  blklist.setFileChecksum( "SHA256", sum.size(), &sum[0] );
+
+  filesystem::TmpFile tmp;
+  FILE * fp = fopen( tmp.path().c_str(), "w+" );
+  BOOST_REQUIRE( fp );
+  writeAt( fp, 3 * blksize, data.substr( 3 * blksize, 2 * blksize ) );
+  writeAt( fp, 20 * blksize, data.substr( 20 * blksize, blksize ) );
+
+  OrderedFileDigest dig( fp, &blklist );
+  BOOST_REQUIRE( dig.valid() );
+
+  // blocks complete in a scrambled order
+  vector<size_t> order;
+  for ( size_t i = 0; i < blklist.numBlocks(); ++i )
+    order.push_back( i );
+  for ( size_t i = 0; i < order.size(); ++i )
+    swap( order[i], order[( i * 7 + 3 ) % order.size()] );
+  if ( order[0] == 0 )
+    swap( order[0], order[order.size() / 2] );
+
+  // the block done last but one is first written broken (checksum error) and retried
+  size_t retried = order[order.size() - 2];
+  MediaBlock rblk( blklist.getBlock( retried ) );
+  writeAt( fp, rblk.off, string( rblk.size, 'X' ) );
+
+  vector<bool> done( blklist.numBlocks(), false );
+  off_t lastoff = 0;
+  for ( size_t blkno : order )
+  {
+    MediaBlock blk( blklist.getBlock( blkno ) );
+    writeAt( fp, blk.off, data.substr( blk.off, blk.size ) );
+    dig.blockdone( blkno );
+    done[blkno] = true;
+    if ( blkno == order[0] )
+      dig.blockdone( blkno );	// reported twice: no-op
+
+    // hashed up to the first block not yet done, never beyond
+    off_t expect = data.size();
+    for ( size_t i = 0; i < done.size(); ++i )
+    {
+      if ( ! done[i] )
+      {
+        expect = blklist.getBlock( i ).off;
+        break;
+      }
+    }
+    BOOST_CHECK_EQUAL( dig.offset(), expect );
+    BOOST_CHECK( dig.offset() >= lastoff );
+    lastoff = dig.offset();
+  }
+  fclose( fp );
+
+  BOOST_CHECK( dig.valid() );
+  BOOST_CHECK_EQUAL( dig.offset(), off_t(data.size()) );
+  BOOST_CHECK( dig.digest().digestVector() == sum );
+}
+
+BOOST_AUTO_TEST_CASE(no_file_checksum)
+{
+  MediaBlockList blklist( blksize );
+  blklist.addBlock( 0, blksize );
+  filesystem::TmpFile tmp;
+  FILE * fp = fopen( tmp.path().c_str(), "w+" );
+  BOOST_REQUIRE( fp );
+  OrderedFileDigest dig( fp, &blklist );
+  BOOST_CHECK( ! dig.valid() );
+  dig.blockdone( 0 );
+  BOOST_CHECK_EQUAL( dig.offset(), off_t(0) );
+  fclose( fp );
+}
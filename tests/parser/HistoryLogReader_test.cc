@@ -1,6 +1,7 @@
 #include "TestSetup.h"
 #include "zypp/parser/HistoryLogReader.h"
 #include "zypp/parser/ParseException.h"
+#include "zypp/TmpPath.h"
 
 using namespace zypp;
 
@@ -27,6 +28,9 @@ BOOST_AUTO_TEST_CASE(basic)
 
   BOOST_CHECK_EQUAL( parser.ignoreInvalidItems(), false );
   BOOST_CHECK_THROW( parser.readAll(), parser::ParseException );
+  try { parser.readAll(); }
+  catch ( const parser::ParseException & excpt )
+  { BOOST_CHECK_EQUAL( excpt.msg(), "Error in history log on line #11" ); }
 
   parser.setIgnoreInvalidItems( true );
   BOOST_CHECK_EQUAL( parser.ignoreInvalidItems(), true );
@@ -48,3 +52,65 @@ BOOST_AUTO_TEST_CASE(basic)
   HistoryLogDataInstall::Ptr p = dynamic_pointer_cast<HistoryLogDataInstall>( history[1] );
   BOOST_CHECK_EQUAL( p->userdata(), "trans|ID" ); // properly (un)escaped?
 }
+
+BOOST_AUTO_TEST_CASE(actionfilter)
+{
+  std::vector<HistoryLogData::Ptr> history;
+  parser::HistoryLogReader parser( TESTS_SRC_DIR "/parser/HistoryLogReader_test.dat",
+				   parser::HistoryLogReader::IGNORE_INVALID_ITEMS,
+    [&history]( HistoryLogData::Ptr ptr )->bool {
+      history.push_back( ptr );
+      return true;
+    } );
+
+  parser.addActionFilter( HistoryActionID::INSTALL );
+  parser.readAll();
+  BOOST_CHECK_EQUAL( history.size(), 2 );
+
+  history.clear();
+  parser.addActionFilter( HistoryActionID::REMOVE );
+  parser.readAll();
+  BOOST_CHECK_EQUAL( history.size(), 4 );
+
+  history.clear();
+  parser.clearActionFilter();
+  parser.readAll();
+  BOOST_CHECK_EQUAL( history.size(), 8 );
+}
+
+BOOST_AUTO_TEST_CASE(daterange)
+{
+  filesystem::TmpFile log;
+  {
+    std::ofstream str( log.path().c_str() );
+    str << "# header" << endl;
+    for ( unsigned day = 1; day <= 28; ++day )
+    {
+      str << str::form( "2018-02-%02u 10:00:00|install|pkg%u|1-1|noarch||repo|0123456789abcdef|", day, day ) << endl;
+      str << "# some rpm output" << endl;
+      str << str::form( "2018-02-%02u 12:00:00|remove |pkg%u|1-1|noarch||", day, day ) << endl;
+    }
+  }
+
+  std::vector<HistoryLogData::Ptr> history;
+  parser::HistoryLogReader parser( log.path(), parser::HistoryLogReader::Options(),
+    [&history]( HistoryLogData::Ptr ptr )->bool {
+      history.push_back( ptr );
+      return true;
+    } );
+
+  parser.readFromTo( Date( "2018-02-10", "%Y-%m-%d" ), Date( "2018-02-12", "%Y-%m-%d" ) );
+  BOOST_REQUIRE_EQUAL( history.size(), 4 );
+  BOOST_CHECK_EQUAL( history.front()->date(), Date( "2018-02-10 10:00:00", HISTORY_LOG_DATE_FORMAT ) );
+  BOOST_CHECK_EQUAL( history.back()->date(), Date( "2018-02-11 12:00:00", HISTORY_LOG_DATE_FORMAT ) );
+
+  history.clear();
+  parser.readFrom( Date( "2018-02-27 10:00:00", HISTORY_LOG_DATE_FORMAT ) );
+  BOOST_REQUIRE_EQUAL( history.size(), 3 );
+  BOOST_CHECK_EQUAL( history.front()->date(), Date( "2018-02-27 12:00:00", HISTORY_LOG_DATE_FORMAT ) );
+
+  history.clear();
+  parser.addActionFilter( HistoryActionID::REMOVE );
+  parser.readFromTo( Date( "2018-02-01", "%Y-%m-%d" ), Date( "2018-03-01", "%Y-%m-%d" ) );
+  BOOST_CHECK_EQUAL( history.size(), 28 );
+}
@@ -0,0 +1,71 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include <boost/test/auto_unit_test.hpp>
+
+#include "zypp/base/Logger.h"
+#include "zypp/PathInfo.h"
+#include "zypp/TmpPath.h"
+#include "zypp/repo/ContentStore.h"
+
+using std::cout;
+using std::endl;
+using namespace zypp;
+using namespace zypp::repo;
+
+/** Create \a file_r containing \a content_r; returns its md5 checksum. */
+CheckSum mkfile( const Pathname & file_r, const std::string & content_r )
+{
+  filesystem::assert_dir( file_r.dirname() );
+  std::ofstream( file_r.c_str() ) << content_r;
+  return CheckSum::md5( filesystem::md5sum( file_r ) );
+}
+
+BOOST_AUTO_TEST_CASE(disabled)
+{
+  ContentStore store;
+  BOOST_CHECK( ! store.enabled() );
+  BOOST_CHECK( store.storedFile( CheckSum::md5( "d41d8cd98f00b204e9800998ecf8427e" ) ).empty() );
+  BOOST_CHECK_EQUAL( store.purge(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE(storedFile)
+{
+  ContentStore store( "/store" );
+  BOOST_CHECK_EQUAL( store.storedFile( CheckSum::md5( "D41D8CD98F00B204E9800998ECF8427E" ) ),
+                     Pathname( "/store/md5/d4/d41d8cd98f00b204e9800998ecf8427e" ) );
+  BOOST_CHECK( store.storedFile( CheckSum() ).empty() );
+  BOOST_CHECK( store.storedFile( CheckSum( "md5", "../../../etc/passwd" ) ).empty() );
+}
+
+BOOST_AUTO_TEST_CASE(add_provide_purge)
+{
+  filesystem::TmpDir tmp;
+  ContentStore store( tmp.path() / "store" );
+
+  Pathname orig( tmp.path() / "repo1" / "primary.xml.gz" );
+  CheckSum sum( mkfile( orig, "primary" ) );
+  BOOST_CHECK( ! store.contains( sum ) );
+  BOOST_CHECK( ! store.provide( sum, tmp.path() / "repo2" / "primary.xml.gz" ) );
+
+  BOOST_CHECK( store.add( sum, orig ) );
+  BOOST_CHECK( store.contains( sum ) );
+  BOOST_CHECK_EQUAL( PathInfo( orig ).nlink(), 2 );
+
+  // provide hardlinks (replacing an existing file)
+  Pathname dest( tmp.path() / "repo2" / "primary.xml.gz" );
+  mkfile( dest, "outdated" );
+  BOOST_CHECK( store.provide( sum, dest ) );
+  BOOST_CHECK_EQUAL( PathInfo( dest ).ino(), PathInfo( orig ).ino() );
+  BOOST_CHECK_EQUAL( filesystem::md5sum( dest ), sum.checksum() );
+  BOOST_CHECK( store.provide( sum, dest ) );	// already in place
+
+  // referenced files are kept
+  BOOST_CHECK_EQUAL( store.purge(), 0 );
+  filesystem::unlink( orig );
+  BOOST_CHECK_EQUAL( store.purge(), 0 );
+  filesystem::unlink( dest );
+  BOOST_CHECK_EQUAL( store.purge(), 1 );
+  BOOST_CHECK( ! store.contains( sum ) );
+}
@@ -0,0 +1,143 @@
+#include <utime.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <boost/test/auto_unit_test.hpp>
+
+#include "zypp/base/NonCopyable.h"
+#include "zypp/base/String.h"
+#include "zypp/PathInfo.h"
+#include "zypp/TmpPath.h"
+#include "zypp/parser/RepoFileReader.h"
+#include "zypp/parser/ParseException.h"
+#include "zypp/repo/RepoDefinitionIndex.h"
+
+using std::endl;
+using namespace zypp;
+using namespace boost::unit_test;
+using repo::RepoDefinitionIndex;
+
+static const std::string oss_repo = "[oss]\n"
+"name=oss\n"
+"enabled=1\n"
+"baseurl=http://download.opensuse.org/repo/oss/\n"
+"http://download.opensuse.org/repo/oss/2\n"
+"type=yast2\n";
+
+static const std::string update_repo = "[update]\n"
+"name=update\n"
+"enabled=0\n"
+"baseurl=http://download.opensuse.org/update/\n";
+
+struct RepoCollector : private base::NonCopyable
+{
+  bool collect( const RepoInfo &repo )
+  {
+    repos.push_back(repo);
+    return true;
+  }
+
+  RepoInfoList repos;
+};
+
+void writeFile( const Pathname & file_r, const std::string & content_r )
+{
+  std::ofstream( file_r.c_str() ) << content_r;
+  // Too recent files are not trusted, so move the mtime back.
+  struct utimbuf times = { 1000000000, 1000000000 };
+  ::utime( file_r.c_str(), &times );
+  ::utime( file_r.dirname().c_str(), &times );
+}
+
+bool isRepoFile( const Pathname & file_r )
+{ return file_r.extension() == ".repo"; }
+
+RepoInfoList readRepos( const RepoDefinitionIndex::FileList & files_r )
+{
+  RepoCollector collector;
+  for ( const auto & file : files_r )
+  {
+    BOOST_REQUIRE( file.second );
+    parser::RepoFileReader( *file.second, bind( &RepoCollector::collect, &collector, _1 ) );
+  }
+  return collector.repos;
+}
+
+std::string asString( const RepoDefinitionIndex & index_r )
+{ return str::Str() << index_r; }
+
+BOOST_AUTO_TEST_CASE(record_and_replay)
+{
+  filesystem::TmpDir tmp;
+  Pathname dir( tmp.path()/"repos.d" );
+  filesystem::assert_dir( dir );
+  writeFile( dir/"oss.repo", oss_repo );
+  writeFile( dir/"update.repo", update_repo );
+  writeFile( dir/"README", "garbage" );
+
+  RepoDefinitionIndex::FileList files;
+  {
+    RepoDefinitionIndex index( tmp.path()/"index" );
+    BOOST_REQUIRE( index.files( dir, isRepoFile, files ) );
+    BOOST_CHECK( asString( index ).find( "parsed 2, cached 0" ) != std::string::npos );
+    index.save();
+  }
+  BOOST_REQUIRE_EQUAL( files.size(), 2 );
+  BOOST_CHECK_EQUAL( files[0].first, dir/"oss.repo" );
+
+  RepoInfoList repos( readRepos( files ) );
+  BOOST_REQUIRE_EQUAL( repos.size(), 2 );
+  BOOST_CHECK_EQUAL( repos.front().alias(), "oss" );
+  BOOST_CHECK_EQUAL( repos.front().baseUrlsSize(), 2 );	// multiline baseurl
+  BOOST_CHECK_EQUAL( repos.front().filepath(), dir/"oss.repo" );
+  BOOST_CHECK_EQUAL( repos.back().enabled(), false );
+
+  // served from the snapshot
+  {
+    RepoDefinitionIndex index( tmp.path()/"index" );
+    BOOST_REQUIRE( index.files( dir, isRepoFile, files ) );
+    BOOST_CHECK( asString( index ).find( "parsed 0, cached 2" ) != std::string::npos );
+  }
+  repos = readRepos( files );
+  BOOST_REQUIRE_EQUAL( repos.size(), 2 );
+  BOOST_CHECK_EQUAL( repos.front().baseUrlsSize(), 2 );
+
+  // changed and new files are parsed again
+  writeFile( dir/"update.repo", update_repo + "priority=42\n" );
+  writeFile( dir/"extra.repo", "[extra]\nbaseurl=http://example.com/\n" );
+  {
+    RepoDefinitionIndex index( tmp.path()/"index" );
+    BOOST_REQUIRE( index.files( dir, isRepoFile, files ) );
+    BOOST_CHECK( asString( index ).find( "parsed 2, cached 1" ) != std::string::npos );
+  }
+  repos = readRepos( files );
+  BOOST_REQUIRE_EQUAL( repos.size(), 3 );
+  BOOST_CHECK_EQUAL( repos.back().priority(), 42 );
+
+  // missing directory
+  BOOST_CHECK( ! RepoDefinitionIndex( tmp.path()/"index" ).files( tmp.path()/"nodir", isRepoFile, files ) );
+}
+
+BOOST_AUTO_TEST_CASE(replay_garbage)
+{
+  filesystem::TmpDir tmp;
+  writeFile( tmp.path()/"bad.repo", "[bad]\nno equal sign here\n" );
+  RepoDefinitionIndex index( tmp.path()/"index" );
+  RepoDefinitionIndex::FileList files;
+  BOOST_REQUIRE( index.files( tmp.path(), isRepoFile, files ) );
+  BOOST_REQUIRE_EQUAL( files.size(), 1 );
+  BOOST_REQUIRE( files[0].second );
+  RepoCollector collector;
+  BOOST_CHECK_THROW( parser::RepoFileReader( *files[0].second, bind( &RepoCollector::collect, &collector, _1 ) ),
+		     parser::ParseException );
+}
+
+BOOST_AUTO_TEST_CASE(invalid_snapshot)
+{
+  filesystem::TmpDir tmp;
+  writeFile( tmp.path()/"index", "ZYPPRDI1 but truncated" );
+  RepoDefinitionIndex index( tmp.path()/"index" );
+  RepoDefinitionIndex::FileList files;
+  BOOST_CHECK( index.files( tmp.path(), isRepoFile, files ) );
+  BOOST_CHECK( files.empty() );
+}
@@ -0,0 +1,166 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <boost/test/auto_unit_test.hpp>
+
+#include <solv/solvversion.h>
+
+#include "zypp/base/Logger.h"
+#include "zypp/PathInfo.h"
+#include "zypp/TmpPath.h"
+#include "zypp/ExternalProgram.h"
+#include "zypp/OnMediaLocation.h"
+#include "zypp/sat/Pool.h"
+#include "zypp/sat/LookupAttr.h"
+#include "zypp/repo/SolvFileBuilder.h"
+
+using std::cout;
+using std::endl;
+using namespace zypp;
+using namespace zypp::repo;
+
+#define DATADIR (Pathname(TESTS_SRC_DIR) + "/repo")
+
+/** Build the solv-file, load it and check it contains \a name_r. */
+void checkBuild( const RepoType & type_r, const Pathname & metadata_r, const std::string & name_r )
+{
+  filesystem::TmpDir tmp;
+  Pathname solvfile( tmp.path() / "solv" );
+
+  SolvFileBuilder( type_r, metadata_r ).build( solvfile );
+  BOOST_REQUIRE( PathInfo( solvfile ).isFile() );
+  BOOST_REQUIRE( PathInfo( solvfile.extend( ".idx" ) ).isFile() );
+
+  Repository repo( sat::Pool::instance().addRepoSolv( solvfile, type_r.asString() ) );
+  BOOST_CHECK( ! repo.solvablesEmpty() );
+  BOOST_CHECK_EQUAL( sat::LookupRepoAttr( sat::SolvAttr::repositoryToolVersion, repo ).begin().asString(), LIBSOLV_TOOLVERSION );
+
+  bool found = false;
+  for ( const auto & solv : repo.solvables() )
+  {
+    if ( solv.name() == name_r )
+    {
+      found = true;
+      break;
+    }
+  }
+  BOOST_CHECK_MESSAGE( found, name_r << " in " << metadata_r );
+
+  // solv.idx lists name, edition and arch of each solvable
+  std::ifstream idx( solvfile.extend( ".idx" ).c_str() );
+  std::string line;
+  found = false;
+  while ( std::getline( idx, line ) )
+  {
+    if ( line.compare( 0, name_r.size()+1, name_r+'\t' ) == 0 )
+    {
+      found = true;
+      break;
+    }
+  }
+  BOOST_CHECK_MESSAGE( found, name_r << " in solv.idx" );
+
+  repo.eraseFromPool();
+}
+
+BOOST_AUTO_TEST_CASE(build_rpmmd)
+{
+  checkBuild( RepoType::RPMMD, DATADIR / "yum/data/10.2-updates-subset", "glabels" );
+}
+
+BOOST_AUTO_TEST_CASE(build_susetags)
+{
+  checkBuild( RepoType::YAST2, DATADIR / "susetags/data/stable-x86-subset", "kdelibs3" );
+}
+
+namespace
+{
+  const Pathname repo2solv( "/usr/bin/repo2solv" );
+
+  /** The solvables in \a solvfile_r, sorted. */
+  std::vector<std::string> solvContent( const Pathname & solvfile_r )
+  {
+    std::vector<std::string> ret;
+    Repository repo( sat::Pool::instance().addRepoSolv( solvfile_r, "compare" ) );
+    for ( const sat::Solvable & solv : repo.solvables() )
+      ret.push_back( str::Str() << solv.ident() << "-" << solv.edition() << "." << solv.arch()
+                                << " " << solv.vendor() << " " << solv.summary()
+                                << " " << solv.lookupLocation().filename() << " " << solv.lookupLocation().checksum()
+                                << " P" << solv.provides() << " R" << solv.requires()
+                                << " C" << solv.conflicts() << " O" << solv.obsoletes() );
+    std::sort( ret.begin(), ret.end() );
+    ret.insert( ret.begin(), "toolversion " + sat::LookupRepoAttr( sat::SolvAttr::repositoryToolVersion, repo ).begin().asString() );
+    repo.eraseFromPool();
+    return ret;
+  }
+
+  /** The lines of \a file_r, sorted. */
+  std::vector<std::string> sortedLines( const Pathname & file_r )
+  {
+    std::vector<std::string> ret;
+    std::ifstream in( file_r.c_str() );
+    for ( std::string line; std::getline( in, line ); )
+      ret.push_back( line );
+    std::sort( ret.begin(), ret.end() );
+    return ret;
+  }
+
+  /** The solv-file and solv.idx must be the same as <tt>repo2solv -X -A</tt> and \ref sat::updateSolvFileIndex produce. */
+  void checkLikeRepo2solv( const RepoType & type_r, const Pathname & metadata_r )
+  {
+    if ( ! PathInfo( repo2solv ).isX() )
+    {
+      BOOST_TEST_MESSAGE( "No " << repo2solv << ": skipping" );
+      return;
+    }
+
+    filesystem::TmpDir tmp;
+    Pathname ours( tmp.path() / "ours" );
+    Pathname theirs( tmp.path() / "theirs" );
+
+    SolvFileBuilder( type_r, metadata_r ).build( ours );
+
+    ExternalProgram::Arguments cmd;
+    cmd.push_back( repo2solv.asString() );
+    cmd.push_back( "-o" );
+    cmd.push_back( theirs.asString() );
+    cmd.push_back( "-X" );
+    cmd.push_back( "-A" );
+    if ( type_r == RepoType::RPMPLAINDIR )
+      cmd.push_back( "-R" );
+    cmd.push_back( metadata_r.asString() );
+    ExternalProgram prog( cmd, ExternalProgram::Stderr_To_Stdout );
+    for ( std::string output( prog.receiveLine() ); output.length(); output = prog.receiveLine() )
+      BOOST_TEST_MESSAGE( output );
+    BOOST_REQUIRE_EQUAL( prog.close(), 0 );
+    sat::updateSolvFileIndex( theirs );
+
+    std::vector<std::string> expected( solvContent( theirs ) );
+    std::vector<std::string> result( solvContent( ours ) );
+    BOOST_CHECK( expected.size() > 1 );
+    BOOST_CHECK_EQUAL_COLLECTIONS( result.begin(), result.end(), expected.begin(), expected.end() );
+
+    expected = sortedLines( theirs.extend( ".idx" ) );
+    result = sortedLines( ours.extend( ".idx" ) );
+    BOOST_CHECK_EQUAL_COLLECTIONS( result.begin(), result.end(), expected.begin(), expected.end() );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(build_rpmmd_like_repo2solv)
+{
+  checkLikeRepo2solv( RepoType::RPMMD, DATADIR / "yum/data/10.2-updates-subset" );
+}
+
+BOOST_AUTO_TEST_CASE(build_susetags_like_repo2solv)
+{
+  checkLikeRepo2solv( RepoType::YAST2, DATADIR / "susetags/data/stable-x86-subset" );
+}
+
+BOOST_AUTO_TEST_CASE(build_unknown_type)
+{
+  filesystem::TmpDir tmp;
+  BOOST_CHECK_THROW( SolvFileBuilder( RepoType::NONE, DATADIR ).build( tmp.path() / "solv" ), Exception );
+}
@@ -0,0 +1,105 @@
+#include "TestSetup.h"
+#include "zypp/PoolQuery.h"
+#include "zypp/sat/detail/SearchIndex.h"
+#include "zypp/sat/detail/PoolImpl.h"
+
+#define BOOST_TEST_MODULE SearchIndex
+
+using sat::detail::SearchIndex;
+
+static TestSetup test( Arch_x86_64 );
+
+BOOST_AUTO_TEST_CASE(init)
+{
+  test.loadRepo( TESTS_SRC_DIR "/data/openSUSE-11.1", "opensuse" );
+  test.loadRepo( TESTS_SRC_DIR "/data/OBS_zypp_svn-11.1", "zyppsvn" );
+}
+
+BOOST_AUTO_TEST_CASE(index_loaded)
+{
+  for ( const Repository & repo : sat::Pool::instance().repos() )
+  {
+    BOOST_CHECK_MESSAGE( sat::detail::PoolMember::myPool().searchIndex( repo.get() ), repo.alias() );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(indexed_attrs)
+{
+  BOOST_CHECK( SearchIndex::indexed( sat::SolvAttr::name ) );
+  BOOST_CHECK( SearchIndex::indexed( sat::SolvAttr::summary ) );
+  BOOST_CHECK( SearchIndex::indexed( sat::SolvAttr::description ) );
+  BOOST_CHECK( ! SearchIndex::indexed( sat::SolvAttr::provides ) );
+  BOOST_CHECK( ! SearchIndex::indexed( sat::SolvAttr::filelist ) );
+}
+
+BOOST_AUTO_TEST_CASE(trigrams)
+{
+  BOOST_CHECK_EQUAL( SearchIndex::trigrams( StrMatcher( "zy", Match::SUBSTRING ) ).size(), 0 );
+  BOOST_CHECK_EQUAL( SearchIndex::trigrams( StrMatcher( "zypp", Match::SUBSTRING ) ).size(), 2 );
+  BOOST_CHECK_EQUAL( SearchIndex::trigrams( StrMatcher( "ZYpp", Match::STRING ) ).size(), 2 );
+  BOOST_CHECK_EQUAL( SearchIndex::trigrams( StrMatcher( "zy*pp", Match::GLOB ) ).size(), 0 );
+  BOOST_CHECK_EQUAL( SearchIndex::trigrams( StrMatcher( "lib*zypp?", Match::GLOB ) ).size(), 3 );
+  BOOST_CHECK_EQUAL( SearchIndex::trigrams( StrMatcher( "lib[z", Match::GLOB ) ).size(), 0 );
+  BOOST_CHECK_EQUAL( SearchIndex::trigrams( StrMatcher( "zypp", Match::REGEX ) ).size(), 0 );
+}
+
+/** Count the solvables whose \a attr_r matches, the hard way. */
+unsigned scan( const sat::SolvAttr & attr_r, const StrMatcher & matcher_r )
+{
+  unsigned ret = 0;
+  for ( const sat::Solvable & solv : sat::Pool::instance().solvables() )
+  {
+    sat::LookupAttr q( attr_r, solv );
+    for_( it, q.begin(), q.end() )
+    {
+      if ( matcher_r.doMatch( it.c_str() ) )
+      {
+	++ret;
+	break;
+      }
+    }
+  }
+  return ret;
+}
+
+BOOST_AUTO_TEST_CASE(same_result_as_scan)
+{
+  struct { const char * str; Match flags; } queries[] = {
+    { "zypp",        Match::SUBSTRING },
+    { "ZYPP",        Match::SUBSTRING | Match::NOCASE },
+    { "lib",         Match::STRINGSTART },
+    { "devel",       Match::STRINGEND },
+    { "libzypp",     Match::STRING },
+    { "*office*",    Match::GLOB },
+    { "k*[0-9]*",    Match::GLOB },
+    { "library",     Match::SUBSTRING | Match::NOCASE },
+    { "no_such_pkg", Match::SUBSTRING },
+  };
+
+  for ( const auto & query : queries )
+  {
+    for ( const sat::SolvAttr & attr : { sat::SolvAttr::name, sat::SolvAttr::summary, sat::SolvAttr::description } )
+    {
+      PoolQuery q;
+      q.addAttribute( attr, query.str );
+      q.setFlags( query.flags );
+      BOOST_CHECK_MESSAGE( q.size() == scan( attr, StrMatcher( query.str, query.flags ) ), attr << " " << query.str );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(pool_order)
+{
+  PoolQuery q;
+  q.addAttribute( sat::SolvAttr::name, "lib" );
+  q.setFlags( Match::SUBSTRING );
+
+  std::vector<sat::Solvable> found( q.begin(), q.end() );
+  std::vector<sat::Solvable> expected;
+  for ( const sat::Solvable & solv : sat::Pool::instance().solvables() )
+  {
+    if ( solv.ident().asString().find( "lib" ) != std::string::npos )
+      expected.push_back( solv );
+  }
+  BOOST_CHECK( found == expected );
+}
@@ -0,0 +1,120 @@
+#include "TestSetup.h"
+#include "zypp/ResPool.h"
+#include "zypp/sat/Transaction.h"
+
+#define BOOST_TEST_MODULE Transaction
+
+static TestSetup test( Arch_x86_64 );
+
+namespace
+{
+  /** Position of \a solv_r in \a trans_r by a linear scan (\c -1 if not found). */
+  int linearFind( const sat::Transaction & trans_r, const sat::Solvable & solv_r )
+  {
+    int pos = 0;
+    for_( it, trans_r.begin(), trans_r.end() )
+    {
+      if ( (*it).satSolvable() == solv_r )
+        return pos;
+      ++pos;
+    }
+    return -1;
+  }
+
+  /** Position of \a it_r in \a trans_r (\c -1 if end). */
+  template <class TIterator>
+  int position( TIterator begin_r, TIterator end_r, TIterator it_r )
+  {
+    if ( it_r == end_r )
+      return -1;
+    return std::distance( begin_r, it_r );
+  }
+
+  /** find() must agree with a linear scan for all solvables in the pool. */
+  void checkFind( sat::Transaction & trans_r )
+  {
+    const sat::Transaction & ctrans( trans_r );
+    unsigned found = 0;
+    for ( const sat::Solvable & solv : sat::Pool::instance().solvables() )
+    {
+      int expected = linearFind( trans_r, solv );
+      BOOST_CHECK_EQUAL( position( ctrans.begin(), ctrans.end(), ctrans.find( solv ) ), expected );
+      BOOST_CHECK_EQUAL( position( trans_r.begin(), trans_r.end(), trans_r.find( solv ) ), expected );
+      if ( expected != -1 )
+        ++found;
+    }
+    BOOST_CHECK_EQUAL( found, trans_r.size() );
+    BOOST_CHECK( ctrans.find( sat::Solvable::noSolvable ) == ctrans.end() );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(init)
+{
+  test.loadTargetRepo( TESTS_SRC_DIR "/data/11.0-update" );
+  test.loadRepo( TESTS_SRC_DIR "/data/openSUSE-11.1" );
+
+  // install every 3rd available and remove every 5th installed package
+  unsigned n = 0;
+  for ( const PoolItem & pi : test.pool() )
+  {
+    if ( ! pi.isKind<Package>() )
+      continue;
+    if ( ( pi.isSystem() && n % 5 == 0 ) || ( ! pi.isSystem() && n % 3 == 0 ) )
+      pi.status().setTransact( true, ResStatus::USER );
+    ++n;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(find_unordered)
+{
+  sat::Transaction trans( sat::Transaction::loadFromPool );
+  BOOST_REQUIRE( trans.valid() );
+  BOOST_REQUIRE( trans.size() > 100 );
+  checkFind( trans );
+}
+
+BOOST_AUTO_TEST_CASE(find_ordered)
+{
+  sat::Transaction trans( sat::Transaction::loadFromPool );
+  BOOST_REQUIRE( trans.order() );
+  checkFind( trans );
+
+  // ordering again is a no-op
+  BOOST_REQUIRE( trans.order() );
+  checkFind( trans );
+}
+
+BOOST_AUTO_TEST_CASE(find_after_stepstage)
+{
+  sat::Transaction trans( sat::Transaction::loadFromPool );
+  BOOST_REQUIRE( trans.order() );
+
+  std::map<sat::detail::IdType,sat::Transaction::StepStage> stages;
+  unsigned n = 0;
+  for_( it, trans.begin(), trans.end() )
+  {
+    sat::Transaction::StepStage stage( n % 3 == 0 ? sat::Transaction::STEP_DONE
+                                     : n % 3 == 1 ? sat::Transaction::STEP_ERROR
+                                                  : sat::Transaction::STEP_TODO );
+    (*it).stepStage( stage );
+    stages[(*it).satSolvable().id()] = stage;
+    ++n;
+  }
+  checkFind( trans );
+
+  // the stage is found via find() and via iteration
+  for ( const auto & p : stages )
+  {
+    sat::Transaction::const_iterator it( trans.find( sat::Solvable( p.first ) ) );
+    BOOST_REQUIRE( it != trans.end() );
+    BOOST_CHECK_EQUAL( (*it).stepStage(), p.second );
+  }
+  for_( it, trans.begin(), trans.end() )
+    BOOST_CHECK_EQUAL( (*it).stepStage(), stages[(*it).satSolvable().id()] );
+
+  // reset one step
+  sat::Transaction::iterator first( trans.begin() );
+  (*first).stepStage( sat::Transaction::STEP_TODO );
+  BOOST_CHECK_EQUAL( (*trans.find( (*first).satSolvable() )).stepStage(), sat::Transaction::STEP_TODO );
+  checkFind( trans );
+}
@@ -0,0 +1,85 @@
+#include <stdlib.h>
+#include <fstream>
+#include <functional>
+#include <fcntl.h>
+#include <unistd.h>
+#include <boost/test/auto_unit_test.hpp>
+
+#include "zypp/ExternalProgram.h"
+#include "zypp/TmpPath.h"
+#include "zypp/base/String.h"
+
+using std::endl;
+using namespace zypp;
+
+/** Run \a argv_r and return its output (stdout and stderr). */
+std::string run( ExternalProgram::Arguments argv_r, const ExternalProgram::Environment & env_r = ExternalProgram::Environment(), int * status_r = nullptr )
+{
+  ExternalProgram prog( argv_r, env_r, ExternalProgram::Stderr_To_Stdout );
+  std::string ret;
+  for ( std::string line( prog.receiveLine() ); line.length(); line = prog.receiveLine() )
+    ret += line;
+  int status = prog.close();
+  if ( status_r )
+    *status_r = status;
+  return ret;
+}
+
+/** The same results whether spawned or forked. */
+void both( const std::function<void()> & test_r )
+{
+  ::unsetenv( "ZYPP_EXEC_FORK" );
+  test_r();
+  ::setenv( "ZYPP_EXEC_FORK", "1", 1 );
+  test_r();
+  ::unsetenv( "ZYPP_EXEC_FORK" );
+}
+
+BOOST_AUTO_TEST_CASE(output_and_status)
+{
+  both( [](){
+    int status = -1;
+    BOOST_CHECK_EQUAL( run( { "sh", "-c", "echo out; echo err >&2; exit 3" }, ExternalProgram::Environment(), &status ), "out\nerr\n" );
+    BOOST_CHECK_EQUAL( status, 3 );
+  } );
+}
+
+BOOST_AUTO_TEST_CASE(exec_error)
+{
+  both( [](){
+    int status = -1;
+    run( { "/no/such/program" }, ExternalProgram::Environment(), &status );
+    BOOST_CHECK_EQUAL( status, 129 );
+  } );
+}
+
+BOOST_AUTO_TEST_CASE(environment)
+{
+  both( [](){
+    ExternalProgram::Environment env;
+    env["ZYPP_TEST_VAR"] = "value";
+    BOOST_CHECK_EQUAL( run( { "sh", "-c", "echo $ZYPP_TEST_VAR" }, env ), "value\n" );
+  } );
+}
+
+BOOST_AUTO_TEST_CASE(redirect_and_chdir)
+{
+  both( [](){
+    filesystem::TmpDir dir;
+    Pathname out( dir.path() / "out" );
+    BOOST_CHECK_EQUAL( run( { "#/tmp", "</dev/null", ">"+out.asString(), "sh", "-c", "pwd; cat" } ), "" );
+    std::ifstream in( out.c_str() );
+    std::string line;
+    std::getline( in, line );
+    BOOST_CHECK_EQUAL( line, "/tmp" );
+  } );
+}
+
+BOOST_AUTO_TEST_CASE(fds_closed)
+{
+  both( [](){
+    int fd = ::open( "/dev/null", O_RDONLY );	// no O_CLOEXEC
+    BOOST_CHECK_EQUAL( run( { "sh", "-c", "test -e /proc/self/fd/" + str::numstring( fd ) + " && echo open || echo closed" } ), "closed\n" );
+    ::close( fd );
+  } );
+}
@@ -2,6 +2,9 @@
 
 #include "zypp/MediaSetAccess.h"
 #include "zypp/Fetcher.h"
+#include "zypp/FileChecker.h"
+#include "zypp/Digest.h"
+#include "zypp/repo/ContentStore.h"
 
 #include "WebServer.h"
 
@@ -218,6 +221,67 @@ BOOST_AUTO_TEST_CASE(fetcher_simple)
     }
 }
 
+BOOST_AUTO_TEST_CASE(fetcher_contentstore_wrong_digest)
+{
+  // The user accepts the wrong digest, but the file must not go into the store.
+  struct AcceptWrongDigest : public callback::ReceiveReport<DigestReport>
+  {
+    virtual bool askUserToAcceptWrongDigest( const Pathname &, const std::string &, const std::string & )
+    { return true; }
+  } receiver;
+  receiver.connect();
+
+  MediaSetAccess media( (DATADIR).asUrl(), "/" );
+  filesystem::TmpDir store;
+  filesystem::TmpDir dest;
+  CheckSum wrong( CheckSum::sha1("f1d2d2f924e986ac86fdf7b36c94bcdf32beec16") );
+  OnMediaLocation loc("/complexdir/subdir1/subdir1-file1.txt");
+  loc.setChecksum( wrong );
+
+  Fetcher fetcher;
+  fetcher.setContentStore( store.path() );
+  fetcher.enqueue( loc, ChecksumFileChecker( wrong ) );
+  fetcher.start( dest.path(), media );
+  BOOST_CHECK( PathInfo(dest.path() + "/complexdir/subdir1/subdir1-file1.txt").isExist() );
+  BOOST_CHECK( ! repo::ContentStore( store.path() ).contains( wrong ) );
+
+  // the correct digest is stored
+  filesystem::TmpDir dest2;
+  loc.setChecksum( CheckSum::sha1("f1d2d2f924e986ac86fdf7b36c94bcdf32beec15") );
+  fetcher.reset();
+  fetcher.enqueueDigested( loc );
+  fetcher.start( dest2.path(), media );
+  BOOST_CHECK( repo::ContentStore( store.path() ).contains( loc.checksum() ) );
+  receiver.disconnect();
+}
+
+BOOST_AUTO_TEST_CASE(fetcher_wrong_checksum_throws)
+{
+  // A not empty checksum is verified without an explicit checker.
+  MediaSetAccess media( (DATADIR).asUrl(), "/" );
+  filesystem::TmpDir store;
+  OnMediaLocation loc("/complexdir/subdir1/subdir1-file1.txt");
+  loc.setChecksum( CheckSum::sha1("f1d2d2f924e986ac86fdf7b36c94bcdf32beec16") );
+
+  {
+    filesystem::TmpDir dest;
+    Fetcher fetcher;
+    fetcher.setContentStore( store.path() );
+    fetcher.enqueue( loc );
+    BOOST_CHECK_THROW( fetcher.start( dest.path(), media ), FileCheckException );
+    BOOST_CHECK( ! PathInfo(dest.path() + "/complexdir/subdir1/subdir1-file1.txt").isExist() );
+  }
+  {
+    filesystem::TmpDir dest;
+    Fetcher fetcher;
+    fetcher.setContentStore( store.path() );
+    fetcher.enqueueDigested( loc );
+    BOOST_CHECK_THROW( fetcher.start( dest.path(), media ), FileCheckException );
+    BOOST_CHECK( ! PathInfo(dest.path() + "/complexdir/subdir1/subdir1-file1.txt").isExist() );
+  }
+  BOOST_CHECK( ! repo::ContentStore( store.path() ).contains( loc.checksum() ) );
+}
+
 BOOST_AUTO_TEST_CASE(content_index)
 {
   MediaSetAccess media( ( DATADIR).asUrl(), "/" );
@@ -371,6 +435,101 @@ BOOST_AUTO_TEST_CASE(enqueuedir_http)
   web.stop();
 }
 
+BOOST_AUTO_TEST_CASE(fetcher_pipeline_http)
+{
+  // setMaxParallel > 1 and a downloading url: files are downloaded by forked workers
+  WebServer web((Pathname(TESTS_SRC_DIR) + "/zypp/data/Fetcher/remote-site").c_str(), 10001);
+  web.start();
+
+  std::vector<OnMediaLocation> locs;
+  locs.push_back( OnMediaLocation("/file-1.txt").setChecksum( CheckSum::sha1("c8633375c179b6b817dcad42c7692236b236b0d9") ) );
+  locs.push_back( OnMediaLocation("/file-2.txt").setChecksum( CheckSum::sha1("ff94e6d4b47596a9e8dfdf882689f1a1a41bb5a2") ) );
+  locs.push_back( OnMediaLocation("/file-3.txt").setChecksum( CheckSum::sha1("6d71fb8c2a4d661719dadb074138323ea0c244af") ) );
+  locs.push_back( OnMediaLocation("/file-4.txt").setChecksum( CheckSum::sha1("2e40cfe248c1ebfb83f967582e368001b494a95c") ) );
+  locs.push_back( OnMediaLocation("/complexdir/subdir1/subdir1-file1.txt").setChecksum( CheckSum::sha1("f1d2d2f924e986ac86fdf7b36c94bcdf32beec15") ) );
+  locs.push_back( OnMediaLocation("/complexdir/subdir1/subdir1-file2.txt").setChecksum( CheckSum::sha1("e242ed3bffccdf271b7fbaf34ed72d089537b42f") ) );
+  locs.push_back( OnMediaLocation("/complexdir/subdir2/subdir2-file1.txt").setChecksum( CheckSum::sha1("f572d396fae9206628714fb2ce00f72e94f2258f") ) );
+
+  // Jobs are completed in order: when a job is reported done, it and
+  // all jobs before it are in dest, but none of the following ones.
+  struct InOrder
+  {
+    InOrder( const Pathname & dest_r, const std::vector<OnMediaLocation> & locs_r )
+    : _dest( dest_r ), _locs( locs_r ), _reports( 0 ), _ok( true )
+    {}
+
+    bool operator()( const ProgressData & progress_r )
+    {
+      ++_reports;
+      unsigned done = progress_r.val();
+      for ( unsigned i = 0; i < _locs.size(); ++i )
+      {
+        if ( PathInfo( _dest / _locs[i].filename() ).isExist() != ( i < done ) )
+          _ok = false;
+      }
+      return true;
+    }
+
+    Pathname _dest;
+    const std::vector<OnMediaLocation> & _locs;
+    unsigned _reports;
+    bool _ok;
+  };
+
+  filesystem::TmpDir store;
+  {
+    MediaSetAccess media( web.url(), "/" );
+    filesystem::TmpDir dest;
+    Fetcher fetcher;
+    fetcher.setMaxParallel( 3 );
+    fetcher.setContentStore( store.path() );
+    for ( const OnMediaLocation & loc : locs )
+      fetcher.enqueueDigested( loc );
+    InOrder inOrder( dest.path(), locs );
+    fetcher.start( dest.path(), media, std::ref( inOrder ) );
+    BOOST_CHECK( inOrder._reports >= locs.size() );
+    BOOST_CHECK( inOrder._ok );
+    for ( const OnMediaLocation & loc : locs )
+    {
+      BOOST_CHECK_EQUAL( CheckSum::sha1( filesystem::sha1sum( dest.path() / loc.filename() ) ), loc.checksum() );
+      BOOST_CHECK( repo::ContentStore( store.path() ).contains( loc.checksum() ) );
+    }
+  }
+
+  // A broken file in the middle: the error is propagated when its job is
+  // processed. The jobs before are done, the ones after it are not.
+  {
+    std::vector<OnMediaLocation> broken( locs );
+    broken[3].setChecksum( CheckSum::sha1("2e40cfe248c1ebfb83f967582e368001b494a95d") );
+    MediaSetAccess media( web.url(), "/" );
+    filesystem::TmpDir dest;
+    Fetcher fetcher;
+    fetcher.setMaxParallel( 3 );
+    for ( const OnMediaLocation & loc : broken )
+      fetcher.enqueueDigested( loc );
+    BOOST_CHECK_THROW( fetcher.start( dest.path(), media ), FileCheckException );
+    for ( unsigned i = 0; i < broken.size(); ++i )
+      BOOST_CHECK_EQUAL( PathInfo( dest.path() / broken[i].filename() ).isExist(), i < 3 );
+    BOOST_CHECK( ! repo::ContentStore( store.path() ).contains( broken[3].checksum() ) );
+  }
+
+  web.stop();
+
+  // The stored files are reused; nothing is downloaded (the server is down).
+  {
+    MediaSetAccess media( web.url(), "/" );
+    filesystem::TmpDir dest;
+    Fetcher fetcher;
+    fetcher.setMaxParallel( 3 );
+    fetcher.setContentStore( store.path() );
+    for ( const OnMediaLocation & loc : locs )
+      fetcher.enqueueDigested( loc );
+    fetcher.start( dest.path(), media );
+    for ( const OnMediaLocation & loc : locs )
+      BOOST_CHECK_EQUAL( CheckSum::sha1( filesystem::sha1sum( dest.path() / loc.filename() ) ), loc.checksum() );
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
 
 // vim: set ts=2 sts=2 sw=2 ai et:
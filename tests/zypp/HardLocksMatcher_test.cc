@@ -0,0 +1,113 @@
+#include "TestSetup.h"
+#include "zypp/PoolQuery.h"
+#include "zypp/pool/HardLocksMatcher.h"
+
+#define BOOST_TEST_MODULE HardLocksMatcher
+
+using pool::HardLocksMatcher;
+
+/////////////////////////////////////////////////////////////////////////////
+static TestSetup test( Arch_x86_64 );
+
+BOOST_AUTO_TEST_CASE(init)
+{
+  test.loadRepo( TESTS_SRC_DIR "/data/openSUSE-11.1", "opensuse" );
+  test.loadRepo( TESTS_SRC_DIR "/data/OBS_zypp_svn-11.1", "zyppsvn" );
+}
+
+namespace
+{
+  PoolQuery nameQuery( const std::string & str_r, Match::Mode mode_r, bool caseSensitive_r = true, const ResKind & kind_r = ResKind() )
+  {
+    PoolQuery q;
+    q.addAttribute( sat::SolvAttr::name, str_r );
+    q.setFlags( Match( mode_r ) | Match::SKIP_KIND );
+    q.setCaseSensitive( caseSensitive_r );
+    if ( kind_r )
+      q.addKind( kind_r );
+    return q;
+  }
+
+  /** Compare the HardLocksMatcher with the PoolQueryResult of \a queries_r. */
+  void check( const pool::PoolTraits::HardLockQueries & queries_r )
+  {
+    PoolQueryResult expected( queries_r.begin(), queries_r.end() );
+    HardLocksMatcher matcher( queries_r );
+
+    unsigned cnt = 0;
+    for ( const PoolItem & pi : test.pool() )
+    {
+      bool match = matcher( pi.satSolvable() );
+      BOOST_CHECK_MESSAGE( match == expected.contains( pi ), pi << " " << match << " " << *queries_r.begin() );
+      if ( match )
+	++cnt;
+    }
+    BOOST_CHECK_EQUAL( cnt, expected.size() );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(plain)
+{
+  BOOST_CHECK( nameQuery( "zypper", Match::STRING ).isPlainNameMatch() );
+  BOOST_CHECK( nameQuery( "zypp*", Match::GLOB, false ).isPlainNameMatch() );
+
+  PoolQuery q( nameQuery( "zypper", Match::STRING ) );
+  q.addRepo( "opensuse" );
+  BOOST_CHECK( ! q.isPlainNameMatch() );
+
+  q = nameQuery( "zypper", Match::STRING );
+  q.setInstalledOnly();
+  BOOST_CHECK( ! q.isPlainNameMatch() );
+
+  q = nameQuery( "zypper", Match::STRING );
+  q.addAttribute( sat::SolvAttr::summary, "zypp" );
+  BOOST_CHECK( ! q.isPlainNameMatch() );
+
+  q = nameQuery( "zypper", Match::STRING );
+  q.addAttribute( sat::SolvAttr::name, "libzypp" );
+  BOOST_CHECK( ! q.isPlainNameMatch() );
+}
+
+BOOST_AUTO_TEST_CASE(single)
+{
+  std::list<PoolQuery> queries {
+    nameQuery( "zypper", Match::STRING ),
+    nameQuery( "ZYpper", Match::STRING ),
+    nameQuery( "ZYpper", Match::STRING, false ),
+    nameQuery( "lib*", Match::GLOB ),
+    nameQuery( "LIB*", Match::GLOB, false ),
+    nameQuery( "*-[dD]evel", Match::GLOB ),
+    nameQuery( "*-[!d]evel", Match::GLOB ),
+    nameQuery( "kde?-*", Match::GLOB ),
+    nameQuery( "yast2-[[:alpha:]]*", Match::GLOB ),
+    nameQuery( "[unclosed", Match::GLOB ),
+    nameQuery( "zypp", Match::SUBSTRING ),
+    nameQuery( "Devel", Match::SUBSTRING, false ),
+    nameQuery( "c++", Match::SUBSTRING ),
+    nameQuery( "^(lib|perl-)[a-c]", Match::REGEX ),
+    nameQuery( "^(.)\\1", Match::REGEX ),
+    nameQuery( "(invalid", Match::REGEX ),
+    nameQuery( "*", Match::GLOB, true, ResKind::pattern ),
+    nameQuery( "base", Match::STRING, true, ResKind::pattern ),
+    nameQuery( "openSUSE", Match::STRING, true, ResKind::product ),
+  };
+
+  for ( const PoolQuery & q : queries )
+    check( { q } );
+
+  // all in one
+  check( queries );
+}
+
+BOOST_AUTO_TEST_CASE(others)
+{
+  PoolQuery q( nameQuery( "zypp", Match::SUBSTRING ) );
+  q.addRepo( "zyppsvn" );
+  check( { q, nameQuery( "glibc", Match::STRING ) } );
+
+  PoolQuery s;
+  s.addString( "zypp" );
+  s.addAttribute( sat::SolvAttr::name );
+  s.addAttribute( sat::SolvAttr::summary );
+  check( { s, nameQuery( "glibc*", Match::GLOB ) } );
+}
@@ -0,0 +1,93 @@
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <iostream>
+#include <fstream>
+
+#include <boost/test/auto_unit_test.hpp>
+
+#include "zypp/HistoryLog.h"
+#include "zypp/TmpPath.h"
+
+using std::endl;
+using namespace zypp;
+
+namespace
+{
+  unsigned countLines( const Pathname & file_r, const std::string & prefix_r )
+  {
+    unsigned ret = 0;
+    std::ifstream in( file_r.c_str() );
+    for ( std::string line; std::getline( in, line ); )
+      if ( line.compare( 0, prefix_r.size(), prefix_r ) == 0 )
+	++ret;
+    return ret;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(batch_killed)
+{
+  filesystem::TmpDir root;
+  HistoryLog::setRoot( root.path() );
+  Pathname logfile( HistoryLog::fname() );
+
+  int pipefd[2];
+  BOOST_REQUIRE_EQUAL( ::pipe( pipefd ), 0 );
+
+  pid_t pid = ::fork();
+  BOOST_REQUIRE( pid >= 0 );
+  if ( pid == 0 )
+  {
+    // Log within a batch and wait to be killed before it is flushed again.
+    ::close( pipefd[0] );
+    HistoryLog::Batch batch;
+    for ( unsigned i = 0; i < 10; ++i )
+      HistoryLog().comment( "record" );
+    batch.flush();
+    for ( unsigned i = 0; i < 10; ++i )
+      HistoryLog().comment( "unflushed" );
+    char ch = '!';
+    if ( ::write( pipefd[1], &ch, 1 ) != 1 )
+      ::_exit( 1 );
+    for ( ;; )
+      ::pause();
+  }
+
+  ::close( pipefd[1] );
+  char ch = 0;
+  BOOST_REQUIRE_EQUAL( ::read( pipefd[0], &ch, 1 ), 1 );
+  ::close( pipefd[0] );
+  ::kill( pid, SIGKILL );
+  int status = 0;
+  BOOST_REQUIRE_EQUAL( ::waitpid( pid, &status, 0 ), pid );
+  BOOST_CHECK( WIFSIGNALED( status ) && WTERMSIG( status ) == SIGKILL );
+
+  // the flushed records are there, the others are lost completely
+  BOOST_CHECK_EQUAL( countLines( logfile, "# record" ), 10 );
+  BOOST_CHECK_EQUAL( countLines( logfile, "# unflushed" ), 0 );
+}
+
+BOOST_AUTO_TEST_CASE(batch_flush)
+{
+  filesystem::TmpDir root;
+  HistoryLog::setRoot( root.path() );
+  Pathname logfile( HistoryLog::fname() );
+  {
+    HistoryLog::Batch batch;
+    HistoryLog().comment( "first" );
+    HistoryLog().comment( "first" );
+    // written when the batch is flushed
+    BOOST_CHECK_EQUAL( countLines( logfile, "# first" ), 0 );
+    batch.flush();
+    BOOST_CHECK_EQUAL( countLines( logfile, "# first" ), 2 );
+    HistoryLog().comment( "second" );
+    BOOST_CHECK_EQUAL( countLines( logfile, "# second" ), 0 );
+  }
+  BOOST_CHECK_EQUAL( countLines( logfile, "# first" ), 2 );
+  BOOST_CHECK_EQUAL( countLines( logfile, "# second" ), 1 );
+
+  // without a batch each record is written at once
+  HistoryLog().comment( "third" );
+  BOOST_CHECK_EQUAL( countLines( logfile, "# third" ), 1 );
+}
@@ -9,6 +9,7 @@
 #include "zypp/base/Logger.h"
 #include "zypp/base/LogControl.h"
 #include "zypp/base/Exception.h"
+#include "zypp/base/String.h"
 #include "zypp/PathInfo.h"
 #include "zypp/TmpPath.h"
 
@@ -210,3 +211,78 @@ BOOST_AUTO_TEST_CASE(test_exchange)
   BOOST_CHECK( PathInfo(a).isFile() );
   BOOST_CHECK( PathInfo(b).isDir() );
 }
+
+BOOST_AUTO_TEST_CASE(test_copy)
+{
+  TmpDir root;
+  Pathname src( root/"src" );
+  filesystem::assert_dir( src/"sub" );
+  {
+    ofstream( (src/"file").c_str() ) << "content" << endl;
+  }
+  filesystem::chmod( src/"file", 0640 );
+  filesystem::hardlink( src/"file", src/"sub/hardlink" );
+  filesystem::symlink( "../file", src/"sub/symlink" );
+
+  // copy
+  BOOST_CHECK_EQUAL( filesystem::copy( src/"file", root/"copy" ), 0 );
+  BOOST_CHECK_EQUAL( filesystem::copy( src/"file", root/"copy" ), 0 ); // overwrite
+  BOOST_CHECK_EQUAL( PathInfo( root/"copy" ).size(), 8 );
+  BOOST_CHECK_EQUAL( PathInfo( root/"copy" ).perm(), 0640 );
+  BOOST_CHECK_EQUAL( filesystem::copy( src, root/"copy" ), EINVAL );
+  BOOST_CHECK_EQUAL( filesystem::copy( src/"file", src ), EISDIR );
+  BOOST_CHECK_EQUAL( filesystem::copy( src/"nonexisting", root/"copy2" ), EINVAL );
+
+  // copy_file2dir
+  filesystem::assert_dir( root/"dir" );
+  BOOST_CHECK_EQUAL( filesystem::copy_file2dir( src/"file", root/"dir" ), 0 );
+  BOOST_CHECK( PathInfo( root/"dir/file" ).isFile() );
+  BOOST_CHECK_EQUAL( filesystem::copy_file2dir( src/"file", root/"copy" ), ENOTDIR );
+
+  // copy_dir
+  BOOST_CHECK_EQUAL( filesystem::copy_dir( src, root/"dir" ), 0 );
+  BOOST_CHECK_EQUAL( filesystem::copy_dir( src, root/"dir" ), EEXIST );
+  PathInfo file( root/"dir/src/file" );
+  PathInfo hardlink( root/"dir/src/sub/hardlink" );
+  BOOST_CHECK( file.isFile() );
+  BOOST_CHECK_EQUAL( file.ino(), hardlink.ino() );
+  BOOST_CHECK_EQUAL( file.nlink(), 2 );
+  BOOST_CHECK( PathInfo( root/"dir/src/sub/symlink", PathInfo::LSTAT ).isLink() );
+  BOOST_CHECK_EQUAL( filesystem::readlink( root/"dir/src/sub/symlink" ), Pathname( "../file" ) );
+
+  // copy_dir_content
+  filesystem::assert_dir( root/"content" );
+  BOOST_CHECK_EQUAL( filesystem::copy_dir_content( src, root/"content" ), 0 );
+  BOOST_CHECK( PathInfo( root/"content/file" ).isFile() );
+  BOOST_CHECK( PathInfo( root/"content/sub/symlink", PathInfo::LSTAT ).isLink() );
+  BOOST_CHECK_EQUAL( filesystem::copy_dir_content( src, root/"content" ), 0 ); // merge
+
+  // never copy onto the source itself
+  BOOST_CHECK_EQUAL( filesystem::copy( src/"file", src/"file" ), EINVAL );
+  BOOST_CHECK_EQUAL( filesystem::copy( src/"file", src/"sub/hardlink" ), EINVAL );
+  BOOST_CHECK_EQUAL( filesystem::copy_file2dir( src/"file", src ), EINVAL );
+  BOOST_CHECK_EQUAL( PathInfo( src/"file" ).size(), 8 );
+  BOOST_CHECK_EQUAL( filesystem::copy_dir( src, src ), EINVAL );
+  BOOST_CHECK_EQUAL( filesystem::copy_dir( src, src/"sub" ), EINVAL );
+  BOOST_CHECK_EQUAL( filesystem::copy_dir( src, src/"sub/../sub" ), EINVAL );
+  BOOST_CHECK( ! PathInfo( src/"sub/src" ).isExist() );
+  BOOST_CHECK_EQUAL( filesystem::copy_dir_content( src, src/"sub" ), EINVAL );
+  BOOST_CHECK( ! PathInfo( src/"sub/sub" ).isExist() );
+
+  // errors are reported like cp does, the copy goes on
+  filesystem::assert_dir( root/"conflict" );
+  {
+    ofstream( (root/"conflict/sub").c_str() ) << "no directory" << endl;
+  }
+  BOOST_CHECK_EQUAL( filesystem::copy_dir_content( src, root/"conflict" ), 1 );
+  BOOST_CHECK( PathInfo( root/"conflict/file" ).isFile() );
+
+  // many files
+  for ( unsigned i = 0; i < 100; ++i )
+    ofstream( (src/"sub"/str::numstring(i)).c_str() ) << i << endl;
+  BOOST_CHECK_EQUAL( filesystem::copy_dir( src, root/"many" ), ENOTDIR );
+  filesystem::assert_dir( root/"many" );
+  BOOST_CHECK_EQUAL( filesystem::copy_dir( src, root/"many" ), 0 );
+  for ( unsigned i = 0; i < 100; ++i )
+    BOOST_CHECK_EQUAL( PathInfo( root/"many/src/sub"/str::numstring(i) ).size(), str::numstring(i).size()+1 );
+}
@@ -0,0 +1,94 @@
+#include "TestSetup.h"
+#include "zypp/ResPool.h"
+#include "zypp/PoolItem.h"
+#include "zypp/Repository.h"
+
+#define BOOST_TEST_MODULE PoolItem
+
+/////////////////////////////////////////////////////////////////////////////
+
+static TestSetup test( Arch_x86_64 );
+
+BOOST_AUTO_TEST_CASE(init)
+{
+  test.loadRepo( TESTS_SRC_DIR "/data/openSUSE-11.1", "opensuse" );
+}
+
+BOOST_AUTO_TEST_CASE(empty_item)
+{
+  PoolItem pi;
+  BOOST_CHECK( ! pi );
+  BOOST_CHECK_EQUAL( pi.satSolvable(), sat::Solvable::noSolvable );
+  BOOST_CHECK( ! pi.resolvable() );
+  BOOST_CHECK( pi == PoolItem() );
+  BOOST_CHECK( pi.status().isUninstalled() );
+}
+
+BOOST_AUTO_TEST_CASE(copies_share_status)
+{
+  ResPool pool( test.pool() );
+  BOOST_REQUIRE( ! pool.empty() );
+  PoolItem pi( *pool.begin() );
+  PoolItem copy( pi.satSolvable() );
+  BOOST_CHECK( copy == pi );
+  BOOST_CHECK( copy.resolvable() == pi.resolvable() );
+  BOOST_CHECK_EQUAL( pi.resolvable()->satSolvable(), pi.satSolvable() );
+  BOOST_CHECK( PoolItem( pi.resolvable() ) == pi );
+
+  BOOST_CHECK( ! copy.status().isLocked() );
+  pi.status().setLock( true, ResStatus::USER );
+  BOOST_CHECK( copy.status().isLocked() );
+  BOOST_CHECK( &copy.status() == &pi.status() );
+  copy.statusReset();
+  BOOST_CHECK( ! pi.status().isLocked() );
+}
+
+BOOST_AUTO_TEST_CASE(all_items)
+{
+  ResPool pool( test.pool() );
+  for ( const PoolItem & pi : pool )
+  {
+    BOOST_CHECK( pi );
+    BOOST_CHECK( pool.find( pi.satSolvable() ) == pi );
+    BOOST_CHECK_EQUAL( pi.status().isInstalled(), pi.satSolvable().isSystem() );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(repo_removal)
+{
+  ResPool pool( test.pool() );
+  PoolItem other( *pool.begin() );
+  ResStatus & otherStatus( other.status() );
+  otherStatus.setLock( true, ResStatus::USER );
+
+  // status references stay valid when the store grows
+  test.loadRepo( TESTS_SRC_DIR "/data/OBS_zypp_svn-11.1", "obs" );
+  BOOST_REQUIRE( ! sat::Pool::instance().reposFind( "obs" ).solvablesEmpty() );
+  BOOST_CHECK( pool.size() > 0 );	// adjusts the store
+  BOOST_CHECK( &other.status() == &otherStatus );
+  BOOST_CHECK( other.status().isLocked() );
+
+  PoolItem pi( *sat::Pool::instance().reposFind( "obs" ).solvablesBegin() );
+  BOOST_REQUIRE( pi );
+  pi.status().setLock( true, ResStatus::USER );
+  sat::detail::SolvableIdType id = pi.satSolvable().id();
+
+  // removing the repo releases the items slots
+  sat::Pool::instance().reposErase( "obs" );
+  BOOST_CHECK( pool.size() > 0 );	// adjusts the store
+  BOOST_CHECK( ! pi );
+  BOOST_CHECK( ! pi.status().isLocked() );
+  BOOST_CHECK( ! pool.find( sat::Solvable( id ) ) );
+  BOOST_CHECK( other.status().isLocked() );
+
+  // a reused id does not inherit the old status
+  test.loadRepo( TESTS_SRC_DIR "/data/OBS_zypp_svn-11.1", "obs" );
+  for ( const sat::Solvable & solv : sat::Pool::instance().reposFind( "obs" ).solvables() )
+  {
+    BOOST_CHECK( ! pool.find( solv ).status().isLocked() );
+  }
+  BOOST_CHECK( other.status().isLocked() );
+
+  sat::Pool::instance().reposErase( "obs" );
+  other.statusReset();
+}
@@ -1,6 +1,7 @@
 #include "TestSetup.h"
 #include "zypp/PoolQuery.h"
 #include "zypp/PoolQueryUtil.tcc"
+#include "zypp/PoolQueryResult.h"
 
 #define BOOST_TEST_MODULE PoolQuery
 
@@ -872,3 +873,31 @@ BOOST_AUTO_TEST_CASE(addDependency)
 }
 
 
+
+BOOST_AUTO_TEST_CASE(pool_query_parallel)
+{
+  PoolQuery q;
+  q.addAttribute( sat::SolvAttr::description, "^lib.*[0-9]" );
+  q.setMatchRegex();
+  q.setCaseSensitive( false );
+
+  std::vector<sat::Solvable> sequential( q.begin(), q.end() );
+  BOOST_CHECK( ! sequential.empty() );
+  // The test pool is smaller than the default slice size; use slices
+  // small enough to really fork the workers.
+  BOOST_REQUIRE( sat::Pool::instance().solvablesSize() > 4 * 500 );
+  for ( unsigned minSliceSize : { 5000, 500, 1 } )
+  {
+    for ( unsigned maxParallel : { 1, 2, 4, 0 } )
+    {
+      // same solvables in the same order
+      BOOST_CHECK_MESSAGE( q.parallelResult( maxParallel, minSliceSize ) == sequential,
+			   "maxParallel " << maxParallel << " minSliceSize " << minSliceSize );
+    }
+  }
+
+  std::vector<sat::Solvable> parallel( q.parallelResult( 4, 500 ) );
+  PoolQueryResult result( parallel.begin(), parallel.end() );
+  BOOST_CHECK_EQUAL( result.size(), PoolQueryResult( q ).size() );
+  BOOST_CHECK( ( result - q ).empty() );
+}
@@ -20,6 +20,7 @@
 
 
 #include "KeyRingTestReceiver.h"
+#include "WebServer.h"
 
 using boost::unit_test::test_suite;
 using boost::unit_test::test_case;
@@ -272,6 +273,210 @@ BOOST_AUTO_TEST_CASE(repomanager_test)
 
 }
 
+BOOST_AUTO_TEST_CASE(refresh_metadata_batch)
+{
+  TmpDir tmpCachePath;
+  RepoManagerOptions opts( RepoManagerOptions::makeTestSetup( tmpCachePath ) ) ;
+  RepoManager manager(opts);
+
+  KeyRingTestReceiver keyring_callbacks;
+  KeyRingTestSignalReceiver receiver;
+
+  // disable sgnature checking
+  keyring_callbacks.answerAcceptKey(KeyRingReport::KEY_TRUST_TEMPORARILY);
+  keyring_callbacks.answerAcceptVerFailed(true);
+  keyring_callbacks.answerAcceptUnknownKey(true);
+
+  std::list<RepoInfo> repos;
+  {
+    RepoInfo repo;
+    repo.setAlias("yum");
+    repo.setBaseUrl( (Pathname(TESTS_SRC_DIR) / "/repo/yum/data/10.2-updates-subset").asDirUrl() );
+    repos.push_back( repo );
+  }
+  {
+    RepoInfo repo;
+    repo.setAlias("missing");
+    repo.setBaseUrl( (Pathname(TESTS_SRC_DIR) / "/repo/yum/data/does-not-exist").asDirUrl() );
+    repos.push_back( repo );
+  }
+  {
+    RepoInfo repo;
+    repo.setAlias("susetags");
+    repo.setBaseUrl( (Pathname(TESTS_SRC_DIR) / "/repo/susetags/data/stable-x86-subset").asDirUrl() );
+    repos.push_back( repo );
+  }
+
+  RepoManager::RefreshMetadataResults res( manager.refreshMetadata( repos ) );
+  BOOST_REQUIRE_EQUAL( res.size(), 3 );
+  // results are reported in the original order, errors don't stop the batch
+  RepoManager::RefreshMetadataResults::const_iterator it( res.begin() );
+  BOOST_CHECK_EQUAL( it->repo.alias(), "yum" );
+  BOOST_CHECK_EQUAL( it->status, RepoManager::REFRESH_NEEDED );
+  BOOST_CHECK( ! it->failed() );
+  ++it;
+  BOOST_CHECK_EQUAL( it->repo.alias(), "missing" );
+  BOOST_CHECK( it->failed() );
+  BOOST_CHECK_THROW( std::rethrow_exception( it->error ), RepoException );
+  ++it;
+  BOOST_CHECK_EQUAL( it->repo.alias(), "susetags" );
+  BOOST_CHECK( ! it->failed() );
+  BOOST_CHECK( ! manager.metadataStatus( it->repo ).empty() );
+
+  // now they are up to date
+  res = manager.refreshMetadata( repos );
+  BOOST_CHECK_EQUAL( res.front().status, RepoManager::REPO_UP_TO_DATE );
+  BOOST_CHECK_EQUAL( res.back().status, RepoManager::REPO_UP_TO_DATE );
+}
+
+BOOST_AUTO_TEST_CASE(refresh_metadata_batch_http)
+{
+  // http urls and maxParallel > 1: repos are refreshed by forked workers
+  WebServer web( Pathname(TESTS_SRC_DIR) / "repo", 10001 );
+  web.start();
+
+  KeyRingTestReceiver keyring_callbacks;
+  KeyRingTestSignalReceiver receiver;
+
+  // disable sgnature checking
+  keyring_callbacks.answerAcceptKey(KeyRingReport::KEY_TRUST_TEMPORARILY);
+  keyring_callbacks.answerAcceptVerFailed(true);
+  keyring_callbacks.answerAcceptUnknownKey(true);
+
+  std::list<RepoInfo> repos;
+  {
+    // the type is known, otherwise the worker leaves storing the probed type to the parent
+    RepoInfo repo;
+    repo.setAlias("yum");
+    repo.setType( RepoType::RPMMD );
+    Url url( web.url() );
+    url.setPathName( "/yum/data/10.2-updates-subset/" );
+    repo.setBaseUrl( url );
+    repos.push_back( repo );
+  }
+  {
+    RepoInfo repo;
+    repo.setAlias("missing");
+    repo.setType( RepoType::RPMMD );
+    Url url( web.url() );
+    url.setPathName( "/yum/data/does-not-exist/" );
+    repo.setBaseUrl( url );
+    repos.push_back( repo );
+  }
+  {
+    RepoInfo repo;
+    repo.setAlias("susetags");
+    repo.setType( RepoType::YAST2 );
+    Url url( web.url() );
+    url.setPathName( "/susetags/data/stable-x86-subset/" );
+    repo.setBaseUrl( url );
+    repos.push_back( repo );
+  }
+
+  TmpDir tmpCachePath;
+  RepoManager manager( RepoManagerOptions::makeTestSetup( tmpCachePath ) );
+  RepoManager::RefreshMetadataResults res( manager.refreshMetadata( repos, RepoManager::RefreshIfNeeded, 3 ) );
+  BOOST_REQUIRE_EQUAL( res.size(), 3 );
+  RepoManager::RefreshMetadataResults::const_iterator it( res.begin() );
+  BOOST_CHECK_EQUAL( it->repo.alias(), "yum" );
+  BOOST_CHECK_EQUAL( it->status, RepoManager::REFRESH_NEEDED );
+  BOOST_CHECK( ! it->failed() );
+  BOOST_CHECK( PathInfo( tmpCachePath.path() / "raw/yum/repodata/repomd.xml" ).isFile() );
+  ++it;
+  BOOST_CHECK_EQUAL( it->repo.alias(), "missing" );	// failed in the worker, then serially
+  BOOST_CHECK( it->failed() );
+  BOOST_CHECK_THROW( std::rethrow_exception( it->error ), RepoException );
+  ++it;
+  BOOST_CHECK_EQUAL( it->repo.alias(), "susetags" );
+  BOOST_CHECK( ! it->failed() );
+  BOOST_CHECK( PathInfo( tmpCachePath.path() / "raw/susetags/content" ).isFile() );
+
+  // the workers leave the same raw cache as a serial refresh
+  TmpDir serialCachePath;
+  RepoManager serial( RepoManagerOptions::makeTestSetup( serialCachePath ) );
+  serial.refreshMetadata( repos, RepoManager::RefreshIfNeeded, 1 );
+  BOOST_CHECK( ! manager.metadataStatus( res.front().repo ).empty() );
+  BOOST_CHECK_EQUAL( manager.metadataStatus( res.front().repo ), serial.metadataStatus( res.front().repo ) );
+  BOOST_CHECK_EQUAL( manager.metadataStatus( res.back().repo ), serial.metadataStatus( res.back().repo ) );
+
+  // checked by the workers again
+  res = manager.refreshMetadata( repos, RepoManager::RefreshIfNeededIgnoreDelay, 3 );
+  BOOST_CHECK_EQUAL( res.front().status, RepoManager::REPO_UP_TO_DATE );
+  BOOST_CHECK_EQUAL( res.back().status, RepoManager::REPO_UP_TO_DATE );
+
+  web.stop();
+
+  // within repo.refresh.delay nothing is downloaded (the server is down)
+  res = manager.refreshMetadata( repos, RepoManager::RefreshIfNeeded, 3 );
+  BOOST_CHECK_EQUAL( res.front().status, RepoManager::REPO_CHECK_DELAYED );
+  BOOST_CHECK( ! res.front().failed() );
+  BOOST_CHECK_EQUAL( res.back().status, RepoManager::REPO_CHECK_DELAYED );
+  BOOST_CHECK( ! res.back().failed() );
+}
+
+BOOST_AUTO_TEST_CASE(build_caches_batch)
+{
+  TmpDir tmpCachePath;
+  RepoManagerOptions opts( RepoManagerOptions::makeTestSetup( tmpCachePath ) ) ;
+  RepoManager manager(opts);
+
+  KeyRingTestReceiver keyring_callbacks;
+  KeyRingTestSignalReceiver receiver;
+
+  // disable sgnature checking
+  keyring_callbacks.answerAcceptKey(KeyRingReport::KEY_TRUST_TEMPORARILY);
+  keyring_callbacks.answerAcceptVerFailed(true);
+  keyring_callbacks.answerAcceptUnknownKey(true);
+
+  std::list<RepoInfo> repos;
+  {
+    RepoInfo repo;
+    repo.setAlias("yum");
+    repo.setBaseUrl( (Pathname(TESTS_SRC_DIR) / "/repo/yum/data/10.2-updates-subset").asDirUrl() );
+    repos.push_back( repo );
+  }
+  {
+    RepoInfo repo;
+    repo.setAlias("missing");
+    repo.setBaseUrl( (Pathname(TESTS_SRC_DIR) / "/repo/yum/data/does-not-exist").asDirUrl() );
+    repos.push_back( repo );
+  }
+  {
+    RepoInfo repo;
+    repo.setAlias("susetags");
+    repo.setBaseUrl( (Pathname(TESTS_SRC_DIR) / "/repo/susetags/data/stable-x86-subset").asDirUrl() );
+    repos.push_back( repo );
+  }
+
+  // missing raw metadata are refreshed on the fly
+  RepoManager::BuildCacheResults res( manager.buildCaches( repos, RepoManager::BuildIfNeeded, 2 ) );
+  BOOST_REQUIRE_EQUAL( res.size(), 3 );
+  RepoManager::BuildCacheResults::const_iterator it( res.begin() );
+  BOOST_CHECK_EQUAL( it->repo.alias(), "yum" );
+  BOOST_CHECK( ! it->failed() );
+  BOOST_CHECK( manager.isCached( it->repo ) );
+  BOOST_CHECK_EQUAL( manager.cacheStatus( it->repo ), manager.metadataStatus( it->repo ) );
+  ++it;
+  BOOST_CHECK_EQUAL( it->repo.alias(), "missing" );
+  BOOST_CHECK( it->failed() );
+  BOOST_CHECK( ! manager.isCached( it->repo ) );
+  ++it;
+  BOOST_CHECK_EQUAL( it->repo.alias(), "susetags" );
+  BOOST_CHECK( ! it->failed() );
+  BOOST_CHECK( manager.isCached( it->repo ) );
+  BOOST_CHECK( PathInfo( tmpCachePath.path() / "solv/susetags/solv.idx" ).isFile() );
+
+  // forced rebuild replaces the caches
+  res = manager.buildCaches( repos, RepoManager::BuildForced, 2 );
+  BOOST_CHECK( ! res.front().failed() );
+  BOOST_CHECK( ! res.back().failed() );
+
+  manager.loadFromCache( res.front().repo );
+  manager.loadFromCache( res.back().repo );
+  BOOST_CHECK( ! sat::Pool::instance().reposFind( "yum" ).solvablesEmpty() );
+  BOOST_CHECK( ! sat::Pool::instance().reposFind( "susetags" ).solvablesEmpty() );
+}
+
 BOOST_AUTO_TEST_CASE(repo_seting_test)
 {
   RepoInfo repo;
@@ -0,0 +1,297 @@
+#include <utime.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+#include <boost/test/auto_unit_test.hpp>
+
+#include "zypp/base/Logger.h"
+#include "zypp/base/String.h"
+#include "zypp/ExternalProgram.h"
+#include "zypp/PathInfo.h"
+#include "zypp/TmpPath.h"
+#include "zypp/Callback.h"
+#include "zypp/target/rpm/RpmDb.h"
+#include "zypp/target/rpm/RpmCallbacks.h"
+
+using std::endl;
+using namespace zypp;
+using namespace zypp::target::rpm;
+
+///////////////////////////////////////////////////////////////////
+// RpmDb::TransactionSet
+//
+// The packages are built by rpmbuild (the tests are skipped if it is
+// not available) and installed into a temporary root (--justdb, no
+// scripts, so no root permissions are needed).
+///////////////////////////////////////////////////////////////////
+namespace
+{
+  const Pathname rpmbuild( "/usr/bin/rpmbuild" );
+
+  /** Build noarch package \a name_r-\a version_r-1 in \a dir_r; \a extra_r is added to the preamble. */
+  Pathname buildRpm( const Pathname & dir_r, const std::string & name_r, const std::string & version_r, const std::string & extra_r = std::string() )
+  {
+    Pathname spec( dir_r / ( name_r+"-"+version_r+".spec" ) );
+    {
+      std::ofstream out( spec.c_str() );
+      out << "Name: " << name_r << endl
+          << "Version: " << version_r << endl
+          << "Release: 1" << endl
+          << "Summary: " << name_r << endl
+          << "License: GPL" << endl
+          << "BuildArch: noarch" << endl
+          << extra_r << endl
+          << "%description" << endl
+          << name_r << endl
+          << "%files" << endl;
+    }
+
+    std::string topdir( "_topdir "+dir_r.asString() );
+    std::string rpmdir( "_rpmdir "+dir_r.asString() );
+    const char * argv[] = {
+      rpmbuild.c_str(), "-bb",
+      "--define", topdir.c_str(),
+      "--define", rpmdir.c_str(),
+      "--define", "_build_name_fmt %%{NAME}-%%{VERSION}-%%{RELEASE}.%%{ARCH}.rpm",
+      spec.c_str(),
+      NULL
+    };
+
+    ExternalProgram prog( argv, ExternalProgram::Stderr_To_Stdout );
+    for ( std::string line = prog.receiveLine(); ! line.empty(); line = prog.receiveLine() )
+      DBG << line;
+    BOOST_REQUIRE_EQUAL( prog.close(), 0 );
+
+    Pathname ret( dir_r / ( name_r+"-"+version_r+"-1.noarch.rpm" ) );
+    BOOST_REQUIRE( PathInfo( ret ).isFile() );
+    return ret;
+  }
+
+  /** The rpm name used by \ref RpmDb::removePackage */
+  std::string rpmName( const std::string & name_r, const std::string & version_r )
+  { return name_r+"-"+version_r+"-1.noarch"; }
+
+  /** Records the elements started and finished. */
+  struct Recorder : public RpmDb::TransactionSet::ElementReceiver
+  {
+    virtual void start( unsigned idx_r )
+    { _events.push_back( str::form( "start %u", idx_r ) ); }
+
+    virtual bool finish( unsigned idx_r, Result result_r )
+    {
+      static const char * names[] = { "DONE", "FAILED", "RETRY" };
+      _events.push_back( str::form( "finish %u %s", idx_r, names[result_r] ) );
+      return result_r != FAILED;
+    }
+
+    std::vector<std::string> _events;
+  };
+
+  /** Answers install problems with \ref _action. */
+  struct InstallProblemReceiver : public callback::ReceiveReport<RpmInstallReport>
+  {
+    InstallProblemReceiver( Action action_r )
+    : _action( action_r ), _problems( 0 )
+    { connect(); }
+
+    virtual Action problem( Exception & excpt_r )
+    { ++_problems; return _action; }
+
+    Action   _action;
+    unsigned _problems;
+  };
+
+  struct TestSetup
+  {
+    TestSetup()
+    {
+      filesystem::assert_dir( _pkgs.path() );
+      _rpmdb.initDatabase( _root.path() );
+    }
+
+    ~TestSetup()
+    { _rpmdb.closeDatabase(); }
+
+    Pathname pkg( const std::string & name_r, const std::string & version_r, const std::string & extra_r = std::string() )
+    { return buildRpm( _pkgs.path(), name_r, version_r, extra_r ); }
+
+    /** Install \a pkgs_r in a transaction of their own. */
+    void install( const std::vector<Pathname> & pkgs_r )
+    {
+      RpmDb::TransactionSet tset( _rpmdb, flags );
+      for ( const Pathname & pkg : pkgs_r )
+        tset.addInstall( pkg );
+      Recorder recorder;
+      BOOST_REQUIRE( tset.run( recorder ) );
+    }
+
+    static const RpmInstFlags flags;
+
+    filesystem::TmpDir _root;
+    filesystem::TmpDir _pkgs;
+    RpmDb _rpmdb;
+  };
+  const RpmInstFlags TestSetup::flags( RPMINST_JUSTDB | RPMINST_NOSCRIPTS | RPMINST_NOSIGNATURE | RPMINST_NODIGEST );
+
+  /** Flip the last byte of \a file_r (in place, so the inode stays) and set its mtime. */
+  void corrupt( const Pathname & file_r, time_t mtime_r )
+  {
+    {
+      std::fstream f( file_r.c_str(), std::ios::in|std::ios::out|std::ios::binary );
+      f.seekg( -1, std::ios::end );
+      char ch = f.get();
+      f.seekp( -1, std::ios::end );
+      f.put( ~ch );
+      BOOST_REQUIRE( f.good() );
+    }
+    struct utimbuf times = { mtime_r, mtime_r };
+    BOOST_REQUIRE_EQUAL( ::utime( file_r.c_str(), &times ), 0 );
+  }
+
+  bool haveRpmbuild()
+  {
+    if ( PathInfo( rpmbuild ).isX() )
+      return true;
+    BOOST_TEST_MESSAGE( "No " << rpmbuild << ": skipping" );
+    return false;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(install_erase_order)
+{
+  if ( ! haveRpmbuild() )
+    return;
+  TestSetup test;
+  test.install( { test.pkg( "a", "1" ), test.pkg( "b", "1" ) } );
+  BOOST_CHECK( test._rpmdb.hasPackage( "a" ) );
+  BOOST_CHECK( test._rpmdb.hasPackage( "b" ) );
+
+  RpmDb::TransactionSet tset( test._rpmdb, TestSetup::flags );
+  BOOST_CHECK_EQUAL( tset.addRemove( rpmName( "a", "1" ) ), 0 );
+  BOOST_CHECK_EQUAL( tset.addInstall( test.pkg( "c", "1" ) ), 1 );
+  BOOST_CHECK_EQUAL( tset.addInstall( test.pkg( "b", "2" ) ), 2 );	// update
+  BOOST_CHECK_EQUAL( tset.size(), 3 );
+
+  Recorder recorder;
+  BOOST_CHECK( tset.run( recorder ) );
+  std::vector<std::string> expected = {
+    "start 0", "finish 0 DONE",
+    "start 1", "finish 1 DONE",
+    "start 2", "finish 2 DONE",
+  };
+  BOOST_CHECK_EQUAL_COLLECTIONS( recorder._events.begin(), recorder._events.end(), expected.begin(), expected.end() );
+
+  BOOST_CHECK( ! test._rpmdb.hasPackage( "a" ) );
+  BOOST_CHECK( test._rpmdb.hasPackage( "c" ) );
+  BOOST_CHECK( test._rpmdb.hasPackage( "b", Edition( "2-1" ) ) );
+  BOOST_CHECK( ! test._rpmdb.hasPackage( "b", Edition( "1-1" ) ) );
+}
+
+BOOST_AUTO_TEST_CASE(obsoletes)
+{
+  if ( ! haveRpmbuild() )
+    return;
+  TestSetup test;
+  test.install( { test.pkg( "a", "1" ), test.pkg( "b", "1" ) } );
+
+  // The erase of a package obsoleted by an install element is reported
+  // as the remove element, but not added twice.
+  {
+    RpmDb::TransactionSet tset( test._rpmdb, TestSetup::flags );
+    tset.addInstall( test.pkg( "x", "1", "Obsoletes: a" ) );
+    tset.addRemove( rpmName( "a", "1" ) );
+
+    Recorder recorder;
+    BOOST_CHECK( tset.run( recorder ) );
+    BOOST_CHECK_EQUAL( recorder._events.size(), 4 );
+    BOOST_CHECK( std::find( recorder._events.begin(), recorder._events.end(), "finish 0 DONE" ) != recorder._events.end() );
+    BOOST_CHECK( std::find( recorder._events.begin(), recorder._events.end(), "finish 1 DONE" ) != recorder._events.end() );
+    BOOST_CHECK( ! test._rpmdb.hasPackage( "a" ) );
+    BOOST_CHECK( test._rpmdb.hasPackage( "x" ) );
+  }
+  // Same with the remove element first.
+  {
+    RpmDb::TransactionSet tset( test._rpmdb, TestSetup::flags );
+    tset.addRemove( rpmName( "b", "1" ) );
+    tset.addInstall( test.pkg( "y", "1", "Obsoletes: b" ) );
+
+    Recorder recorder;
+    BOOST_CHECK( tset.run( recorder ) );
+    std::vector<std::string> expected = {
+      "start 0", "finish 0 DONE",
+      "start 1", "finish 1 DONE",
+    };
+    BOOST_CHECK_EQUAL_COLLECTIONS( recorder._events.begin(), recorder._events.end(), expected.begin(), expected.end() );
+    BOOST_CHECK( ! test._rpmdb.hasPackage( "b" ) );
+    BOOST_CHECK( test._rpmdb.hasPackage( "y" ) );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(problem_abort)
+{
+  if ( ! haveRpmbuild() )
+    return;
+  TestSetup test;
+  Pathname broken( test.pkg( "e", "1" ) );
+
+  RpmDb::TransactionSet tset( test._rpmdb, TestSetup::flags );
+  tset.addInstall( broken );
+  tset.addInstall( test.pkg( "f", "1" ) );
+  filesystem::unlink( broken );	// can't be opened when rpm wants to install it
+
+  InstallProblemReceiver receiver( RpmInstallReport::ABORT );
+  Recorder recorder;
+  tset.run( recorder );
+  BOOST_CHECK_EQUAL( receiver._problems, 1 );
+  std::vector<std::string> expected = { "start 0", "finish 0 FAILED" };
+  BOOST_CHECK_EQUAL_COLLECTIONS( recorder._events.begin(), recorder._events.end(), expected.begin(), expected.end() );
+  BOOST_CHECK( ! test._rpmdb.hasPackage( "e" ) );
+  BOOST_CHECK( ! test._rpmdb.hasPackage( "f" ) );	// stopped
+}
+
+BOOST_AUTO_TEST_CASE(problem_retry)
+{
+  if ( ! haveRpmbuild() )
+    return;
+  TestSetup test;
+  Pathname broken( test.pkg( "e", "1" ) );
+
+  RpmDb::TransactionSet tset( test._rpmdb, TestSetup::flags );
+  tset.addInstall( broken );
+  tset.addInstall( test.pkg( "f", "1" ) );
+  filesystem::unlink( broken );
+
+  InstallProblemReceiver receiver( RpmInstallReport::RETRY );
+  Recorder recorder;
+  BOOST_CHECK( tset.run( recorder ) );
+  BOOST_CHECK_EQUAL( receiver._problems, 1 );
+  // RETRY is passed to the receiver (not taken as IGNORE) and the transaction goes on
+  std::vector<std::string> expected = { "start 0", "finish 0 RETRY", "start 1", "finish 1 DONE" };
+  BOOST_CHECK_EQUAL_COLLECTIONS( recorder._events.begin(), recorder._events.end(), expected.begin(), expected.end() );
+  BOOST_CHECK( ! test._rpmdb.hasPackage( "e" ) );
+  BOOST_CHECK( test._rpmdb.hasPackage( "f" ) );
+}
+
+BOOST_AUTO_TEST_CASE(prechecked_signature)
+{
+  if ( ! haveRpmbuild() )
+    return;
+  TestSetup test;
+  Pathname a( test.pkg( "a", "1" ) );
+  Pathname b( test.pkg( "b", "1" ) );
+  RpmDb::CheckPackageDetail detail;
+  BOOST_REQUIRE_EQUAL( test._rpmdb.checkPackageSignature( a, detail ), RpmDb::CHK_NOSIG );	// unsigned
+
+  test._rpmdb.checkPackagesSignature( { a, b }, 2 );
+  // a looks unchanged (same inode, size and mtime), b got a new mtime
+  corrupt( a, PathInfo( a ).mtime() );
+  corrupt( b, PathInfo( b ).mtime() + 10 );
+
+  // The result of a is taken from the pre-check, but just once...
+  BOOST_CHECK_EQUAL( test._rpmdb.checkPackageSignature( a, detail ), RpmDb::CHK_NOSIG );
+  BOOST_CHECK_EQUAL( test._rpmdb.checkPackageSignature( a, detail ), RpmDb::CHK_FAIL );
+  // ...while the stale result of b is not used at all.
+  BOOST_CHECK_EQUAL( test._rpmdb.checkPackageSignature( b, detail ), RpmDb::CHK_FAIL );
+}
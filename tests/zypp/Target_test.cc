@@ -2,16 +2,28 @@
 #include <fstream>
 #include <list>
 #include <string>
+#include <vector>
+#include <algorithm>
 
 // Boost.Test
 #include <boost/test/auto_unit_test.hpp>
 
+#include <solv/solvversion.h>
+
 #include "zypp/base/Logger.h"
 #include "zypp/base/Exception.h"
+#include "zypp/base/String.h"
 #include "zypp/ZYppFactory.h"
 #include "zypp/ZYpp.h"
 #include "zypp/ZYppFactory.h"
 #include "zypp/TmpPath.h"
+#include "zypp/PathInfo.h"
+#include "zypp/ExternalProgram.h"
+#include "zypp/ZConfig.h"
+#include "zypp/Repository.h"
+#include "zypp/sat/Pool.h"
+#include "zypp/sat/LookupAttr.h"
+#include "zypp/target/rpm/RpmDb.h"
 
 using boost::unit_test::test_case;
 using namespace std;
@@ -55,3 +67,121 @@ BOOST_AUTO_TEST_CASE(target_test)
     BOOST_CHECK_EQUAL( dlabel.summary, "A cool distribution" );
     BOOST_CHECK_EQUAL( dlabel.shortName, "" );
 }
+
+namespace
+{
+  const Pathname rpmdb2solv( "/usr/bin/rpmdb2solv" );
+  const Pathname rpmbuild( "/usr/bin/rpmbuild" );
+
+  /** Build noarch package \a name_r-1-1 in \a dir_r; \a extra_r is added to the preamble. */
+  Pathname buildRpm( const Pathname & dir_r, const std::string & name_r, const std::string & extra_r )
+  {
+    Pathname spec( dir_r / ( name_r+".spec" ) );
+    {
+      ofstream out( spec.c_str() );
+      out << "Name: " << name_r << endl
+          << "Version: 1" << endl
+          << "Release: 1" << endl
+          << "Summary: " << name_r << endl
+          << "License: GPL" << endl
+          << "BuildArch: noarch" << endl
+          << extra_r << endl
+          << "%description" << endl
+          << name_r << endl
+          << "%files" << endl;
+    }
+    std::string topdir( "_topdir "+dir_r.asString() );
+    std::string rpmdir( "_rpmdir "+dir_r.asString() );
+    const char * argv[] = {
+      rpmbuild.c_str(), "-bb",
+      "--define", topdir.c_str(),
+      "--define", rpmdir.c_str(),
+      "--define", "_build_name_fmt %%{NAME}.rpm",
+      spec.c_str(),
+      NULL
+    };
+    ExternalProgram prog( argv, ExternalProgram::Stderr_To_Stdout );
+    for ( string line = prog.receiveLine(); ! line.empty(); line = prog.receiveLine() )
+      DBG << line;
+    BOOST_REQUIRE_EQUAL( prog.close(), 0 );
+    return dir_r / ( name_r+".rpm" );
+  }
+
+  /** Rebuild the @System solv-file below \a root_r, by rpmdb2solv or in-process,
+   * and return its content: the toolversion and the solvables.
+   */
+  std::vector<std::string> systemSolvContent( const Pathname & root_r, bool external_r, bool clean_r )
+  {
+    Target_Ptr target( getZYpp()->target() );
+    if ( clean_r )
+      target->cleanCache();
+    Pathname solvdir( Pathname::assertprefix( root_r, ZConfig::instance().repoSolvfilesPath() / sat::Pool::systemRepoAlias() ) );
+    filesystem::unlink( solvdir / "cookie" );	// rebuild, using the old solv-file if present
+
+    if ( external_r )
+      ::setenv( "ZYPP_EXTERNAL_RPMDB2SOLV", "1", 1 );
+    target->buildCache();
+    ::unsetenv( "ZYPP_EXTERNAL_RPMDB2SOLV" );
+
+    std::vector<std::string> ret;
+    Repository repo( sat::Pool::instance().addRepoSolv( solvdir / "solv", "compare" ) );
+    for ( const sat::Solvable & solv : repo.solvables() )
+      ret.push_back( str::Str() << solv.ident() << "-" << solv.edition() << "." << solv.arch()
+                                << " " << solv.summary() << " " << solv.provides() );
+    std::sort( ret.begin(), ret.end() );
+    ret.insert( ret.begin(), "toolversion " + sat::LookupRepoAttr( sat::SolvAttr::repositoryToolVersion, repo ).begin().asString() );
+    repo.eraseFromPool();
+    return ret;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(system_solv_like_rpmdb2solv)
+{
+  if ( ! PathInfo( rpmdb2solv ).isX() )
+  {
+    BOOST_TEST_MESSAGE( "No " << rpmdb2solv << ": skipping" );
+    return;
+  }
+
+  filesystem::TmpDir tmp;
+  filesystem::TmpDir pkgs;
+  assert_dir( tmp.path() / "/etc/products.d" );
+  BOOST_REQUIRE( copy( Pathname(TESTS_SRC_DIR) / "/zypp/data/Target/product.prod",  tmp.path() / "/etc/products.d/product.prod") == 0 );
+  assert_dir( tmp.path() / "/usr/share/metainfo" );
+  {
+    ofstream( ( tmp.path() / "/usr/share/metainfo/app.appdata.xml" ).c_str() )
+      << "<component type=\"desktop\"><id>app.desktop</id><name>App</name><summary>An app</summary></component>" << endl;
+  }
+
+  ZYpp::Ptr z = getZYpp();
+  ::setenv( "ZYPP_EXTERNAL_RPMDB2SOLV", "1", 1 );
+  z->initializeTarget( tmp.path() );
+  ::unsetenv( "ZYPP_EXTERNAL_RPMDB2SOLV" );
+
+  const target::rpm::RpmInstFlags flags( target::rpm::RPMINST_JUSTDB | target::rpm::RPMINST_NOSCRIPTS
+                                         | target::rpm::RPMINST_NOSIGNATURE | target::rpm::RPMINST_NODIGEST );
+  bool havePackages = PathInfo( rpmbuild ).isX();
+  if ( havePackages )
+    z->target()->rpmDb().installPackage( buildRpm( pkgs.path(), "patterns-test-foo", "Provides: pattern() = foo\nProvides: pattern-visible()" ), flags );
+  else
+    BOOST_TEST_MESSAGE( "No " << rpmbuild << ": no packages, no autopatterns" );
+
+  // from scratch
+  std::vector<std::string> expected( systemSolvContent( tmp.path(), true, true ) );
+  std::vector<std::string> result( systemSolvContent( tmp.path(), false, true ) );
+  BOOST_CHECK_EQUAL_COLLECTIONS( result.begin(), result.end(), expected.begin(), expected.end() );
+  BOOST_CHECK_EQUAL( expected[0], std::string( "toolversion " ) + LIBSOLV_TOOLVERSION );
+  BOOST_CHECK( std::find_if( expected.begin(), expected.end(), []( const std::string & l ) { return l.compare( 0, 8, "product:" ) == 0; } ) != expected.end() );
+  if ( havePackages )
+    BOOST_CHECK( std::find_if( expected.begin(), expected.end(), []( const std::string & l ) { return l.compare( 0, 12, "pattern:foo-" ) == 0; } ) != expected.end() );
+
+  // reusing the old solv-file
+  if ( havePackages )
+  {
+    z->target()->rpmDb().installPackage( buildRpm( pkgs.path(), "bar", "" ), flags );
+    expected = systemSolvContent( tmp.path(), true, true );
+    result = systemSolvContent( tmp.path(), false, false );
+    BOOST_CHECK_EQUAL_COLLECTIONS( result.begin(), result.end(), expected.begin(), expected.end() );
+  }
+  z->finishTarget();
+}
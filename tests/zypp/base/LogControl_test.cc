@@ -0,0 +1,67 @@
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <iostream>
+#include <fstream>
+#include <boost/test/auto_unit_test.hpp>
+
+#include "zypp/base/LogControl.h"
+#include "zypp/base/Logger.h"
+#include "zypp/TmpPath.h"
+
+#define BOOST_TEST_MODULE LogControl
+
+using std::endl;
+using namespace zypp;
+using base::LogControl;
+
+namespace
+{
+  unsigned countLines( const Pathname & file_r, const std::string & needle_r )
+  {
+    std::ifstream in( file_r.c_str() );
+    unsigned ret = 0;
+    for ( std::string line; std::getline( in, line ); )
+    {
+      if ( line.find( needle_r ) != std::string::npos )
+        ++ret;
+    }
+    return ret;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(async_logfile)
+{
+  filesystem::TmpDir tmp;
+  Pathname logfile( tmp.path() / "log" );
+
+  LogControl::instance().logAsync( true );
+  LogControl::instance().logfile( logfile );
+
+  for ( unsigned i = 0; i < 10000; ++i )
+    MIL << "line " << i << endl;
+  // errors are written immediately
+  ERR << "an error" << endl;
+  BOOST_CHECK_EQUAL( countLines( logfile, "] line " ), 10000 );
+  BOOST_CHECK_EQUAL( countLines( logfile, "an error" ), 1 );
+
+  // pending lines are written before fork, the child writes synchronously
+  MIL << "before fork" << endl;
+  pid_t pid = ::fork();
+  if ( pid == 0 )
+  {
+    MIL << "in child" << endl;
+    ::_exit( 0 );
+  }
+  BOOST_REQUIRE( pid > 0 );
+  ::waitpid( pid, nullptr, 0 );
+  BOOST_CHECK_EQUAL( countLines( logfile, "before fork" ), 1 );
+  BOOST_CHECK_EQUAL( countLines( logfile, "in child" ), 1 );
+
+  // switching the mode (or closing the file) flushes
+  MIL << "last line" << endl;
+  LogControl::instance().logAsync( false );
+  BOOST_CHECK_EQUAL( countLines( logfile, "last line" ), 1 );
+
+  LogControl::instance().logNothing();
+}
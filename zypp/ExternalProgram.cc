@@ -18,6 +18,8 @@
 #include <fcntl.h>
 #include <pty.h> // openpty
 #include <stdlib.h> // setenv
+#include <spawn.h>
+#include <sys/syscall.h>
 
 #include <cstring> // strsignal
 #include <iostream>
@@ -34,8 +36,144 @@ using namespace std;
 #undef  ZYPP_BASE_LOGGER_LOGGROUP
 #define ZYPP_BASE_LOGGER_LOGGROUP "zypp::exec"
 
+extern char ** environ;
+
 namespace zypp {
 
+    ///////////////////////////////////////////////////////////////////
+    namespace env
+    {
+      /** To start external programs the traditional way (fork/exec) instead of \c posix_spawn */
+      inline bool ZYPP_EXEC_FORK()
+      {
+	const char * env = getenv("ZYPP_EXEC_FORK");
+	return( env && str::strToBool( env, true ) );
+      }
+    } // namespace env
+    ///////////////////////////////////////////////////////////////////
+
+    namespace
+    {
+      /** Close all filedescriptors above stderr (in the forked child). */
+      void closeNonStdFds()
+      {
+#ifdef SYS_close_range
+	// One syscall instead of one per possible fd (the limit may be 1M+).
+	if ( ::syscall( SYS_close_range, 3U, ~0U, 0U ) == 0 )
+	  return;
+#endif
+	for ( int i = ::getdtablesize() - 1; i > 2; --i ) {
+	  ::close( i );
+	}
+      }
+
+      /** Start the program via \c posix_spawnp.
+       *
+       * Unlike fork, \c posix_spawn does not copy our page tables and
+       * the fds above stderr are closed by a single \c closefrom action.
+       * The file actions mirror what \ref ExternalProgram::start_program
+       * does in the forked child. Setups \c posix_spawn can not handle
+       * (chroot, pty, a \c PATH in \a environment_r...) return \c 0;
+       * the caller must fork then.
+       *
+       * Returns the pid or \c -1 and \c errno on error.
+       */
+      pid_t spawnProgram( const char *const * argv_r,
+			  const ExternalProgram::Environment & environment_r,
+			  bool defaultLocale_r,
+			  int stdin_r, int stdout_r,
+			  const char * redirectStdin_r, const char * redirectStdout_r,
+			  ExternalProgram::Stderr_Disposition stderrDisp_r, int stderrFd_r,
+			  const char * chdirTo_r, bool switchPgid_r )
+      {
+#ifndef HAVE_POSIX_SPAWN_CLOSEFROM
+	return 0;
+#else
+#ifndef HAVE_POSIX_SPAWN_CHDIR
+	if ( chdirTo_r )
+	  return 0;
+#endif
+	// posix_spawnp looks up argv[0] in our PATH, not in the childs.
+	if ( environment_r.count( "PATH" ) )
+	  return 0;
+	// dup2 to 0/1 must not clobber one of the other fds.
+	if ( stdin_r <= 2 || stdout_r <= 2 || ( stderrDisp_r == ExternalProgram::Stderr_To_FileDesc && stderrFd_r <= 1 ) )
+	  return 0;
+
+	// The environment: ours modified like setenv would do in the child.
+	std::vector<std::string> envstr;
+	for ( char ** env = environ; env && *env; ++env )
+	{
+	  const char * sep = ::strchr( *env, '=' );
+	  std::string key( *env, sep ? sep - *env : ::strlen( *env ) );
+	  if ( environment_r.count( key ) || ( defaultLocale_r && key == "LC_ALL" ) )
+	    continue;
+	  envstr.push_back( *env );
+	}
+	for ( const auto & var : environment_r )
+	  envstr.push_back( var.first + "=" + var.second );
+	if ( defaultLocale_r )
+	  envstr.push_back( "LC_ALL=C" );
+
+	std::vector<char *> envp;
+	for ( std::string & var : envstr )
+	  envp.push_back( &var[0] );
+	envp.push_back( nullptr );
+
+	posix_spawn_file_actions_t actions;
+	posix_spawnattr_t attr;
+	::posix_spawn_file_actions_init( &actions );
+	::posix_spawnattr_init( &attr );
+
+	::posix_spawn_file_actions_adddup2( &actions, stdin_r, 0 );
+	::posix_spawn_file_actions_adddup2( &actions, stdout_r, 1 );
+	if ( redirectStdin_r )
+	  ::posix_spawn_file_actions_addopen( &actions, 0, redirectStdin_r, O_RDONLY, 0 );
+	if ( redirectStdout_r )
+	  ::posix_spawn_file_actions_addopen( &actions, 1, redirectStdout_r, O_WRONLY|O_CREAT|O_APPEND, 0600 );
+
+	switch ( stderrDisp_r )
+	{
+	  case ExternalProgram::Discard_Stderr:
+	    ::posix_spawn_file_actions_addopen( &actions, 2, "/dev/null", O_WRONLY, 0 );
+	    break;
+	  case ExternalProgram::Stderr_To_Stdout:
+	    ::posix_spawn_file_actions_adddup2( &actions, 1, 2 );
+	    break;
+	  case ExternalProgram::Stderr_To_FileDesc:
+	    ::posix_spawn_file_actions_adddup2( &actions, stderrFd_r, 2 );
+	    break;
+	  case ExternalProgram::Normal_Stderr:
+	    break;
+	}
+#ifdef HAVE_POSIX_SPAWN_CHDIR
+	if ( chdirTo_r )
+	  ::posix_spawn_file_actions_addchdir_np( &actions, chdirTo_r );
+#endif
+	::posix_spawn_file_actions_addclosefrom_np( &actions, 3 );
+
+	if ( switchPgid_r )
+	{
+	  ::posix_spawnattr_setflags( &attr, POSIX_SPAWN_SETPGROUP );
+	  ::posix_spawnattr_setpgroup( &attr, 0 );
+	}
+
+	pid_t pid = -1;
+	int err = ::posix_spawnp( &pid, argv_r[0], &actions, &attr, const_cast<char *const *>( argv_r ), envp.data() );
+
+	::posix_spawnattr_destroy( &attr );
+	::posix_spawn_file_actions_destroy( &actions );
+
+	if ( err )
+	{
+	  errno = err;
+	  return -1;
+	}
+	return pid;
+#endif // HAVE_POSIX_SPAWN_CLOSEFROM
+      }
+    } // namespace
+
     ExternalProgram::ExternalProgram()
       : use_pty (false)
       , pid( -1 )
@@ -283,8 +421,36 @@ namespace zypp {
     	}
       }
 
-      // Create module process
-      if ((pid = fork()) == 0)
+      pid_t spawned = 0;
+      if ( ! use_pty && ! root && ! env::ZYPP_EXEC_FORK() )
+      {
+	spawned = spawnProgram( argv, environment, default_locale,
+			    to_external[0], from_external[1],
+			    redirectStdin, redirectStdout,
+			    stderr_disp, stderr_fd, chdirTo, switch_pgid );
+	if ( spawned == -1 )
+	{
+	  if ( chdirTo && ::access( chdirTo, X_OK ) != 0 )
+	  {
+	    _execError = str::form( _("Can't chdir to '%s' (%s)."), chdirTo, strerror(errno) );
+	    _exitStatus = 128;
+	  }
+	  else
+	  {
+	    _execError = str::form( _("Can't exec '%s' (%s)."), argv[0], strerror(errno) );
+	    _exitStatus = 129;
+	  }
+	  ERR << _execError << endl;
+	  ::close(to_external[0]);
+	  ::close(to_external[1]);
+	  ::close(from_external[0]);
+	  ::close(from_external[1]);
+	  return;
+	}
+      }
+
+      // Create module process (unless spawned)
+      if ((pid = ( spawned ? spawned : fork() )) == 0)
       {
         //////////////////////////////////////////////////////////////////////
         // Don't write to the logfile after fork!
@@ -376,9 +542,7 @@ namespace zypp {
 	}
 
     	// close all filedesctiptors above stderr
-    	for ( int i = ::getdtablesize() - 1; i > 2; --i ) {
-    	  ::close( i );
-    	}
+    	closeNonStdFds();
 
     	execvp(argv[0], const_cast<char *const *>(argv));
         // don't want to get here
@@ -13,6 +13,7 @@
 #include <fstream>
 #include <list>
 #include <map>
+#include <deque>
 
 #include "zypp/base/Easy.h"
 #include "zypp/base/LogControl.h"
@@ -20,10 +21,14 @@
 #include "zypp/base/PtrTypes.h"
 #include "zypp/base/DefaultIntegral.h"
 #include "zypp/base/String.h"
+#include "zypp/base/ForkedWorkers_p.h"
 #include "zypp/Fetcher.h"
 #include "zypp/ZYppFactory.h"
+#include "zypp/ZYppCallbacks.h"
 #include "zypp/CheckSum.h"
+#include "zypp/TmpPath.h"
 #include "zypp/base/UserRequestException.h"
+#include "zypp/repo/ContentStore.h"
 #include "zypp/parser/susetags/ContentFileReader.h"
 #include "zypp/parser/susetags/RepoIndex.h"
 
@@ -118,6 +123,172 @@ namespace zypp
     return str << obj->location;
   }
 
+  ///////////////////////////////////////////////////////////////////
+  namespace
+  {
+    /** Download \a resource_r from \a url_r and verify its checksum; executed by a forked worker.
+     * The file is hardlinked to \a file_r. Returns the workers exit code.
+     */
+    int pipelineWorker( const Url & url_r, const OnMediaLocation & resource_r, const Pathname & deltafile_r, const Pathname & file_r )
+    {
+      ForkedWorkers::muteCallbacks();
+      media::ScopedDisableMediaChangeReport guard;
+
+      try
+      {
+	MediaSetAccess access( url_r );
+	Pathname provided( access.provideFile( resource_r, MediaSetAccess::PROVIDE_NON_INTERACTIVE, deltafile_r ) );
+	if ( ! is_checksum( provided, resource_r.checksum() ) )
+	  return 2;
+	if ( filesystem::hardlinkCopy( provided, file_r ) != 0 )
+	  return 3;
+	access.releaseFile( resource_r );
+	return 0;
+      }
+      catch ( const Exception & excpt )
+      {
+	ZYPP_CAUGHT( excpt );
+      }
+      return 1;
+    }
+  } // namespace
+  ///////////////////////////////////////////////////////////////////
+
+  ///////////////////////////////////////////////////////////////////
+  /// \class FetcherPipeline
+  /// \brief Download and verify upcoming \ref Fetcher jobs in forked workers.
+  ///
+  /// Jobs are \ref enqueue d in the order the Fetcher processes them. Workers
+  /// are started as long as less than 2 * maxParallel files are in flight or
+  /// waiting to be \ref take n, so the disk space used is bounded.
+  ///////////////////////////////////////////////////////////////////
+  class FetcherPipeline : private base::NonCopyable
+  {
+  public:
+    enum State { QUEUED, RUNNING, DONE, FAILED };
+
+  public:
+    FetcherPipeline( unsigned maxParallel_r, const Url & url_r, const Pathname & destDir_r )
+    : _url( url_r )
+    , _window( 2 * maxParallel_r )
+    , _pending( 0 )
+    , _workers( maxParallel_r )
+    {
+      if ( maxParallel_r > 1 && url_r.schemeIsDownloading() )
+      {
+	// sibling of destDir_r, so the files can be hardlinked into it
+	if ( filesystem::assert_dir( destDir_r ) == 0 )
+	  _tmpdir = filesystem::TmpDir::makeSibling( destDir_r );
+      }
+    }
+
+    ~FetcherPipeline()
+    {
+      _queue.clear();
+      _workers.waitAll();
+    }
+
+    bool enabled() const
+    { return ! _tmpdir.path().empty(); }
+
+    /** Schedule \a job_r if it needs to be downloaded. */
+    void enqueue( const FetcherJob_Ptr & job_r )
+    {
+      if ( ! enabled() || _state.count( job_r.get() ) )
+	return;
+      const OnMediaLocation & loc( job_r->location );
+      if ( ( job_r->flags & FetcherJob::Directory ) || loc.checksum().empty() || loc.medianr() != 1 )
+	return;
+      _state[job_r.get()] = QUEUED;
+      _queue.push_back( job_r );
+      startWorkers();
+    }
+
+    /** Wait for \a job_r and return the verified file or an empty path (provide it the usual way). */
+    Pathname take( const FetcherJob_Ptr & job_r )
+    {
+      std::map<const FetcherJob*,State>::iterator it( _state.find( job_r.get() ) );
+      if ( it == _state.end() )
+	return Pathname();
+
+      if ( it->second == QUEUED )
+      {
+	// not yet started; nothing to gain
+	for ( std::deque<FetcherJob_Ptr>::iterator qit = _queue.begin(); qit != _queue.end(); ++qit )
+	{
+	  if ( *qit == job_r )
+	  {
+	    _queue.erase( qit );
+	    break;
+	  }
+	}
+	_state.erase( it );
+	startWorkers();
+	return Pathname();
+      }
+
+      while ( it->second == RUNNING )
+      {
+	_workers.reap( /*block*/true );
+	startWorkers();
+      }
+
+      Pathname ret;
+      if ( it->second == DONE )
+      {
+	ret = file( job_r );
+	--_pending;
+      }
+      _state.erase( it );
+      startWorkers();
+      return ret;
+    }
+
+  private:
+    /** Where the worker stores the file of \a job_r. */
+    Pathname file( const FetcherJob_Ptr & job_r ) const
+    { return _tmpdir.path() / job_r->location.filename(); }
+
+    void startWorkers()
+    {
+      _workers.reap();
+      while ( ! _queue.empty() && ! _workers.full() && _workers.running() + _pending < _window )
+      {
+	FetcherJob_Ptr job( _queue.front() );
+	_queue.pop_front();
+
+	Pathname dest( file( job ) );
+	State & state( _state[job.get()] );
+	if ( filesystem::assert_dir( dest.dirname() ) != 0
+	  || ! _workers.start( [&]() { return pipelineWorker( _url, job->location, job->deltafile, dest ); },
+			       [this,&state,job]( int exitcode_r ) {
+				 if ( exitcode_r == 0 )
+				 {
+				   state = DONE;
+				   ++_pending;
+				 }
+				 else
+				 {
+				   DBG << "Pipelined download failed (" << exitcode_r << "): " << job << endl;
+				   state = FAILED;
+				 }
+			       } ) )
+	{
+	  state = FAILED;
+	}
+      }
+    }
+
+  private:
+    Url _url;
+    unsigned _window;
+    unsigned _pending;	///< files DONE but not yet taken
+    filesystem::TmpDir _tmpdir;
+    std::map<const FetcherJob*,State> _state;
+    std::deque<FetcherJob_Ptr> _queue;
+    ForkedWorkers _workers;	///< last member: dtor must wait for workers first
+  };
+
   ///////////////////////////////////////////////////////////////////
   //
   //	CLASS NAME : Fetcher::Impl
@@ -143,6 +314,10 @@ namespace zypp
     void enqueue( const OnMediaLocation &resource, const FileChecker &checker = FileChecker()  );
     void enqueueDigested( const OnMediaLocation &resource, const FileChecker &checker = FileChecker(), const Pathname &deltafile = Pathname() );
     void addCachePath( const Pathname &cache_dir );
+    void setContentStore( const Pathname &store_dir )
+    { _store = repo::ContentStore( store_dir ); }
+    void setMaxParallel( unsigned maxParallel )
+    { _maxParallel = maxParallel; }
     void reset();
     void start( const Pathname &dest_dir,
                 MediaSetAccess &media,
@@ -187,8 +362,12 @@ namespace zypp
        * Tries to locate the file represented by job by looking at
        * the cache (matching checksum is mandatory). Returns the
        * location of the cached file or an empty \ref Pathname.
+       *
+       * A file provided by the \ref repo::ContentStore is hardlinked
+       * to its final destination and \a verified_r is set, as its
+       * checksum need not be checked again.
        */
-      Pathname locateInCache( const OnMediaLocation & resource_r, const Pathname & destDir_r );
+      Pathname locateInCache( const OnMediaLocation & resource_r, const Pathname & destDir_r, bool & verified_r );
       /**
        * Validates the provided file against its checkers.
        * \throws Exception
@@ -211,7 +390,7 @@ namespace zypp
       /**
        * Provide the resource to \ref dest_dir
        */
-      void provideToDest( MediaSetAccess & media_r, const Pathname & destDir_r , const FetcherJob_Ptr & jobp_r );
+      void provideToDest( MediaSetAccess & media_r, const Pathname & destDir_r , const FetcherJob_Ptr & jobp_r, FetcherPipeline & pipeline_r );
 
   private:
     friend Impl * rwcowClone<Impl>( const Impl * rhs );
@@ -222,12 +401,14 @@ namespace zypp
     std::list<FetcherJob_Ptr>   _resources;
     std::set<FetcherIndex_Ptr,SameFetcherIndex> _indexes;
     std::set<Pathname> _caches;
+    repo::ContentStore _store;
     // checksums read from the indexes
     std::map<std::string, CheckSum> _checksums;
     // cache of dir contents
     std::map<std::string, filesystem::DirContent> _dircontent;
 
     Fetcher::Options _options;
+    unsigned _maxParallel;
   };
   ///////////////////////////////////////////////////////////////////
 
@@ -241,6 +422,7 @@ namespace zypp
 
   Fetcher::Impl::Impl()
       : _options(0)
+      , _maxParallel(1)
   {
   }
 
@@ -329,15 +511,25 @@ namespace zypp
 
   }
 
-  Pathname Fetcher::Impl::locateInCache( const OnMediaLocation & resource_r, const Pathname & destDir_r )
+  Pathname Fetcher::Impl::locateInCache( const OnMediaLocation & resource_r, const Pathname & destDir_r, bool & verified_r )
   {
     Pathname ret;
+    verified_r = false;
     // No checksum - no match
     if ( resource_r.checksum().empty() )
       return ret;
 
-    // first check in the destination directory
+    // the content store needs no hashing
     Pathname cacheLocation = destDir_r / resource_r.filename();
+    if ( _store.provide( resource_r.checksum(), cacheLocation ) )
+    {
+      MIL << "file " << resource_r.filename() << " found in " << _store << endl;
+      verified_r = true;
+      swap( ret, cacheLocation );
+      return ret;
+    }
+
+    // first check in the destination directory
     if ( PathInfo(cacheLocation).isExist() && is_checksum( cacheLocation, resource_r.checksum() ) )
     {
       swap( ret, cacheLocation );
@@ -503,7 +695,7 @@ namespace zypp
       }
   }
 
-  void Fetcher::Impl::provideToDest( MediaSetAccess & media_r, const Pathname & destDir_r , const FetcherJob_Ptr & jobp_r )
+  void Fetcher::Impl::provideToDest( MediaSetAccess & media_r, const Pathname & destDir_r , const FetcherJob_Ptr & jobp_r, FetcherPipeline & pipeline_r )
   {
     const OnMediaLocation & resource( jobp_r->location );
 
@@ -512,7 +704,21 @@ namespace zypp
       scoped_ptr<MediaSetAccess::ReleaseFileGuard> releaseFileGuard; // will take care provided files get released
 
       // get cached file (by checksum) or provide from media
-      Pathname tmpFile = locateInCache( resource, destDir_r );
+      bool verified = false;
+      bool pipelined = false;
+      Pathname tmpFile = locateInCache( resource, destDir_r, verified );
+      if ( tmpFile.empty() )
+      {
+	// downloaded and verified by a pipeline worker
+	tmpFile = pipeline_r.take( jobp_r );
+	if ( ! tmpFile.empty() )
+	{
+	  MIL << "Provided by the pipeline" << endl;
+	  verified = pipelined = true;
+	}
+      }
+      else
+	pipeline_r.take( jobp_r );	// not needed
       if ( tmpFile.empty() )
       {
 	MIL << "Not found in cache, retrieving..." << endl;
@@ -529,6 +735,18 @@ namespace zypp
 
       // validate the file (throws if not valid)
       validate( tmpFile, jobp_r->checkers );
+      // A not empty checksum is checked here, unless the content store or
+      // a pipeline worker already proved it. The file is hashed once: a
+      // mismatch is passed to the ChecksumFileChecker, which throws unless
+      // the user accepts the wrong digest. Only a real match goes into the
+      // store.
+      bool matched = verified;
+      if ( ! verified && ! resource.checksum().empty() )
+      {
+	matched = is_checksum( tmpFile, resource.checksum() );
+	if ( ! matched )
+	  ChecksumFileChecker( resource.checksum() )( tmpFile );
+      }
 
       // move it to the final destination
       if ( tmpFile == destFullPath )
@@ -541,6 +759,10 @@ namespace zypp
 	if ( filesystem::hardlinkCopy( tmpFile, destFullPath ) != 0 )
 	  ZYPP_THROW( Exception( "Can't hardlink/copy " + tmpFile.asString() + " to " + destDir_r.asString() ) );
       }
+
+      // remember the verified file
+      if ( matched && ( ! verified || pipelined ) )
+	_store.add( resource.checksum(), destFullPath );
     }
     catch ( Exception & excpt )
     {
@@ -722,6 +944,29 @@ namespace zypp
 
     downloadAndReadIndexList(media, dest_dir);
 
+    // Let workers download what is neither stored nor cached.
+    FetcherPipeline pipeline( _maxParallel, media.url(), dest_dir );
+    if ( pipeline.enabled() )
+    {
+      for ( const FetcherJob_Ptr & jobp : _resources )
+      {
+	const OnMediaLocation & loc( jobp->location );
+	if ( loc.checksum().empty() || _store.contains( loc.checksum() ) || PathInfo( dest_dir / loc.filename() ).isExist() )
+	  continue;
+	bool cached = false;
+	for ( const Pathname & cacheDir : _caches )
+	{
+	  if ( PathInfo( cacheDir / loc.filename() ).isExist() )
+	  {
+	    cached = true;
+	    break;
+	  }
+	}
+	if ( ! cached )
+	  pipeline.enqueue( jobp );
+      }
+    }
+
     for ( const FetcherJob_Ptr & jobp : _resources )
     {
       if ( jobp->flags & FetcherJob::Directory )
@@ -785,16 +1030,12 @@ namespace zypp
               }
           }
       }
-      else
-      {
-          // checksum is not empty, so add a checksum checker
-          ChecksumFileChecker digest_check(jobp->location.checksum());
-          jobp->checkers.push_back(digest_check);
-      }
+      // else: a not empty checksum is checked in provideToDest (unless
+      // the content store or a pipeline worker already proved it).
 
       // Provide and validate the file. If the file was not transferred
       // and no exception was thrown, it was an optional file.
-      provideToDest( media, dest_dir, jobp );
+      provideToDest( media, dest_dir, jobp, pipeline );
 
       if ( ! progress.incr() )
         ZYPP_THROW(AbortRequestException());
@@ -864,6 +1105,16 @@ namespace zypp
     _pimpl->addCachePath(cache_dir);
   }
 
+  void Fetcher::setContentStore( const Pathname &store_dir )
+  {
+    _pimpl->setContentStore(store_dir);
+  }
+
+  void Fetcher::setMaxParallel( unsigned maxParallel )
+  {
+    _pimpl->setMaxParallel(maxParallel);
+  }
+
   void Fetcher::reset()
   {
     _pimpl->reset();
@@ -301,6 +301,30 @@ namespace zypp
     */
     void addCachePath( const Pathname &cache_dir );
 
+    /**
+     * Use the \ref repo::ContentStore at \a store_dir.
+     *
+     * Files are looked up in the store by checksum first. A file provided
+     * by the store is hardlinked into place and not hashed again. Every
+     * downloaded file whose checksum was verified is added to the store.
+     * An empty \a store_dir disables the store (the default).
+     */
+    void setContentStore( const Pathname &store_dir );
+
+    /**
+     * Pipelined execution: While \ref start processes the jobs in order,
+     * up to \a maxParallel upcoming files are downloaded and verified
+     * against their checksum by forked workers.
+     *
+     * Only jobs with a checksum on downloading media (\ref Url::schemeIsDownloading)
+     * take part. The workers do not talk to the user; a file a worker
+     * failed to provide is provided the usual way when its job is
+     * processed, so errors and user interaction happen in job order.
+     *
+     * Default is \c 1 (no workers).
+     */
+    void setMaxParallel( unsigned maxParallel );
+
     /**
      * Reset the transfer (jobs) list
      * \note It does not reset the cache directory list
@@ -11,12 +11,19 @@
  */
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <algorithm>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>	// IOV_MAX
+#include <sys/uio.h>
 
 #include "zypp/ZConfig.h"
 #include "zypp/base/String.h"
 #include "zypp/base/Logger.h"
 #include "zypp/base/IOStream.h"
+#include "zypp/base/Errno.h"
 
 #include "zypp/PathInfo.h"
 #include "zypp/Date.h"
@@ -102,8 +109,132 @@ namespace zypp
 
   namespace
   {
+    ///////////////////////////////////////////////////////////////////
+    /// \class LogBuf
+    /// \brief Streambuf collecting a record until it is flushed (\c endl).
+    ///
+    /// Complete records are appended to the file at once. While a
+    /// \ref HistoryLog::Batch is active, they are kept in memory and
+    /// written together by a single \c writev, followed by an
+    /// \c fdatasync, when the batch is flushed.
+    ///////////////////////////////////////////////////////////////////
+    class LogBuf : public std::streambuf
+    {
+    public:
+      ~LogBuf()
+      { close(); }
+
+      bool open( const Pathname & file_r )
+      {
+	close();
+	_fd = ::open( file_r.c_str(), O_WRONLY|O_CREAT|O_APPEND|O_CLOEXEC, 0666 );
+	return _fd >= 0;
+      }
+
+      void close()
+      {
+	if ( _fd < 0 )
+	  return;
+	writeBatch();
+	::close( _fd );
+	_fd = -1;
+      }
+
+      /** Write the records collected by the batch and fdatasync them. */
+      void writeBatch()
+      {
+	if ( _batch.empty() )
+	  return;
+	if ( _fd >= 0 )	// else openLog complained
+	{
+	  writev( _batch );
+	  if ( ::fdatasync( _fd ) != 0 )
+	    WAR << "fdatasync history log: " << Errno() << endl;
+	}
+	_batch.clear();
+      }
+
+      unsigned _batchcnt = 0;
+
+    protected:
+      virtual int_type overflow( int_type ch_r )
+      {
+	if ( ! traits_type::eq_int_type( ch_r, traits_type::eof() ) )
+	  _record += traits_type::to_char_type( ch_r );
+	return traits_type::not_eof( ch_r );
+      }
+
+      virtual std::streamsize xsputn( const char * s_r, std::streamsize n_r )
+      {
+	_record.append( s_r, n_r );
+	return n_r;
+      }
+
+      virtual int sync()
+      {
+	if ( _record.empty() )
+	  return 0;
+	if ( _batchcnt )
+	{
+	  _batch.push_back( std::string() );
+	  _batch.back().swap( _record );
+	}
+	else
+	{
+	  if ( _fd >= 0 )	// else openLog complained
+	    writev( std::vector<std::string>( 1, _record ) );
+	  _record.clear();
+	}
+	return 0;
+      }
+
+    private:
+      /** Append \a records_r to the file, as few \c writev as possible. */
+      void writev( const std::vector<std::string> & records_r )
+      {
+	std::vector<struct iovec> iov;
+	iov.reserve( records_r.size() );
+	for ( const std::string & record : records_r )
+	  iov.push_back( { const_cast<char*>( record.data() ), record.size() } );
+
+	struct iovec * next = iov.data();
+	struct iovec * end = next + iov.size();
+	while ( next != end )
+	{
+	  ssize_t ret = ::writev( _fd, next, std::min( end - next, std::ptrdiff_t(IOV_MAX) ) );
+	  if ( ret < 0 )
+	  {
+	    if ( errno == EINTR )
+	      continue;
+	    ERR << "Could not write history log: " << Errno() << endl;
+	    return;
+	  }
+	  // skip what's written
+	  for ( size_t done = ret; done; )
+	  {
+	    if ( done >= next->iov_len )
+	    {
+	      done -= next->iov_len;
+	      ++next;
+	    }
+	    else
+	    {
+	      next->iov_base = static_cast<char*>( next->iov_base ) + done;
+	      next->iov_len -= done;
+	      done = 0;
+	    }
+	  }
+	}
+      }
+
+      int         _fd = -1;
+      std::string _record;	///< the record currently written
+      std::vector<std::string> _batch;	///< records collected while a Batch is active
+    };
+
     const char		_sep = '|';
-    std::ofstream 	_log;
+    LogBuf		_logbuf;
+    std::ostream	_log( &_logbuf );
     unsigned		_refcnt = 0;
     Pathname		_fname;
     Pathname		_fnameLastFail;
@@ -114,8 +245,7 @@ namespace zypp
         _fname = ZConfig::instance().historyLogFile();
 
       _log.clear();
-      _log.open( _fname.asString().c_str(), std::ios::out|std::ios::app );
-      if( !_log && _fnameLastFail != _fname )
+      if( !_logbuf.open( _fname ) && _fnameLastFail != _fname )
       {
         ERR << "Could not open logfile '" << _fname << "'" << endl;
 	_fnameLastFail = _fname;
@@ -125,7 +255,7 @@ namespace zypp
     inline void closeLog()
     {
       _log.clear();
-      _log.close();
+      _logbuf.close();
     }
 
     inline void refUp()
@@ -176,6 +306,22 @@ namespace zypp
       openLog();
   }
 
+  HistoryLog::Batch::Batch()
+  {
+    refUp();
+    ++_logbuf._batchcnt;
+  }
+
+  HistoryLog::Batch::~Batch()
+  {
+    if ( ! --_logbuf._batchcnt )
+      _logbuf.writeBatch();
+    refDown();
+  }
+
+  void HistoryLog::Batch::flush()
+  { _logbuf.writeBatch(); }
+
   const Pathname & HistoryLog::fname()
   {
     if ( _fname.empty() )
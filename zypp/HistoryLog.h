@@ -80,6 +80,29 @@ namespace zypp
      */
     static const Pathname & fname();
 
+    ///////////////////////////////////////////////////////////////////
+    /// \class HistoryLog::Batch
+    /// \brief Write the records logged while a Batch exists together.
+    ///
+    /// The Batch keeps the log open and collects the records in memory.
+    /// They are written by a single \c writev and synced (\c fdatasync)
+    /// on \ref flush and when the last Batch goes out of scope (also if an
+    /// exception is thrown). Records not yet flushed are lost if the
+    /// process dies. \c TargetImpl::commit flushes at the end of each heap
+    /// and when the commit stops.
+    ///////////////////////////////////////////////////////////////////
+    class Batch
+    {
+      Batch( const Batch & );
+      Batch & operator=( const Batch & );
+    public:
+      Batch();
+      ~Batch();
+
+      /** Write and sync the records collected so far. */
+      void flush();
+    };
+
     /**
      * Log a comment (even multiline).
      *
@@ -111,6 +111,12 @@ namespace zypp
       void setLabel( const std::string & label_r )
       { _label = label_r; }
 
+      /**
+       * The media or media set URL.
+       */
+      const Url & url() const
+      { return _url; }
+
       enum ProvideFileOption
       {
         /**
@@ -11,12 +11,19 @@
 */
 
 #include <utime.h>     // for ::utime
+#include <fcntl.h>
+#include <dirent.h>
 #include <sys/statvfs.h>
 #include <sys/sysmacros.h> // for ::minor, ::major macros
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>      // for FICLONE
 
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <map>
 
 #include "zypp/base/LogTools.h"
 #include "zypp/base/String.h"
@@ -447,6 +454,331 @@ namespace zypp
       return logResult( recursive_rmdir_1( path, false/* don't remove path itself */ ) );
     }
 
+    ///////////////////////////////////////////////////////////////////
+    namespace
+    {
+      /** Copy the data of \a in_r to the empty \a out_r (both at offset 0).
+       * Try a reflink first, then \c copy_file_range (in kernel, no user space
+       * buffers), \c sendfile and finally read/write. A method the filesystems
+       * do not support is dropped before the first byte is copied.
+       * Returns 0 or errno.
+       */
+      int copyData( int in_r, int out_r, off_t size_r )
+      {
+#ifdef FICLONE
+	if ( size_r && ::ioctl( out_r, FICLONE, in_r ) == 0 )
+	  return 0;
+#endif
+	enum Method { CopyFileRange, SendFile, ReadWrite };
+#ifdef SYS_copy_file_range
+	Method method = CopyFileRange;
+#else
+	Method method = SendFile;
+#endif
+	static const size_t chunk = 1U << 30;
+	bool copied = false;
+	while ( true )
+	{
+	  ssize_t ret = -1;
+	  switch ( method )
+	  {
+	    case CopyFileRange:
+#ifdef SYS_copy_file_range
+	      ret = ::syscall( SYS_copy_file_range, in_r, nullptr, out_r, nullptr, chunk, 0U );
+	      // Some pseudo filesystems report a bogus EOF.
+	      if ( ret == 0 && ! copied && size_r )
+	      {
+		method = SendFile;
+		continue;
+	      }
+#endif
+	      break;
+
+	    case SendFile:
+	      ret = ::sendfile( out_r, in_r, nullptr, chunk );
+	      break;
+
+	    case ReadWrite:
+	    {
+	      char buf[65536];
+	      ret = ::read( in_r, buf, sizeof(buf) );
+	      for ( ssize_t written = 0; ret > 0 && written < ret; )
+	      {
+		ssize_t w = ::write( out_r, buf + written, ret - written );
+		if ( w == -1 )
+		{
+		  if ( errno == EINTR )
+		    continue;
+		  return errno;
+		}
+		written += w;
+	      }
+	    }
+	    break;
+	  }
+
+	  if ( ret > 0 )
+	  {
+	    copied = true;
+	    continue;
+	  }
+	  if ( ret == 0 )
+	    return 0;	// EOF
+	  if ( errno == EINTR )
+	    continue;
+	  if ( ! copied && method != ReadWrite
+	       && ( errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP || errno == EBADF ) )
+	  {
+	    method = Method( method + 1 );
+	    continue;
+	  }
+	  return errno;
+	}
+      }
+
+      /** Copy the regular file \a src_r to \a dest_r, like 'cp' does (no attributes
+       * but the permissions are copied). An existing \a dest_r is overwritten, or
+       * removed first if \a removeDestination_r is set.
+       * Returns 0 or errno.
+       */
+      int copyFile( const std::string & src_r, const std::string & dest_r, bool removeDestination_r )
+      {
+	int in = ::open( src_r.c_str(), O_RDONLY|O_CLOEXEC );
+	if ( in == -1 )
+	  return errno;
+
+	int ret = 0;
+	struct stat st;
+	struct stat dst;
+	if ( ::fstat( in, &st ) == -1 )
+	  ret = errno;
+	else if ( ::stat( dest_r.c_str(), &dst ) == 0 && dst.st_dev == st.st_dev && dst.st_ino == st.st_ino )
+	  ret = EINVAL;	// don't truncate the source
+	else
+	{
+	  if ( removeDestination_r && ::unlink( dest_r.c_str() ) == -1 && errno != ENOENT )
+	    ret = errno;
+	  else
+	  {
+	    int out = ::open( dest_r.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, st.st_mode & 0777 );
+	    if ( out == -1 )
+	      ret = errno;
+	    else
+	    {
+	      ret = copyData( in, out, st.st_size );
+	      if ( ::close( out ) == -1 && ! ret )
+		ret = errno;
+	    }
+	  }
+	}
+	::close( in );
+	return ret;
+      }
+
+      /** Whether \a file_r and \a other_r are the same file (device and inode). */
+      inline bool sameFile( const PathInfo & file_r, const PathInfo & other_r )
+      { return file_r.isExist() && other_r.isExist() && file_r.dev() == other_r.dev() && file_r.ino() == other_r.ino(); }
+
+      /** Whether directory \a dir_r is \a ancestor_r or below it. The parents
+       * are compared by device and inode, so symlinks and relative paths
+       * don't matter.
+       */
+      bool isWithin( const PathInfo & ancestor_r, const Pathname & dir_r )
+      {
+	std::string dir( dir_r.asString() );
+	PathInfo cur( dir );
+	while ( cur.isDir() )
+	{
+	  if ( sameFile( cur, ancestor_r ) )
+	    return true;
+	  dir += "/..";
+	  PathInfo parent( dir );
+	  if ( sameFile( parent, cur ) )
+	    break;	// reached /
+	  cur = parent;
+	}
+	return false;
+      }
+
+      /** Log \a error_r (errno) and return the exit code cp(1) or mv(1) would
+       * have returned: 0 on success, 1 on failure.
+       */
+      int cmdExitCode( int error_r, const char * cmd_r )
+      {
+	if ( ! error_r )
+	  return 0;
+	WAR << cmd_r << ": " << Errno( error_r ) << endl;
+	return 1;
+      }
+
+      ///////////////////////////////////////////////////////////////////
+      /// \class TreeCopy
+      /// \brief Native 'cp -dR': copy a directory tree.
+      ///
+      /// Directories, symlinks and special files are created while walking
+      /// the source tree, regular files are collected and copied afterwards
+      /// (in kernel by \ref copyData). Hardlinked files are copied once and
+      /// linked afterwards (like --preserve=links). Like cp, the copy goes on
+      /// after an error; the first error is returned.
+      ///////////////////////////////////////////////////////////////////
+      class TreeCopy
+      {
+      public:
+	/** Copy \a src_r to \a dest_r (merged into \a dest_r if it is an existing directory). */
+	int copyEntry( const std::string & src_r, const std::string & dest_r )
+	{
+	  struct stat st;
+	  if ( ::lstat( src_r.c_str(), &st ) == -1 )
+	    return remember( errno );
+
+	  if ( S_ISDIR( st.st_mode ) )
+	  {
+	    // Writable for us until all content is copied.
+	    if ( ::mkdir( dest_r.c_str(), ( st.st_mode & 07777 ) | S_IRWXU ) == 0 )
+	      _dirModes.push_back( std::make_pair( dest_r, applyUmaskTo( st.st_mode & 07777 ) ) );
+	    else if ( errno != EEXIST || ! PathInfo( dest_r ).isDir() )
+	      return remember( errno );
+	    return copyContent( src_r, dest_r );
+	  }
+
+	  if ( S_ISREG( st.st_mode ) )
+	  {
+	    if ( st.st_nlink > 1 )
+	    {
+	      std::pair<dev_t,ino_t> inode( st.st_dev, st.st_ino );
+	      auto it( _inodes.find( inode ) );
+	      if ( it != _inodes.end() )
+	      {
+		_links.push_back( Job( it->second, dest_r ) );
+		return 0;
+	      }
+	      _inodes[inode] = dest_r;
+	    }
+	    _files.push_back( Job( src_r, dest_r ) );
+	    return 0;
+	  }
+
+	  if ( S_ISLNK( st.st_mode ) )
+	  {
+	    Pathname target;
+	    if ( readlink( src_r, target ) != 0 )
+	      return remember( EIO );
+	    if ( ::symlink( target.c_str(), dest_r.c_str() ) == -1 )
+	    {
+	      if ( errno != EEXIST || PathInfo( dest_r, PathInfo::LSTAT ).isDir()
+		   || ::unlink( dest_r.c_str() ) == -1 || ::symlink( target.c_str(), dest_r.c_str() ) == -1 )
+		return remember( errno );
+	    }
+	    return 0;
+	  }
+
+	  // fifo, device, socket
+	  if ( ::mknod( dest_r.c_str(), st.st_mode & ( S_IFMT|0777 ), st.st_rdev ) == -1 )
+	    return remember( errno );
+	  return 0;
+	}
+
+	/** Copy the content of directory \a src_r into the existing directory \a dest_r. */
+	int copyContent( const std::string & src_r, const std::string & dest_r )
+	{
+	  DIR * dir = ::opendir( src_r.c_str() );
+	  if ( ! dir )
+	    return remember( errno );
+	  for ( struct dirent * entry = ::readdir( dir ); entry; entry = ::readdir( dir ) )
+	  {
+	    if ( entry->d_name[0] == '.' && ( entry->d_name[1] == '\0' || ( entry->d_name[1] == '.' && entry->d_name[2] == '\0' ) ) )
+	      continue; // omitt . and ..
+	    copyEntry( src_r + "/" + entry->d_name, dest_r + "/" + entry->d_name );
+	  }
+	  ::closedir( dir );
+	  return _error;
+	}
+
+	/** Copy the collected files, create the hardlinks and adjust the directory modes. */
+	int finish()
+	{
+	  for ( const Job & file : _files )
+	    remember( copyFile( file.first, file.second, false ) );
+
+	  for ( const Job & link : _links )
+	  {
+	    ::unlink( link.second.c_str() );
+	    if ( ::link( link.first.c_str(), link.second.c_str() ) == -1 )
+	      remember( copyFile( link.first, link.second, true ) );
+	  }
+
+	  // deepest first, in case we drop our write permission
+	  for ( auto it = _dirModes.rbegin(); it != _dirModes.rend(); ++it )
+	  {
+	    if ( ::chmod( it->first.c_str(), it->second ) == -1 )
+	      remember( errno );
+	  }
+	  return _error;
+	}
+
+      private:
+	typedef std::pair<std::string,std::string> Job;	///< source, destination
+
+	int remember( int error_r )
+	{
+	  if ( error_r && ! _error )
+	    _error = error_r;
+	  return error_r;
+	}
+
+	std::vector<Job> _files;
+	std::vector<Job> _links;
+	std::map<std::pair<dev_t,ino_t>,std::string> _inodes;	///< first copy of a hardlinked file
+	std::vector<std::pair<std::string,mode_t> > _dirModes;	///< final modes of the created directories
+	int _error = 0;
+      };
+
+      /** Move \a oldpath_r to \a newpath_r on an other filesystem, like mv(1) does
+       * (copy preserving mode, owner and timestamps, then remove the original).
+       * Just regular files and symlinks.
+       * Returns 0 or errno.
+       */
+      int moveAcrossFs( const Pathname & oldpath_r, const Pathname & newpath_r, const struct stat & st_r )
+      {
+	Pathname tmp( newpath_r.extend( ".mv." + str::numstring( ::getpid() ) ) );
+	int ret = 0;
+	if ( S_ISLNK( st_r.st_mode ) )
+	{
+	  Pathname target;
+	  if ( readlink( oldpath_r, target ) != 0 )
+	    ret = EIO;
+	  else if ( ::symlink( target.c_str(), tmp.c_str() ) == -1 )
+	    ret = errno;
+	  else
+	    ::lchown( tmp.c_str(), st_r.st_uid, st_r.st_gid );	// as far as we may
+	}
+	else
+	{
+	  ret = copyFile( oldpath_r.asString(), tmp.asString(), true );
+	  if ( ! ret )
+	  {
+	    ::chown( tmp.c_str(), st_r.st_uid, st_r.st_gid );	// as far as we may
+	    if ( ::chmod( tmp.c_str(), st_r.st_mode & 07777 ) == -1 )
+	      ret = errno;
+	    struct timespec times[2] = { st_r.st_atim, st_r.st_mtim };
+	    ::utimensat( AT_FDCWD, tmp.c_str(), times, 0 );
+	  }
+	}
+
+	if ( ! ret && ::rename( tmp.c_str(), newpath_r.c_str() ) == -1 )
+	  ret = errno;
+	if ( ret )
+	{
+	  ::unlink( tmp.c_str() );
+	  return ret;
+	}
+	if ( ::unlink( oldpath_r.c_str() ) == -1 )
+	  WAR << "Moved " << oldpath_r << " but can't remove it: " << Errno() << endl;
+	return 0;
+      }
+    } // namespace
+    ///////////////////////////////////////////////////////////////////
+
     ///////////////////////////////////////////////////////////////////
     //
     //	METHOD NAME : copy_dir
@@ -471,21 +803,13 @@ namespace zypp
         return logResult( EEXIST );
       }
 
-
-      const char *const argv[] = {
-        "/bin/cp",
-        "-dR",
-        "--",
-        srcpath.asString().c_str(),
-        destpath.asString().c_str(),
-        NULL
-      };
-      ExternalProgram prog( argv, ExternalProgram::Stderr_To_Stdout );
-      for ( string output( prog.receiveLine() ); output.length(); output = prog.receiveLine() ) {
-        MIL << "  " << output;
+      if ( isWithin( sp, destpath ) ) {
+        return logResult( EINVAL );	// cannot copy a directory into itself
       }
-      int ret = prog.close();
-      return logResult( ret, "returned" );
+
+      TreeCopy tree;
+      tree.copyEntry( srcpath.asString(), ( destpath / srcpath.basename() ).asString() );
+      return logResult( cmdExitCode( tree.finish(), "cp" ), "returned" );
     }
 
     ///////////////////////////////////////////////////////////////////
@@ -511,22 +835,13 @@ namespace zypp
         return logResult( EEXIST );
       }
 
-      std::string src( srcpath.asString());
-      src += "/.";
-      const char *const argv[] = {
-        "/bin/cp",
-        "-dR",
-        "--",
-        src.c_str(),
-        destpath.asString().c_str(),
-        NULL
-      };
-      ExternalProgram prog( argv, ExternalProgram::Stderr_To_Stdout );
-      for ( string output( prog.receiveLine() ); output.length(); output = prog.receiveLine() ) {
-        MIL << "  " << output;
+      if ( isWithin( sp, destpath ) ) {
+        return logResult( EINVAL );	// cannot copy a directory into itself
       }
-      int ret = prog.close();
-      return logResult( ret, "returned" );
+
+      TreeCopy tree;
+      tree.copyContent( srcpath.asString(), destpath.asString() );
+      return logResult( cmdExitCode( tree.finish(), "cp" ), "returned" );
     }
 
     ///////////////////////////////////////////////////////////////////////
@@ -666,9 +981,15 @@ namespace zypp
       {
         int ret = ::rename( oldpath.asString().c_str(), newpath.asString().c_str() );
 
-        // rename(2) can fail on OverlayFS. Fallback to using mv(1), which is
-        // explicitly mentioned in the kernel docs to deal correctly with OverlayFS.
-        if ( ret == -1 && errno == EXDEV ) {
+        // rename(2) can fail on OverlayFS. Files and symlinks are moved
+        // natively, otherwise fallback to using mv(1), which is explicitly
+        // mentioned in the kernel docs to deal correctly with OverlayFS.
+        struct stat st;
+        if ( ret == -1 && errno == EXDEV
+             && ::lstat( oldpath.c_str(), &st ) == 0 && ( S_ISREG( st.st_mode ) || S_ISLNK( st.st_mode ) ) ) {
+          ret = cmdExitCode( moveAcrossFs( oldpath, newpath, st ), "mv" );
+        }
+        else if ( ret == -1 && errno == EXDEV ) {
           const char *const argv[] = {
             "/usr/bin/mv",
             oldpath.asString().c_str(),
@@ -784,20 +1105,11 @@ namespace zypp
         return logResult( EISDIR );
       }
 
-      const char *const argv[] = {
-        "/bin/cp",
-        "--remove-destination",
-        "--",
-        file.asString().c_str(),
-        dest.asString().c_str(),
-        NULL
-      };
-      ExternalProgram prog( argv, ExternalProgram::Stderr_To_Stdout );
-      for ( string output( prog.receiveLine() ); output.length(); output = prog.receiveLine() ) {
-        MIL << "  " << output;
+      if ( sameFile( sp, dp ) ) {
+        return logResult( EINVAL );
       }
-      int ret = prog.close();
-      return logResult( ret, "returned" );
+
+      return logResult( cmdExitCode( copyFile( file.asString(), dest.asString(), /*removeDestination*/true ), "cp" ), "returned" );
     }
 
     ///////////////////////////////////////////////////////////////////
@@ -954,19 +1266,11 @@ namespace zypp
         return logResult( ENOTDIR );
       }
 
-      const char *const argv[] = {
-        "/bin/cp",
-        "--",
-        file.asString().c_str(),
-        dest.asString().c_str(),
-        NULL
-      };
-      ExternalProgram prog( argv, ExternalProgram::Stderr_To_Stdout );
-      for ( string output( prog.receiveLine() ); output.length(); output = prog.receiveLine() ) {
-        MIL << "  " << output;
+      if ( sameFile( sp, PathInfo( dest / file.basename() ) ) ) {
+        return logResult( EINVAL );
       }
-      int ret = prog.close();
-      return logResult( ret, "returned" );
+
+      return logResult( cmdExitCode( copyFile( file.asString(), ( dest / file.basename() ).asString(), /*removeDestination*/false ), "cp" ), "returned" );
     }
 
     ///////////////////////////////////////////////////////////////////
@@ -438,8 +438,12 @@ namespace zypp
      * Like 'cp -a srcpath destpath'. Copy directory tree. srcpath/destpath must be
      * directories. 'basename srcpath' must not exist in destpath.
      *
+     * Symlinks are copied as symlinks, hardlinks within the tree are preserved.
+     * The files are copied in-process (reflinked if the filesystem supports it).
+     *
      * @return 0 on success, ENOTDIR if srcpath/destpath is not a directory, EEXIST if
-     * 'basename srcpath' exists in destpath, otherwise the commands return value.
+     * 'basename srcpath' exists in destpath, EINVAL if destpath is srcpath or below it,
+     * otherwise cp's return value (1).
      **/
     int copy_dir( const Pathname & srcpath, const Pathname & destpath );
 
@@ -448,8 +452,8 @@ namespace zypp
      * into destpath. Both \p srcpath and \p destpath has to exists.
      *
      * @return 0 on success, ENOTDIR if srcpath/destpath is not a directory,
-     * EEXIST if srcpath and destpath are equal, otherwise the commands
-     * return value.
+     * EEXIST if srcpath and destpath are equal, EINVAL if destpath is
+     * below srcpath, otherwise cp's return value (1).
      */
     int copy_dir_content( const Pathname & srcpath, const Pathname & destpath);
 
@@ -599,11 +603,13 @@ namespace zypp
 
     /**
      * Like '::rename'. Renames a file, moving it between directories if
-     * required. It falls back to using mv(1) in case errno is set to
-     * EXDEV, indicating a cross-device rename, which is likely to happen when
-     * oldpath and newpath are not on the same OverlayFS layer.
+     * required. In case errno is set to EXDEV, indicating a cross-device rename,
+     * which is likely to happen when oldpath and newpath are not on the same
+     * OverlayFS layer, files and symlinks are copied (preserving mode, owner and
+     * timestamps) and removed. Directories are moved using mv(1).
      *
-     * @return 0 on success, errno on failure
+     * @return 0 on success, errno on failure (mv's return value if the
+     * cross-device move fails)
      **/
     int rename( const Pathname & oldpath, const Pathname & newpath );
 
@@ -639,7 +645,8 @@ namespace zypp
      * Like 'cp file dest'. Copy file to destination file.
      *
      * @return 0 on success, EINVAL if file is not a file, EISDIR if
-     * destiantion is a directory, otherwise the commands return value.
+     * destiantion is a directory, EINVAL if file and dest are the same file,
+     * otherwise cp's return value (1).
      **/
     int copy( const Pathname & file, const Pathname & dest );
 
@@ -699,7 +706,8 @@ namespace zypp
      * Like 'cp file dest'. Copy file to dest dir.
      *
      * @return 0 on success, EINVAL if file is not a file, ENOTDIR if dest
-     * is no directory, otherwise the commands return value.
+     * is no directory, EINVAL if file is already in dest, otherwise cp's
+     * return value (1).
      **/
     int copy_file2dir( const Pathname & file, const Pathname & dest );
     //@}
@@ -10,8 +10,9 @@
  *
 */
 #include <iostream>
+#include <vector>
+#include <deque>
 #include "zypp/base/Logger.h"
-#include "zypp/base/DefaultIntegral.h"
 
 #include "zypp/PoolItem.h"
 #include "zypp/ResPool.h"
@@ -25,200 +26,209 @@ namespace zypp
 { /////////////////////////////////////////////////////////////////
 
   ///////////////////////////////////////////////////////////////////
-  //
-  //	CLASS NAME : PoolItem::Impl
-  //
-  /** PoolItem implementation.
-   * \c _buddy handling:
-   * \li \c ==0 no buddy
-   * \li \c >0 this uses \c _buddy status
-   * \li \c <0 this status used by \c -_buddy
-   */
-  struct PoolItem::Impl
+  namespace
   {
-    public:
-      Impl() {}
-
-      Impl( ResObject::constPtr res_r,
-            const ResStatus & status_r )
-      : _status( status_r )
-      , _resolvable( res_r )
-      {}
-
-      ResStatus & status() const
-      { return _buddy > 0 ? PoolItem(buddy()).status() : _status; }
+    ///////////////////////////////////////////////////////////////////
+    /// \class PoolItemStore
+    /// \brief The PoolItems data, arrays indexed by solvable id.
+    ///
+    /// Slot \c 0 (noSolvable) serves the empty PoolItem. The
+    /// \ref ResObject is created on demand.
+    ///
+    /// The status arrays are deques, as \ref PoolItem::status hands
+    /// out references which must stay valid when the store grows.
+    ///
+    /// \c _buddy handling:
+    /// \li \c ==0 no buddy
+    /// \li \c >0 this uses \c _buddy status
+    /// \li \c <0 this status used by \c -_buddy
+    ///////////////////////////////////////////////////////////////////
+    struct PoolItemStore
+    {
+      typedef sat::detail::SolvableIdType IdType;
 
-      sat::Solvable buddy() const
+      static PoolItemStore & instance()
       {
-        if ( !_buddy )
-          return sat::Solvable::noSolvable;
-        if ( _buddy < 0 )
-          return sat::Solvable( -_buddy );
-        return sat::Solvable( _buddy );
+        static PoolItemStore _store;
+        return _store;
       }
 
-      void setBuddy( const sat::Solvable & solv_r );
+      PoolItemStore()
+      : _status( 1 )
+      , _savedStatus( 1 )
+      , _buddy( 1, 0 )
+      , _resolvable( 1 )
+      {}
 
-      ResObject::constPtr resolvable() const
-      { return _resolvable; }
+      /** The slot of \a id_r (\c 0 if not in the store). */
+      IdType slot( IdType id_r ) const
+      { return id_r < _status.size() ? id_r : 0; }
 
-      ResStatus & statusReset() const
+      /** Initialize the slot for a new item. */
+      void init( IdType id_r, const ResStatus & status_r )
       {
-        _status.setLock( false, zypp::ResStatus::USER );
-        _status.resetTransact( zypp::ResStatus::USER );
-        return _status;
+        if ( id_r >= _status.size() )
+        {
+          _status.resize( id_r+1 );
+          _savedStatus.resize( id_r+1 );
+          _buddy.resize( id_r+1, 0 );
+          _resolvable.resize( id_r+1 );
+        }
+        release( id_r );
+        _status[id_r] = status_r;
       }
 
-    public:
-      bool isUndetermined() const
+      /** Reset the slot of an item no longer in the pool. */
+      void release( IdType id_r )
       {
-	  return status().isUndetermined();
+        if ( ! id_r || id_r >= _status.size() )
+          return;
+        sat::detail::IdType & buddy( _buddy[id_r] );
+        if ( buddy )
+        {
+          _buddy[buddy > 0 ? buddy : -buddy] = 0;
+          buddy = 0;
+        }
+        _status[id_r] = ResStatus();
+        _savedStatus[id_r] = ResStatus();
+        _resolvable[id_r].reset();
       }
 
-      bool isRelevant() const
+      ResStatus & status( IdType id_r )
       {
-	  return !status().isNonRelevant();
+        id_r = slot( id_r );
+        return _buddy[id_r] > 0 ? _status[_buddy[id_r]] : _status[id_r];
       }
 
-      bool isSatisfied() const
+      ResStatus & statusReset( IdType id_r )
       {
-	  return status().isSatisfied();
+        ResStatus & status( _status[slot( id_r )] );
+        status.setLock( false, zypp::ResStatus::USER );
+        status.resetTransact( zypp::ResStatus::USER );
+        return status;
       }
 
-      bool isBroken() const
+      sat::Solvable buddy( IdType id_r ) const
       {
-	  return status().isBroken();
+        sat::detail::IdType buddy = _buddy[slot( id_r )];
+        return sat::Solvable( buddy < 0 ? -buddy : buddy );
       }
 
-      bool isNeeded() const
+      void setBuddy( IdType id_r, const sat::Solvable & solv_r )
       {
-	return status().isToBeInstalled() || ( isBroken() && ! status().isLocked() );
+        PoolItem myBuddy( solv_r );
+        if ( myBuddy && slot( id_r ) )
+        {
+          if ( _buddy[slot( myBuddy.satSolvable().id() )] )
+          {
+            ERR <<  PoolItem( sat::Solvable( id_r ) ) << " would be buddy2 in " << myBuddy << endl;
+            return;
+          }
+          _buddy[myBuddy.satSolvable().id()] = -id_r;
+          _buddy[id_r] = myBuddy.satSolvable().id();
+          DBG << PoolItem( sat::Solvable( id_r ) ) << " has buddy " << myBuddy << endl;
+        }
       }
 
-      bool isUnwanted() const
+      ResObject::constPtr resolvable( IdType id_r )
       {
-	return isBroken() && status().isLocked();
+        id_r = slot( id_r );
+        ResObject::constPtr & res( _resolvable[id_r] );
+        if ( ! res && id_r )
+          res = makeResObject( sat::Solvable( id_r ) );
+        return res;
       }
 
-    private:
-      mutable ResStatus     _status;
-      ResObject::constPtr   _resolvable;
-      DefaultIntegral<sat::detail::IdType,sat::detail::noId> _buddy;
-
-    /** \name Poor man's save/restore state.
+      /** \name Poor man's save/restore state.
        * \todo There may be better save/restore state strategies.
-     */
-    //@{
-    public:
-      void saveState() const
-      { _savedStatus = status(); }
-      void restoreState() const
-      { status() = _savedStatus; }
-      bool sameState() const
+       */
+      //@{
+      void saveState( IdType id_r )
+      { _savedStatus[slot( id_r )] = status( id_r ); }
+
+      void restoreState( IdType id_r )
+      { status( id_r ) = _savedStatus[slot( id_r )]; }
+
+      bool sameState( IdType id_r )
       {
-        if ( status() == _savedStatus )
+        const ResStatus & status( this->status( id_r ) );
+        const ResStatus & savedStatus( _savedStatus[slot( id_r )] );
+        if ( status == savedStatus )
           return true;
         // some bits changed...
-        if ( status().getTransactValue() != _savedStatus.getTransactValue()
-             && ( ! status().isBySolver() // ignore solver state changes
+        if ( status.getTransactValue() != savedStatus.getTransactValue()
+             && ( ! status.isBySolver() // ignore solver state changes
                   // removing a user lock also goes to bySolver
-                  || _savedStatus.getTransactValue() == ResStatus::LOCKED ) )
+                  || savedStatus.getTransactValue() == ResStatus::LOCKED ) )
           return false;
-        if ( status().isLicenceConfirmed() != _savedStatus.isLicenceConfirmed() )
+        if ( status.isLicenceConfirmed() != savedStatus.isLicenceConfirmed() )
           return false;
         return true;
       }
-    private:
-      mutable ResStatus _savedStatus;
-    //@}
+      //@}
 
-    public:
-      /** Offer default Impl. */
-      static shared_ptr<Impl> nullimpl()
-      {
-        static shared_ptr<Impl> _nullimpl( new Impl );
-        return _nullimpl;
-      }
-  };
+    private:
+      std::deque<ResStatus>            _status;
+      std::deque<ResStatus>            _savedStatus;
+      std::vector<sat::detail::IdType> _buddy;
+      std::vector<ResObject::constPtr> _resolvable;
+    };
+
+    inline PoolItemStore & store()
+    { return PoolItemStore::instance(); }
+  } // namespace
   ///////////////////////////////////////////////////////////////////
 
-  /** \relates PoolItem::Impl Stream output */
-  inline std::ostream & operator<<( std::ostream & str, const PoolItem::Impl & obj )
-  {
-    str << obj.status();
-    if (obj.resolvable())
-	str << *obj.resolvable();
-    else
-	str << "(NULL)";
-    return str;
-  }
-
-  inline void PoolItem::Impl::setBuddy( const sat::Solvable & solv_r )
-  {
-    PoolItem myBuddy( solv_r );
-    if ( myBuddy )
-    {
-      if ( myBuddy._pimpl->_buddy )
-      {
-	ERR <<  *this << " would be buddy2 in " << myBuddy << endl;
-	return;
-      }
-      myBuddy._pimpl->_buddy = -resolvable()->satSolvable().id();
-      _buddy = myBuddy.satSolvable().id();
-      DBG << *this << " has buddy " << myBuddy << endl;
-    }
-  }
-
   ///////////////////////////////////////////////////////////////////
   //	class PoolItem
   ///////////////////////////////////////////////////////////////////
 
-  PoolItem::PoolItem()
-  : _pimpl( Impl::nullimpl() )
-  {}
-
   PoolItem::PoolItem( const sat::Solvable & solvable_r )
-  : _pimpl( ResPool::instance().find( solvable_r )._pimpl )
+  : _id( ResPool::instance().find( solvable_r )._id )
   {}
 
   PoolItem::PoolItem( const ResObject::constPtr & resolvable_r )
-  : _pimpl( ResPool::instance().find( resolvable_r )._pimpl )
-  {}
-
-  PoolItem::PoolItem( Impl * implptr_r )
-  : _pimpl( implptr_r )
+  : _id( ResPool::instance().find( resolvable_r )._id )
   {}
 
   PoolItem PoolItem::makePoolItem( const sat::Solvable & solvable_r )
   {
-    return PoolItem( new Impl( makeResObject( solvable_r ), solvable_r.isSystem() ) );
+    store().init( solvable_r.id(), ResStatus( solvable_r.isSystem() ) );
+    return PoolItem( solvable_r.id() );
   }
 
-  PoolItem::~PoolItem()
-  {}
+  void PoolItem::dropPoolItem( const sat::Solvable & solvable_r )
+  { store().release( solvable_r.id() ); }
 
   ResPool PoolItem::pool() const
   { return ResPool::instance(); }
 
 
-  ResStatus & PoolItem::status() const			{ return _pimpl->status(); }
-  ResStatus & PoolItem::statusReset() const		{ return _pimpl->statusReset(); }
-  sat::Solvable PoolItem::buddy() const			{ return _pimpl->buddy(); }
-  void PoolItem::setBuddy( const sat::Solvable & solv_r )	{ _pimpl->setBuddy( solv_r ); }
-  bool PoolItem::isUndetermined() const			{ return _pimpl->isUndetermined(); }
-  bool PoolItem::isRelevant() const			{ return _pimpl->isRelevant(); }
-  bool PoolItem::isSatisfied() const			{ return _pimpl->isSatisfied(); }
-  bool PoolItem::isBroken() const			{ return _pimpl->isBroken(); }
-  bool PoolItem::isNeeded() const			{ return _pimpl->isNeeded(); }
-  bool PoolItem::isUnwanted() const			{ return _pimpl->isUnwanted(); }
-  void PoolItem::saveState() const			{ _pimpl->saveState(); }
-  void PoolItem::restoreState() const			{ _pimpl->restoreState(); }
-  bool PoolItem::sameState() const			{ return _pimpl->sameState(); }
-  ResObject::constPtr PoolItem::resolvable() const	{ return _pimpl->resolvable(); }
+  ResStatus & PoolItem::status() const			{ return store().status( _id ); }
+  ResStatus & PoolItem::statusReset() const		{ return store().statusReset( _id ); }
+  sat::Solvable PoolItem::buddy() const			{ return store().buddy( _id ); }
+  void PoolItem::setBuddy( const sat::Solvable & solv_r )	{ store().setBuddy( _id, solv_r ); }
+  bool PoolItem::isUndetermined() const			{ return status().isUndetermined(); }
+  bool PoolItem::isRelevant() const			{ return !status().isNonRelevant(); }
+  bool PoolItem::isSatisfied() const			{ return status().isSatisfied(); }
+  bool PoolItem::isBroken() const			{ return status().isBroken(); }
+  bool PoolItem::isNeeded() const			{ return status().isToBeInstalled() || ( isBroken() && ! status().isLocked() ); }
+  bool PoolItem::isUnwanted() const			{ return isBroken() && status().isLocked(); }
+  void PoolItem::saveState() const			{ store().saveState( _id ); }
+  void PoolItem::restoreState() const			{ store().restoreState( _id ); }
+  bool PoolItem::sameState() const			{ return store().sameState( _id ); }
+  ResObject::constPtr PoolItem::resolvable() const	{ return store().resolvable( _id ); }
 
 
   std::ostream & operator<<( std::ostream & str, const PoolItem & obj )
-  { return str << *obj._pimpl; }
+  {
+    str << obj.status();
+    if ( obj.resolvable() )
+      str << *obj.resolvable();
+    else
+      str << "(NULL)";
+    return str;
+  }
 
 } // namespace zypp
 ///////////////////////////////////////////////////////////////////
@@ -38,6 +38,10 @@ namespace zypp
   /// the same PoolItem. All changes via a PoolItem are immediately
   /// visible in all copies (now COW).
   ///
+  /// \note A PoolItem is just a handle (the solvables id). The status
+  /// is kept in an array indexed by solvable id, the \ref ResObject is
+  /// created on demand (\ref resolvable).
+  ///
   /// \note PoolItem is a SolvableType, which provides direct access to
   /// many of the underlying sat::Solvables properties.
   /// \see \ref sat::SolvableType
@@ -52,7 +56,9 @@ namespace zypp
     friend std::ostream & operator<<( std::ostream & str, const PoolItem & obj );
     public:
       /** Default ctor for use in std::container. */
-      PoolItem();
+      PoolItem()
+      : _id( sat::detail::noSolvableId )
+      {}
 
       /** Ctor looking up the \ref sat::Solvable in the \ref ResPool. */
       explicit PoolItem( const sat::Solvable & solvable_r );
@@ -66,9 +72,6 @@ namespace zypp
       /** Ctor looking up the \ref ResObject in the \ref ResPool. */
       explicit PoolItem( const ResObject::constPtr & resolvable_r );
 
-      /** Dtor */
-      ~PoolItem();
-
     public:
       /** \name Status related methods. */
       //@{
@@ -113,7 +116,7 @@ namespace zypp
 
       /** This is a \ref sat::SolvableType. */
       explicit operator sat::Solvable() const
-      { return resolvable() ? resolvable()->satSolvable() : sat::Solvable::noSolvable; }
+      { return sat::Solvable( _id ); }
 
       /** Return the buddy we share our status object with.
        * A \ref Product e.g. may share it's status with an associated reference \ref Package.
@@ -121,7 +124,7 @@ namespace zypp
       sat::Solvable buddy() const;
 
     public:
-      /** Returns the ResObject::constPtr.
+      /** Returns the ResObject::constPtr (created on first access).
        * \see \ref operator->
        */
       ResObject::constPtr resolvable() const;
@@ -138,17 +141,18 @@ namespace zypp
 
     private:
       friend class pool::PoolImpl;
-      /** \ref PoolItem generator for \ref pool::PoolImpl. */
+      /** \ref PoolItem generator for \ref pool::PoolImpl (initializes the solvables slot in the status store). */
       static PoolItem makePoolItem( const sat::Solvable & solvable_r );
+      /** Releases the status store slot of an item no longer in the pool (for \ref pool::PoolImpl). */
+      static void dropPoolItem( const sat::Solvable & solvable_r );
       /** Buddies are set by \ref pool::PoolImpl.*/
       void setBuddy( const sat::Solvable & solv_r );
       /** internal ctor */
-    public:
-      class Impl;	///< Expose type only
-    private:
-      explicit PoolItem( Impl * implptr_r );
-      /** Pointer to implementation */
-      RW_pointer<Impl> _pimpl;
+      explicit PoolItem( sat::detail::SolvableIdType id_r )
+      : _id( id_r )
+      {}
+      /** The solvables id, the index into the status store. */
+      sat::detail::SolvableIdType _id;
 
     private:
       /** \name tmp hack for save/restore state. */
@@ -168,7 +172,7 @@ namespace zypp
 
   /** \relates PoolItem Required to disambiguate vs. (PoolItem,ResObject::constPtr) due to implicit PoolItem::operator ResObject::constPtr  */
   inline bool operator==( const PoolItem & lhs, const PoolItem & rhs )
-  { return lhs.resolvable() == rhs.resolvable(); }
+  { return lhs.satSolvable() == rhs.satSolvable(); }
 
   /** \relates PoolItem Convenience compare */
   inline bool operator==( const PoolItem & lhs, const ResObject::constPtr & rhs )
@@ -10,17 +10,22 @@
  *
 */
 #include <iostream>
+#include <fstream>
 #include <sstream>
 
 #include "zypp/base/Gettext.h"
 #include "zypp/base/LogTools.h"
 #include "zypp/base/Algorithm.h"
 #include "zypp/base/String.h"
+#include "zypp/base/ForkedWorkers_p.h"
 #include "zypp/repo/RepoException.h"
+#include "zypp/PathInfo.h"
+#include "zypp/TmpPath.h"
 #include "zypp/RelCompare.h"
 
 #include "zypp/sat/Pool.h"
 #include "zypp/sat/Solvable.h"
+#include "zypp/sat/detail/SearchIndex.h"
 #include "zypp/base/StrMatcher.h"
 
 #include "zypp/PoolQuery.h"
@@ -1092,6 +1097,44 @@ attremptycheckend:
   PoolQuery::StatusFilter PoolQuery::statusFilterFlags() const
   { return _pimpl->_status_flags; }
 
+  bool PoolQuery::isPlainNameMatch() const
+  {
+    const Impl & impl( *_pimpl );
+    if ( ! impl._strings.empty()
+      || impl._attrs.size() != 1
+      || impl._attrs.begin()->first != sat::SolvAttr::name
+      || ! impl._uncompiledPredicated.empty()
+      || ! impl._repos.empty()
+      || impl._op != Rel::ANY
+      || impl._status_flags != ALL
+      || impl._match_word )
+      return false;
+
+    // exactly one non empty string (empty strings are not compiled)
+    unsigned cnt = 0;
+    for ( const std::string & str : impl._attrs.begin()->second )
+    {
+      if ( ! str.empty() )
+	++cnt;
+    }
+    if ( cnt != 1 )
+      return false;
+
+    switch ( impl._flags.mode() )
+    {
+      case Match::STRING:
+      case Match::SUBSTRING:
+      case Match::GLOB:
+      case Match::REGEX:
+	break;
+      default:
+	return false;
+    }
+    Match flags( impl._flags.flags() );
+    flags -= Match::NOCASE;
+    return( flags == Match::SKIP_KIND );
+  }
+
   bool PoolQuery::empty() const
   {
     try { return begin() == end(); }
@@ -1548,6 +1591,9 @@ attremptycheckend:
 
 	bool advance( base_iterator & base_r ) const
 	{
+	  if ( _candidates )
+	    return advanceCandidates( base_r );
+
 	  if ( base_r == end() )
 	    base_r = startNewQyery(); // first candidate
 	  else
@@ -1620,7 +1666,8 @@ attremptycheckend:
 	/** Ctor stores the \ref PoolQuery settings.
          * \throw MatchException Any of the exceptions thrown by \ref PoolQuery::Impl::compile.
          */
-	PoolQueryMatcher( const shared_ptr<const PoolQuery::Impl> & query_r )
+	PoolQueryMatcher( const shared_ptr<const PoolQuery::Impl> & query_r,
+			  const shared_ptr<std::vector<sat::Solvable> > & candidates_r = shared_ptr<std::vector<sat::Solvable> >() )
 	{
 	  query_r->compile();
 
@@ -1649,11 +1696,45 @@ attremptycheckend:
 	  _status_flags = query_r->_status_flags;
           // StrMatcher
           _attrMatchList = query_r->_attrMatchList;
+
+	  // Let the search indexes preselect the solvables to look at:
+	  if ( candidates_r )
+	    _candidates = candidates_r;
+	  else if ( ! _neverMatchRepo )
+	  {
+	    std::vector<std::pair<sat::SolvAttr,StrMatcher> > attrs;
+	    for ( const AttrMatchData & matchData : _attrMatchList )
+	      attrs.push_back( std::make_pair( matchData.attr, matchData.strMatcher ) );
+
+	    shared_ptr<std::vector<sat::Solvable> > candidates( new std::vector<sat::Solvable> );
+	    if ( sat::detail::searchIndexCandidates( attrs, _repos, *candidates ) )
+	    {
+	      DBG << "Search index: " << candidates->size() << " candidates" << endl;
+	      _candidates = candidates;
+	    }
+	  }
 	}
 
 	~PoolQueryMatcher()
 	{}
 
+	/** The solvables \ref advance would look at, in pool order. */
+	std::vector<sat::Solvable> toVisit() const
+	{
+	  if ( _candidates )
+	    return *_candidates;
+
+	  std::vector<sat::Solvable> ret;
+	  if ( _neverMatchRepo )
+	    return ret;
+	  for ( const Repository & repo : sat::Pool::instance().repos() )
+	  {
+	    if ( _repos.empty() || _repos.count( repo ) )
+	      ret.insert( ret.end(), repo.solvablesBegin(), repo.solvablesEnd() );
+	  }
+	  return ret;
+	}
+
       private:
 	/** Initialize a new base query. */
 	base_iterator startNewQyery() const
@@ -1686,6 +1767,41 @@ attremptycheckend:
 	}
 
 
+	/** A base query restricted to \a solv_r. */
+	base_iterator startCandidateQuery( const sat::Solvable & solv_r ) const
+	{
+	  if ( _attrMatchList.size() == 1 )
+	  {
+	    const AttrMatchData & matchData( _attrMatchList.front() );
+	    sat::LookupAttr q( matchData.attr, solv_r );
+	    if ( matchData.strMatcher )
+	      q.setStrMatcher( matchData.strMatcher );
+	    return q.begin();
+	  }
+	  return sat::LookupAttr( sat::SolvAttr::allAttr, solv_r ).begin();
+	}
+
+	/** \ref advance visiting the \ref _candidates only.
+	 * Stateless (iterators share the matcher): the next candidate is
+	 * looked up behind the solvable \a base_r is in.
+	 */
+	bool advanceCandidates( base_iterator & base_r ) const
+	{
+	  std::vector<sat::Solvable>::const_iterator next( _candidates->begin() );
+	  if ( base_r != end() )
+	    next = std::upper_bound( _candidates->begin(), _candidates->end(), base_r.inSolvable(), sat::detail::searchIndexOrder );
+
+	  for ( ; next != _candidates->end(); ++next )
+	  {
+	    for ( base_r = startCandidateQuery( *next ); base_r != end(); ++base_r )
+	    {
+	      if ( isAMatch( base_r ) )
+		return true;
+	    }
+	  }
+	  return false;
+	}
+
 	/** Check whether we are on a match.
 	 *
 	 * The check covers the whole Solvable, not just the current
@@ -1803,6 +1919,8 @@ attremptycheckend:
         int _status_flags;
         /** StrMatcher per attribtue. */
         AttrMatchList _attrMatchList;
+        /** If not \c nullptr, the solvables to look at (by \ref sat::detail::SearchIndex). */
+        shared_ptr<std::vector<sat::Solvable> > _candidates;
     };
     ///////////////////////////////////////////////////////////////////
 
@@ -1858,6 +1976,76 @@ attremptycheckend:
     return shared_ptr<detail::PoolQueryMatcher>( new detail::PoolQueryMatcher( _pimpl.getPtr() ) );
   }
 
+  std::vector<sat::Solvable> PoolQuery::parallelResult( unsigned maxParallel_r, unsigned minSliceSize_r ) const
+  {
+    // Forking is not for free; a worker should at least scan minSliceSize_r solvables.
+    if ( ! minSliceSize_r )
+      minSliceSize_r = 1;
+    shared_ptr<detail::PoolQueryMatcher> matcher( new detail::PoolQueryMatcher( _pimpl.getPtr() ) );
+    std::vector<sat::Solvable> toVisit( matcher->toVisit() );
+
+    if ( ! maxParallel_r )
+      maxParallel_r = ForkedWorkers::onlineCPUs();
+    unsigned slices = std::min( size_t(maxParallel_r), toVisit.size() / minSliceSize_r );
+
+    std::vector<sat::Solvable> ret;
+    if ( slices < 2 )
+    {
+      ret.assign( const_iterator( matcher ), end() );
+      return ret;
+    }
+
+    // Each worker matches a contiguous slice of the pool, so the
+    // concatenated results are in pool order.
+    typedef shared_ptr<std::vector<sat::Solvable> > Slice;
+    std::vector<Slice> slice( slices );
+    for ( unsigned i = 0; i < slices; ++i )
+      slice[i].reset( new std::vector<sat::Solvable>( toVisit.begin() + toVisit.size() * i / slices,
+						       toVisit.begin() + toVisit.size() * (i+1) / slices ) );
+
+    std::vector<std::vector<sat::Solvable> > results( slices );
+    std::vector<bool> done( slices, false );
+    filesystem::TmpDir resultDir;
+    {
+      ForkedWorkers workers( slices );
+      for ( unsigned i = 0; i < slices; ++i )
+      {
+	Pathname resultFile( resultDir.path() / str::numstring( i ) );
+	workers.start( [this,&slice,&resultFile,i]() {
+			 std::ofstream out( resultFile.c_str() );
+			 shared_ptr<detail::PoolQueryMatcher> part( new detail::PoolQueryMatcher( _pimpl.getPtr(), slice[i] ) );
+			 for_( it, const_iterator( part ), end() )
+			   out << it->id() << '\n';
+			 out.close();
+			 return out.fail() ? 1 : 0;
+		       },
+		       [&results,&done,resultFile,i]( int exitcode_r ) {
+			 if ( exitcode_r == 0 )
+			 {
+			   std::ifstream in( resultFile.c_str() );
+			   for ( sat::detail::SolvableIdType id; in >> id; )
+			     results[i].push_back( sat::Solvable( id ) );
+			   done[i] = in.eof();
+			 }
+			 filesystem::unlink( resultFile );
+		       } );
+      }
+      workers.waitAll();
+    }
+
+    for ( unsigned i = 0; i < slices; ++i )
+    {
+      if ( ! done[i] )
+      {
+	WAR << "Query worker " << i << " failed; matching its slice in-process." << endl;
+	results[i].assign( const_iterator( shared_ptr<detail::PoolQueryMatcher>( new detail::PoolQueryMatcher( _pimpl.getPtr(), slice[i] ) ) ), end() );
+      }
+      ret.insert( ret.end(), results[i].begin(), results[i].end() );
+    }
+    DBG << "Matched " << ret.size() << " of " << toVisit.size() << " solvables in " << slices << " workers" << endl;
+    return ret;
+  }
+
   /////////////////////////////////////////////////////////////////
 } // namespace zypp
 ///////////////////////////////////////////////////////////////////
@@ -15,6 +15,7 @@
 #include <iosfwd>
 #include <set>
 #include <map>
+#include <vector>
 
 #include "zypp/base/Regex.h"
 #include "zypp/base/PtrTypes.h"
@@ -135,6 +136,22 @@ namespace zypp
      */
     void execute(ProcessResolvable fnc);
 
+    /**
+     * Collect the query result using up to \a maxParallel_r forked worker
+     * processes (\c 0: one per CPU), each matching a slice of at least
+     * \a minSliceSize_r solvables. The solvables are in the order \ref begin
+     * would return them.
+     *
+     * Worth it for CPU bound queries (regex or description search)
+     * on large pools; queries on less than two slices are executed in-process.
+     *
+     * \note The result is an ordered vector rather than a \ref PoolQueryResult,
+     * which is an unordered set. A PoolQueryResult can be built from its range.
+     *
+     * \throws sat::MatchInvalidRegexException like \ref begin.
+     */
+    std::vector<sat::Solvable> parallelResult( unsigned maxParallel_r = 0, unsigned minSliceSize_r = 5000 ) const;
+
     /**
      * Filter by selectable kind.
      *
@@ -437,6 +454,14 @@ namespace zypp
     bool requireAll() const;
 
     StatusFilter statusFilterFlags() const;
+
+    /**
+     * Whether the query just matches a single string against the
+     * \ref sat::SolvAttr::name (skipping any \c kind: prefix),
+     * restricted by \ref kinds only. As most lock queries are of this
+     * kind, \ref pool::HardLocksMatcher evaluates them without a pool scan.
+     */
+    bool isPlainNameMatch() const;
     //@}
 
     /**
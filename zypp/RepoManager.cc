@@ -17,6 +17,10 @@
 #include <list>
 #include <map>
 #include <algorithm>
+#include <vector>
+#include <exception>
+
+#include <unistd.h>
 
 #include <solv/solvversion.h>
 
@@ -27,6 +31,7 @@
 #include "zypp/base/DefaultIntegral.h"
 #include "zypp/base/Function.h"
 #include "zypp/base/Regex.h"
+#include "zypp/base/ForkedWorkers_p.h"
 #include "zypp/PathInfo.h"
 #include "zypp/TmpPath.h"
 
@@ -40,6 +45,8 @@
 #include "zypp/ExternalProgram.h"
 #include "zypp/ManagedFile.h"
 #include "zypp/KeyManager.h"
+#include "zypp/KeyRing.h"
+#include "zypp/Digest.h"
 
 #include "zypp/parser/RepoFileReader.h"
 #include "zypp/parser/ServiceFileReader.h"
@@ -47,6 +54,9 @@
 #include "zypp/repo/yum/Downloader.h"
 #include "zypp/repo/susetags/Downloader.h"
 #include "zypp/repo/PluginServices.h"
+#include "zypp/repo/SolvFileBuilder.h"
+#include "zypp/repo/ContentStore.h"
+#include "zypp/repo/RepoDefinitionIndex.h"
 
 #include "zypp/Target.h" // for Target::targetDistribution() for repo index services
 #include "zypp/ZYppFactory.h" // to get the Target from ZYpp instance
@@ -75,6 +85,13 @@ namespace zypp
       const char * env = getenv("ZYPP_PLUGIN_APPDATA_FORCE_COLLECT");
       return( env && str::strToBool( env, true ) );
     }
+
+    /** To build the solv cache using the external \c repo2solv instead of \ref repo::SolvFileBuilder */
+    inline bool ZYPP_EXTERNAL_REPO2SOLV()
+    {
+      const char * env = getenv("ZYPP_EXTERNAL_REPO2SOLV");
+      return( env && str::strToBool( env, true ) );
+    }
   } // namespace env
   ///////////////////////////////////////////////////////////////////
 
@@ -304,11 +321,34 @@ namespace zypp
      *
      * \param dir pathname of the directory to read.
      */
-    std::list<RepoInfo> repositories_in_dir( const Pathname &dir )
+    std::list<RepoInfo> repositories_in_dir( const Pathname &dir, repo::RepoDefinitionIndex * index_r = nullptr )
     {
       MIL << "directory " << dir << endl;
       std::list<RepoInfo> repos;
       bool nonroot( geteuid() != 0 );
+      static const str::regex allowedRepoExt("^\\.repo(_[0-9]+)?$");
+
+      repo::RepoDefinitionIndex::FileList files;
+      if ( ! nonroot && index_r
+	   && index_r->files( dir, []( const Pathname & file_r ) { return str::regex_match( file_r.extension(), allowedRepoExt ); }, files ) )
+      {
+	for ( const auto & file : files )
+	{
+	  if ( file.second )
+	  {
+	    RepoCollector collector;
+	    parser::RepoFileReader( *file.second, bind( &RepoCollector::collect, &collector, _1 ) );
+	    repos.splice( repos.end(), collector.repos );
+	  }
+	  else
+	  {
+	    std::list<RepoInfo> tmp( repositories_in_file( file.first ) );	// report the error
+	    repos.splice( repos.end(), tmp );
+	  }
+	}
+	return repos;
+      }
+
       if ( nonroot && ! PathInfo(dir).userMayRX() )
       {
 	JobReport::warning( str::Format(_("Cannot read repo directory '%1%': Permission denied")) % dir );
@@ -322,7 +362,6 @@ namespace zypp
 	  ZYPP_THROW(Exception(str::form(_("Failed to read directory '%s'"), dir.c_str())));
 	}
 
-	str::regex allowedRepoExt("^\\.repo(_[0-9]+)?$");
 	for ( std::list<Pathname>::const_iterator it = entries.begin(); it != entries.end(); ++it )
 	{
 	  if ( str::regex_match(it->extension(), allowedRepoExt) )
@@ -401,6 +440,13 @@ namespace zypp
       return isTmpRepo( info ) ? info.metadataPath() : opt.repoRawCachePath / info.escaped_alias();
     }
 
+    /**
+     * \short The \ref repo::ContentStore shared by all raw caches, this is usually
+     * /var/cache/zypp/store
+     */
+    inline Pathname contentstore_path( const RepoManagerOptions &opt )
+    { return opt.repoCachePath / "store"; }
+
     /**
      * \short Calculates the raw product metadata path for a repository, this is
      * inside the raw cache dir, plus an optional path where the metadata is.
@@ -525,8 +571,11 @@ namespace zypp
     Impl( const RepoManagerOptions &opt )
       : _options(opt)
     {
-      init_knownServices();
-      init_knownRepositories();
+      repo::RepoDefinitionIndex index( _options.repoCachePath / "repodefinitions.idx" );
+      init_knownServices( index );
+      init_knownRepositories( index );
+      index.save();
+      MIL << index << endl;
     }
 
     ~Impl()
@@ -599,7 +648,9 @@ namespace zypp
 
     RefreshCheckStatus checkIfToRefreshMetadata( const RepoInfo & info, const Url & url, RawMetadataRefreshPolicy policy );
 
-    void refreshMetadata( const RepoInfo & info, RawMetadataRefreshPolicy policy, OPT_PROGRESS );
+    RefreshCheckStatus refreshMetadata( const RepoInfo & info, RawMetadataRefreshPolicy policy, OPT_PROGRESS );
+
+    RefreshMetadataResults refreshMetadata( const std::list<RepoInfo> & repos_r, RawMetadataRefreshPolicy policy, unsigned maxParallel_r, OPT_PROGRESS );
 
     void cleanMetadata( const RepoInfo & info, OPT_PROGRESS );
 
@@ -607,6 +658,8 @@ namespace zypp
 
     void buildCache( const RepoInfo & info, CacheBuildPolicy policy, OPT_PROGRESS );
 
+    BuildCacheResults buildCaches( const std::list<RepoInfo> & repos_r, CacheBuildPolicy policy, unsigned jobs_r, OPT_PROGRESS );
+
     repo::RepoType probe( const Url & url, const Pathname & path = Pathname() ) const;
     repo::RepoType probeCache( const Pathname & path_r ) const;
 
@@ -687,6 +740,16 @@ namespace zypp
 
     void touchIndexFile( const RepoInfo & info );
 
+    /** Download \a info's raw metadata from \a url into \a destdir_r.
+     * Up to \a maxParallel_r files are downloaded concurrently (\c 0: \c download.max_concurrent_connections).
+     */
+    void downloadMetadata( const RepoInfo & info, const Url & url, const repo::RepoType & repokind, const Pathname & destdir_r, unsigned maxParallel_r = 0 );
+
+    /** The forked worker process of a batch \ref refreshMetadata; returns the workers exit code.
+     * The worker downloads up to \a maxParallel_r files concurrently.
+     */
+    int refreshMetadataWorker( const RepoInfo & info, RawMetadataRefreshPolicy policy, const Pathname & destdir_r, unsigned maxParallel_r );
+
     template<typename OutputIterator>
     void getRepositoriesInService( const std::string & alias, OutputIterator out ) const
     {
@@ -697,8 +760,8 @@ namespace zypp
     }
 
   private:
-    void init_knownServices();
-    void init_knownRepositories();
+    void init_knownServices( repo::RepoDefinitionIndex & index_r );
+    void init_knownRepositories( repo::RepoDefinitionIndex & index_r );
 
     const RepoSet & repos() const { return _reposX; }
     RepoSet & reposManip()        { if ( ! _reposDirty ) _reposDirty = true; return _reposX; }
@@ -773,11 +836,22 @@ namespace zypp
 
   ////////////////////////////////////////////////////////////////////////////
 
-  void RepoManager::Impl::init_knownServices()
+  void RepoManager::Impl::init_knownServices( repo::RepoDefinitionIndex & index_r )
   {
     Pathname dir = _options.knownServicesPath;
     std::list<Pathname> entries;
-    if (PathInfo(dir).isExist())
+    repo::RepoDefinitionIndex::FileList files;
+    if ( geteuid() == 0 && index_r.files( dir, repo::RepoDefinitionIndex::Filter(), files ) )
+    {
+      for ( const auto & file : files )
+      {
+	if ( file.second )
+	  parser::ServiceFileReader( *file.second, ServiceCollector(_services) );
+	else
+	  parser::ServiceFileReader( file.first, ServiceCollector(_services) );	// report the error
+      }
+    }
+    else if (PathInfo(dir).isExist())
     {
       if ( filesystem::readdir( entries, dir, false ) != 0 )
       {
@@ -826,7 +900,7 @@ namespace zypp
     }
   } // namespace
   ///////////////////////////////////////////////////////////////////
-  void RepoManager::Impl::init_knownRepositories()
+  void RepoManager::Impl::init_knownRepositories( repo::RepoDefinitionIndex & index_r )
   {
     MIL << "start construct known repos" << endl;
 
@@ -834,7 +908,7 @@ namespace zypp
     {
       std::list<std::string> repoEscAliases;
       std::list<RepoInfo> orphanedRepos;
-      for ( RepoInfo & repoInfo : repositories_in_dir(_options.knownReposPath) )
+      for ( RepoInfo & repoInfo : repositories_in_dir(_options.knownReposPath, &index_r) )
       {
         // set the metadata path for the repo
         repoInfo.setMetadataPath( rawcache_path_for_repoinfo(_options, repoInfo) );
@@ -1085,7 +1159,7 @@ namespace zypp
   }
 
 
-  void RepoManager::Impl::refreshMetadata( const RepoInfo & info, RawMetadataRefreshPolicy policy, const ProgressData::ReceiverFnc & progress )
+  RepoManager::RefreshCheckStatus RepoManager::Impl::refreshMetadata( const RepoInfo & info, RawMetadataRefreshPolicy policy, const ProgressData::ReceiverFnc & progress )
   {
     assert_alias(info);
     assert_urls(info);
@@ -1106,8 +1180,9 @@ namespace zypp
 
         // check whether to refresh metadata
         // if the check fails for this url, it throws, so another url will be checked
-        if (checkIfToRefreshMetadata(info, url, policy)!=REFRESH_NEEDED)
-          return;
+        RefreshCheckStatus checkStatus = checkIfToRefreshMetadata( info, url, policy );
+        if ( checkStatus != REFRESH_NEEDED )
+          return checkStatus;
 
         MIL << "Going to refresh metadata from " << url << endl;
 
@@ -1151,47 +1226,7 @@ namespace zypp
           ZYPP_THROW(ex);
         }
 
-        if ( ( repokind.toEnum() == RepoType::RPMMD_e ) ||
-             ( repokind.toEnum() == RepoType::YAST2_e ) )
-        {
-          MediaSetAccess media(url);
-          shared_ptr<repo::Downloader> downloader_ptr;
-
-          MIL << "Creating downloader for [ " << info.alias() << " ]" << endl;
-
-          if ( repokind.toEnum() == RepoType::RPMMD_e )
-            downloader_ptr.reset(new yum::Downloader(info, mediarootpath));
-          else
-            downloader_ptr.reset( new susetags::Downloader(info, mediarootpath) );
-
-          /**
-           * Given a downloader, sets the other repos raw metadata
-           * path as cache paths for the fetcher, so if another
-           * repo has the same file, it will not download it
-           * but copy it from the other repository
-           */
-          for_( it, repoBegin(), repoEnd() )
-          {
-            Pathname cachepath(rawcache_path_for_repoinfo( _options, *it ));
-            if ( PathInfo(cachepath).isExist() )
-              downloader_ptr->addCachePath(cachepath);
-          }
-
-          downloader_ptr->download( media, tmpdir.path() );
-        }
-        else if ( repokind.toEnum() == RepoType::RPMPLAINDIR_e )
-        {
-          MediaMounter media( url );
-          RepoStatus newstatus = RepoStatus( media.getPathName( info.path() ) );	// dir status
-
-          Pathname productpath( tmpdir.path() / info.path() );
-          filesystem::assert_dir( productpath );
-	  newstatus.saveToCookieFile( productpath/"cookie" );
-        }
-        else
-        {
-          ZYPP_THROW(RepoUnknownTypeException( info ));
-        }
+        downloadMetadata( info, url, repokind, tmpdir.path() );
 
         // ok we have the metadata, now exchange
         // the contents
@@ -1200,7 +1235,7 @@ namespace zypp
 	  reposManip();	// remember to trigger appdata refresh
 
         // we are done.
-        return;
+        return REFRESH_NEEDED;
       }
       catch ( const Exception &e )
       {
@@ -1221,6 +1256,238 @@ namespace zypp
     ZYPP_THROW(rexception);
   }
 
+
+  void RepoManager::Impl::downloadMetadata( const RepoInfo & info, const Url & url, const repo::RepoType & repokind, const Pathname & destdir_r, unsigned maxParallel_r )
+  {
+    Pathname mediarootpath = rawcache_path_for_repoinfo( _options, info );
+
+    if ( ( repokind.toEnum() == RepoType::RPMMD_e ) ||
+         ( repokind.toEnum() == RepoType::YAST2_e ) )
+    {
+      MediaSetAccess media(url);
+      shared_ptr<repo::Downloader> downloader_ptr;
+
+      MIL << "Creating downloader for [ " << info.alias() << " ]" << endl;
+
+      if ( repokind.toEnum() == RepoType::RPMMD_e )
+        downloader_ptr.reset(new yum::Downloader(info, mediarootpath));
+      else
+        downloader_ptr.reset( new susetags::Downloader(info, mediarootpath) );
+
+      /**
+       * Given a downloader, sets the other repos raw metadata
+       * path as cache paths for the fetcher, so if another
+       * repo has the same file, it will not download it
+       * but copy it from the other repository
+       */
+      for_( it, repoBegin(), repoEnd() )
+      {
+        Pathname cachepath(rawcache_path_for_repoinfo( _options, *it ));
+        if ( PathInfo(cachepath).isExist() )
+          downloader_ptr->addCachePath(cachepath);
+      }
+      // Files shared by mirrors are found by checksum, without rehashing
+      // the other repos files. Leftovers are purged by cleanCacheDirGarbage
+      // and once per batch refreshMetadata.
+      downloader_ptr->setContentStore( contentstore_path( _options ) );
+      // Download the metadata files in parallel, as MediaMultiCurl does for chunks.
+      if ( ! maxParallel_r )
+	maxParallel_r = std::max( ZConfig::instance().download_max_concurrent_connections(), 1L );
+      downloader_ptr->setMaxParallel( maxParallel_r );
+
+      downloader_ptr->download( media, destdir_r );
+    }
+    else if ( repokind.toEnum() == RepoType::RPMPLAINDIR_e )
+    {
+      MediaMounter media( url );
+      RepoStatus newstatus = RepoStatus( media.getPathName( info.path() ) );	// dir status
+
+      Pathname productpath( destdir_r / info.path() );
+      filesystem::assert_dir( productpath );
+      newstatus.saveToCookieFile( productpath/"cookie" );
+    }
+    else
+    {
+      ZYPP_THROW(RepoUnknownTypeException( info ));
+    }
+  }
+
+  ///////////////////////////////////////////////////////////////////
+  namespace
+  {
+    /** Exit codes of a forked \ref RepoManager::Impl::refreshMetadataWorker.
+     * Anything else (e.g. a crashing worker) is handled like \c RWS_FALLBACK.
+     */
+    enum RefreshWorkerStatus
+    {
+      RWS_UP_TO_DATE	= 10,	///< \ref RepoManager::REPO_UP_TO_DATE
+      RWS_DELAYED	= 11,	///< \ref RepoManager::REPO_CHECK_DELAYED
+      RWS_DOWNLOADED	= 12,	///< new raw metadata are available in the workers destdir
+      RWS_FALLBACK	= 13,	///< the parent must refresh the repo itself
+    };
+
+    /** Whether a repo may be handed to a forked refresh worker.
+     * Only downloading urls; we don't want to mount media in a worker.
+     */
+    inline bool refreshableByWorker( const RepoInfo & info_r )
+    {
+      if ( info_r.baseUrlsEmpty() )
+	return false;
+      for ( const Url & url : info_r.baseUrls() )
+      {
+	if ( ! url.schemeIsDownloading() )
+	  return false;
+      }
+      return true;
+    }
+  } // namespace
+  ///////////////////////////////////////////////////////////////////
+
+  int RepoManager::Impl::refreshMetadataWorker( const RepoInfo & info, RawMetadataRefreshPolicy policy, const Pathname & destdir_r, unsigned maxParallel_r )
+  {
+    // Requests which would require interaction fail and the repo is
+    // refreshed again by the parent process, the usual way.
+    ForkedWorkers::muteCallbacks();
+    media::ScopedDisableMediaChangeReport guard;
+    try
+    {
+      for ( const Url & url : info.baseUrls() )
+      {
+	try
+	{
+	  switch ( checkIfToRefreshMetadata( info, url, policy ) )
+	  {
+	    case REPO_UP_TO_DATE:	return RWS_UP_TO_DATE;	break;
+	    case REPO_CHECK_DELAYED:	return RWS_DELAYED;	break;
+	    case REFRESH_NEEDED:	break;
+	  }
+
+	  // A changed repo type must be stored in the .repo file,
+	  // that's up to the parent.
+	  repo::RepoType repokind = probe( url, info.path() );
+	  if ( repokind != info.type() )
+	    return RWS_FALLBACK;
+
+	  downloadMetadata( info, url, repokind, destdir_r, maxParallel_r );
+	  return RWS_DOWNLOADED;
+	}
+	catch ( const Exception & e )
+	{
+	  ZYPP_CAUGHT(e);
+	  ERR << "Worker trying another url..." << endl;
+	}
+      }
+    }
+    catch (...)
+    {}
+    return RWS_FALLBACK;
+  }
+
+  RepoManager::RefreshMetadataResults RepoManager::Impl::refreshMetadata( const std::list<RepoInfo> & repos_r, RawMetadataRefreshPolicy policy, unsigned maxParallel_r, const ProgressData::ReceiverFnc & progressrcv )
+  {
+    RefreshMetadataResults ret;
+
+    ProgressData progress( repos_r.size() );
+    progress.sendTo( progressrcv );
+    progress.toMin();
+
+    if ( ! maxParallel_r )
+      maxParallel_r = std::max( ZConfig::instance().download_max_concurrent_connections(), 1L );
+
+    // Per repo data of the workers. The TmpDir is created as sibling of the
+    // repos raw cache, so the downloaded metadata can be exchanged later.
+    struct Job
+    {
+      RepoInfo			info;
+      filesystem::TmpPath	destdir;
+      int			status = RWS_FALLBACK;
+    };
+    std::vector<Job> jobs;
+    jobs.reserve( repos_r.size() );
+    for ( const RepoInfo & info : repos_r )
+    {
+      jobs.push_back( Job() );
+      jobs.back().info = info;
+    }
+
+    // Phase 1: Let forked workers check and download the metadata of all repos
+    // available via a downloading url concurrently. Workers don't modify the
+    // raw cache; they just download into their destdir.
+    if ( maxParallel_r > 1 )
+    {
+      // download.max_concurrent_connections limits the whole process: the
+      // workers share it, rather than each pipelining its own downloads.
+      unsigned connections = std::max( ZConfig::instance().download_max_concurrent_connections(), 1L );
+      unsigned fetchParallel = std::max( connections / maxParallel_r, 1U );
+      ForkedWorkers workers( maxParallel_r );
+      for ( Job & job : jobs )
+      {
+	if ( job.info.alias().empty() || ! refreshableByWorker( job.info ) )
+	  continue;
+
+	Pathname mediarootpath = rawcache_path_for_repoinfo( _options, job.info );
+	if ( filesystem::assert_dir( mediarootpath ) )
+	  continue;
+	job.destdir = filesystem::TmpDir::makeSibling( mediarootpath );
+	if ( job.destdir.path().empty() )
+	  continue;
+
+	DBG << "Refresh worker for " << job.info.alias() << endl;
+	Job * jobp = &job;
+	workers.start( [&]() { return refreshMetadataWorker( job.info, policy, job.destdir.path(), fetchParallel ); },
+		       [jobp]( int exitcode_r ) { jobp->status = exitcode_r; } );	// failed fork stays RWS_FALLBACK
+      }
+      workers.waitAll();
+    }
+
+    // Phase 2: Commit the workers results and refresh the remaining repos
+    // serially, in the original order.
+    for ( Job & job : jobs )
+    {
+      RefreshMetadataResult res;
+      res.repo = job.info;
+      res.status = REFRESH_NEEDED;
+      try
+      {
+	switch ( job.status )
+	{
+	  case RWS_UP_TO_DATE:
+	    res.status = REPO_UP_TO_DATE;
+	    break;
+
+	  case RWS_DELAYED:
+	    res.status = REPO_CHECK_DELAYED;
+	    break;
+
+	  case RWS_DOWNLOADED:
+	    MIL << "Commit metadata downloaded by refresh worker for " << job.info.alias() << endl;
+	    filesystem::exchange( job.destdir.path(), rawcache_path_for_repoinfo( _options, job.info ) );
+	    if ( ! isTmpRepo( job.info ) )
+	      reposManip();	// remember to trigger appdata refresh
+	    break;
+
+	  default:
+	    res.status = refreshMetadata( job.info, policy );
+	    break;
+	}
+      }
+      catch ( const Exception & e )
+      {
+	ZYPP_CAUGHT(e);
+	ERR << "Refresh failed for " << job.info.alias() << endl;
+	res.error = std::current_exception();
+      }
+      ret.push_back( res );
+      progress.incr();
+    }
+
+    // Drop store entries no longer used by any raw cache.
+    repo::ContentStore( contentstore_path( _options ) ).purge();
+
+    progress.toMax();
+    return ret;
+  }
+
   ////////////////////////////////////////////////////////////////////////////
 
   void RepoManager::Impl::cleanMetadata( const RepoInfo & info, const ProgressData::ReceiverFnc & progressfnc )
@@ -1229,6 +1496,7 @@ namespace zypp
     progress.sendTo(progressfnc);
 
     filesystem::recursive_rmdir(rawcache_path_for_repoinfo(_options, info));
+    repo::ContentStore( contentstore_path( _options ) ).purge();
     progress.toMax();
   }
 
@@ -1276,9 +1544,7 @@ namespace zypp
         if ( policy == BuildIfNeeded )
 	{
 	  // On the fly add missing solv.idx files for bash completion.
-	  const Pathname & base = solv_path_for_repoinfo( _options, info);
-	  if ( ! PathInfo(base/"solv.idx").isExist() )
-	    sat::updateSolvFileIndex( base/"solv" );
+	  sat::ensureSolvFileIndex( solv_path_for_repoinfo( _options, info ) / "solv" );
 
 	  return;
         }
@@ -1344,6 +1610,31 @@ namespace zypp
         ManagedFile guard( solvfile, filesystem::unlink );
         scoped_ptr<MediaMounter> forPlainDirs;
 
+        Pathname metadatapath( productdatapath );
+        if ( repokind == RepoType::RPMPLAINDIR )
+        {
+          forPlainDirs.reset( new MediaMounter( info.url() ) );
+          // FIXME this does only work form dir: URLs
+          metadatapath = forPlainDirs->getPathName( info.path() );
+        }
+
+        if ( ! env::ZYPP_EXTERNAL_REPO2SOLV() )
+        {
+          // Parse in-process, writing solv and solv.idx in one pass.
+          try
+          {
+            repo::SolvFileBuilder( repokind, metadatapath ).build( solvfile );
+            // We keep it.
+            guard.resetDispose();
+            break;
+          }
+          catch ( const Exception & excpt )
+          {
+            ZYPP_CAUGHT( excpt );
+            WAR << "In-process cache build failed, falling back to repo2solv: " << excpt.asUserString() << endl;
+          }
+        }
+
         ExternalProgram::Arguments cmd;
         cmd.push_back( PathInfo( "/usr/bin/repo2solv" ).isFile() ? "repo2solv" : "repo2solv.sh" );
         // repo2solv expects -o as 1st arg!
@@ -1354,14 +1645,10 @@ namespace zypp
 
         if ( repokind == RepoType::RPMPLAINDIR )
         {
-          forPlainDirs.reset( new MediaMounter( info.url() ) );
           // recusive for plaindir as 2nd arg!
           cmd.push_back( "-R" );
-          // FIXME this does only work form dir: URLs
-          cmd.push_back( forPlainDirs->getPathName( info.path() ).c_str() );
         }
-        else
-          cmd.push_back( productdatapath.asString() );
+        cmd.push_back( metadatapath.asString() );
 
         ExternalProgram prog( cmd, ExternalProgram::Stderr_To_Stdout );
         std::string errdetail;
@@ -1398,6 +1685,203 @@ namespace zypp
     progress.toMax();
   }
 
+  ///////////////////////////////////////////////////////////////////
+  namespace
+  {
+    /** The forked worker process of a batch \ref buildCaches; returns the workers exit code. */
+    int buildCacheWorker( const repo::RepoType & repokind_r, const Pathname & metadatapath_r, const Pathname & solvfile_r )
+    {
+      try
+      {
+	repo::SolvFileBuilder( repokind_r, metadatapath_r ).build( solvfile_r );
+	return 0;
+      }
+      catch ( const Exception & e )
+      {
+	ZYPP_CAUGHT(e);
+      }
+      catch (...)
+      {}
+      return 1;
+    }
+  } // namespace
+  ///////////////////////////////////////////////////////////////////
+
+  RepoManager::BuildCacheResults RepoManager::Impl::buildCaches( const std::list<RepoInfo> & repos_r, CacheBuildPolicy policy, unsigned jobs_r, const ProgressData::ReceiverFnc & progressrcv )
+  {
+    BuildCacheResults ret;
+
+    ProgressData progress( repos_r.size() );
+    progress.sendTo( progressrcv );
+    progress.toMin();
+
+    if ( ! jobs_r )
+      jobs_r = ForkedWorkers::onlineCPUs();
+
+    // Per repo data of the workers. The TmpDir is created as sibling of the
+    // repos solv cache, so the new cache can be exchanged later.
+    struct Job
+    {
+      RepoInfo			info;
+      RepoStatus		rawStatus;
+      repo::RepoType		repokind;
+      Pathname			metadatapath;
+      shared_ptr<MediaMounter>	forPlainDirs;
+      filesystem::TmpPath	destdir;
+      bool			done = false;	///< cache is up to date or failed in preparation
+      int			status = -1;	///< worker exit code; 0 on success
+      std::exception_ptr	error;
+    };
+    std::vector<Job> jobs;
+    jobs.reserve( repos_r.size() );
+
+    // Phase 1: Serially check which repos need a new cache. Missing raw
+    // metadata are refreshed, plaindir media are attached.
+    if( filesystem::assert_dir(_options.repoCachePath) )
+    {
+      Exception ex(str::form( _("Can't create %s"), _options.repoCachePath.c_str()) );
+      ZYPP_THROW(ex);
+    }
+    for ( const RepoInfo & info : repos_r )
+    {
+      jobs.push_back( Job() );
+      Job & job( jobs.back() );
+      job.info = info;
+      try
+      {
+	assert_alias(info);
+	job.rawStatus = metadataStatus(info);
+	if ( job.rawStatus.empty() )
+	{
+	  refreshMetadata(info, RefreshIfNeeded );
+	  job.rawStatus = metadataStatus(info);
+	}
+
+	if ( policy == BuildIfNeeded && isCached( info ) && cacheStatus(info) == job.rawStatus )
+	{
+	  MIL << info.alias() << " cache is up to date with metadata." << endl;
+	  // On the fly add missing solv.idx files for bash completion.
+	  sat::ensureSolvFileIndex( solv_path_for_repoinfo( _options, info ) / "solv" );
+	  job.done = true;
+	  continue;
+	}
+
+	// Fail early like buildCache does, if the cache can't be written.
+	Pathname base = solv_path_for_repoinfo( _options, info );
+	if( filesystem::assert_dir(base) )
+	{
+	  Exception ex(str::form( _("Can't create %s"), base.c_str()) );
+	  ZYPP_THROW(ex);
+	}
+	if( ! PathInfo(base).userMayW() )
+	{
+	  Exception ex(str::form( _("Can't create cache at %s - no writing permissions."), base.c_str()) );
+	  ZYPP_THROW(ex);
+	}
+
+	job.repokind = info.type();
+	if ( job.repokind == RepoType::NONE )
+	  job.repokind = probeCache( rawproductdata_path_for_repoinfo( _options, info ) );
+
+	switch ( job.repokind.toEnum() )
+	{
+	  case RepoType::RPMMD_e :
+	  case RepoType::YAST2_e :
+	    job.metadatapath = rawproductdata_path_for_repoinfo( _options, info );
+	    break;
+	  case RepoType::RPMPLAINDIR_e :
+	    job.forPlainDirs.reset( new MediaMounter( info.url() ) );
+	    job.metadatapath = job.forPlainDirs->getPathName( info.path() );
+	    break;
+	  default:
+	    break;	// serial buildCache will tell
+	}
+      }
+      catch ( const Exception & e )
+      {
+	ZYPP_CAUGHT(e);
+	ERR << "Build cache preparation failed for " << info.alias() << endl;
+	job.error = std::current_exception();
+	job.done = true;
+      }
+    }
+
+    // Phase 2: Let forked workers parse the metadata and write the new
+    // caches concurrently. Workers don't modify the solv cache; they
+    // just write into their destdir.
+    if ( jobs_r > 1 && ! env::ZYPP_EXTERNAL_REPO2SOLV() )
+    {
+      ForkedWorkers workers( jobs_r );
+      for ( Job & job : jobs )
+      {
+	if ( job.done || job.metadatapath.empty() )
+	  continue;
+
+	// base exists (phase 1); the TmpDir clones its mode
+	job.destdir = filesystem::TmpDir::makeSibling( solv_path_for_repoinfo( _options, job.info ) );
+	if ( job.destdir.path().empty() )
+	  continue;
+
+	DBG << "Build cache worker for " << job.info.alias() << endl;
+	Job * jobp = &job;
+	workers.start( [&]() { return buildCacheWorker( job.repokind, job.metadatapath, job.destdir.path() / "solv" ); },
+		       [jobp]( int exitcode_r ) { jobp->status = exitcode_r; } );	// failed fork is built serially
+      }
+      workers.waitAll();
+    }
+
+    // Phase 3: Commit the new caches and their cookies and build the
+    // remaining repos serially, in the original order.
+    for ( Job & job : jobs )
+    {
+      BuildCacheResult res;
+      res.repo = job.info;
+      res.error = job.error;
+      if ( ! job.done )
+      {
+	try
+	{
+	  if ( job.status == 0 )
+	  {
+	    // Per repo progress as reported by buildCache.
+	    ProgressData repoprogress( 100 );
+	    callback::SendReport<ProgressReport> report;
+	    repoprogress.sendTo( ProgressReportAdaptor( ProgressData::ReceiverFnc(), report ) );
+	    repoprogress.name( str::form(_("Building repository '%s' cache"), job.info.label().c_str()) );
+	    repoprogress.toMin();
+
+	    MIL << "Commit cache built by worker for " << job.info.alias() << endl;
+	    Pathname base = solv_path_for_repoinfo( _options, job.info );
+	    if ( filesystem::exchange( job.destdir.path(), base ) != 0 )
+	    {
+	      Exception ex(str::form( _("Can't create %s"), base.c_str()) );
+	      ZYPP_THROW(ex);
+	    }
+	    setCacheStatus( job.info, job.rawStatus );
+	    repoprogress.toMax();
+	  }
+	  else
+	  {
+	    job.forPlainDirs.reset();	// buildCache attaches it again
+	    buildCache( job.info, policy );
+	  }
+	}
+	catch ( const Exception & e )
+	{
+	  ZYPP_CAUGHT(e);
+	  ERR << "Build cache failed for " << job.info.alias() << endl;
+	  res.error = std::current_exception();
+	}
+      }
+      job.destdir = filesystem::TmpPath();	// the old cache, if exchanged
+      ret.push_back( res );
+      progress.incr();
+    }
+
+    progress.toMax();
+    return ret;
+  }
+
   ////////////////////////////////////////////////////////////////////////////
 
 
@@ -1557,6 +2041,8 @@ namespace zypp
       else
         progress.set( progress.val() + 100 );
     }
+    // files no longer used by any raw cache
+    repo::ContentStore( contentstore_path( _options ) ).purge();
     progress.toMax();
   }
 
@@ -2568,7 +3054,10 @@ namespace zypp
   { return _pimpl->packagesPath( info ); }
 
   void RepoManager::refreshMetadata( const RepoInfo &info, RawMetadataRefreshPolicy policy, const ProgressData::ReceiverFnc & progressrcv )
-  { return _pimpl->refreshMetadata( info, policy, progressrcv ); }
+  { _pimpl->refreshMetadata( info, policy, progressrcv ); }
+
+  RepoManager::RefreshMetadataResults RepoManager::refreshMetadata( const std::list<RepoInfo> & repos_r, RawMetadataRefreshPolicy policy, unsigned maxParallel_r, const ProgressData::ReceiverFnc & progressrcv )
+  { return _pimpl->refreshMetadata( repos_r, policy, maxParallel_r, progressrcv ); }
 
   void RepoManager::cleanMetadata( const RepoInfo &info, const ProgressData::ReceiverFnc & progressrcv )
   { return _pimpl->cleanMetadata( info, progressrcv ); }
@@ -2582,6 +3071,9 @@ namespace zypp
   void RepoManager::buildCache( const RepoInfo &info, CacheBuildPolicy policy, const ProgressData::ReceiverFnc & progressrcv )
   { return _pimpl->buildCache( info, policy, progressrcv ); }
 
+  RepoManager::BuildCacheResults RepoManager::buildCaches( const std::list<RepoInfo> & repos_r, CacheBuildPolicy policy, unsigned jobs_r, const ProgressData::ReceiverFnc & progressrcv )
+  { return _pimpl->buildCaches( repos_r, policy, jobs_r, progressrcv ); }
+
   void RepoManager::cleanCache( const RepoInfo &info, const ProgressData::ReceiverFnc & progressrcv )
   { return _pimpl->cleanCache( info, progressrcv ); }
 
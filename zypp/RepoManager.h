@@ -14,6 +14,7 @@
 
 #include <iosfwd>
 #include <list>
+#include <exception>
 
 #include "zypp/base/PtrTypes.h"
 #include "zypp/base/Iterator.h"
@@ -301,6 +302,52 @@ namespace zypp
                          RawMetadataRefreshPolicy policy = RefreshIfNeeded,
                          const ProgressData::ReceiverFnc & progressrcv = ProgressData::ReceiverFnc() );
 
+   /** Outcome of refreshing a single repo in a batch \ref refreshMetadata. */
+   struct RefreshMetadataResult
+   {
+     RepoInfo repo;			///< The repository.
+     RefreshCheckStatus status;		///< \c REFRESH_NEEDED if new metadata were (tried to be) downloaded.
+     std::exception_ptr error;		///< The exception which made the refresh fail (if any).
+
+     /** Whether refreshing the repo failed (see \ref error). */
+     bool failed() const
+     { return bool(error); }
+   };
+   typedef std::list<RefreshMetadataResult> RefreshMetadataResults;
+
+   /**
+    * \short Refresh local raw cache of many repositories at once
+    *
+    * Repositories available via downloading urls (http, https, ftp...)
+    * are checked and downloaded concurrently, using up to \a maxParallel_r
+    * worker processes (\c 0 uses \ref ZConfig::download_max_concurrent_connections).
+    * The workers share the \c download.max_concurrent_connections for their
+    * pipelined file downloads (at least one each).
+    * The new metadata are committed to the raw cache in the order of
+    * \a repos_r. Workers do not talk to the user. Repos which need user
+    * interaction (e.g. to accept a new key or to provide credentials),
+    * change their type or fail in a worker are refreshed again serially,
+    * like \ref refreshMetadata(const RepoInfo&,RawMetadataRefreshPolicy,const ProgressData::ReceiverFnc&)
+    * would do. So are repos on local or mountable media.
+    *
+    * Errors do not stop the batch. They are remembered in the
+    * per repo \ref RefreshMetadataResult and can be rethrown via
+    * \c std::rethrow_exception. The progress is reported per repo.
+    *
+    * \code
+    *   for ( const auto & res : manager.refreshMetadata( repos ) )
+    *   {
+    *     if ( res.failed() )
+    *       try { std::rethrow_exception( res.error ); }
+    *       catch ( const repo::RepoException & excpt ) { ... }
+    *   }
+    * \endcode
+    */
+   RefreshMetadataResults refreshMetadata( const std::list<RepoInfo> & repos_r,
+                                           RawMetadataRefreshPolicy policy = RefreshIfNeeded,
+                                           unsigned maxParallel_r = 0,
+                                           const ProgressData::ReceiverFnc & progressrcv = ProgressData::ReceiverFnc() );
+
    /**
     * \short Clean local metadata
     *
@@ -350,6 +397,44 @@ namespace zypp
                     CacheBuildPolicy policy = BuildIfNeeded,
                     const ProgressData::ReceiverFnc & progressrcv = ProgressData::ReceiverFnc() );
 
+   /** Outcome of building a single repos cache in a batch \ref buildCaches. */
+   struct BuildCacheResult
+   {
+     RepoInfo repo;			///< The repository.
+     std::exception_ptr error;		///< The exception which made the build fail (if any).
+
+     /** Whether building the cache failed (see \ref error). */
+     bool failed() const
+     { return bool(error); }
+   };
+   typedef std::list<BuildCacheResult> BuildCacheResults;
+
+   /**
+    * \short Build the caches of many repositories at once
+    *
+    * Parsing the raw metadata and writing the solv-files is done
+    * concurrently, using up to \a jobs_r worker processes (\c 0 uses
+    * the number of online CPUs). Each worker writes into a private
+    * temporary directory. The new caches and their cookies are committed
+    * by the calling process in the order of \a repos_r, so a cache is
+    * either completely replaced or left untouched.
+    *
+    * Missing raw metadata are refreshed before. Repos whose cache is
+    * up to date are skipped if \a policy is \c BuildIfNeeded. Repos
+    * failing in a worker are built again serially, like \ref buildCache
+    * would do (using the external \c repo2solv as last resort).
+    *
+    * Errors do not stop the batch. They are remembered in the
+    * per repo \ref BuildCacheResult, e.g. the same exception
+    * \ref buildCache throws if the cache directory is not writable.
+    * \a progressrcv receives the progress of the whole batch; each
+    * repo built sends its own \ref ProgressReport like \ref buildCache.
+    */
+   BuildCacheResults buildCaches( const std::list<RepoInfo> & repos_r,
+                                  CacheBuildPolicy policy = BuildIfNeeded,
+                                  unsigned jobs_r = 0,
+                                  const ProgressData::ReceiverFnc & progressrcv = ProgressData::ReceiverFnc() );
+
    /**
     * \short clean local cache
     *
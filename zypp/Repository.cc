@@ -21,6 +21,7 @@
 #include "zypp/Pathname.h"
 
 #include "zypp/sat/detail/PoolImpl.h"
+#include "zypp/sat/detail/SearchIndex.h"
 #include "zypp/Repository.h"
 #include "zypp/ResPool.h"
 #include "zypp/Product.h"
@@ -328,11 +329,18 @@ namespace zypp
         ZYPP_THROW( Exception( "Can't open solv-file: "+file_r.asString() ) );
       }
 
+      // The search index covers the solvables of a solv-file loaded into an empty repo.
+      bool fresh = ( _repo->nsolvables == 0 );
+      sat::detail::SolvableIdType base = myPool().getPool()->nsolvables;
+
       if ( myPool()._addSolv( _repo, file ) != 0 )
       {
         ZYPP_THROW( Exception( "Error reading solv-file: "+file_r.asString() ) );
       }
 
+      if ( fresh )
+        myPool().setSearchIndex( _repo, sat::detail::SearchIndex::load( file_r, base, myPool().getPool()->nsolvables - base ) );
+
       MIL << *this << " after adding " << file_r << endl;
     }
 
@@ -323,6 +323,9 @@ namespace zypp
         , download_max_silent_tries	( 5 )
         , download_transfer_timeout	( 180 )
         , commit_downloadMode		( DownloadDefault )
+        , commit_downloadMaxParallel	( 4 )
+        , commit_downloadHeapSize	( 1024 )
+        , commit_singleRpmTransaction	( false )
 	, gpgCheck			( true )
 	, repoGpgCheck			( indeterminate )
 	, pkgGpgCheck			( indeterminate )
@@ -474,6 +477,20 @@ namespace zypp
                 {
                   commit_downloadMode.set( deserializeDownloadMode( value ) );
                 }
+                else if ( entry == "commit.downloadMaxParallel" )
+                {
+                  str::strtonum(value, commit_downloadMaxParallel);
+                  if ( commit_downloadMaxParallel < 1 )		commit_downloadMaxParallel = 1;
+                }
+                else if ( entry == "commit.downloadHeapSize" )
+                {
+                  str::strtonum(value, commit_downloadHeapSize);
+                  if ( commit_downloadHeapSize < 0 )		commit_downloadHeapSize = 0;
+                }
+                else if ( entry == "commit.singleRpmTransaction" )
+                {
+                  commit_singleRpmTransaction = str::strToBool( value, commit_singleRpmTransaction );
+                }
                 else if ( entry == "gpgcheck" )
 		{
 		  gpgCheck.restoreToDefault( str::strToBool( value, gpgCheck ) );
@@ -656,6 +673,9 @@ namespace zypp
     int download_transfer_timeout;
 
     Option<DownloadMode> commit_downloadMode;
+    int commit_downloadMaxParallel;
+    long commit_downloadHeapSize;	///< in MiB
+    bool commit_singleRpmTransaction;
 
     DefaultOption<bool>		gpgCheck;
     DefaultOption<TriBool>	repoGpgCheck;
@@ -1048,6 +1068,15 @@ namespace zypp
   DownloadMode ZConfig::commit_downloadMode() const
   { return _pimpl->commit_downloadMode; }
 
+  unsigned ZConfig::commit_downloadMaxParallel() const
+  { return _pimpl->commit_downloadMaxParallel; }
+
+  ByteCount ZConfig::commit_downloadHeapSize() const
+  { return ByteCount( _pimpl->commit_downloadHeapSize, ByteCount::MiB ); }
+
+  bool ZConfig::commit_singleRpmTransaction() const
+  { return _pimpl->commit_singleRpmTransaction; }
+
 
   bool ZConfig::gpgCheck() const			{ return _pimpl->gpgCheck; }
   TriBool ZConfig::repoGpgCheck() const			{ return _pimpl->repoGpgCheck; }
@@ -25,6 +25,7 @@
 #include "zypp/Pathname.h"
 #include "zypp/IdString.h"
 #include "zypp/TriBool.h"
+#include "zypp/ByteCount.h"
 
 #include "zypp/DownloadMode.h"
 #include "zypp/target/rpm/RpmFlags.h"
@@ -316,6 +317,27 @@ namespace zypp
        */
       DownloadMode commit_downloadMode() const;
 
+      /**
+       * Maximum number of packages to download concurrently in advance of a commit.
+       * \c 1 downloads one package after the other.
+       * Config option <tt>commit.downloadMaxParallel (4)</tt>
+       */
+      unsigned commit_downloadMaxParallel() const;
+
+      /**
+       * Maximum download size of a heap if the transaction is committed \ref DownloadInHeaps.
+       * \c 0 commits the whole transaction as one heap.
+       * Config option <tt>commit.downloadHeapSize (1024 MiB)</tt>
+       */
+      ByteCount commit_downloadHeapSize() const;
+
+      /**
+       * Whether to install and remove the packages of a commit within a single
+       * rpm transaction, instead of running \c rpm once per package.
+       * Config option <tt>commit.singleRpmTransaction (false)</tt>
+       */
+      bool commit_singleRpmTransaction() const;
+
       /** \name Signature checking (repodata and packages)
        * If \ref gpgcheck is \c on (the default) we will either check the signature
        * of repo metadata (packages are secured via checksum in the metadata), or the
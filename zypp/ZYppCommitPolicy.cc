@@ -34,6 +34,9 @@ namespace zypp
       : _restrictToMedia	( 0 )
       , _dryRun			( false )
       , _downloadMode		( ZConfig::instance().commit_downloadMode() )
+      , _downloadMaxParallel	( ZConfig::instance().commit_downloadMaxParallel() )
+      , _downloadHeapSize	( ZConfig::instance().commit_downloadHeapSize() )
+      , _singleRpmTransaction	( ZConfig::instance().commit_singleRpmTransaction() )
       , _rpmInstFlags		( ZConfig::instance().rpmInstallFlags() )
       , _syncPoolAfterCommit	( true )
       {}
@@ -42,6 +45,9 @@ namespace zypp
       unsigned			_restrictToMedia;
       bool			_dryRun;
       DownloadMode		_downloadMode;
+      unsigned			_downloadMaxParallel;
+      ByteCount			_downloadHeapSize;
+      bool			_singleRpmTransaction;
       target::rpm::RpmInstFlags	_rpmInstFlags;
       bool			_syncPoolAfterCommit;
 
@@ -83,6 +89,26 @@ namespace zypp
   { return _pimpl->_downloadMode; }
 
 
+  ZYppCommitPolicy & ZYppCommitPolicy::downloadMaxParallel( unsigned val_r )
+  { _pimpl->_downloadMaxParallel = ( val_r ? val_r : 1 ); return *this; }
+
+  unsigned ZYppCommitPolicy::downloadMaxParallel() const
+  { return _pimpl->_downloadMaxParallel; }
+
+  ZYppCommitPolicy & ZYppCommitPolicy::downloadHeapSize( ByteCount val_r )
+  { _pimpl->_downloadHeapSize = val_r; return *this; }
+
+  ByteCount ZYppCommitPolicy::downloadHeapSize() const
+  { return _pimpl->_downloadHeapSize; }
+
+
+  ZYppCommitPolicy & ZYppCommitPolicy::singleRpmTransaction( bool yesNo_r )
+  { _pimpl->_singleRpmTransaction = yesNo_r; return *this; }
+
+  bool ZYppCommitPolicy::singleRpmTransaction() const
+  { return _pimpl->_singleRpmTransaction; }
+
+
   ZYppCommitPolicy &  ZYppCommitPolicy::rpmInstFlags( target::rpm::RpmInstFlags newFlags_r )
   { _pimpl->_rpmInstFlags = newFlags_r; return *this; }
 
@@ -117,6 +143,12 @@ namespace zypp
     if ( obj.dryRun() )
       str << " dryRun";
     str << " " << obj.downloadMode();
+    if ( obj.downloadMaxParallel() > 1 )
+      str << " downloadMaxParallel:" << obj.downloadMaxParallel();
+    if ( obj.downloadMode() == DownloadInHeaps )
+      str << " downloadHeapSize:" << obj.downloadHeapSize();
+    if ( obj.singleRpmTransaction() )
+      str << " singleRpmTransaction";
     if ( obj.syncPoolAfterCommit() )
       str << " syncPoolAfterCommit";
     if ( obj.rpmInstFlags() )
@@ -16,6 +16,7 @@
 
 #include "zypp/base/PtrTypes.h"
 
+#include "zypp/ByteCount.h"
 #include "zypp/DownloadMode.h"
 #include "zypp/target/rpm/RpmFlags.h"
 
@@ -68,6 +69,27 @@ namespace zypp
 
       DownloadMode downloadMode() const;
 
+      /** Maximum number of packages to download concurrently in advance of the installation.
+       * (default: \ref ZConfig::commit_downloadMaxParallel)
+       * \c 1 downloads one package after the other.
+       */
+      ZYppCommitPolicy & downloadMaxParallel( unsigned val_r );
+      unsigned downloadMaxParallel() const;
+
+      /** Maximum download size of a heap if committing \ref DownloadInHeaps.
+       * (default: \ref ZConfig::commit_downloadHeapSize)
+       * \c 0 commits the whole transaction as one heap.
+       */
+      ZYppCommitPolicy & downloadHeapSize( ByteCount val_r );
+      ByteCount downloadHeapSize() const;
+
+      /** Whether to commit the packages within a single rpm transaction.
+       * (default: \ref ZConfig::commit_singleRpmTransaction)
+       * Not used with \ref DownloadAsNeeded or \ref dryRun.
+       */
+      ZYppCommitPolicy & singleRpmTransaction( bool yesNo_r );
+      bool singleRpmTransaction() const;
+
 
       /** The default \ref target::rpm::RpmInstFlags. (default: none)*/
       ZYppCommitPolicy &  rpmInstFlags( target::rpm::RpmInstFlags newFlags_r );
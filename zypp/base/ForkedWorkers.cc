@@ -0,0 +1,163 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/base/ForkedWorkers.cc
+ *
+*/
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+
+#include <iostream>
+
+#include "zypp/base/LogTools.h"
+#include "zypp/base/Errno.h"
+#include "zypp/base/ForkedWorkers_p.h"
+
+#include "zypp/ZYppCallbacks.h"
+#include "zypp/KeyRing.h"
+#include "zypp/Digest.h"
+
+using std::endl;
+
+namespace zypp
+{
+  ForkedWorkers::ForkedWorkers( unsigned maxParallel_r )
+  : _maxParallel( maxParallel_r ? maxParallel_r : 1 )
+  {}
+
+  unsigned ForkedWorkers::onlineCPUs()
+  {
+    long cpus = ::sysconf( _SC_NPROCESSORS_ONLN );
+    return( cpus > 0 ? cpus : 1 );
+  }
+
+  void ForkedWorkers::muteCallbacks()
+  {
+    callback::DistributeReport<ProgressReport>::instance().noReceiver();
+    callback::DistributeReport<JobReport>::instance().noReceiver();
+    callback::DistributeReport<media::MediaChangeReport>::instance().noReceiver();
+    callback::DistributeReport<media::DownloadProgressReport>::instance().noReceiver();
+    callback::DistributeReport<media::AuthenticationReport>::instance().noReceiver();
+    callback::DistributeReport<repo::DownloadResolvableReport>::instance().noReceiver();
+    callback::DistributeReport<KeyRingReport>::instance().noReceiver();
+    callback::DistributeReport<KeyRingSignals>::instance().noReceiver();
+    callback::DistributeReport<DigestReport>::instance().noReceiver();
+  }
+
+  ForkedWorkers::~ForkedWorkers()
+  {
+    try { waitAll(); }
+    catch (...) {}
+  }
+
+  bool ForkedWorkers::start( const Task & task_r, const Done & done_r )
+  {
+    while ( full() )
+      reap( /*block*/true );
+
+    int fds[2];
+    if ( ::pipe2( fds, O_CLOEXEC ) == -1 )
+    {
+      ERR << "Worker pipe failed: " << Errno() << endl;
+      return false;
+    }
+
+    pid_t pid = ::fork();
+    if ( pid == pid_t(-1) )
+    {
+      ERR << "Worker fork failed: " << Errno() << endl;
+      ::close( fds[0] );
+      ::close( fds[1] );
+      return false;
+    }
+    else if ( pid == 0 )
+    {
+      ::close( fds[0] );
+      int ret = 255;
+      try
+      {
+	ret = task_r();
+      }
+      catch (...)
+      {}
+      // No dtors: the calling process owns all resources.
+      // fds[1] is closed on exit and signals EOF.
+      ::_exit( ret );
+    }
+
+    ::close( fds[1] );
+    _workers.push_back( Worker{ pid, fds[0], done_r } );
+    DBG << "Worker " << pid << " started (" << running() << "/" << maxParallel() << ")" << endl;
+    return true;
+  }
+
+  unsigned ForkedWorkers::reap( bool block_r )
+  {
+    if ( _workers.empty() )
+      return 0;
+
+    std::vector<struct pollfd> pfds( _workers.size() );
+    for ( unsigned i = 0; i < _workers.size(); ++i )
+    {
+      pfds[i].fd = _workers[i].fd;
+      pfds[i].events = POLLIN;
+      pfds[i].revents = 0;
+    }
+
+    int res = 0;
+    do {
+      res = ::poll( &pfds[0], pfds.size(), block_r ? -1 : 0 );
+    } while ( res == -1 && errno == EINTR );
+
+    if ( res <= 0 )
+    {
+      if ( res == -1 )
+	ERR << "Worker poll failed: " << Errno() << endl;
+      return 0;
+    }
+
+    // Collect finished workers first; Done may start new ones.
+    std::vector<Worker> finished;
+    std::vector<Worker> stillRunning;
+    for ( unsigned i = 0; i < _workers.size(); ++i )
+    {
+      if ( pfds[i].revents )
+	finished.push_back( _workers[i] );
+      else
+	stillRunning.push_back( _workers[i] );
+    }
+    _workers.swap( stillRunning );
+
+    for ( Worker & worker : finished )
+    {
+      // The pipe is closed when the worker exits, so this does not block for long.
+      int status = 0;
+      pid_t wpid = 0;
+      do {
+	wpid = ::waitpid( worker.pid, &status, 0 );
+      } while ( wpid == -1 && errno == EINTR );
+      ::close( worker.fd );
+
+      int exitcode = ( wpid == worker.pid && WIFEXITED( status ) ) ? WEXITSTATUS( status ) : -1;
+      DBG << "Worker " << worker.pid << " returned " << exitcode << endl;
+      if ( worker.done )
+	worker.done( exitcode );
+    }
+    return finished.size();
+  }
+
+  void ForkedWorkers::waitAll()
+  {
+    while ( ! _workers.empty() )
+      reap( /*block*/true );
+  }
+
+} // namespace zypp
@@ -0,0 +1,117 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/base/ForkedWorkers_p.h
+ * This file contains private API, it will change without notice.
+ * You have been warned.
+*/
+#ifndef ZYPP_BASE_FORKEDWORKERS_P_H
+#define ZYPP_BASE_FORKEDWORKERS_P_H
+
+#include <unistd.h>
+#include <vector>
+
+#include "zypp/APIConfig.h"
+#include "zypp/base/NonCopyable.h"
+#include "zypp/base/Function.h"
+
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  /// \class ForkedWorkers
+  /// \brief Run tasks concurrently in up to N forked worker processes.
+  ///
+  /// libzypp is not thread safe (callbacks, MediaManager, logging...).
+  /// A worker is a forked copy of the calling process. It executes a
+  /// \ref Task and passes the tasks \c int result back as exit code.
+  /// Changes a task makes to the process state are lost, so tasks should
+  /// leave their results in the filesystem. Tasks must not interact with
+  /// the user; call \ref muteCallbacks in the task.
+  ///
+  /// The calling process is notified about a finished worker via the
+  /// \ref Done callback, which is invoked from \ref start, \ref reap or
+  /// \ref waitAll.
+  ///
+  /// Workers are waited for by pid (like \ref CleanerThread does), so other
+  /// children of the process (\ref ExternalProgram, plugins) are not affected.
+  ///
+  /// \code
+  ///   ForkedWorkers workers( 4 );
+  ///   for ( const auto & job : jobs )
+  ///     workers.start( [&]() { return doJob( job ); },
+  ///                    [&]( int exitcode_r ) { job.status = exitcode_r; } );
+  ///   workers.waitAll();
+  /// \endcode
+  ///////////////////////////////////////////////////////////////////
+  class ZYPP_LOCAL ForkedWorkers : private base::NonCopyable
+  {
+  public:
+    /** Executed in the worker; the result is the workers exit code (0..255). */
+    typedef function<int()> Task;
+    /** Executed in the calling process; the workers exit code or \c -1 if it did not exit normally. */
+    typedef function<void(int)> Done;
+
+  public:
+    /** Ctor taking the maximum number of concurrent workers (at least \c 1). */
+    explicit ForkedWorkers( unsigned maxParallel_r );
+
+    /** The number of online CPUs (at least \c 1); a reasonable \c maxParallel for CPU bound tasks. */
+    static unsigned onlineCPUs();
+
+    /** Disconnect all receivers of user interacting reports (progress, media, auth, keyring, digest...).
+     * To be called by a \ref Task: a worker must not talk to the user. Requests which
+     * would require interaction fail, so the parent can redo the job the usual way.
+     * \note Does not disable the media change request itself; use a
+     * \ref media::ScopedDisableMediaChangeReport for this.
+     */
+    static void muteCallbacks();
+
+    /** Dtor waits for running workers (their \ref Done is invoked). */
+    ~ForkedWorkers();
+
+  public:
+    /** Maximum number of concurrent workers. */
+    unsigned maxParallel() const
+    { return _maxParallel; }
+
+    /** Number of running workers. */
+    unsigned running() const
+    { return _workers.size(); }
+
+    /** Whether \ref maxParallel workers are running. */
+    bool full() const
+    { return running() >= maxParallel(); }
+
+    /** Fork a worker executing \a task_r.
+     * If already \ref full, wait for a worker to finish first.
+     * Returns \c false if the worker could not be forked (\a done_r is not invoked then).
+     */
+    bool start( const Task & task_r, const Done & done_r );
+
+    /** Reap finished workers and invoke their \ref Done.
+     * If \a block_r is set and workers are running, wait for at least one to finish.
+     * Returns the number of workers reaped.
+     */
+    unsigned reap( bool block_r = false );
+
+    /** Wait for all running workers to finish. */
+    void waitAll();
+
+  private:
+    struct Worker
+    {
+      pid_t pid;	///< the worker process
+      int   fd;		///< read end of a pipe; EOF when the worker exits
+      Done  done;
+    };
+    unsigned            _maxParallel;
+    std::vector<Worker> _workers;
+  };
+
+} // namespace zypp
+#endif // ZYPP_BASE_FORKEDWORKERS_P_H
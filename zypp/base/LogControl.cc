@@ -9,9 +9,19 @@
 /** \file	zypp/base/LogControl.cc
  *
 */
+#include <fcntl.h>
+#include <pthread.h>
+#include <cerrno>
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
+#include <typeinfo>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 #include "zypp/base/Logger.h"
 #include "zypp/base/LogControl.h"
@@ -107,6 +117,47 @@ namespace zypp
   namespace base
   { /////////////////////////////////////////////////////////////////
 
+    ///////////////////////////////////////////////////////////////////
+    namespace
+    {
+      /** Hostname and pid are looked up once (the pid again after fork). */
+      struct ProcessInfo
+      {
+	static ProcessInfo & instance()
+	{
+	  static ProcessInfo _instance;
+	  return _instance;
+	}
+
+	std::string       _hostname;
+	std::atomic<pid_t> _pid;
+
+      private:
+	ProcessInfo()
+	: _pid( ::getpid() )
+	{
+	  char hostname[1024];
+	  _hostname = ( ::gethostname( hostname, sizeof(hostname) ) ? "unknown" : hostname );
+	  ::pthread_atfork( nullptr, nullptr, []() { instance()._pid = ::getpid(); } );
+	}
+      };
+
+      /** The current time formated; reformated once per second. */
+      inline const std::string & nowString()
+      {
+	static thread_local Date::ValueType _last = -1;
+	static thread_local std::string _str;
+	Date now( Date::now() );
+	if ( now != _last )
+	{
+	  _str = now.form( "%Y-%m-%d %H:%M:%S" );
+	  _last = now;
+	}
+	return _str;
+      }
+    } // namespace
+    ///////////////////////////////////////////////////////////////////
+
     ///////////////////////////////////////////////////////////////////
     // LineFormater
     ///////////////////////////////////////////////////////////////////
@@ -117,13 +168,11 @@ namespace zypp
                                                   int                 line_r,
                                                   const std::string & message_r )
     {
-      static char hostname[1024];
-      static char nohostname[] = "unknown";
-      std::string now( Date::now().form( "%Y-%m-%d %H:%M:%S" ) );
+      const ProcessInfo & process( ProcessInfo::instance() );
       return str::form( "%s <%d> %s(%d) [%s] %s(%s):%d %s",
-                        now.c_str(), level_r,
-                        ( gethostname( hostname, 1024 ) ? nohostname : hostname ),
-                        getpid(),
+                        nowString().c_str(), level_r,
+                        process._hostname.c_str(),
+                        process._pid.load(),
                         group_r.c_str(),
                         file_r, func_r, line_r,
                         message_r.c_str() );
@@ -247,6 +296,266 @@ namespace zypp
       };
       ///////////////////////////////////////////////////////////////////
 
+      ///////////////////////////////////////////////////////////////////
+      /// \class AsyncFileLineWriter
+      /// \brief \ref LineWriter to file, writing in a background thread.
+      ///
+      /// \ref writeOut just queues the line in a lock-free ring buffer
+      /// (bounded MPMC queue as described by D. Vyukov). The writer thread
+      /// wakes up periodically or if the ring fills up, and writes all
+      /// queued lines at once. \ref flush waits until everything queued
+      /// is written.
+      ///
+      /// Queued lines are flushed before \c fork. The child process has no
+      /// writer thread and writes synchronously.
+      ///////////////////////////////////////////////////////////////////
+      class AsyncFileLineWriter : public LogControl::LineWriter
+      {
+	static const size_t _capacity = 4096;	// power of 2
+	static const size_t _mask = _capacity - 1;
+
+	struct Cell
+	{
+	  std::atomic<size_t> _seq;
+	  std::string         _data;
+	};
+
+      public:
+	AsyncFileLineWriter( const Pathname & file_r, mode_t mode_r )
+	: _fd( -1 )
+	, _ring( _capacity )
+	, _enqueuePos( 0 )
+	, _dequeuePos( 0 )
+	, _written( 0 )
+	, _wakeup( false )
+	, _stop( false )
+	{
+	  resetRing();
+	  // not filesystem:: functions as they log
+	  _fd = ::open( file_r.c_str(), O_WRONLY|O_CREAT|O_APPEND|O_CLOEXEC, mode_r ? mode_r : 0640 );
+
+	  static std::once_flag registered;
+	  std::call_once( registered, []() {
+	    ::pthread_atfork( []() { if ( _active ) _active.load()->flush(); },
+			      nullptr,
+			      []() { if ( _active ) _active.load()->forkedChild(); } );
+	  } );
+	  try
+	  {
+	    _thread.reset( new std::thread( [this]() { run(); } ) );
+	  }
+	  catch ( const std::exception & )
+	  {}	// write synchronously
+	  _active = this;
+	}
+
+	virtual ~AsyncFileLineWriter()
+	{
+	  AsyncFileLineWriter * self = this;
+	  _active.compare_exchange_strong( self, nullptr );
+	  if ( _thread )
+	  {
+	    {
+	      std::lock_guard<std::mutex> lock( _mutex );
+	      _stop = true;
+	    }
+	    _cv.notify_one();
+	    _thread->join();
+	  }
+	  drain();
+	  if ( _fd != -1 )
+	    ::close( _fd );
+	}
+
+	virtual void writeOut( const std::string & formated_r )
+	{
+	  std::string rec;
+	  rec.reserve( formated_r.size() + 1 );
+	  rec += formated_r;
+	  rec += '\n';
+
+	  if ( ! _thread )
+	  {
+	    writeAll( rec );
+	    return;
+	  }
+
+	  while ( ! tryPush( rec ) )
+	  {
+	    wakeup();
+	    std::this_thread::yield();
+	  }
+	  if ( _enqueuePos.load( std::memory_order_relaxed ) - _dequeuePos.load( std::memory_order_relaxed ) > _capacity / 2 )
+	    wakeup();
+	}
+
+	/** Wait until all lines queued so far are written. */
+	void flush()
+	{
+	  if ( ! _thread )
+	    return;
+	  size_t target = _enqueuePos.load();
+	  wakeup();
+	  std::unique_lock<std::mutex> lock( _mutex );
+	  _flushed.wait( lock, [this,target]() { return _written >= target; } );
+	}
+
+      private:
+	void wakeup()
+	{
+	  {
+	    std::lock_guard<std::mutex> lock( _mutex );
+	    _wakeup = true;
+	  }
+	  _cv.notify_one();
+	}
+
+	/** The writer thread. */
+	void run()
+	{
+	  bool stop = false;
+	  while ( ! stop )
+	  {
+	    {
+	      std::unique_lock<std::mutex> lock( _mutex );
+	      _cv.wait_for( lock, std::chrono::milliseconds( 200 ), [this]() { return _wakeup || _stop; } );
+	      _wakeup = false;
+	      stop = _stop;
+	    }
+	    drain();
+	    {
+	      std::lock_guard<std::mutex> lock( _mutex );
+	      _written = _dequeuePos.load();
+	    }
+	    _flushed.notify_all();
+	  }
+	}
+
+	/** Write all queued lines. */
+	void drain()
+	{
+	  std::string batch;
+	  std::string rec;
+	  while ( tryPop( rec ) )
+	  {
+	    batch += rec;
+	    if ( batch.size() >= 65536 )
+	    {
+	      writeAll( batch );
+	      batch.clear();
+	    }
+	  }
+	  writeAll( batch );
+	}
+
+	void writeAll( const std::string & data_r )
+	{
+	  const char * data = data_r.data();
+	  size_t size = data_r.size();
+	  while ( size && _fd != -1 )
+	  {
+	    ssize_t n = ::write( _fd, data, size );
+	    if ( n < 0 )
+	    {
+	      if ( errno == EINTR )
+		continue;
+	      break;
+	    }
+	    data += n;
+	    size -= n;
+	  }
+	}
+
+	/** After fork: no thread in the child. Lines queued
+	 * after the flush belong to the parent.
+	 */
+	void forkedChild()
+	{
+	  _thread.release();	// must not be joined or destructed
+	  resetRing();
+	}
+
+	void resetRing()
+	{
+	  for ( size_t i = 0; i < _capacity; ++i )
+	  {
+	    _ring[i]._seq.store( i, std::memory_order_relaxed );
+	    _ring[i]._data.clear();
+	  }
+	  _enqueuePos = 0;
+	  _dequeuePos = 0;
+	}
+
+	bool tryPush( std::string & rec_r )
+	{
+	  Cell * cell;
+	  size_t pos = _enqueuePos.load( std::memory_order_relaxed );
+	  while ( true )
+	  {
+	    cell = &_ring[pos & _mask];
+	    size_t seq = cell->_seq.load( std::memory_order_acquire );
+	    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+	    if ( diff == 0 )
+	    {
+	      if ( _enqueuePos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+		break;
+	    }
+	    else if ( diff < 0 )
+	      return false;	// full
+	    else
+	      pos = _enqueuePos.load( std::memory_order_relaxed );
+	  }
+	  cell->_data.swap( rec_r );
+	  cell->_seq.store( pos + 1, std::memory_order_release );
+	  return true;
+	}
+
+	bool tryPop( std::string & rec_r )
+	{
+	  Cell * cell;
+	  size_t pos = _dequeuePos.load( std::memory_order_relaxed );
+	  while ( true )
+	  {
+	    cell = &_ring[pos & _mask];
+	    size_t seq = cell->_seq.load( std::memory_order_acquire );
+	    intptr_t diff = (intptr_t)seq - (intptr_t)( pos + 1 );
+	    if ( diff == 0 )
+	    {
+	      if ( _dequeuePos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+		break;
+	    }
+	    else if ( diff < 0 )
+	      return false;	// empty
+	    else
+	      pos = _dequeuePos.load( std::memory_order_relaxed );
+	  }
+	  rec_r.clear();
+	  rec_r.swap( cell->_data );
+	  cell->_seq.store( pos + _mask + 1, std::memory_order_release );
+	  return true;
+	}
+
+      private:
+	int _fd;
+	std::vector<Cell>   _ring;
+	std::atomic<size_t> _enqueuePos;
+	std::atomic<size_t> _dequeuePos;
+
+	std::mutex              _mutex;		///< guards the members below
+	std::condition_variable _cv;		///< wakes the writer thread
+	std::condition_variable _flushed;	///< writer thread wrote up to _written
+	size_t _written;
+	bool   _wakeup;
+	bool   _stop;
+
+	std::unique_ptr<std::thread> _thread;
+
+	static std::atomic<AsyncFileLineWriter*> _active;	///< flushed at fork
+      };
+
+      std::atomic<AsyncFileLineWriter*> AsyncFileLineWriter::_active( nullptr );
+      ///////////////////////////////////////////////////////////////////
+
       ///////////////////////////////////////////////////////////////////
       //
       //	CLASS NAME : LogControlImpl
@@ -287,17 +596,45 @@ namespace zypp
 
         void logfile( const Pathname & logfile_r, mode_t mode_r = 0640 )
         {
+          _asyncWriter.reset();
           if ( logfile_r.empty() )
             setLineWriter( shared_ptr<LogControl::LineWriter>() );
           else if ( logfile_r == Pathname( "-" ) )
             setLineWriter( shared_ptr<LogControl::LineWriter>(new log::StderrLineWriter) );
+          else if ( _async )
+          {
+            _asyncWriter.reset( new AsyncFileLineWriter( logfile_r, mode_r ) );
+            setLineWriter( _asyncWriter );
+            _logfile = logfile_r;
+          }
           else
+          {
             setLineWriter( shared_ptr<LogControl::LineWriter>(new log::FileLineWriter(logfile_r, mode_r)) );
+            _logfile = logfile_r;
+          }
+        }
+
+        /** Switching the mode reopens a logfile we are writing. */
+        void logAsync( bool onOff_r )
+        {
+          if ( _async == onOff_r )
+            return;
+          _async = onOff_r;
+          if ( _lineWriter && ! _logfile.empty() )
+          {
+            bool ours = ( _asyncWriter ? _lineWriter == _asyncWriter
+                                       : typeid(*_lineWriter) == typeid(log::FileLineWriter) );
+            if ( ours )
+              logfile( _logfile, 0 );
+          }
         }
 
       private:
         std::ostream _no_stream;
         bool         _excessive;
+        bool         _async;
+        Pathname     _logfile;	///< the last logfile opened
+        shared_ptr<AsyncFileLineWriter> _asyncWriter;	///< if in use
 
         shared_ptr<LogControl::LineFormater> _lineFormater;
         shared_ptr<LogControl::LineWriter>   _lineWriter;
@@ -337,9 +674,13 @@ namespace zypp
                         const std::string & message_r )
         {
           if ( _lineWriter )
+          {
             _lineWriter->writeOut( _lineFormater->format( group_r, level_r,
                                                           file_r, func_r, line_r,
                                                           message_r ) );
+            if ( _asyncWriter && level_r >= E_ERR && level_r != E_XXX && _lineWriter == _asyncWriter )
+              _asyncWriter->flush();
+          }
         }
 
       private:
@@ -356,6 +697,7 @@ namespace zypp
         LogControlImpl()
         : _no_stream( NULL )
         , _excessive( getenv("ZYPP_FULLLOG") )
+        , _async( getenv("ZYPP_LOGASYNC") )
         , _lineFormater( new LogControl::LineFormater )
         {
           if ( getenv("ZYPP_LOGFILE") )
@@ -371,6 +713,7 @@ namespace zypp
         ~LogControlImpl()
         {
           _lineWriter.reset();
+          _asyncWriter.reset();	// flushes
         }
 
       public:
@@ -459,6 +802,9 @@ namespace zypp
     void LogControl::setLineFormater( const shared_ptr<LineFormater> & formater_r )
     { LogControlImpl::instance().setLineFormater( formater_r ); }
 
+    void LogControl::logAsync( bool onOff_r )
+    { LogControlImpl::instance().logAsync( onOff_r ); }
+
     void LogControl::logNothing()
     { LogControlImpl::instance().setLineWriter( shared_ptr<LineWriter>() ); }
 
@@ -138,6 +138,15 @@ namespace zypp
       void logfile( const Pathname & logfile_r );
       void logfile( const Pathname & logfile_r, mode_t mode_r );
 
+      /** Write the logfile in a background thread.
+       * The loglines are still formated by the caller, but queued and
+       * written in batches. Errors are written immediately, pending
+       * lines before \c fork and at exit. Default is off unless
+       * \c $ZYPP_LOGASYNC is set. Switching the mode reopens the
+       * current logfile.
+      */
+      void logAsync( bool onOff_r );
+
       /** Turn off logging. */
       void logNothing();
 
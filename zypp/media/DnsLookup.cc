@@ -0,0 +1,129 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/media/DnsLookup.cc
+ *
+*/
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <signal.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include <iostream>
+
+#include "zypp/base/Logger.h"
+#include "zypp/media/DnsLookup_p.h"
+
+using std::endl;
+
+namespace zypp
+{
+  namespace media
+  {
+    namespace
+    {
+      // The request handed to getaddrinfo_a. The resolver thread calls
+      // notify when it is done; the request owns the sending end of the
+      // socket and frees itself, so the DnsLookup may close its end at
+      // any time.
+      struct Request
+      {
+	struct gaicb _cb;
+	struct addrinfo _hints;
+	std::string _host;
+	int _notifyfd;
+
+	static void notify( union sigval sv )
+	{
+	  Request * me = reinterpret_cast<Request *>( sv.sival_ptr );
+	  int err = gai_error( &me->_cb );
+	  // no SIGPIPE if the DnsLookup is already gone
+	  (void)send( me->_notifyfd, &err, sizeof(err), MSG_NOSIGNAL );
+	  close( me->_notifyfd );
+	  if ( me->_cb.ar_result )
+	    freeaddrinfo( me->_cb.ar_result );
+	  delete me;
+	}
+      };
+    } // namespace
+
+    DnsLookup::DnsLookup( const std::string & host_r )
+    : _fd( -1 )
+    , _result( EAI_SYSTEM )
+    {
+      int sockfds[2];
+      if ( socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockfds ) )
+      {
+	WAR << "DNS socket creation failed: " << strerror( errno ) << endl;
+	return;
+      }
+      Request * req = new Request;
+      memset( &req->_cb, 0, sizeof(req->_cb) );
+      memset( &req->_hints, 0, sizeof(req->_hints) );
+      req->_host = host_r;
+      req->_notifyfd = sockfds[1];
+      req->_hints.ai_family = PF_UNSPEC;
+      int tstsock = socket( PF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0 );
+      if ( tstsock == -1 )
+	req->_hints.ai_family = PF_INET;
+      else
+	close( tstsock );
+      req->_hints.ai_socktype = SOCK_STREAM;
+      req->_hints.ai_flags = AI_CANONNAME;
+      req->_cb.ar_name = req->_host.c_str();
+      req->_cb.ar_request = &req->_hints;
+
+      struct sigevent sev;
+      memset( &sev, 0, sizeof(sev) );
+      sev.sigev_notify = SIGEV_THREAD;
+      sev.sigev_notify_function = &Request::notify;
+      sev.sigev_value.sival_ptr = req;
+      struct gaicb * lookups[] = { &req->_cb };
+      if ( getaddrinfo_a( GAI_NOWAIT, lookups, 1, &sev ) )
+      {
+	WAR << "DNS lookup start failed: " << host_r << endl;
+	close( sockfds[0] );
+	close( sockfds[1] );
+	delete req;
+	return;
+      }
+      _fd = sockfds[0];
+    }
+
+    DnsLookup::~DnsLookup()
+    { cancel(); }
+
+    int DnsLookup::result()
+    {
+      if ( _fd == -1 )
+	return _result;
+
+      int err;
+      ssize_t r;
+      while ( ( r = recv( _fd, &err, sizeof(err), 0 ) ) == -1 && errno == EINTR )
+	;
+      _result = ( r == sizeof(err) ? err : EAI_SYSTEM );
+      close( _fd );
+      _fd = -1;
+      return _result;
+    }
+
+    void DnsLookup::cancel()
+    {
+      if ( _fd == -1 )
+	return;
+      close( _fd );
+      _fd = -1;
+      _result = EAI_CANCELED;
+    }
+
+  } // namespace media
+} // namespace zypp
@@ -0,0 +1,75 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/media/DnsLookup_p.h
+ * This file contains private API, it will change without notice.
+ * You have been warned.
+*/
+#ifndef ZYPP_MEDIA_DNSLOOKUP_P_H
+#define ZYPP_MEDIA_DNSLOOKUP_P_H
+
+#include <string>
+
+#include "zypp/base/NonCopyable.h"
+
+namespace zypp
+{
+  namespace media
+  {
+    ///////////////////////////////////////////////////////////////////
+    /// \class DnsLookup
+    /// \brief Asynchronous host name lookup via getaddrinfo_a(3).
+    ///
+    /// The lookup runs in the resolver thread of the libc. When it is
+    /// done, the result code is sent through a socket, so \ref fd can be
+    /// polled together with other descriptors (e.g. curl's). A lookup
+    /// which is still pending when the DnsLookup is canceled or destroyed
+    /// cleans up after itself; its result is discarded.
+    ///
+    /// \code
+    ///   DnsLookup lookup( "download.opensuse.org" );
+    ///   // ...poll lookup.fd() for POLLIN, unless ! lookup.pending()
+    ///   if ( lookup.result() != 0 )
+    ///     ERR << gai_strerror( lookup.result() ) << endl;
+    /// \endcode
+    ///////////////////////////////////////////////////////////////////
+    class DnsLookup : private base::NonCopyable
+    {
+    public:
+      /** Start looking up \a host_r. */
+      explicit DnsLookup( const std::string & host_r );
+
+      /** Dtor \ref cancel s a pending lookup. */
+      ~DnsLookup();
+
+    public:
+      /** Whether the \ref result is not yet retrieved (\c false if the lookup could not be started). */
+      bool pending() const
+      { return _fd != -1; }
+
+      /** Descriptor becoming readable when the lookup is done (\c -1 unless \ref pending). */
+      int fd() const
+      { return _fd; }
+
+      /** The result of the lookup: \c 0 on success, otherwise a getaddrinfo \c EAI_* code.
+       * If the lookup is \ref pending, wait for it to be done.
+       * \c EAI_SYSTEM if the lookup could not be started, \c EAI_CANCELED if it was canceled.
+       */
+      int result();
+
+      /** Discard a \ref pending lookup. */
+      void cancel();
+
+    private:
+      int _fd;
+      int _result;
+    };
+
+  } // namespace media
+} // namespace zypp
+#endif // ZYPP_MEDIA_DNSLOOKUP_P_H
@@ -11,6 +11,8 @@
  */
 
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,10 +20,13 @@
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <thread>
+#include <system_error>
 
 #include "zypp/media/MediaBlockList.h"
 #include "zypp/base/Logger.h"
 #include "zypp/base/String.h"
+#include "zypp/base/ForkedWorkers_p.h"
 
 using namespace std;
 using namespace zypp::base;
@@ -244,11 +249,234 @@ MediaBlockList::writeBlock(size_t blkno, FILE *fp, const unsigned char *buf, siz
   found[blocks.size()] = true;
 }
 
+namespace {
+  // Byte source for reuseBlocks. Scanning an old file (e.g. an ISO image)
+  // touches every byte, so stdio's per byte getc() overhead dominates.
+  // The file is mapped into memory if possible, otherwise it is read in
+  // large chunks.
+  class SeedReader
+  {
+  public:
+    SeedReader(FILE *fp)
+    : _fp(fp), _map(0), _maplen(0), _p(0), _end(0)
+    {
+      struct stat st;
+      if (fstat(fileno(fp), &st) || !S_ISREG(st.st_mode) || st.st_size <= 0 || off_t(size_t(st.st_size)) != st.st_size)
+	return;
+      void *map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+      if (map == MAP_FAILED)
+	return;
+      madvise(map, st.st_size, MADV_SEQUENTIAL);
+      _map = _p = static_cast<unsigned char *>(map);
+      _maplen = st.st_size;
+      _end = _map + _maplen;
+    }
+
+    ~SeedReader()
+    {
+      if (_map)
+	munmap(_map, _maplen);
+    }
+
+    /** next byte or EOF */
+    inline int get()
+    {
+      if (_p == _end && !fill())
+	return EOF;
+      return *_p++;
+    }
+
+    /** the mapped file or 0 */
+    const unsigned char *data() const
+    { return _map; }
+
+    /** size of the mapped file */
+    size_t size() const
+    { return _maplen; }
+
+    /** offset of the next byte in the mapped file */
+    off_t offset() const
+    { return _p - _map; }
+
+    /** read up to len bytes, returns the number of bytes read */
+    size_t read(unsigned char *bp, size_t len)
+    {
+      size_t ret = 0;
+      while (len)
+	{
+	  if (_p == _end && !fill())
+	    break;
+	  size_t l = size_t(_end - _p) > len ? len : _end - _p;
+	  memcpy(bp, _p, l);
+	  _p += l;
+	  bp += l;
+	  len -= l;
+	  ret += l;
+	}
+      return ret;
+    }
+
+  private:
+    bool fill()
+    {
+      if (_map)
+	return false;
+      if (_buf.empty())
+	_buf.resize(65536);
+      size_t l = fread(&_buf[0], 1, _buf.size(), _fp);
+      _p = &_buf[0];
+      _end = _p + l;
+      return l != 0;
+    }
+
+    FILE *_fp;
+    unsigned char *_map;
+    size_t _maplen;
+    unsigned char *_p;
+    unsigned char *_end;
+    vector<unsigned char> _buf;
+  };
+
+  // Scanning is split among threads if the seed file is mapped and large
+  // enough. The parts are merged in order, so the result is the same as
+  // of a serial scan.
+  const size_t minScanChunk = 4 * 1024 * 1024;
+
+  // Testing: $ZYPP_MEDIA_BLOCKLIST_SCANTHREADS=N scans with N threads
+  // regardless of the file size (1 for a serial scan).
+  inline unsigned
+  envScanThreads()
+  {
+    const char *envp = getenv("ZYPP_MEDIA_BLOCKLIST_SCANTHREADS");
+    if (!envp)
+      return 0;
+    unsigned n = str::strtonum<unsigned>(envp);
+    return n > 64 ? 64 : n;
+  }
+
+  unsigned
+  scanThreads(size_t len)
+  {
+    if (unsigned t = envScanThreads())
+      return t;
+    size_t n = len / minScanChunk;
+    unsigned cpus = ForkedWorkers::onlineCPUs();
+    if (n > cpus)
+      n = cpus;
+    return n ? n : 1;
+  }
+
+  // Run part(0) .. part(n-1), part 0 in the calling thread. Parts a thread
+  // can't be started for are run in the calling thread as well.
+  template <class TPart>
+  void
+  runParts(unsigned n, TPart part)
+  {
+    vector<thread> threads;
+    unsigned w = 1;
+    try
+      {
+	for (; w < n; w++)
+	  threads.push_back(thread(part, w));
+      }
+    catch (const std::system_error &e)
+      {
+	WAR << "Can't start scan thread: " << e.what() << endl;
+      }
+    part(0);
+    for (; w < n; w++)
+      part(w);
+    for (size_t i = 0; i < threads.size(); i++)
+      threads[i].join();
+  }
+
+  inline unsigned int
+  rsumValue(int rsumlen, unsigned short a, unsigned short b)
+  {
+    if (rsumlen == 1)
+      return ((unsigned int)b & 255);
+    else if (rsumlen == 2)
+      return ((unsigned int)b & 65535);
+    else if (rsumlen == 3)
+      return ((unsigned int)a & 255) << 16 | ((unsigned int)b & 65535);
+    else
+      return ((unsigned int)a & 65535) << 16 | ((unsigned int)b & 65535);
+  }
+
+  // Find the offsets of the last byte of all blksize windows of data whose
+  // rolling checksum matches a block in the hash. Windows are checked in
+  // parallel. The serial scan then just probes the hash at these offsets.
+  // Returns false if not worth it (or too many candidates).
+  bool
+  findRsumCandidates(const unsigned char *data, size_t len, size_t blksize, int bshift, int rsumlen,
+		     const unsigned int *ht, unsigned int hm, const vector<unsigned int> &rsums, vector<off_t> &cand)
+  {
+    if (!data || len < blksize)
+      return false;
+    size_t total = len - (blksize - 1);	// number of windows
+    unsigned n = scanThreads(len);
+    if (n < 2)
+      return false;
+    size_t maxcand = total / 64 + 1024;	// hits are rare unless rsums are short
+    vector<vector<off_t> > parts(n);
+    vector<char> ok(n, 1);
+    runParts(n, [&](unsigned w) {
+      size_t s = blksize - 1 + total / n * w;
+      size_t e = w + 1 == n ? len : s + total / n;
+      vector<off_t> &c = parts[w];
+      unsigned short a = 0, b = 0;
+      for (size_t j = s + 1 - blksize; j <= s; j++)
+	{
+	  a += data[j];
+	  b += a;
+	}
+      for (size_t p = s; p < e; p++)
+	{
+	  if (p != s)
+	    {
+	      int ch = data[p];
+	      int oc = data[p - blksize];
+	      a += ch - oc;
+	      if (bshift)
+		b += a - (oc << bshift);
+	      else
+		b += a - oc * blksize;
+	    }
+	  unsigned int r = rsumValue(rsumlen, a, b);
+	  unsigned int hh = 7;
+	  for (unsigned int h = r & hm; ht[h]; h = (h + hh++) & hm)
+	    {
+	      if (rsums[ht[h] - 1] == r)
+		{
+		  c.push_back(p);
+		  break;
+		}
+	    }
+	  if (c.size() > maxcand / n)
+	    {
+	      ok[w] = 0;
+	      return;
+	    }
+	}
+    });
+    for (unsigned w = 0; w < n; w++)
+      {
+	if (!ok[w])
+	  {
+	    DBG << "too many rsum candidates, scanning serially" << endl;
+	    return false;
+	  }
+	cand.insert(cand.end(), parts[w].begin(), parts[w].end());
+      }
+    DBG << cand.size() << " rsum candidates found by " << n << " threads" << endl;
+    return true;
+  }
+} // namespace
+
 static size_t
-fetchnext(FILE *fp, unsigned char *bp, size_t blksize, size_t pushback, unsigned char *pushbackp)
+fetchnext(SeedReader &reader, unsigned char *bp, size_t blksize, size_t pushback, unsigned char *pushbackp)
 {
   size_t l = blksize;
-  int c;
 
   if (pushback)
     {
@@ -257,14 +485,9 @@ fetchnext(FILE *fp, unsigned char *bp, size_t blksize, size_t pushback, unsigned
       bp += pushback;
       l -= pushback;
     }
-  while (l)
-    {
-      c = getc(fp);
-      if (c == EOF)
-        break;
-      *bp++ = c;
-      l--;
-    }
+  size_t r = reader.read(bp, l);
+  bp += r;
+  l -= r;
   if (l)
     memset(bp, 0, l);
   return blksize - l;
@@ -307,6 +530,7 @@ MediaBlockList::reuseBlocks(FILE *wfp, string filename)
 	  ht[h] = i + 1;
 	}
 
+      SeedReader reader(fp);
       unsigned char *buf = new unsigned char[blksize];
       unsigned char *buf2 = new unsigned char[blksize];
       size_t pushback = 0;
@@ -315,6 +539,12 @@ MediaBlockList::reuseBlocks(FILE *wfp, string filename)
       if ((blksize & (blksize - 1)) == 0)
 	for (bshift = 0; size_t(1 << bshift) != blksize; bshift++)
 	  ;
+      // Where the window holds blksize bytes of the file, its rsum is known
+      // in advance; the hash is probed at the candidates only.
+      vector<off_t> cand;
+      bool usecand = findRsumCandidates(reader.data(), reader.size(), blksize, bshift, rsumlen, ht, hm, rsums, cand);
+      size_t candidx = 0;
+      size_t fed = 0;		// bytes of the file in the window since the (re)start
       unsigned short a, b;
       a = b = 0;
       memset(buf, 0, blksize);
@@ -336,7 +566,7 @@ MediaBlockList::reuseBlocks(FILE *wfp, string filename)
 		      pushback--;
 		    }
 		  else
-		    c = getc(fp);
+		    c = reader.get();
 		  if (c == EOF)
 		    {
 		      eof = true;
@@ -344,6 +574,8 @@ MediaBlockList::reuseBlocks(FILE *wfp, string filename)
 		      if (!i || sql == 2)
 			break;
 		    }
+		  else
+		    fed++;
 		}
 	      int oc = buf[i];
 	      buf[i] = c;
@@ -358,15 +590,15 @@ MediaBlockList::reuseBlocks(FILE *wfp, string filename)
 		    continue;
 		  init = 0;
 		}
-	      unsigned int r;
-	      if (rsumlen == 1)
-		r = ((unsigned int)b & 255);
-	      else if (rsumlen == 2)
-		r = ((unsigned int)b & 65535);
-	      else if (rsumlen == 3)
-		r = ((unsigned int)a & 255) << 16 | ((unsigned int)b & 65535);
-	      else
-		r = ((unsigned int)a & 65535) << 16 | ((unsigned int)b & 65535);
+	      if (usecand && !eof && fed >= blksize)
+		{
+		  off_t end = reader.offset() - pushback - 1;	// the last byte fed
+		  while (candidx < cand.size() && cand[candidx] < end)
+		    candidx++;
+		  if (candidx == cand.size() || cand[candidx] != end)
+		    continue;	// no block has this rsum
+		}
+	      unsigned int r = rsumValue(rsumlen, a, b);
 	      unsigned int h = r & hm;
 	      unsigned int hh = 7;
 	      for (; ht[h]; h = (h + hh++) & hm)
@@ -380,7 +612,7 @@ MediaBlockList::reuseBlocks(FILE *wfp, string filename)
 		    {
 		      if (eof || blkno + 1 >= nblks)
 			continue;
-		      pushback = fetchnext(fp, buf2, blksize, pushback, pushbackp);
+		      pushback = fetchnext(reader, buf2, blksize, pushback, pushbackp);
 		      pushbackp = buf2;
 		      if (!pushback)
 			continue;
@@ -401,7 +633,7 @@ MediaBlockList::reuseBlocks(FILE *wfp, string filename)
 		  while (!eof)
 		    {
 		      blkno++;
-		      pushback = fetchnext(fp, buf2, blksize, pushback, pushbackp);
+		      pushback = fetchnext(reader, buf2, blksize, pushback, pushbackp);
 		      pushbackp = buf2;
 		      if (!pushback)
 			break;
@@ -415,6 +647,7 @@ MediaBlockList::reuseBlocks(FILE *wfp, string filename)
 		  init = false;
 		  memset(buf, 0, blksize);
 	 	  a = b = 0;
+		  fed = 0;
 		  i = size_t(-1);	// start with 0 on next iteration
 		  break;
 		}
@@ -427,36 +660,67 @@ MediaBlockList::reuseBlocks(FILE *wfp, string filename)
   else if (chksumlen >= 16)
     {
       // dummy variant, just check the checksums
-      size_t bufl = 4096;
-      off_t off = 0;
-      unsigned char *buf = new unsigned char[bufl];
-      for (size_t blkno = 0; blkno < blocks.size(); ++blkno)
+      SeedReader reader(fp);
+      unsigned n = reader.data() ? scanThreads(reader.size()) : 1;
+      if (n > 1)
 	{
-	  if (off > blocks[blkno].off)
-	    continue;
-	  size_t blksize = blocks[blkno].size;
-	  if (blksize > bufl)
+	  // the blocks the serial loop below checks, in order
+	  vector<size_t> todo;
+	  off_t off = 0;
+	  for (size_t blkno = 0; blkno < blocks.size(); ++blkno)
 	    {
-	      delete[] buf;
-	      bufl = blksize;
-              buf = new unsigned char[bufl];
+	      if (off > blocks[blkno].off)
+		continue;
+	      if (blocks[blkno].off + off_t(blocks[blkno].size) > off_t(reader.size()))
+		break;
+	      todo.push_back(blkno);
+	      off = blocks[blkno].off + blocks[blkno].size;
 	    }
-	  size_t skip = blocks[blkno].off - off;
-	  while (skip)
+	  const unsigned char *data = reader.data();
+	  vector<char> match(todo.size(), 0);
+	  runParts(n, [&](unsigned w) {
+	    for (size_t i = w; i < todo.size(); i += n)
+	      match[i] = checkChecksum(todo[i], data + blocks[todo[i]].off, blocks[todo[i]].size);
+	  });
+	  for (size_t i = 0; i < todo.size(); ++i)
+	    if (match[i])
+	      writeBlock(todo[i], wfp, data + blocks[todo[i]].off, blocks[todo[i]].size, 0, found);
+	}
+      else
+	{
+	  size_t bufl = 4096;
+	  off_t off = 0;
+	  unsigned char *buf = new unsigned char[bufl];
+	  for (size_t blkno = 0; blkno < blocks.size(); ++blkno)
 	    {
-	      size_t l = skip > bufl ? bufl : skip;
-	      if (fread(buf, l, 1, fp) != 1)
+	      if (off > blocks[blkno].off)
+		continue;
+	      size_t blksize = blocks[blkno].size;
+	      if (blksize > bufl)
+		{
+		  delete[] buf;
+		  bufl = blksize;
+		  buf = new unsigned char[bufl];
+		}
+	      size_t skip = blocks[blkno].off - off;
+	      while (skip)
+		{
+		  size_t l = skip > bufl ? bufl : skip;
+		  if (fread(buf, l, 1, fp) != 1)
+		    break;
+		  skip -= l;
+		  off += l;
+		}
+	      if (fread(buf, blksize, 1, fp) != 1)
 		break;
-	      skip -= l;
-	      off += l;
+	      if (checkChecksum(blkno, buf, blksize))
+		writeBlock(blkno, wfp, buf, blksize, 0, found);
+	      off += blksize;
 	    }
-	  if (fread(buf, blksize, 1, fp) != 1)
-	    break;
-	  if (checkChecksum(blkno, buf, blksize))
-	    writeBlock(blkno, wfp, buf, blksize, 0, found);
-	  off += blksize;
+	  delete[] buf;
 	}
     }
+  fclose(fp);
   if (!found[nblks])
     return;
   // now throw out all of the blocks we found
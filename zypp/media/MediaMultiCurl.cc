@@ -13,7 +13,6 @@
 #include <ctype.h>
 #include <sys/types.h>
 #include <signal.h>
-#include <sys/wait.h>
 #include <netdb.h>
 #include <arpa/inet.h>
 
@@ -26,6 +25,8 @@
 #include "zypp/base/Logger.h"
 #include "zypp/media/MediaMultiCurl.h"
 #include "zypp/media/MetaLinkParser.h"
+#include "zypp/media/DnsLookup_p.h"
+#include "zypp/media/OrderedFileDigest_p.h"
 
 using namespace std;
 using namespace zypp::base;
@@ -58,8 +59,7 @@ public:
   void disableCompetition();
 
   void checkdns();
-  void adddnsfd(fd_set &rset, int &maxfd);
-  void dnsevent(fd_set &rset);
+  void dnsevent(double now, bool ready);
 
   int _workerno;
 
@@ -96,8 +96,8 @@ private:
   size_t _size;
   Digest _dig;
 
-  pid_t _pid;
-  int _dnspipe;
+  DnsLookup *_dnslookup;
+  double _dnsstarttime;
 };
 
 #define WORKER_STARTING 0
@@ -117,6 +117,11 @@ public:
 
   void run(std::vector<Url> &urllist);
 
+  // whether the file digest was computed while downloading
+  bool haveFileDigest() const { return _filedig.valid(); }
+  Digest &fileDigest() { return _filedig.digest(); }
+  off_t fileDigestOffset() const { return _filedig.offset(); }
+
 protected:
   friend class multifetchworker;
 
@@ -146,6 +151,9 @@ protected:
   off_t _fetchedsize;
   off_t _fetchedgoodsize;
 
+  // incremental file digest, see OrderedFileDigest
+  OrderedFileDigest _filedig;
+
   double _starttime;
   double _lastprogress;
 
@@ -162,6 +170,7 @@ public:
 
 #define BLKSIZE		131072
 #define MAXURLS		10
+#define MAXWAIT		1000	// ms; upper bound for waiting on the sockets
 
 
 //////////////////////////////////////////////////////////////////////
@@ -306,8 +315,8 @@ multifetchworker::multifetchworker(int no, multifetchrequest &request, const Url
   _size = _blksize = 0;
   _pass = 0;
   _blkno = 0;
-  _pid = 0;
-  _dnspipe = -1;
+  _dnslookup = 0;
+  _dnsstarttime = 0;
   _blkreceived = 0;
   _received = 0;
   _blkstarttime = 0;
@@ -396,20 +405,9 @@ multifetchworker::~multifetchworker()
         curl_easy_cleanup(_curl);
       _curl = 0;
     }
-  if (_pid)
-    {
-      kill(_pid, SIGKILL);
-      int status;
-      while (waitpid(_pid, &status, 0) == -1)
-        if (errno != EINTR)
-	  break;
-      _pid = 0;
-    }
-  if (_dnspipe != -1)
-    {
-      close(_dnspipe);
-      _dnspipe = -1;
-    }
+  // a pending lookup cleans up after itself, see DnsLookup
+  delete _dnslookup;
+  _dnslookup = 0;
   // the destructor in MediaCurl doesn't call disconnect() if
   // the media is not attached, so we do it here manually
   disconnectFrom();
@@ -455,88 +453,36 @@ multifetchworker::checkdns()
     }
 
   XXX << "checking DNS lookup of " << host << endl;
-  int pipefds[2];
-  if (pipe(pipefds))
-    {
-      _state = WORKER_BROKEN;
-      strncpy(_curlError, "DNS pipe creation failed", CURL_ERROR_SIZE);
-      return;
-    }
-  _pid = fork();
-  if (_pid == pid_t(-1))
+  _dnslookup = new DnsLookup(host);
+  if (!_dnslookup->pending())
     {
-      close(pipefds[0]);
-      close(pipefds[1]);
-      _pid = 0;
+      delete _dnslookup;
+      _dnslookup = 0;
       _state = WORKER_BROKEN;
-      strncpy(_curlError, "DNS checker fork failed", CURL_ERROR_SIZE);
+      strncpy(_curlError, "DNS lookup start failed", CURL_ERROR_SIZE);
       return;
     }
-  else if (_pid == 0)
-    {
-      close(pipefds[0]);
-      // XXX: close all other file descriptors
-      struct addrinfo *ai, aihints;
-      memset(&aihints, 0, sizeof(aihints));
-      aihints.ai_family = PF_UNSPEC;
-      int tstsock = socket(PF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0);
-      if (tstsock == -1)
-	aihints.ai_family = PF_INET;
-      else
-	close(tstsock);
-      aihints.ai_socktype = SOCK_STREAM;
-      aihints.ai_flags = AI_CANONNAME;
-      unsigned int connecttimeout = _request->_connect_timeout;
-      if (connecttimeout)
-	alarm(connecttimeout);
-      signal(SIGALRM, SIG_DFL);
-      if (getaddrinfo(host.c_str(), NULL, &aihints, &ai))
-        _exit(1);
-      _exit(0);
-    }
-  close(pipefds[1]);
-  _dnspipe = pipefds[0];
+  _dnsstarttime = currentTime();
   _state = WORKER_LOOKUP;
 }
 
 void
-multifetchworker::adddnsfd(fd_set &rset, int &maxfd)
+multifetchworker::dnsevent(double now, bool ready)
 {
   if (_state != WORKER_LOOKUP)
     return;
-  FD_SET(_dnspipe, &rset);
-  if (maxfd < _dnspipe)
-    maxfd = _dnspipe;
-}
-
-void
-multifetchworker::dnsevent(fd_set &rset)
-{
+  int err = EAI_SYSTEM;
+  if (ready)
+    err = _dnslookup->result();
+  else if (!_request->_connect_timeout || now - _dnsstarttime < _request->_connect_timeout)
+    return;	// still waiting
+  else
+    XXX << "#" << _workerno << ": DNS lookup timed out" << endl;
 
-  if (_state != WORKER_LOOKUP || !FD_ISSET(_dnspipe, &rset))
-    return;
-  int status;
-  while (waitpid(_pid, &status, 0) == -1)
-    {
-      if (errno != EINTR)
-        return;
-    }
-  _pid = 0;
-  if (_dnspipe != -1)
-    {
-      close(_dnspipe);
-      _dnspipe = -1;
-    }
-  if (!WIFEXITED(status))
-    {
-      _state = WORKER_BROKEN;
-      strncpy(_curlError, "DNS lookup failed", CURL_ERROR_SIZE);
-      _request->_activeworkers--;
-      return;
-    }
-  int exitcode = WEXITSTATUS(status);
-  XXX << "#" << _workerno << ": DNS lookup returned " << exitcode << endl;
-  if (exitcode != 0)
+  delete _dnslookup;
+  _dnslookup = 0;
+  XXX << "#" << _workerno << ": DNS lookup returned " << err << endl;
+  if (err != 0)
     {
       _state = WORKER_BROKEN;
       strncpy(_curlError, "DNS lookup failed", CURL_ERROR_SIZE);
@@ -782,7 +728,7 @@ multifetchworker::run()
 //////////////////////////////////////////////////////////////////////
 
 
-multifetchrequest::multifetchrequest(const MediaMultiCurl *context, const Pathname &filename, const Url &baseurl, CURLM *multi, FILE *fp, callback::SendReport<DownloadProgressReport> *report, MediaBlockList *blklist, off_t filesize) : _context(context), _filename(filename), _baseurl(baseurl)
+multifetchrequest::multifetchrequest(const MediaMultiCurl *context, const Pathname &filename, const Url &baseurl, CURLM *multi, FILE *fp, callback::SendReport<DownloadProgressReport> *report, MediaBlockList *blklist, off_t filesize) : _context(context), _filename(filename), _baseurl(baseurl), _filedig(fp, blklist)
 {
   _fp = fp;
   _report = report;
@@ -841,8 +787,7 @@ multifetchrequest::run(std::vector<Url> &urllist)
   std::vector<Url>::iterator urliter = urllist.begin();
   for (;;)
     {
-      fd_set rset, wset, xset;
-      int maxfd, nqueue;
+      int nqueue;
 
       if (_finished)
 	{
@@ -881,21 +826,26 @@ multifetchrequest::run(std::vector<Url> &urllist)
 	  break;
 	}
 
-      FD_ZERO(&rset);
-      FD_ZERO(&wset);
-      FD_ZERO(&xset);
-
-      curl_multi_fdset(_multi, &rset, &wset, &xset, &maxfd);
-
+      // workers waiting for their DNS lookup
+      std::vector<multifetchworker *> lookups;
+      double waituntil = 0;
       if (_lookupworkers)
-        for (std::list<multifetchworker *>::iterator workeriter = _workers.begin(); workeriter != _workers.end(); ++workeriter)
-	  (*workeriter)->adddnsfd(rset, maxfd);
+	for (std::list<multifetchworker *>::iterator workeriter = _workers.begin(); workeriter != _workers.end(); ++workeriter)
+	  {
+	    multifetchworker *worker = *workeriter;
+	    if (worker->_state != WORKER_LOOKUP)
+	      continue;
+	    lookups.push_back(worker);
+	    if (_connect_timeout && (!waituntil || waituntil > worker->_dnsstarttime + _connect_timeout))
+	      waituntil = worker->_dnsstarttime + _connect_timeout;
+	  }
 
-      timeval tv;
       // if we added a new job we have to call multi_perform once
       // to make it show up in the fd set. do not sleep in this case.
-      tv.tv_sec = 0;
-      tv.tv_usec = _havenewjob ? 0 : 200000;
+      // Otherwise sleep until something happens on the sockets, a sleeper
+      // needs to be woken up or a lookup times out. curl lowers the timeout
+      // further if its own timers expire earlier.
+      long timeoutms = _havenewjob ? 0 : MAXWAIT;
       if (_sleepworkers && !_havenewjob)
 	{
 	  if (_minsleepuntil == 0)
@@ -909,28 +859,75 @@ multifetchrequest::run(std::vector<Url> &urllist)
 		    _minsleepuntil = worker->_sleepuntil;
 		}
 	    }
-	  double sl = _minsleepuntil - currentTime();
-	  if (sl < 0)
+	  if (_minsleepuntil < currentTime())
 	    {
-	      sl = 0;
 	      _minsleepuntil = 0;
+	      timeoutms = 0;
 	    }
-	  if (sl < .2)
-	    tv.tv_usec = sl * 1000000;
+	  else if (!waituntil || waituntil > _minsleepuntil)
+	    waituntil = _minsleepuntil;
+	}
+      if (waituntil && timeoutms)
+	{
+	  double sl = waituntil - currentTime();
+	  if (sl < 0)
+	    sl = 0;
+	  if (sl * 1000 < timeoutms)
+	    timeoutms = sl * 1000;
+	}
+
+      std::vector<bool> dnsready(lookups.size(), false);
+#if CURLVERSION_AT_LEAST(7,66,0)
+      std::vector<struct curl_waitfd> waitfds(lookups.size());
+      for (size_t i = 0; i < lookups.size(); i++)
+	{
+	  waitfds[i].fd = lookups[i]->_dnslookup->fd();
+	  waitfds[i].events = CURL_WAIT_POLLIN;
+	  waitfds[i].revents = 0;
+	}
+      int numfds;
+      if (curl_multi_poll(_multi, waitfds.empty() ? NULL : &waitfds[0], waitfds.size(), timeoutms, &numfds) != CURLM_OK)
+	ZYPP_THROW(MediaCurlException(_baseurl, "curl_multi_poll() failed", "unknown error"));
+      for (size_t i = 0; i < lookups.size(); i++)
+	dnsready[i] = waitfds[i].revents;
+#else
+      fd_set rset, wset, xset;
+      int maxfd;
+
+      FD_ZERO(&rset);
+      FD_ZERO(&wset);
+      FD_ZERO(&xset);
+
+      curl_multi_fdset(_multi, &rset, &wset, &xset, &maxfd);
+
+      for (size_t i = 0; i < lookups.size(); i++)
+	{
+	  int fd = lookups[i]->_dnslookup->fd();
+	  FD_SET(fd, &rset);
+	  if (maxfd < fd)
+	    maxfd = fd;
 	}
+
+      timeval tv;
+      tv.tv_sec = timeoutms / 1000;
+      tv.tv_usec = (timeoutms % 1000) * 1000;
       int r = select(maxfd + 1, &rset, &wset, &xset, &tv);
       if (r == -1 && errno != EINTR)
 	ZYPP_THROW(MediaCurlException(_baseurl, "select() failed", "unknown error"));
-      if (r != 0 && _lookupworkers)
-	for (std::list<multifetchworker *>::iterator workeriter = _workers.begin(); workeriter != _workers.end(); ++workeriter)
-	  {
-	    multifetchworker *worker = *workeriter;
-	    if (worker->_state != WORKER_LOOKUP)
-	      continue;
-	    (*workeriter)->dnsevent(rset);
-	    if (worker->_state != WORKER_LOOKUP)
-	      _lookupworkers--;
-	  }
+      if (r > 0)
+	for (size_t i = 0; i < lookups.size(); i++)
+	  dnsready[i] = FD_ISSET(lookups[i]->_dnslookup->fd(), &rset);
+#endif
+      if (!lookups.empty())
+	{
+	  double now = currentTime();
+	  for (size_t i = 0; i < lookups.size(); i++)
+	    {
+	      lookups[i]->dnsevent(now, dnsready[i]);
+	      if (lookups[i]->_state != WORKER_LOOKUP)
+		_lookupworkers--;
+	    }
+	}
       _havenewjob = false;
 
       // run curl
@@ -1054,6 +1051,7 @@ multifetchrequest::run(std::vector<Url> &urllist)
 			}
 		    }
 		  _fetchedgoodsize += worker->_blksize;
+		  _filedig.blockdone(worker->_blkno);
 		}
 
 	      // make bad workers sleep a little
@@ -1552,17 +1550,26 @@ void MediaMultiCurl::multifetch(const Pathname & filename, FILE *fp, std::vector
   if (!myurllist.size())
     myurllist.push_back(baseurl);
   req.run(myurllist);
-  checkFileDigest(baseurl, fp, blklist);
+  if (req.haveFileDigest())
+    checkFileDigest(baseurl, fp, blklist, req.fileDigest(), req.fileDigestOffset());
+  else
+    checkFileDigest(baseurl, fp, blklist);
 }
 
 void MediaMultiCurl::checkFileDigest(Url &url, FILE *fp, MediaBlockList *blklist) const
 {
   if (!blklist || !blklist->haveFileChecksum())
     return;
-  if (fseeko(fp, off_t(0), SEEK_SET))
-    ZYPP_THROW(MediaCurlException(url, "fseeko", "seek error"));
   Digest dig;
   blklist->createFileDigest(dig);
+  checkFileDigest(url, fp, blklist, dig, off_t(0));
+}
+
+void MediaMultiCurl::checkFileDigest(Url &url, FILE *fp, MediaBlockList *blklist, Digest &dig, off_t off) const
+{
+  // dig contains the file data up to off, hash the rest
+  if (fseeko(fp, off, SEEK_SET))
+    ZYPP_THROW(MediaCurlException(url, "fseeko", "seek error"));
   char buf[4096];
   size_t l;
   while ((l = fread(buf, 1, sizeof(buf), fp)) > 0)
@@ -59,6 +59,7 @@ protected:
 
   virtual void setupEasy();
   void checkFileDigest(Url &url, FILE *fp, MediaBlockList *blklist) const;
+  void checkFileDigest(Url &url, FILE *fp, MediaBlockList *blklist, Digest &dig, off_t off) const;
   static int progressCallback( void *clientp, double dltotal, double dlnow, double ultotal, double ulnow );
 
 private:
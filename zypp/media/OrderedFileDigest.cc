@@ -0,0 +1,87 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file zypp/media/OrderedFileDigest.cc
+ *
+ */
+
+#include <unistd.h>
+#include <errno.h>
+
+#include <iostream>
+
+#include "zypp/media/OrderedFileDigest_p.h"
+
+namespace zypp {
+  namespace media {
+
+OrderedFileDigest::OrderedFileDigest(FILE *fp, const MediaBlockList *blklist)
+{
+  _fp = fp;
+  _blklist = blklist;
+  _valid = false;
+  _off = 0;
+  _blkno = 0;
+  if (_fp && _blklist && _blklist->haveFileChecksum() && _blklist->createFileDigest(_dig))
+    {
+      _valid = true;
+      _done.resize(_blklist->numBlocks(), false);
+    }
+}
+
+void
+OrderedFileDigest::blockdone(size_t blkno)
+{
+  if (!_valid || blkno >= _done.size())
+    return;
+  _done[blkno] = true;
+  // blocks are ordered; everything between the blocks was
+  // reused from an old file and is already in place.
+  while (_blkno < _done.size())
+    {
+      MediaBlock blk = _blklist->getBlock(_blkno);
+      if (!_done[_blkno])
+	{
+	  if (!hashrange(blk.off))
+	    _valid = false;
+	  return;
+	}
+      if (!hashrange(blk.off + blk.size))
+	{
+	  _valid = false;
+	  return;
+	}
+      _blkno++;
+    }
+}
+
+bool
+OrderedFileDigest::hashrange(off_t end)
+{
+  if (_off >= end)
+    return true;
+  if (fflush(_fp))
+    return false;
+  int fd = fileno(_fp);
+  char buf[65536];
+  while (_off < end)
+    {
+      size_t cnt = end - _off > off_t(sizeof(buf)) ? sizeof(buf) : end - _off;
+      ssize_t r = pread(fd, buf, cnt, _off);
+      if (r == -1 && errno == EINTR)
+	continue;
+      if (r <= 0)
+	return false;
+      _dig.update(buf, r);
+      _off += r;
+    }
+  return true;
+}
+
+  } // namespace media
+} // namespace zypp
@@ -0,0 +1,83 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file zypp/media/OrderedFileDigest_p.h
+ * This file contains private API, it will change without notice.
+ * You have been warned.
+*/
+#ifndef ZYPP_MEDIA_ORDEREDFILEDIGEST_P_H
+#define ZYPP_MEDIA_ORDEREDFILEDIGEST_P_H
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <vector>
+
+#include "zypp/Digest.h"
+#include "zypp/media/MediaBlockList.h"
+
+namespace zypp {
+  namespace media {
+
+/**
+ * Incremental digest of a file whose blocks are downloaded in any order.
+ *
+ * The file is hashed in order as soon as the blocks up to a position are
+ * verified (see blockdone()), so the data is still in the page cache and
+ * need not be read again at the end. Data between the blocks of the
+ * blocklist (reused from an old file) must already be in place.
+ **/
+class OrderedFileDigest {
+public:
+  /**
+   * digest of fp, described by blklist. Invalid unless blklist has a
+   * file checksum.
+   **/
+  OrderedFileDigest(FILE *fp, const MediaBlockList *blklist);
+
+  /**
+   * whether the digest is computed. Becomes false if reading the
+   * file fails; the whole file must be hashed at the end then.
+   **/
+  inline bool valid() const {
+    return _valid;
+  }
+  /**
+   * block blkno was written and verified. Calling it again for
+   * a block is a no-op.
+   **/
+  void blockdone(size_t blkno);
+
+  /**
+   * the digest of the file data up to offset()
+   **/
+  inline Digest &digest() {
+    return _dig;
+  }
+  inline off_t offset() const {
+    return _off;
+  }
+
+private:
+  OrderedFileDigest(const OrderedFileDigest &);
+  OrderedFileDigest &operator=(const OrderedFileDigest &);
+
+  bool hashrange(off_t end);
+
+  FILE *_fp;
+  const MediaBlockList *_blklist;
+  Digest _dig;
+  bool _valid;
+  off_t _off;			// file data up to here is hashed
+  size_t _blkno;		// next block to hash
+  std::vector<bool> _done;
+};
+
+  } // namespace media
+} // namespace zypp
+
+#endif // ZYPP_MEDIA_ORDEREDFILEDIGEST_P_H
@@ -10,7 +10,15 @@
 /** \file HistoryLogReader.cc
  *
  */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
 #include <iostream>
+#include <algorithm>
+#include <boost/utility/string_ref.hpp>
 
 #include "zypp/base/InputStream.h"
 #include "zypp/base/IOStream.h"
@@ -21,6 +29,79 @@
 
 using std::endl;
 
+///////////////////////////////////////////////////////////////////
+namespace
+{
+  /** Read only memory mapped file, empty if it can't be mapped. */
+  struct MappedFile
+  {
+    MappedFile( const zypp::Pathname & file_r )
+    : _begin( nullptr ), _size( 0 )
+    {
+      int fd = ::open( file_r.c_str(), O_RDONLY|O_CLOEXEC );
+      if ( fd < 0 )
+	return;
+      struct stat st;
+      if ( ::fstat( fd, &st ) == 0 && S_ISREG( st.st_mode ) && st.st_size > 0 )
+      {
+	void * map = ::mmap( 0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	if ( map != MAP_FAILED )
+	{
+	  _begin = static_cast<const char *>( map );
+	  _size = st.st_size;
+	  ::madvise( map, _size, MADV_SEQUENTIAL );
+	}
+      }
+      ::close( fd );
+    }
+
+    ~MappedFile()
+    { if ( _begin ) ::munmap( const_cast<char *>( _begin ), _size ); }
+
+    MappedFile( const MappedFile & ) = delete;
+    MappedFile & operator=( const MappedFile & ) = delete;
+
+    /** Whether the file is mapped and plain text (InputStream must handle compressed files). */
+    explicit operator bool() const
+    { return _begin && ! ( _size >= 2 && (unsigned char)_begin[0] == 0x1f && (unsigned char)_begin[1] == 0x8b ); }
+
+    const char * begin() const	{ return _begin; }
+    const char * end() const	{ return _begin + _size; }
+
+  private:
+    const char * _begin;
+    size_t       _size;
+  };
+
+  /** End of the line starting at \a pos_r (the \c '\\n' or \a end_r). */
+  inline const char * lineEnd( const char * pos_r, const char * end_r )
+  {
+    const char * nl = static_cast<const char *>( ::memchr( pos_r, '\n', end_r - pos_r ) );
+    return nl ? nl : end_r;
+  }
+
+  /** Start of the line containing \a pos_r (but not before \a begin_r). */
+  inline const char * lineStart( const char * begin_r, const char * pos_r )
+  {
+    const char * nl = static_cast<const char *>( ::memrchr( begin_r, '\n', pos_r - begin_r ) );
+    return nl ? nl + 1 : begin_r;
+  }
+
+  /** The n-th \c '|' separated field of a line (no unescaping; for the date and action field). */
+  inline boost::string_ref field( boost::string_ref line_r, unsigned n_r )
+  {
+    for ( ; n_r; --n_r )
+    {
+      boost::string_ref::size_type pos = line_r.find( '|' );
+      if ( pos == boost::string_ref::npos )
+	return boost::string_ref();
+      line_r.remove_prefix( pos + 1 );
+    }
+    return line_r.substr( 0, line_r.find( '|' ) );
+  }
+} // namespace
+///////////////////////////////////////////////////////////////////
+
 ///////////////////////////////////////////////////////////////////
 namespace zypp
 {
@@ -41,18 +122,52 @@ namespace zypp
     , _callback( callback_r )
     {}
 
-    bool parseLine( const std::string & line_r, unsigned int lineNr_r );
+    /** Line number to report, computed on demand. */
+    typedef function<unsigned()> LineNr;
+
+    bool parseLine( const std::string & line_r, const LineNr & lineNr_r );
+
+    /** Whether the lines action passes the action filter (checked without copying the line). */
+    bool actionWanted( boost::string_ref line_r ) const;
 
     void readAll( const ProgressData::ReceiverFnc & progress_r );
     void readFrom( const Date & date_r, const ProgressData::ReceiverFnc & progress_r );
     void readFromTo( const Date & fromDate_r, const Date & toDate_r, const ProgressData::ReceiverFnc & progress_r );
 
+    /** Parse the data lines in [\a begin_r, \a end_r) of \a file_r. */
+    void readMapped( const MappedFile & file_r, const char * begin_r, const char * end_r, const ProgressData::ReceiverFnc & progress_r );
+
+    /** Start of the first data line in [\a begin_r, \a end_r) logged after (\a orEqual_r: at or after) \a date_r.
+     * Binary search, as the log is written in chronological order. Returns \a end_r if there is none.
+     */
+    const char * lowerBound( const char * begin_r, const char * end_r, const Date & date_r, bool orEqual_r ) const;
+
     Pathname _filename;
     Options  _options;
     ProcessData _callback;
+    std::vector<std::string> _actionFilter;
   };
 
-  bool HistoryLogReader::Impl::parseLine( const std::string & line_r, unsigned lineNr_r )
+  bool HistoryLogReader::Impl::actionWanted( boost::string_ref line_r ) const
+  {
+    if ( _actionFilter.empty() )
+      return true;
+
+    boost::string_ref action( field( line_r, 1 ) );	// writer is padding the action field
+    while ( ! action.empty() && ::isspace( action.front() ) )
+      action.remove_prefix( 1 );
+    while ( ! action.empty() && ::isspace( action.back() ) )
+      action.remove_suffix( 1 );
+
+    for ( const std::string & wanted : _actionFilter )
+    {
+      if ( action == wanted )
+	return true;
+    }
+    return false;
+  }
+
+  bool HistoryLogReader::Impl::parseLine( const std::string & line_r, const LineNr & lineNr_r )
   {
     // parse into fields
     HistoryLogData::FieldVector fields;
@@ -71,13 +186,13 @@ namespace zypp
       ZYPP_CAUGHT( excpt );
       if ( _options.testFlag( IGNORE_INVALID_ITEMS ) )
       {
-	WAR << "Ignore invalid history log entry on line #" << lineNr_r << " '"<< line_r << "'" << endl;
+	WAR << "Ignore invalid history log entry on line #" << lineNr_r() << " '"<< line_r << "'" << endl;
 	return true;
       }
       else
       {
-	ERR << "Invalid history log entry on line #" << lineNr_r << " '"<< line_r << "'" << endl;
-	ParseException newexcpt( str::Str() << "Error in history log on line #" << lineNr_r );
+	ERR << "Invalid history log entry on line #" << lineNr_r() << " '"<< line_r << "'" << endl;
+	ParseException newexcpt( str::Str() << "Error in history log on line #" << lineNr_r() );
 	newexcpt.remember( excpt );
 	ZYPP_THROW( newexcpt );
       }
@@ -86,14 +201,93 @@ namespace zypp
     // consume data
     if ( _callback && !_callback( data ) )
     {
-      WAR << "Stop parsing requested by consumer callback on line #" << lineNr_r << endl;
+      WAR << "Stop parsing requested by consumer callback on line #" << lineNr_r() << endl;
       return false;
     }
     return true;
   }
 
+  const char * HistoryLogReader::Impl::lowerBound( const char * begin_r, const char * end_r, const Date & date_r, bool orEqual_r ) const
+  {
+    // [begin_r, end_r) are line boundaries; lines before begin_r are logged
+    // before date_r, lines from end_r on at/after date_r.
+    while ( begin_r < end_r )
+    {
+      const char * mid = lineStart( begin_r, begin_r + ( end_r - begin_r ) / 2 );
+      const char * line = mid;
+      const char * eol = line;
+      for ( ; line < end_r; line = eol + 1 )
+      {
+	eol = lineEnd( line, end_r );
+	if ( line != eol && *line != '#' )
+	  break;	// data line
+      }
+      if ( line >= end_r )
+      {
+	end_r = mid;	// just comments up to end_r
+	continue;
+      }
+
+      bool after = false;
+      try
+      {
+	Date logDate( field( boost::string_ref( line, eol - line ), 0 ).to_string(), HISTORY_LOG_DATE_FORMAT );
+	after = ( orEqual_r ? logDate >= date_r : logDate > date_r );
+      }
+      catch ( const Exception & )
+      {
+	after = false;	// treat as old; if it's in the range read, parseLine will complain
+      }
+
+      if ( after )
+	end_r = line;
+      else
+	begin_r = ( eol < end_r ? eol + 1 : end_r );
+    }
+    return begin_r;
+  }
+
+  void HistoryLogReader::Impl::readMapped( const MappedFile & file_r, const char * begin_r, const char * end_r, const ProgressData::ReceiverFnc & progress_r )
+  {
+    ProgressData pd( end_r - begin_r );
+    pd.sendTo( progress_r );
+    pd.toMin();
+
+    // Line numbers are needed for messages only; count them on demand.
+    const char * countedPos = file_r.begin();
+    unsigned countedNr = 0;
+    const char * line = begin_r;
+    auto lineNr = [&]()->unsigned {
+      countedNr += std::count( countedPos, line, '\n' );
+      countedPos = line;
+      return countedNr + 1;
+    };
+
+    for ( const char * eol = begin_r; line < end_r; line = eol + 1 )
+    {
+      eol = lineEnd( line, end_r );
+      pd.set( line - begin_r );
+
+      // ignore comments
+      if ( *line == '#' )
+	continue;
+
+      if ( ! actionWanted( boost::string_ref( line, eol - line ) ) )
+	continue;
+
+      if ( ! parseLine( std::string( line, eol ), lineNr ) )
+	break;	// requested by consumer callback
+    }
+
+    pd.toMax();
+  }
+
   void HistoryLogReader::Impl::readAll( const ProgressData::ReceiverFnc & progress_r )
   {
+    MappedFile file( _filename );
+    if ( file )
+      return readMapped( file, file.begin(), file.end(), progress_r );
+
     InputStream is( _filename );
     iostr::EachLine line( is );
 
@@ -107,7 +301,10 @@ namespace zypp
       if ( (*line)[0] == '#' )
         continue;
 
-      if ( ! parseLine( *line, line.lineNo() ) )
+      if ( ! actionWanted( *line ) )
+	continue;
+
+      if ( ! parseLine( *line, [&line]()->unsigned { return line.lineNo(); } ) )
 	break;	// requested by consumer callback
     }
 
@@ -116,6 +313,10 @@ namespace zypp
 
   void HistoryLogReader::Impl::readFrom( const Date & date_r, const ProgressData::ReceiverFnc & progress_r )
   {
+    MappedFile file( _filename );
+    if ( file )
+      return readMapped( file, lowerBound( file.begin(), file.end(), date_r, false ), file.end(), progress_r );
+
     InputStream is( _filename );
     iostr::EachLine line( is );
 
@@ -134,7 +335,7 @@ namespace zypp
 
       if ( pastDate )
       {
-	if ( ! parseLine( s, line.lineNo() ) )
+	if ( actionWanted( s ) && ! parseLine( s, [&line]()->unsigned { return line.lineNo(); } ) )
 	  break;	// requested by consumer callback
       }
       else
@@ -143,7 +344,7 @@ namespace zypp
         if ( logDate > date_r )
         {
           pastDate = true;
-          if ( ! parseLine( s, line.lineNo() ) )
+          if ( actionWanted( s ) && ! parseLine( s, [&line]()->unsigned { return line.lineNo(); } ) )
 	    break;	// requested by consumer callback
         }
       }
@@ -154,6 +355,13 @@ namespace zypp
 
   void HistoryLogReader::Impl::readFromTo( const Date & fromDate_r, const Date & toDate_r, const ProgressData::ReceiverFnc & progress_r )
   {
+    MappedFile file( _filename );
+    if ( file )
+    {
+      const char * begin = lowerBound( file.begin(), file.end(), fromDate_r, false );
+      return readMapped( file, begin, lowerBound( begin, file.end(), toDate_r, true ), progress_r );
+    }
+
     InputStream is( _filename );
     iostr::EachLine line( is );
 
@@ -182,7 +390,7 @@ namespace zypp
 
       if ( pastFromDate )
       {
-	if ( ! parseLine( s, line.lineNo() ) )
+	if ( actionWanted( s ) && ! parseLine( s, [&line]()->unsigned { return line.lineNo(); } ) )
 	  break;	// requested by consumer callback
       }
     }
@@ -209,6 +417,17 @@ namespace zypp
   bool HistoryLogReader::ignoreInvalidItems() const
   { return _pimpl->_options.testFlag( IGNORE_INVALID_ITEMS ); }
 
+  void HistoryLogReader::addActionFilter( const HistoryActionID & action_r )
+  {
+    if ( action_r == HistoryActionID::NONE )
+      _pimpl->_actionFilter.clear();
+    else if ( std::find( _pimpl->_actionFilter.begin(), _pimpl->_actionFilter.end(), action_r.asString() ) == _pimpl->_actionFilter.end() )
+      _pimpl->_actionFilter.push_back( action_r.asString() );
+  }
+
+  void HistoryLogReader::clearActionFilter()
+  { _pimpl->_actionFilter.clear(); }
+
   void HistoryLogReader::readAll( const ProgressData::ReceiverFnc & progress_r )
   { _pimpl->readAll( progress_r ); }
 
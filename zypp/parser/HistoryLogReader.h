@@ -62,6 +62,11 @@ namespace zypp
   /// \endcode
   /// \see \ref HistoryLogData for how to access the individual data fields.
   ///
+  /// Plain text files are memory mapped. As the log is written in chronological
+  /// order, \ref readFrom and \ref readFromTo locate the requested range by
+  /// binary search, and lines rejected by the \ref addActionFilter are skipped
+  /// without being copied or parsed.
+  ///
   ///////////////////////////////////////////////////////////////////
   class HistoryLogReader
   {
@@ -139,6 +144,15 @@ namespace zypp
      */
     bool ignoreInvalidItems() const;
 
+    /**
+     * Process only lines with the given action (and those of former calls).
+     * Adding \ref HistoryActionID::NONE clears the filter.
+     */
+    void addActionFilter( const HistoryActionID & action_r );
+
+    /** Process lines with any action (the default). */
+    void clearActionFilter();
+
   private:
     /** Implementation */
     class Impl;
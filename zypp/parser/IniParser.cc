@@ -36,6 +36,25 @@ namespace parser
       static const std::string & _val( ":/?|,\\" );
       return _val;
     }
+
+    /** Parser recording the callbacks (garbage lines do not throw). */
+    struct IniRecorder : public IniParser
+    {
+      IniRecorder( IniEvents & events_r )
+      : _events( events_r )
+      {}
+
+      virtual void consume( const std::string & section_r )
+      { _events.events.push_back( { IniEvents::SECTION, 0, section_r, std::string(), std::string() } ); }
+
+      virtual void consume( const std::string & section_r, const std::string & key_r, const std::string & value_r )
+      { _events.events.push_back( { IniEvents::ENTRY, 0, section_r, key_r, value_r } ); }
+
+      virtual void garbageLine( const std::string & section_r, const std::string & line_r )
+      { _events.events.push_back( { IniEvents::GARBAGE, lineNr(), section_r, line_r, std::string() } ); }
+
+      IniEvents & _events;
+    };
   } //namespace
 
 ///////////////////////////////////////////////////////////////////
@@ -138,6 +157,38 @@ void IniParser::parse( const InputStream & input_r, const ProgressData::Receiver
   MIL << "Done parsing " << input_r << endl;
 }
 
+void IniParser::replay( const IniEvents & events_r )
+{
+  _inputname = events_r.inputname;
+  beginParse();
+  for ( const IniEvents::Event & event : events_r.events )
+  {
+    switch ( event.type )
+    {
+      case IniEvents::SECTION:
+	consume( event.section );
+	break;
+      case IniEvents::ENTRY:
+	consume( event.section, event.key, event.value );
+	break;
+      case IniEvents::GARBAGE:
+	_line_nr = event.lineNr;
+	garbageLine( event.section, event.key );
+	break;
+    }
+  }
+  endParse();
+  _inputname.clear();
+}
+
+IniEvents IniParser::record( const InputStream & input_r )
+{
+  IniEvents ret;
+  ret.inputname = input_r.name();
+  IniRecorder( ret ).parse( input_r );
+  return ret;
+}
+
 /////////////////////////////////////////////////////////////////
 } // namespace parser
 ///////////////////////////////////////////////////////////////////
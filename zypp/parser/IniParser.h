@@ -15,6 +15,7 @@
 #include <iosfwd>
 #include <string>
 #include <list>
+#include <vector>
 
 #include "zypp/base/PtrTypes.h"
 #include "zypp/base/NonCopyable.h"
@@ -28,6 +29,31 @@ namespace zypp
 namespace parser
 { /////////////////////////////////////////////////////////////////
 
+///////////////////////////////////////////////////////////////////
+/// \class IniEvents
+/// \brief The callbacks an \ref IniParser invokes for an INI-file, recorded.
+///
+/// Recording a file (\ref IniParser::record) and replaying the events
+/// (\ref IniParser::replay) has the same effect as parsing it. Allows
+/// to cache parsed files (\see \ref repo::RepoDefinitionIndex).
+///////////////////////////////////////////////////////////////////
+struct IniEvents
+{
+  enum Type { SECTION, ENTRY, GARBAGE };
+
+  struct Event
+  {
+    Type        type;
+    int         lineNr;		///< GARBAGE: line number for the error message
+    std::string section;
+    std::string key;		///< ENTRY: key, GARBAGE: the line
+    std::string value;		///< ENTRY: value
+  };
+
+  std::string        inputname;	///< Name of the recorded InputStream
+  std::vector<Event> events;
+};
+
 ///////////////////////////////////////////////////////////////////
 /// \class IniParser
 /// \brief Simple INI-file parser
@@ -52,6 +78,16 @@ public:
   */
   void parse( const InputStream & imput_r, const ProgressData::ReceiverFnc & progress = ProgressData::ReceiverFnc() );
 
+  /** Invoke the callbacks recorded in \a events_r, as if the file was parsed again.
+   * \throw ParseException on errors (as \ref parse would do).
+   */
+  void replay( const IniEvents & events_r );
+
+  /** Parse the stream, just recording the callbacks to invoke.
+   * \throw Exception if the stream can not be read.
+   */
+  static IniEvents record( const InputStream & imput_r );
+
 public:
   /** Called when start parsing. */
   virtual void beginParse();
@@ -80,6 +116,12 @@ public:
     return _inputname;
   }
 
+  /** Number of the line passed to \ref garbageLine. */
+  int lineNr() const
+  {
+    return _line_nr;
+  }
+
 private:
   std::string _inputname;
   std::string _current_section;
@@ -40,6 +40,9 @@ namespace zypp
 	RepoFileParser( const InputStream & is_r )
 	{ read( is_r ); }
 
+	RepoFileParser( const IniEvents & events_r )
+	{ replay( events_r ); }
+
 	using IniDict::consume;	// don't hide overloads we don't redefine here
 
 	virtual void consume( const std::string & section_r, const std::string & key_r, const std::string & value_r )
@@ -113,11 +116,10 @@ namespace zypp
    * \short List of RepoInfo's from a file.
    * \param file pathname of the file to read.
    */
-    static void repositories_in_stream( const InputStream &is,
-                                        const RepoFileReader::ProcessRepo &callback,
-                                        const ProgressData::ReceiverFnc &progress )
+    static void repositories_in_dict( RepoFileParser & dict,
+                                      const Pathname & file,
+                                      const RepoFileReader::ProcessRepo &callback )
     {
-      RepoFileParser dict(is);
       for_( its, dict.sectionsBegin(), dict.sectionsEnd() )
       {
         RepoInfo info;
@@ -187,7 +189,7 @@ namespace zypp
 
 	info.setGpgKeyUrls( std::move(dict.gpgkeys( *its )) );
 
-        info.setFilepath(is.path());
+        info.setFilepath(file);
         MIL << info << endl;
         // add it to the list.
         callback(info);
@@ -196,6 +198,14 @@ namespace zypp
       }
     }
 
+    static void repositories_in_stream( const InputStream &is,
+                                        const RepoFileReader::ProcessRepo &callback,
+                                        const ProgressData::ReceiverFnc &progress )
+    {
+      RepoFileParser dict(is);
+      repositories_in_dict( dict, is.path(), callback );
+    }
+
     ///////////////////////////////////////////////////////////////////
     //
     //	CLASS NAME : RepoFileReader
@@ -218,6 +228,14 @@ namespace zypp
       repositories_in_stream(is, _callback, progress);
     }
 
+    RepoFileReader::RepoFileReader( const IniEvents & events,
+                                    const ProcessRepo & callback )
+      : _callback(callback)
+    {
+      RepoFileParser dict(events);
+      repositories_in_dict( dict, events.inputname, _callback );
+    }
+
     RepoFileReader::~RepoFileReader()
     {}
 
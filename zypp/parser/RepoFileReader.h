@@ -25,6 +25,7 @@ namespace zypp
   ///////////////////////////////////////////////////////////////////
   namespace parser
   { /////////////////////////////////////////////////////////////////
+    struct IniEvents;
 
     /**
      * \short Read repository data from a .repo file
@@ -97,6 +98,19 @@ namespace zypp
                       const ProcessRepo & callback,
                       const ProgressData::ReceiverFnc &progress = ProgressData::ReceiverFnc() );
 
+     /**
+      * \short Constructor. Creates the reader and replays the recorded repo file.
+      *
+      * \param events The events recorded when parsing a repo file (\see \ref IniParser::record)
+      * \param callback Callback that will be called for each repository.
+      *
+      * \throws AbortRequestException If the callback returns false
+      * \throws Exception If a error occurs at parsing
+      *
+      */
+      RepoFileReader( const IniEvents & events,
+                      const ProcessRepo & callback );
+
       /**
        * Dtor
        */
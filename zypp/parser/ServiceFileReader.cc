@@ -35,6 +35,9 @@ namespace zypp
     public:
       static void parseServices( const Pathname & file,
           const ServiceFileReader::ProcessService & callback );
+
+      static void parseServices( const IniDict & dict, const Pathname & file,
+          const ServiceFileReader::ProcessService & callback );
     };
 
     void ServiceFileReader::Impl::parseServices( const Pathname & file,
@@ -48,6 +51,12 @@ namespace zypp
       }
 
       parser::IniDict dict(is);
+      parseServices( dict, file, callback );
+    }
+
+    void ServiceFileReader::Impl::parseServices( const IniDict & dict, const Pathname & file,
+                                  const ServiceFileReader::ProcessService & callback )
+    {
       for ( parser::IniDict::section_const_iterator its = dict.sectionsBegin();
             its != dict.sectionsEnd();
             ++its )
@@ -163,6 +172,14 @@ namespace zypp
       //MIL << "Done" << endl;
     }
 
+    ServiceFileReader::ServiceFileReader( const IniEvents & events,
+                                    const ProcessService & callback )
+    {
+      IniDict dict;
+      dict.replay( events );
+      Impl::parseServices( dict, events.inputname, callback );
+    }
+
     ServiceFileReader::~ServiceFileReader()
     {}
 
@@ -26,6 +26,7 @@ namespace zypp
   ///////////////////////////////////////////////////////////////////
   namespace parser
   { /////////////////////////////////////////////////////////////////
+    struct IniEvents;
 
     /**
      * \short Read service data from a .service file
@@ -70,6 +71,19 @@ namespace zypp
       */
       ServiceFileReader( const Pathname & serviceFile,
                       const ProcessService & callback);
+
+     /**
+      * \short Constructor. Creates the reader and replays the recorded .service file.
+      *
+      * \param events The events recorded when parsing a .service file (\see \ref IniParser::record)
+      * \param callback Callback that will be called for each service.
+      *
+      * \throws AbortRequestException If the callback returns false
+      * \throws Exception If a error occurs at parsing
+      *
+      */
+      ServiceFileReader( const IniEvents & events,
+                      const ProcessService & callback);
      
       /**
        * Dtor
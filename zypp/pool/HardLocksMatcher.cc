@@ -0,0 +1,303 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/pool/HardLocksMatcher.cc
+ *
+*/
+#include <cstring>
+#include <iostream>
+
+#include "zypp/base/LogTools.h"
+#include "zypp/base/String.h"
+#include "zypp/pool/HardLocksMatcher.h"
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace pool
+  {
+    ///////////////////////////////////////////////////////////////////
+    namespace
+    {
+      inline Match matchFlags( Match::Mode mode_r, bool nocase_r )
+      {
+	Match ret( mode_r );
+	if ( nocase_r )
+	  ret |= Match::NOCASE;
+	return ret;
+      }
+
+      /** Append \a ch_r to \a rx_r, escaped if special to an extended regex. */
+      inline void appendLiteral( std::string & rx_r, char ch_r )
+      {
+	if ( ::strchr( ".^$+(){}|\\*?[", ch_r ) )
+	  rx_r += '\\';
+	rx_r += ch_r;
+      }
+
+      /** Extended regex matching the same strings as \c fnmatch(3) does for \a glob_r.
+       * Returns \c false if the glob uses features not converted (escapes within
+       * bracket expressions, character classes, unclosed brackets, trailing backslash).
+       */
+      bool glob2regex( const std::string & glob_r, std::string & rx_r )
+      {
+	std::string rx( "^" );
+	for ( std::string::size_type i = 0; i < glob_r.size(); ++i )
+	{
+	  char ch = glob_r[i];
+	  switch ( ch )
+	  {
+	    case '*':
+	      rx += ".*";
+	      break;
+
+	    case '?':
+	      rx += '.';
+	      break;
+
+	    case '\\':
+	      if ( ++i == glob_r.size() )
+		return false;
+	      appendLiteral( rx, glob_r[i] );
+	      break;
+
+	    case '[':
+	    {
+	      std::string::size_type j = i + 1;
+	      bool negate = false;
+	      if ( j < glob_r.size() && ( glob_r[j] == '!' || glob_r[j] == '^' ) )
+	      {
+		negate = true;
+		++j;
+	      }
+	      std::string::size_type start = j;
+	      if ( j < glob_r.size() && glob_r[j] == ']' )
+		++j;	// a leading ']' is a member
+	      std::string::size_type end = glob_r.find( ']', j );
+	      if ( end == std::string::npos )
+		return false;
+	      std::string members( glob_r.substr( start, end - start ) );
+	      if ( members.find_first_of( "\\[" ) != std::string::npos )
+		return false;
+	      rx += '[';
+	      if ( negate )
+		rx += '^';
+	      rx += members;
+	      rx += ']';
+	      i = end;
+	    }
+	    break;
+
+	    default:
+	      appendLiteral( rx, ch );
+	      break;
+	  }
+	}
+	rx += '$';
+	rx_r.swap( rx );
+	return true;
+      }
+
+      /** Whether \a rx_r contains a back reference (which would break when joined). */
+      inline bool hasBackref( const std::string & rx_r )
+      {
+	for ( std::string::size_type pos = rx_r.find( '\\' ); pos != std::string::npos && pos+1 < rx_r.size(); pos = rx_r.find( '\\', pos+2 ) )
+	{
+	  if ( rx_r[pos+1] >= '1' && rx_r[pos+1] <= '9' )
+	    return true;
+	}
+	return false;
+      }
+
+      /** Compile \a matcher_r, log and return \c false if it fails. */
+      bool compiles( const StrMatcher & matcher_r, bool verbose_r = true )
+      {
+	try
+	{
+	  matcher_r.compile();
+	  return true;
+	}
+	catch ( const Exception & excpt )
+	{
+	  ZYPP_CAUGHT( excpt );
+	}
+	if ( verbose_r )
+	  WAR << "Lock pattern does not compile: " << matcher_r << endl;
+	return false;
+      }
+    } // namespace
+    ///////////////////////////////////////////////////////////////////
+
+    void HardLocksMatcher::Bucket::add( const std::string & str_r, const Match & flags_r )
+    {
+      bool nocase = flags_r.test( Match::NOCASE );
+      std::string rx;
+      switch ( flags_r.mode() )
+      {
+	case Match::STRING:
+	  _exact[nocase].insert( nocase ? str::toLower( str_r ) : str_r );
+	  return;
+
+	case Match::SUBSTRING:
+	  for ( char ch : str_r )
+	    appendLiteral( rx, ch );
+	  break;
+
+	case Match::GLOB:
+	  if ( ! glob2regex( str_r, rx ) || ! compiles( StrMatcher( rx, matchFlags( Match::REGEX, nocase ) ), /*verbose*/false ) )
+	  {
+	    StrMatcher single( str_r, matchFlags( Match::GLOB, nocase ) );
+	    if ( compiles( single ) )
+	      _single.push_back( single );
+	    return;
+	  }
+	  break;
+
+	case Match::REGEX:
+	{
+	  StrMatcher single( str_r, matchFlags( Match::REGEX, nocase ) );
+	  if ( ! compiles( single ) )
+	    return;	// like PoolQueryResult: matches nothing
+	  if ( hasBackref( str_r ) )
+	  {
+	    _single.push_back( single );
+	    return;
+	  }
+	  rx = str_r;
+	}
+	break;
+
+	default:	// not a PoolQuery::isPlainNameMatch
+	  return;
+      }
+      _rx[nocase].push_back( rx );
+    }
+
+    void HardLocksMatcher::Bucket::compile()
+    {
+      for ( unsigned nocase = 0; nocase < 2; ++nocase )
+      {
+	std::vector<std::string> & rxs( _rx[nocase] );
+	if ( rxs.empty() )
+	  continue;
+
+	std::string joined;
+	for ( const std::string & rx : rxs )
+	{
+	  if ( ! joined.empty() )
+	    joined += '|';
+	  joined += '(';
+	  joined += rx;
+	  joined += ')';
+	}
+	_joined[nocase] = StrMatcher( joined, matchFlags( Match::REGEX, nocase ) );
+	if ( ! compiles( _joined[nocase] ) )
+	{
+	  // Should not happen as the components compile, but be safe.
+	  _joined[nocase] = StrMatcher();
+	  for ( const std::string & rx : rxs )
+	  {
+	    StrMatcher single( rx, matchFlags( Match::REGEX, nocase ) );
+	    if ( compiles( single ) )
+	      _single.push_back( single );
+	  }
+	}
+	rxs.clear();
+      }
+    }
+
+    bool HardLocksMatcher::Bucket::matches( const char * name_r ) const
+    {
+      if ( ! _exact[0].empty() && _exact[0].count( name_r ) )
+	return true;
+      if ( ! _exact[1].empty() && _exact[1].count( str::toLower( name_r ) ) )
+	return true;
+      for ( unsigned nocase = 0; nocase < 2; ++nocase )
+      {
+	if ( _joined[nocase] && _joined[nocase].doMatch( name_r ) )
+	  return true;
+      }
+      for ( const StrMatcher & single : _single )
+      {
+	if ( single.doMatch( name_r ) )
+	  return true;
+      }
+      return false;
+    }
+
+    HardLocksMatcher::HardLocksMatcher( const PoolTraits::HardLockQueries & queries_r )
+    : _compiled( 0 )
+    {
+      for ( const PoolQuery & query : queries_r )
+      {
+	if ( ! query.isPlainNameMatch() )
+	{
+	  _others += query;
+	  continue;
+	}
+
+	std::string pattern;
+	for ( const std::string & str : query.attribute( sat::SolvAttr::name ) )
+	{
+	  if ( ! str.empty() )
+	  {
+	    pattern = str;
+	    break;
+	  }
+	}
+
+	if ( query.kinds().empty() )
+	  _buckets[ResKind()].add( pattern, query.flags() );
+	else
+	{
+	  for ( const ResKind & kind : query.kinds() )
+	    _buckets[kind].add( pattern, query.flags() );
+	}
+	++_compiled;
+      }
+
+      for ( auto & bucket : _buckets )
+	bucket.second.compile();
+
+      MIL << *this << endl;
+    }
+
+    bool HardLocksMatcher::operator()( const sat::Solvable & solv_r ) const
+    {
+      if ( ! _others.empty() && _others.contains( solv_r ) )
+	return true;
+      if ( _buckets.empty() )
+	return false;
+
+      // Like Match::SKIP_KIND: look at the name without 'kind:' prefix.
+      const char * name = solv_r.ident().c_str();
+      const char * sep = ::strchr( name, ':' );
+      if ( sep )
+	name = sep+1;
+
+      for ( const auto & bucket : _buckets )
+      {
+	if ( ( ! bucket.first || solv_r.isKind( bucket.first ) ) && bucket.second.matches( name ) )
+	  return true;
+      }
+      return false;
+    }
+
+    std::ostream & operator<<( std::ostream & str, const HardLocksMatcher & obj )
+    {
+      return str << "HardLocksMatcher(compiled " << obj._compiled << ", " << obj._buckets.size() << " buckets; others match "
+                 << obj._others.size() << ")";
+    }
+
+  } // namespace pool
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
@@ -0,0 +1,88 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/pool/HardLocksMatcher.h
+ *
+*/
+#ifndef ZYPP_POOL_HARDLOCKSMATCHER_H
+#define ZYPP_POOL_HARDLOCKSMATCHER_H
+
+#include <iosfwd>
+#include <map>
+#include <vector>
+#include <unordered_set>
+
+#include "zypp/pool/PoolTraits.h"
+#include "zypp/PoolQueryResult.h"
+#include "zypp/base/StrMatcher.h"
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace pool
+  {
+    ///////////////////////////////////////////////////////////////////
+    /// \class HardLocksMatcher
+    /// \brief All hard lock queries compiled into one matcher.
+    ///
+    /// Evaluating each lock query on its own means a pool scan per
+    /// lock. Instead the usual locks (\ref PoolQuery::isPlainNameMatch)
+    /// are bucketed by kind and case sensitivity. Exact names are looked
+    /// up in a hash set, substring, glob and regex patterns are joined
+    /// into a single regex per bucket. Only the remaining queries are
+    /// evaluated the usual way (once, when the matcher is built).
+    ///
+    /// \code
+    ///   HardLocksMatcher locked( hardLockQueries );
+    ///   for ( const PoolItem & pi : pool )
+    ///     pi.status().setLock( locked( pi.satSolvable() ), ResStatus::USER );
+    /// \endcode
+    ///
+    /// As with \ref PoolQueryResult, a query that does not compile
+    /// matches nothing.
+    ///////////////////////////////////////////////////////////////////
+    class HardLocksMatcher
+    {
+      friend std::ostream & operator<<( std::ostream & str, const HardLocksMatcher & obj );
+
+    public:
+      /** Ctor compiling \a queries_r. */
+      explicit HardLocksMatcher( const PoolTraits::HardLockQueries & queries_r );
+
+    public:
+      /** Whether \a solv_r is matched by any of the lock queries. */
+      bool operator()( const sat::Solvable & solv_r ) const;
+
+    private:
+      /** Patterns for solvables of one kind (or any kind). */
+      struct Bucket
+      {
+	std::unordered_set<std::string> _exact[2];	///< [0] case sensitive, [1] lowercased
+	std::vector<std::string>        _rx[2];		///< regex components to join
+	StrMatcher                      _joined[2];	///< the joined regex
+	std::vector<StrMatcher>         _single;	///< patterns not to join
+
+	void add( const std::string & str_r, const Match & flags_r );
+	void compile();
+	bool matches( const char * name_r ) const;
+      };
+
+      std::map<ResKind,Bucket> _buckets;	///< by kind; ResKind() for any kind
+      PoolQueryResult _others;			///< result of the queries not compiled
+      unsigned _compiled;			///< number of queries compiled
+    };
+
+    /** \relates HardLocksMatcher Stream output */
+    std::ostream & operator<<( std::ostream & str, const HardLocksMatcher & obj );
+
+  } // namespace pool
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_POOL_HARDLOCKSMATCHER_H
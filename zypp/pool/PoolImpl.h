@@ -22,6 +22,7 @@
 #include "zypp/pool/PoolTraits.h"
 #include "zypp/ResPoolProxy.h"
 #include "zypp/PoolQueryResult.h"
+#include "zypp/pool/HardLocksMatcher.h"
 
 #include "zypp/sat/Pool.h"
 #include "zypp/Product.h"
@@ -229,16 +230,16 @@ namespace zypp
           // did not change since. Action is to be performed only on
           // those items that gained the bit in the UserLockQueryField.
           MIL << "Re-apply " << _hardLockQueries.size() << " HardLockQueries" << endl;
-          PoolQueryResult locked;
-          for_( it, _hardLockQueries.begin(), _hardLockQueries.end() )
-          {
-            locked += *it;
-          }
-          MIL << "HardLockQueries match " << locked.size() << " Solvables." << endl;
+          HardLocksMatcher locked( _hardLockQueries );
+          unsigned cnt = 0;
           for_( it, begin(), end() )
           {
-            resstatus::UserLockQueryManip::reapplyLock( it->status(), locked.contains( *it ) );
+            bool match = locked( it->satSolvable() );
+            if ( match )
+              ++cnt;
+            resstatus::UserLockQueryManip::reapplyLock( it->status(), match );
           }
+          MIL << "HardLockQueries match " << cnt << " Solvables." << endl;
         }
 
         void setHardLockQueries( const HardLockQueries & newLocks_r )
@@ -246,16 +247,16 @@ namespace zypp
           MIL << "Apply " << newLocks_r.size() << " HardLockQueries" << endl;
           _hardLockQueries = newLocks_r;
           // now adjust the pool status
-          PoolQueryResult locked;
-          for_( it, _hardLockQueries.begin(), _hardLockQueries.end() )
-          {
-            locked += *it;
-          }
-          MIL << "HardLockQueries match " << locked.size() << " Solvables." << endl;
+          HardLocksMatcher locked( _hardLockQueries );
+          unsigned cnt = 0;
           for_( it, begin(), end() )
           {
-            resstatus::UserLockQueryManip::setLock( it->status(), locked.contains( *it ) );
+            bool match = locked( it->satSolvable() );
+            if ( match )
+              ++cnt;
+            resstatus::UserLockQueryManip::setLock( it->status(), match );
           }
+          MIL << "HardLockQueries match " << cnt << " Solvables." << endl;
         }
 
         bool getHardLockQueries( HardLockQueries & activeLocks_r )
@@ -298,6 +299,13 @@ namespace zypp
           return setChanged;
        }
 
+      private:
+        /** Whether \a pi_r holds an item. \c bool(pi_r) can't tell as it just
+         * asks whether the solvable is (still) valid.
+         */
+        static bool slotUsed( const PoolItem & pi_r )
+        { return pi_r._id != sat::detail::noSolvableId; }
+
       public:
         const ContainerT & store() const
         {
@@ -309,6 +317,11 @@ namespace zypp
 	    bool reusedIDs = _watcherIDs.remember( pool.serialIDs() );
             std::list<PoolItem> addedProducts;
 
+	    for ( sat::detail::SolvableIdType i = pool.capacity(); i < _store.size(); ++i )
+	    {
+	      if ( slotUsed( _store[i] ) )
+		PoolItem::dropPoolItem( sat::Solvable( i ) );
+	    }
 	    _store.resize( pool.capacity() );
 
             if ( pool.capacity() )
@@ -317,9 +330,10 @@ namespace zypp
               {
                 sat::Solvable s( i );
                 PoolItem & pi( _store[i] );
-                if ( ! s &&  pi )
+                if ( ! s && slotUsed( pi ) )
                 {
                   // the PoolItem got invalidated (e.g unloaded repo)
+                  PoolItem::dropPoolItem( s );
                   pi = PoolItem();
                 }
                 else if ( reusedIDs || (s && ! pi) )
@@ -365,7 +379,7 @@ namespace zypp
 	    _id2item = Id2ItemT( size() );
             for_( it, begin(), end() )
             {
-              const sat::Solvable &s = (*it)->satSolvable();
+              sat::Solvable s( it->satSolvable() );
               sat::detail::IdType id = s.ident().id();
               if ( s.isKind( ResKind::srcpackage ) )
                 id = -id;
@@ -0,0 +1,178 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/repo/ContentStore.cc
+ *
+*/
+#include <unistd.h>
+#include <iostream>
+#include <list>
+
+#include "zypp/base/LogTools.h"
+#include "zypp/base/String.h"
+#include "zypp/PathInfo.h"
+#include "zypp/repo/ContentStore.h"
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace repo
+  {
+    ///////////////////////////////////////////////////////////////////
+    namespace
+    {
+      /** Whether \a str_r is a non empty string of [0-9a-z] (no path tricks). */
+      inline bool isPlainKey( const std::string & str_r )
+      {
+	if ( str_r.empty() )
+	  return false;
+	for ( char ch : str_r )
+	{
+	  if ( ! ( ( ch >= '0' && ch <= '9' ) || ( ch >= 'a' && ch <= 'z' ) ) )
+	    return false;
+	}
+	return true;
+      }
+
+      /** A process specific temporary name next to \a path_r. */
+      inline Pathname tmpName( const Pathname & path_r )
+      { return path_r.extend( ".store." + str::numstring( ::getpid() ) ); }
+
+      /** Hardlink \a from_r to \a to_r atomically replacing \a to_r. */
+      bool linkReplace( const Pathname & from_r, const Pathname & to_r )
+      {
+	if ( filesystem::assert_dir( to_r.dirname() ) != 0 )
+	  return false;
+	Pathname tmp( tmpName( to_r ) );
+	filesystem::unlink( tmp );
+	if ( filesystem::hardlink( from_r, tmp ) != 0 )
+	  return false;
+	if ( filesystem::rename( tmp, to_r ) != 0 )
+	{
+	  filesystem::unlink( tmp );
+	  return false;
+	}
+	return true;
+      }
+
+      /** Whether \a lhs and \a rhs are the same file. */
+      inline bool sameFile( const PathInfo & lhs, const PathInfo & rhs )
+      { return lhs.isFile() && rhs.isFile() && lhs.ino() == rhs.ino() && lhs.dev() == rhs.dev(); }
+    } // namespace
+    ///////////////////////////////////////////////////////////////////
+
+    ContentStore::ContentStore( const Pathname & root_r )
+    : _root( root_r )
+    {}
+
+    Pathname ContentStore::storedFile( const CheckSum & checksum_r ) const
+    {
+      Pathname ret;
+      if ( ! enabled() || checksum_r.empty() )
+	return ret;
+
+      std::string type( str::toLower( checksum_r.type() ) );
+      std::string sum( str::toLower( checksum_r.checksum() ) );
+      if ( ! isPlainKey( type ) || ! isPlainKey( sum ) || sum.size() < 3 )
+	return ret;
+
+      ret = _root / type / sum.substr( 0, 2 ) / sum;
+      return ret;
+    }
+
+    bool ContentStore::contains( const CheckSum & checksum_r ) const
+    {
+      Pathname stored( storedFile( checksum_r ) );
+      return( ! stored.empty() && PathInfo( stored ).isFile() );
+    }
+
+    bool ContentStore::provide( const CheckSum & checksum_r, const Pathname & dest_r ) const
+    {
+      Pathname stored( storedFile( checksum_r ) );
+      if ( stored.empty() )
+	return false;
+
+      PathInfo spi( stored );
+      if ( ! spi.isFile() )
+	return false;
+
+      if ( sameFile( spi, PathInfo( dest_r ) ) )
+	return true;	// already in place
+
+      if ( ! linkReplace( stored, dest_r ) )
+      {
+	WAR << "Can't link " << stored << " to " << dest_r << endl;
+	return false;
+      }
+      DBG << "Provided " << checksum_r << " from store: " << dest_r << endl;
+      return true;
+    }
+
+    bool ContentStore::add( const CheckSum & checksum_r, const Pathname & file_r ) const
+    {
+      Pathname stored( storedFile( checksum_r ) );
+      if ( stored.empty() )
+	return false;
+
+      PathInfo fpi( file_r );
+      if ( ! fpi.isFile() )
+	return false;
+
+      PathInfo spi( stored );
+      if ( spi.isFile() )
+	return true;	// first one wins; an existing file is as good as ours
+
+      // A copy would just double the disk usage; no store across devices.
+      if ( ! linkReplace( file_r, stored ) )
+	return false;
+      DBG << "Added " << checksum_r << " to store: " << file_r << endl;
+      return true;
+    }
+
+    unsigned ContentStore::purge() const
+    {
+      unsigned ret = 0;
+      if ( ! enabled() || ! PathInfo( _root ).isDir() )
+	return ret;
+
+      std::list<Pathname> types;
+      filesystem::readdir( types, _root, /*dots*/false );
+      for ( const Pathname & type : types )
+      {
+	std::list<Pathname> prefixes;
+	filesystem::readdir( prefixes, type, /*dots*/false );
+	for ( const Pathname & prefix : prefixes )
+	{
+	  std::list<Pathname> files;
+	  filesystem::readdir( files, prefix, /*dots*/false );
+	  unsigned removed = 0;
+	  for ( const Pathname & file : files )
+	  {
+	    // leftover tmp files are garbage as well
+	    if ( PathInfo( file, PathInfo::LSTAT ).nlink() <= 1 && filesystem::unlink( file ) == 0 )
+	      ++removed;
+	  }
+	  if ( removed == files.size() )
+	    filesystem::rmdir( prefix );
+	  ret += removed;
+	}
+      }
+      MIL << *this << ": purged " << ret << " files." << endl;
+      return ret;
+    }
+
+    std::ostream & operator<<( std::ostream & str, const ContentStore & obj )
+    { return str << "ContentStore(" << obj.root() << ")"; }
+
+  } // namespace repo
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
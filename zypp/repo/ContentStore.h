@@ -0,0 +1,106 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/repo/ContentStore.h
+ *
+*/
+#ifndef ZYPP_REPO_CONTENTSTORE_H
+#define ZYPP_REPO_CONTENTSTORE_H
+
+#include <iosfwd>
+
+#include "zypp/Pathname.h"
+#include "zypp/CheckSum.h"
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace repo
+  {
+    ///////////////////////////////////////////////////////////////////
+    /// \class ContentStore
+    /// \brief Content addressed store of verified files.
+    ///
+    /// Files are kept as hardlinks named by their checksum:
+    /// \c ROOT/TYPE/XX/CHECKSUM (\c XX being the first two digits).
+    /// The directory layout is the index, a lookup is a single \c stat.
+    ///
+    /// Only files whose checksum was verified must be \ref add ed, so a file
+    /// \ref provide d by the store need not be hashed again. As stored files
+    /// share the inode with the original, they must be replaced, never
+    /// modified in place.
+    ///
+    /// A stored file no longer linked anywhere else (link count \c 1) is
+    /// garbage and removed by \ref purge.
+    ///
+    /// \code
+    ///   ContentStore store( "/var/cache/zypp/store" );
+    ///   if ( ! store.provide( loc.checksum(), dest ) )
+    ///   {
+    ///     download( loc, dest );
+    ///     verify( dest, loc.checksum() );
+    ///     store.add( loc.checksum(), dest );
+    ///   }
+    /// \endcode
+    ///////////////////////////////////////////////////////////////////
+    class ContentStore
+    {
+      friend std::ostream & operator<<( std::ostream & str, const ContentStore & obj );
+
+    public:
+      /** Ctor taking the stores root directory (created on demand).
+       * An empty \a root_r disables the store.
+       */
+      explicit ContentStore( const Pathname & root_r = Pathname() );
+
+    public:
+      /** Whether the store is enabled. */
+      bool enabled() const
+      { return ! _root.empty(); }
+
+      /** The stores root directory. */
+      const Pathname & root() const
+      { return _root; }
+
+      /** Where the file with \a checksum_r is stored.
+       * Empty if the store is disabled or \a checksum_r is not usable as a key.
+       */
+      Pathname storedFile( const CheckSum & checksum_r ) const;
+
+      /** Whether a file with \a checksum_r is stored. */
+      bool contains( const CheckSum & checksum_r ) const;
+
+      /** Hardlink the file with \a checksum_r to \a dest_r (replacing \a dest_r).
+       * Returns \c false if it is not stored or can not be linked.
+       */
+      bool provide( const CheckSum & checksum_r, const Pathname & dest_r ) const;
+
+      /** Add \a file_r, which must have been verified against \a checksum_r.
+       * The file is hardlinked, never copied. Returns whether the store
+       * contains the checksum afterwards.
+       */
+      bool add( const CheckSum & checksum_r, const Pathname & file_r ) const;
+
+      /** Remove all stored files not linked anywhere else.
+       * Returns the number of files removed.
+       */
+      unsigned purge() const;
+
+    private:
+      Pathname _root;
+    };
+
+    /** \relates ContentStore Stream output */
+    std::ostream & operator<<( std::ostream & str, const ContentStore & obj );
+
+  } // namespace repo
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_REPO_CONTENTSTORE_H
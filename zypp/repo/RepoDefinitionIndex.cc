@@ -0,0 +1,353 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/repo/RepoDefinitionIndex.cc
+ *
+*/
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <fstream>
+#include <list>
+
+#include "zypp/base/LogTools.h"
+#include "zypp/base/String.h"
+#include "zypp/base/Exception.h"
+#include "zypp/base/Errno.h"
+#include "zypp/PathInfo.h"
+#include "zypp/repo/RepoDefinitionIndex.h"
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace repo
+  {
+    ///////////////////////////////////////////////////////////////////
+    namespace
+    {
+      // Snapshot file layout (host byte order, unaligned):
+      //   magic[8] uint32 byteOrder uint32 ndirs
+      //   ndirs  * { str path, Signature, uint32 nfiles }
+      //   nfiles * { str name, Signature, str inputname, uint32 nevents }
+      //   nevents* { uint8 type, int32 lineNr, str section, str key, str value }
+      // with str being { uint32 len, char[len] }.
+      const char     magic[8]  = { 'Z','Y','P','P','R','D','I','1' };
+      const uint32_t byteOrder = 0x01020304;
+
+      /** Files modified within this many seconds before they were read are not trusted (may change within the same mtime). */
+      const int64_t racyWindow = 2;
+
+      /** Append binary data to a buffer. */
+      struct Writer
+      {
+	std::string _buf;
+
+	template <class Tp>
+	void put( const Tp & val_r )
+	{ _buf.append( reinterpret_cast<const char *>( &val_r ), sizeof(Tp) ); }
+
+	void put( const std::string & val_r )
+	{
+	  put( uint32_t(val_r.size()) );
+	  _buf.append( val_r );
+	}
+
+	void put( const RepoDefinitionIndex::Signature & sig_r )
+	{
+	  put( sig_r.dev ); put( sig_r.ino ); put( sig_r.size ); put( sig_r.sec ); put( sig_r.nsec );
+	}
+      };
+
+      /** Read binary data from a memory mapped snapshot; \c false once out of bounds. */
+      struct Reader
+      {
+	const char * _pos;
+	const char * _end;
+
+	template <class Tp>
+	bool get( Tp & val_r )
+	{
+	  if ( size_t(_end - _pos) < sizeof(Tp) )
+	    return false;
+	  ::memcpy( &val_r, _pos, sizeof(Tp) );
+	  _pos += sizeof(Tp);
+	  return true;
+	}
+
+	bool get( std::string & val_r )
+	{
+	  uint32_t len;
+	  if ( ! get( len ) || size_t(_end - _pos) < len )
+	    return false;
+	  val_r.assign( _pos, len );
+	  _pos += len;
+	  return true;
+	}
+
+	bool get( RepoDefinitionIndex::Signature & sig_r )
+	{ return get( sig_r.dev ) && get( sig_r.ino ) && get( sig_r.size ) && get( sig_r.sec ) && get( sig_r.nsec ); }
+      };
+
+      /** Whether \a sig_r was modified so recently that a further change might not alter it. */
+      inline bool racy( const RepoDefinitionIndex::Signature & sig_r )
+      { return sig_r.sec + racyWindow >= int64_t(::time( nullptr )); }
+    } // namespace
+    ///////////////////////////////////////////////////////////////////
+
+    RepoDefinitionIndex::Signature RepoDefinitionIndex::Signature::of( const Pathname & path_r )
+    {
+      Signature ret;
+      struct stat st;
+      if ( ::stat( path_r.c_str(), &st ) == 0 )
+      {
+	ret.dev  = st.st_dev;
+	ret.ino  = st.st_ino;
+	ret.size = st.st_size;
+	ret.sec  = st.st_mtim.tv_sec;
+	ret.nsec = st.st_mtim.tv_nsec;
+      }
+      return ret;
+    }
+
+    RepoDefinitionIndex::RepoDefinitionIndex( const Pathname & file_r )
+    : _file( file_r )
+    , _parsed( 0 )
+    , _cached( 0 )
+    , _dirty( false )
+    { load(); }
+
+    RepoDefinitionIndex::~RepoDefinitionIndex()
+    {}
+
+    void RepoDefinitionIndex::load()
+    {
+      int fd = ::open( _file.c_str(), O_RDONLY|O_CLOEXEC );
+      if ( fd < 0 )
+	return;	// no snapshot
+
+      struct stat st;
+      if ( ::fstat( fd, &st ) != 0 || st.st_size == 0 )
+      {
+	::close( fd );
+	return;
+      }
+
+      void * map = ::mmap( 0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+      ::close( fd );
+      if ( map == MAP_FAILED )
+      {
+	WAR << "Can't mmap " << _file << endl;
+	return;
+      }
+
+      Reader reader { static_cast<const char *>( map ), static_cast<const char *>( map ) + st.st_size };
+      char fmagic[sizeof(magic)];
+      uint32_t fbyteOrder = 0;
+      uint32_t ndirs = 0;
+      bool valid = ( reader.get( fmagic ) && ::memcmp( fmagic, magic, sizeof(magic) ) == 0
+		     && reader.get( fbyteOrder ) && fbyteOrder == byteOrder
+		     && reader.get( ndirs ) );
+
+      std::map<std::string,DirEntry> dirs;
+      for ( uint32_t d = 0; valid && d < ndirs; ++d )
+      {
+	std::string path;
+	uint32_t nfiles = 0;
+	valid = reader.get( path );
+	DirEntry & dir( dirs[path] );
+	valid = valid && reader.get( dir.sig ) && reader.get( nfiles );
+	for ( uint32_t f = 0; valid && f < nfiles; ++f )
+	{
+	  FileEntry file;
+	  shared_ptr<parser::IniEvents> events( new parser::IniEvents );
+	  uint32_t nevents = 0;
+	  valid = reader.get( file.name ) && reader.get( file.sig ) && reader.get( events->inputname ) && reader.get( nevents );
+	  if ( valid )
+	    events->events.reserve( std::min( nevents, uint32_t(reader._end - reader._pos) ) );
+	  for ( uint32_t e = 0; valid && e < nevents; ++e )
+	  {
+	    uint8_t type = 0;
+	    int32_t lineNr = 0;
+	    parser::IniEvents::Event event;
+	    valid = reader.get( type ) && type <= parser::IniEvents::GARBAGE && reader.get( lineNr )
+	         && reader.get( event.section ) && reader.get( event.key ) && reader.get( event.value );
+	    event.type   = parser::IniEvents::Type( type );
+	    event.lineNr = lineNr;
+	    events->events.push_back( std::move( event ) );
+	  }
+	  file.events = events;
+	  dir.files.push_back( std::move( file ) );
+	}
+      }
+      ::munmap( map, st.st_size );
+
+      if ( valid && reader._pos == reader._end )
+      {
+	_dirs.swap( dirs );
+	DBG << "Loaded " << *this << endl;
+      }
+      else
+	WAR << "Ignore invalid snapshot " << _file << endl;
+    }
+
+    bool RepoDefinitionIndex::files( const Pathname & dir_r, const Filter & filter_r, FileList & result_r )
+    {
+      result_r.clear();
+      Signature dirsig( Signature::of( dir_r ) );
+      if ( ! dirsig )
+	return false;
+
+      DirEntry & dir( _dirs[dir_r.asString()] );
+      if ( dir.sig == dirsig )
+      {
+	// Directory content unchanged; just the files must be too.
+	bool unchanged = true;
+	for ( const FileEntry & file : dir.files )
+	{
+	  if ( ! ( Signature::of( dir_r/file.name ) == file.sig ) )
+	  {
+	    unchanged = false;
+	    break;
+	  }
+	}
+	if ( unchanged )
+	{
+	  for ( const FileEntry & file : dir.files )
+	    result_r.push_back( File( dir_r/file.name, file.events ) );
+	  _cached += dir.files.size();
+	  return true;
+	}
+      }
+
+      std::list<std::string> names;
+      if ( filesystem::readdir( names, dir_r, false ) != 0 )
+	return false;
+      names.sort();
+
+      std::vector<FileEntry> files;
+      std::vector<FileEntry>::const_iterator old( dir.files.begin() );
+      for ( const std::string & name : names )
+      {
+	Pathname path( dir_r/name );
+	if ( filter_r && ! filter_r( path ) )
+	  continue;
+
+	FileEntry file;
+	file.name = name;
+	file.sig = Signature::of( path );
+
+	while ( old != dir.files.end() && old->name < name )
+	  ++old;
+	if ( file.sig && old != dir.files.end() && old->name == name && old->sig == file.sig )
+	{
+	  file.events = old->events;
+	  ++_cached;
+	}
+	else
+	{
+	  try
+	  {
+	    InputStream input( path );
+	    if ( input.stream().fail() )
+	      ZYPP_THROW( Exception( "Can't open " + path.asString() ) );
+	    file.events.reset( new parser::IniEvents( parser::IniParser::record( input ) ) );
+	    ++_parsed;
+	  }
+	  catch ( const Exception & excpt )
+	  {
+	    ZYPP_CAUGHT( excpt );
+	    file.events.reset();	// let the caller try and report
+	  }
+	}
+
+	if ( ! file.events || racy( file.sig ) )
+	  file.sig = Signature();	// parse it again next time
+	result_r.push_back( File( path, file.events ) );
+	files.push_back( std::move( file ) );
+      }
+
+      dir.sig = racy( dirsig ) ? Signature() : dirsig;
+      dir.files.swap( files );
+      _dirty = true;
+      return true;
+    }
+
+    void RepoDefinitionIndex::save()
+    {
+      if ( ! _dirty )
+	return;
+
+      Writer out;
+      out._buf.append( magic, sizeof(magic) );
+      out.put( byteOrder );
+      out.put( uint32_t(_dirs.size()) );
+      for ( const auto & dir : _dirs )
+      {
+	out.put( dir.first );
+	out.put( dir.second.sig );
+	out.put( uint32_t(dir.second.files.size()) );
+	for ( const FileEntry & file : dir.second.files )
+	{
+	  static const parser::IniEvents noEvents;
+	  const parser::IniEvents & events( file.events ? *file.events : noEvents );
+	  out.put( file.name );
+	  out.put( file.sig );
+	  out.put( events.inputname );
+	  out.put( uint32_t(events.events.size()) );
+	  for ( const parser::IniEvents::Event & event : events.events )
+	  {
+	    out.put( uint8_t(event.type) );
+	    out.put( int32_t(event.lineNr) );
+	    out.put( event.section );
+	    out.put( event.key );
+	    out.put( event.value );
+	  }
+	}
+      }
+
+      // The definitions may contain credentials.
+      Pathname tmpfile( _file.extend( ".new" ) );
+      int fd = ::open( tmpfile.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0600 );
+      if ( fd < 0 )
+      {
+	DBG << "Can't write snapshot " << tmpfile << ": " << Errno() << endl;
+	return;
+      }
+      bool ok = ( ::write( fd, out._buf.data(), out._buf.size() ) == ssize_t(out._buf.size()) );
+      if ( ::close( fd ) != 0 )
+	ok = false;
+      if ( ! ok || filesystem::rename( tmpfile, _file ) != 0 )
+      {
+	WAR << "Can't write snapshot " << _file << endl;
+	filesystem::unlink( tmpfile );
+	return;
+      }
+      _dirty = false;
+      DBG << "Wrote " << *this << " (" << out._buf.size() << " bytes)" << endl;
+    }
+
+    std::ostream & operator<<( std::ostream & str, const RepoDefinitionIndex & obj )
+    {
+      str << "RepoDefinitionIndex(" << obj._file << ": " << obj._dirs.size() << " dirs";
+      if ( obj._parsed || obj._cached )
+	str << "; parsed " << obj._parsed << ", cached " << obj._cached;
+      return str << ")";
+    }
+
+  } // namespace repo
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
@@ -0,0 +1,136 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/repo/RepoDefinitionIndex.h
+ *
+*/
+#ifndef ZYPP_REPO_REPODEFINITIONINDEX_H
+#define ZYPP_REPO_REPODEFINITIONINDEX_H
+
+#include <stdint.h>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "zypp/base/NonCopyable.h"
+#include "zypp/base/PtrTypes.h"
+#include "zypp/base/Function.h"
+#include "zypp/parser/IniParser.h"
+#include "zypp/Pathname.h"
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace repo
+  {
+    ///////////////////////////////////////////////////////////////////
+    /// \class RepoDefinitionIndex
+    /// \brief Snapshot of the parsed repo and service definition files.
+    ///
+    /// For each directory (e.g. \c /etc/zypp/repos.d) the snapshot
+    /// file remembers the recorded \ref parser::IniEvents of the
+    /// definition files, along with the directories and files inode,
+    /// size and mtime. As long as they are unchanged, \ref files
+    /// serves the files from the snapshot, so they need not be read
+    /// and parsed again. A changed directory is read again, changed
+    /// files are parsed again.
+    ///
+    /// \code
+    ///   RepoDefinitionIndex index( cachePath/"repodefinitions.idx" );
+    ///   RepoDefinitionIndex::FileList files;
+    ///   if ( index.files( reposDir, isRepoFile, files ) )
+    ///     for ( const auto & file : files )
+    ///       parser::RepoFileReader( *file.second, collect );
+    ///   index.save();
+    /// \endcode
+    ///
+    /// The snapshot is memory mapped and decoded at once. It's just a
+    /// cache: if it's missing, invalid or can't be written, the files
+    /// are parsed as usual.
+    ///////////////////////////////////////////////////////////////////
+    class RepoDefinitionIndex : private base::NonCopyable
+    {
+      friend std::ostream & operator<<( std::ostream & str, const RepoDefinitionIndex & obj );
+
+    public:
+      /** A file and its recorded events (\c nullptr if it could not be read). */
+      typedef std::pair<Pathname, shared_ptr<const parser::IniEvents> > File;
+      typedef std::vector<File> FileList;
+      /** Which files in a directory to consider. */
+      typedef function<bool( const Pathname & )> Filter;
+
+    public:
+      /** Ctor loading the snapshot file \a file_r (if it exists). */
+      explicit RepoDefinitionIndex( const Pathname & file_r );
+
+      /** Dtor */
+      ~RepoDefinitionIndex();
+
+    public:
+      /** The files in \a dir_r accepted by \a filter_r, sorted by name.
+       * Unchanged files are served from the snapshot, others are read.
+       * Returns \c false if \a dir_r can't be read.
+       */
+      bool files( const Pathname & dir_r, const Filter & filter_r, FileList & result_r );
+
+      /** Write the snapshot if it changed. */
+      void save();
+
+    public:
+      /** Signature of a directory or file: changes if it is modified or replaced. */
+      struct Signature
+      {
+	uint64_t dev   = 0;
+	uint64_t ino   = 0;
+	uint64_t size  = 0;
+	int64_t  sec   = 0;
+	int64_t  nsec  = 0;
+
+	bool operator==( const Signature & rhs ) const
+	{ return dev == rhs.dev && ino == rhs.ino && size == rhs.size && sec == rhs.sec && nsec == rhs.nsec; }
+
+	/** Empty if \a path_r does not exist. */
+	static Signature of( const Pathname & path_r );
+
+	explicit operator bool() const
+	{ return ino; }
+      };
+
+    private:
+      struct FileEntry
+      {
+	std::string name;
+	Signature   sig;
+	shared_ptr<const parser::IniEvents> events;
+      };
+
+      struct DirEntry
+      {
+	Signature              sig;
+	std::vector<FileEntry> files;	///< the accepted files, sorted by name
+      };
+
+      void load();
+
+      Pathname _file;
+      std::map<std::string,DirEntry> _dirs;
+      unsigned _parsed;		///< files parsed since loaded
+      unsigned _cached;		///< files served from the snapshot
+      bool _dirty;
+    };
+
+    /** \relates RepoDefinitionIndex Stream output */
+    std::ostream & operator<<( std::ostream & str, const RepoDefinitionIndex & obj );
+
+  } // namespace repo
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_REPO_REPODEFINITIONINDEX_H
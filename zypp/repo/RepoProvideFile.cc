@@ -13,6 +13,7 @@
 #include <fstream>
 #include <sstream>
 #include <set>
+#include <list>
 
 #include "zypp/base/Gettext.h"
 #include "zypp/base/Logger.h"
@@ -228,6 +229,7 @@ namespace zypp
 
       public:
         ProvideFilePolicy _defaultPolicy;
+        std::list<Pathname> _cachePaths;
     };
     ///////////////////////////////////////////////////////////////////
 
@@ -245,6 +247,9 @@ namespace zypp
     const ProvideFilePolicy & RepoMediaAccess::defaultPolicy() const
     { return _impl->_defaultPolicy; }
 
+    void RepoMediaAccess::addCachePath( const Pathname & cacheRoot_r )
+    { _impl->_cachePaths.push_back( cacheRoot_r ); }
+
     ManagedFile RepoMediaAccess::provideFile( RepoInfo repo_r,
                                               const OnMediaLocation & loc_rx,
                                               const ProvideFilePolicy & policy_r )
@@ -271,6 +276,15 @@ namespace zypp
       Fetcher fetcher;
       fetcher.addCachePath( repo_r.packagesPath() );
       MIL << "Added cache path " << repo_r.packagesPath() << endl;
+      for ( const Pathname & cacheRoot : _impl->_cachePaths )
+      {
+        Pathname cachePath( cacheRoot / repo_r.alias() );
+        if ( PathInfo( cachePath ).isDir() )
+        {
+          fetcher.addCachePath( cachePath );
+          MIL << "Added cache path " << cachePath << endl;
+        }
+      }
 
       // Test whether download destination is writable, if not
       // switch into the tmpspace (e.g. bnc#755239, download and
@@ -88,6 +88,13 @@ namespace zypp
       /** Get the current default \ref ProvideFilePolicy. */
       const ProvideFilePolicy & defaultPolicy() const;
 
+      /** Additionally look for files of a repository below <tt>cacheRoot_r/ALIAS</tt>.
+       * Files found there (with matching checksum) are used instead of downloading them,
+       * but they are validated by the \ref ProvideFilePolicy::fileChecker like
+       * downloaded files. Used for files downloaded in advance (\see \ref target::CommitPackagePrefetcher).
+       */
+      void addCachePath( const Pathname & cacheRoot_r );
+
    private:
       class Impl;
        RW_pointer<Impl> _impl;
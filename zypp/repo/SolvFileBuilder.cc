@@ -0,0 +1,369 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/repo/SolvFileBuilder.cc
+ *
+*/
+extern "C"
+{
+#include <solv/pool.h>
+#include <solv/repo.h>
+#include <solv/repodata.h>
+#include <solv/dataiterator.h>
+#include <solv/knownid.h>
+#include <solv/solvversion.h>
+#include <solv/solv_xfopen.h>
+#include <solv/repo_write.h>
+#include <solv/repo_repomdxml.h>
+#include <solv/repo_rpmmd.h>
+#include <solv/repo_updateinfoxml.h>
+#include <solv/repo_deltainfoxml.h>
+#include <solv/repo_appdata.h>
+#include <solv/repo_content.h>
+#include <solv/repo_susetags.h>
+#include <solv/repo_rpmdb.h>
+#include <solv/repo_autopattern.h>
+}
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "zypp/base/LogTools.h"
+#include "zypp/base/String.h"
+#include "zypp/base/Exception.h"
+#include "zypp/base/Function.h"
+#include "zypp/AutoDispose.h"
+#include "zypp/PathInfo.h"
+
+#include "zypp/repo/SolvFileBuilder.h"
+#include "zypp/sat/Pool.h"
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace repo
+  {
+    ///////////////////////////////////////////////////////////////////
+    namespace
+    {
+      typedef sat::detail::CPool CPool;
+      typedef sat::detail::CRepo CRepo;
+
+      /** Open a (maybe compressed) metadata file for reading. */
+      AutoDispose<FILE*> openMetadata( const Pathname & file_r )
+      {
+	AutoDispose<FILE*> ret( ::solv_xfopen( file_r.c_str(), "r" ), ::fclose );
+	if ( ret == NULL )
+	{
+	  ret.resetDispose();
+	  ZYPP_THROW( Exception( str::Str() << "Can't open metadata file " << file_r ) );
+	}
+	return ret;
+      }
+
+      /** Locate \a file_r or a compressed variant of it. Empty if none exists. */
+      Pathname findMetadata( const Pathname & file_r )
+      {
+	for ( const char * ext : { "", ".gz", ".xz", ".bz2", ".zst" } )
+	{
+	  Pathname ret( file_r.extend( ext ) );
+	  if ( PathInfo( ret ).isFile() )
+	    return ret;
+	}
+	return Pathname();
+      }
+
+      /** Strip a known compression suffix from filename \a name_r. */
+      std::string stripCompressionSuffix( std::string name_r )
+      {
+	for ( const char * ext : { ".gz", ".xz", ".bz2", ".zst" } )
+	{
+	  if ( str::hasSuffix( name_r, ext ) )
+	    return str::stripSuffix( name_r, ext );
+	}
+	return name_r;
+      }
+
+      ///////////////////////////////////////////////////////////////////
+      /// \brief One data file mentioned in repomd.xml.
+      struct RepomdFile
+      {
+	std::string type;	///< e.g. "primary", "susedata.de"
+	Pathname    location;	///< relative to the repos root
+      };
+
+      /** Collect all files mentioned in the (already parsed) repomd.xml whose
+       * type is \a type_r (or starts with \a type_r if \a prefix_r is set).
+       */
+      std::vector<RepomdFile> repomdFind( CRepo * repo_r, const char * type_r, bool prefix_r = false )
+      {
+	std::vector<RepomdFile> ret;
+	CPool * pool = repo_r->pool;
+	::Dataiterator di;
+	::dataiterator_init( &di, pool, repo_r, SOLVID_META, REPOSITORY_REPOMD_TYPE, type_r, ( prefix_r ? SEARCH_STRINGSTART : SEARCH_STRING ) );
+	::dataiterator_prepend_keyname( &di, REPOSITORY_REPOMD );
+	while ( ::dataiterator_step( &di ) )
+	{
+	  std::string type( di.kv.str ? di.kv.str : "" );
+	  ::dataiterator_setpos_parent( &di );
+	  const char * location = ::pool_lookup_str( pool, SOLVID_POS, REPOSITORY_REPOMD_LOCATION );
+	  if ( location && *location )
+	    ret.push_back( RepomdFile{ type, Pathname( location ) } );
+	}
+	::dataiterator_free( &di );
+	return ret;
+      }
+
+      ///////////////////////////////////////////////////////////////////
+      /// \brief rpm-md metadata (like \c rpmmd2solv as called by \c repo2solv)
+      void addRpmmd( CRepo * repo_r, const Pathname & root_r )
+      {
+	CPool * pool = repo_r->pool;
+	{
+	  Pathname repomd( root_r / "repodata/repomd.xml" );
+	  AutoDispose<FILE*> fp( openMetadata( repomd ) );
+	  if ( ::repo_add_repomdxml( repo_r, fp, 0 ) != 0 )
+	    throwSolvError( pool, repomd.asString() );
+	}
+	{
+	  // optional, not mentioned in repomd.xml
+	  Pathname suseinfo( findMetadata( root_r / "repodata/suseinfo.xml" ) );
+	  if ( ! suseinfo.empty() )
+	  {
+	    AutoDispose<FILE*> fp( openMetadata( suseinfo ) );
+	    if ( ::repo_add_repomdxml( repo_r, fp, 0 ) != 0 )
+	      throwSolvError( pool, suseinfo.asString() );
+	  }
+	}
+
+	// Files not downloaded (e.g. filelists, unwanted translations) are silently skipped.
+	auto forEachFile = [&]( const char * type_r, bool prefix_r, function<int(FILE*,const RepomdFile &)> fnc_r )
+	{
+	  for ( const RepomdFile & file : repomdFind( repo_r, type_r, prefix_r ) )
+	  {
+	    Pathname path( root_r / file.location );
+	    if ( ! PathInfo( path ).isFile() )
+	    {
+	      DBG << "Skip " << file.type << " (not downloaded): " << path << endl;
+	      continue;
+	    }
+	    DBG << "Parse " << file.type << ": " << path << endl;
+	    AutoDispose<FILE*> fp( openMetadata( path ) );
+	    if ( fnc_r( fp, file ) != 0 )
+	      throwSolvError( pool, path.asString() );
+	  }
+	};
+
+	forEachFile( "primary", false, [&]( FILE * fp_r, const RepomdFile & ) {
+	  return ::repo_add_rpmmd( repo_r, fp_r, 0, 0 );
+	});
+	forEachFile( "susedata", false, [&]( FILE * fp_r, const RepomdFile & ) {
+	  return ::repo_add_rpmmd( repo_r, fp_r, 0, REPO_EXTEND_SOLVABLES );
+	});
+	forEachFile( "susedata.", true, [&]( FILE * fp_r, const RepomdFile & file_r ) {
+	  std::string lang( file_r.type.substr( 9 ) );	// strlen("susedata.")
+	  return ::repo_add_rpmmd( repo_r, fp_r, lang.c_str(), REPO_EXTEND_SOLVABLES );
+	});
+	forEachFile( "updateinfo", false, [&]( FILE * fp_r, const RepomdFile & ) {
+	  return ::repo_add_updateinfoxml( repo_r, fp_r, 0 );
+	});
+	for ( const char * delta : { "deltainfo", "prestodelta" } )
+	{
+	  forEachFile( delta, false, [&]( FILE * fp_r, const RepomdFile & ) {
+	    return ::repo_add_deltainfoxml( repo_r, fp_r, 0 );
+	  });
+	}
+	forEachFile( "appdata", false, [&]( FILE * fp_r, const RepomdFile & ) {
+	  return ::repo_add_appdata( repo_r, fp_r, 0 );
+	});
+      }
+
+      ///////////////////////////////////////////////////////////////////
+      /// \brief susetags metadata (like \c susetags2solv as called by \c repo2solv)
+      void addSusetags( CRepo * repo_r, const Pathname & root_r )
+      {
+	CPool * pool = repo_r->pool;
+	{
+	  Pathname content( root_r / "content" );
+	  AutoDispose<FILE*> fp( openMetadata( content ) );
+	  if ( ::repo_add_content( repo_r, fp, 0 ) != 0 )
+	    throwSolvError( pool, content.asString() );
+	}
+
+	Pathname descrdir( root_r / "suse/setup/descr" );
+	if ( const char * val = ::repo_lookup_str( repo_r, SOLVID_META, SUSETAGS_DESCRDIR ) )
+	  descrdir = root_r / val;
+	Id defvendor = ::repo_lookup_id( repo_r, SOLVID_META, SUSETAGS_DEFAULTVENDOR );
+
+	auto parse = [&]( const Pathname & file_r, const char * lang_r, int flags_r )
+	{
+	  DBG << "Parse " << file_r << endl;
+	  AutoDispose<FILE*> fp( openMetadata( file_r ) );
+	  if ( ::repo_add_susetags( repo_r, fp, defvendor, lang_r, flags_r|REPO_NO_INTERNALIZE ) != 0 )
+	    throwSolvError( pool, file_r.asString() );
+	};
+
+	// The packages file must be parsed first, its translations extend the solvables.
+	Pathname packages( findMetadata( descrdir / "packages" ) );
+	if ( ! packages.empty() )
+	  parse( packages, 0, SUSETAGS_RECORD_SHARES );
+
+	filesystem::DirContent entries;
+	filesystem::readdir( entries, descrdir, /*dots*/false );
+	std::vector<std::string> names;
+	for ( const auto & entry : entries )
+	  names.push_back( entry.name );
+	std::sort( names.begin(), names.end() );
+
+	for ( const std::string & name : names )
+	{
+	  std::string base( stripCompressionSuffix( name ) );
+	  Pathname file( descrdir / name );
+
+	  if ( base == "packages" )
+	    continue;	// done
+	  else if ( base == "packages.en" || base == "packages.DU" )
+	    parse( file, 0, REPO_EXTEND_SOLVABLES );
+	  else if ( base == "packages.FL" )
+	    continue;	// file lists are not needed
+	  else if ( str::hasPrefix( base, "packages." ) )
+	    parse( file, base.substr( 9 ).c_str(), REPO_EXTEND_SOLVABLES );	// strlen("packages.")
+	  else if ( str::hasSuffix( base, ".pat" ) )
+	    parse( file, 0, 0 );
+	  else if ( base == "appdata.xml" )
+	  {
+	    DBG << "Parse " << file << endl;
+	    AutoDispose<FILE*> fp( openMetadata( file ) );
+	    if ( ::repo_add_appdata( repo_r, fp, 0 ) != 0 )
+	      throwSolvError( pool, file.asString() );
+	  }
+	}
+	::repo_internalize( repo_r );
+      }
+
+      ///////////////////////////////////////////////////////////////////
+      /// \brief Plaindir: recursively collect all rpms below \a root_r (like <tt>repo2solv -R</tt>)
+      void collectRpms( const Pathname & root_r, const std::string & dir_r, std::vector<std::string> & rpms_r )
+      {
+	filesystem::DirContent entries;
+	filesystem::readdir( entries, root_r / dir_r, /*dots*/false );
+	for ( const auto & entry : entries )
+	{
+	  if ( entry.name[0] == '.' )
+	    continue;
+	  if ( entry.type == filesystem::FT_DIR )
+	    collectRpms( root_r, dir_r + entry.name + "/", rpms_r );
+	  else if ( str::hasSuffix( entry.name, ".rpm" )
+		    && ! str::hasSuffix( entry.name, ".delta.rpm" )
+		    && ! str::hasSuffix( entry.name, ".patch.rpm" ) )
+	    rpms_r.push_back( dir_r + entry.name );
+	}
+      }
+
+      void addPlaindir( CRepo * repo_r, const Pathname & root_r )
+      {
+	std::vector<std::string> rpms;	// relative to root_r
+	collectRpms( root_r, std::string(), rpms );
+	std::sort( rpms.begin(), rpms.end() );
+	DBG << "Parse " << rpms.size() << " rpms below " << root_r << endl;
+
+	::Repodata * data = ::repo_add_repodata( repo_r, 0 );
+	for ( const std::string & rpm : rpms )
+	{
+	  Id p = ::repo_add_rpm( repo_r, (root_r / rpm).c_str(), REPO_REUSE_REPODATA|REPO_NO_INTERNALIZE|REPO_NO_LOCATION );
+	  if ( ! p )
+	  {
+	    // like repo2solv: a broken rpm does not spoil the whole repo
+	    WAR << "Skip " << (root_r / rpm) << ": " << ::pool_errstr( repo_r->pool ) << endl;
+	    continue;
+	  }
+	  ::repodata_set_location( data, p, 0, 0, rpm.c_str() );
+	}
+	::repodata_internalize( data );
+      }
+
+    } // namespace
+    ///////////////////////////////////////////////////////////////////
+
+    SolvFileBuilder::SolvFileBuilder( const RepoType & type_r, const Pathname & metadata_r )
+    : _type( type_r )
+    , _metadata( metadata_r )
+    {}
+
+    void SolvFileBuilder::build( const Pathname & solvfile_r ) const
+    {
+      MIL << "Building " << solvfile_r << " from " << *this << endl;
+
+      AutoDispose<CPool*> pool( ::pool_create(), ::pool_free );
+      CRepo * repo = ::repo_create( pool, "" );	// freed along with the pool
+
+      switch ( _type.toEnum() )
+      {
+	case RepoType::RPMMD_e:
+	  addRpmmd( repo, _metadata );
+	  break;
+	case RepoType::YAST2_e:
+	  addSusetags( repo, _metadata );
+	  break;
+	case RepoType::RPMPLAINDIR_e:
+	  addPlaindir( repo, _metadata );
+	  break;
+	case RepoType::NONE_e:
+	  ZYPP_THROW( Exception( str::Str() << "Can't build solv-file for unknown repo type at " << _metadata ) );
+	  break;
+      }
+
+      // repo2solv -X: autogenerate pattern/product pseudo packages
+      ::repo_add_autopattern( repo, 0 );
+
+      writeSolvFile( repo, solvfile_r );
+
+      // content digest for zypper bash completion; the repo is still at hand
+      sat::updateSolvFileIndex( solvfile_r, repo );
+      MIL << "Built " << solvfile_r << " (" << repo->nsolvables << " solvables)" << endl;
+    }
+
+    std::ostream & operator<<( std::ostream & str, const SolvFileBuilder & obj )
+    { return str << "SolvFileBuilder(" << obj.type() << ")" << obj.metadataPath(); }
+
+    void throwSolvError( sat::detail::CPool * pool_r, const std::string & what_r )
+    {
+      ZYPP_THROW( Exception( str::Str() << what_r << ": " << ::pool_errstr( pool_r ) ) );
+    }
+
+    void writeSolvFile( sat::detail::CRepo * repo_r, const Pathname & solvfile_r )
+    {
+      {
+	// loadFromCache rejects solv-files built by a different parser version.
+	::Repodata * info = ::repo_add_repodata( repo_r, 0 );
+	::repodata_set_str( info, SOLVID_META, REPOSITORY_TOOLVERSION, LIBSOLV_TOOLVERSION );
+	::repodata_internalize( info );
+      }
+
+      AutoDispose<FILE*> fp( ::fopen( solvfile_r.c_str(), "we" ), ::fclose );
+      if ( fp == NULL )
+      {
+	fp.resetDispose();
+	ZYPP_THROW( Exception( str::Str() << "Can't create solv-file " << solvfile_r ) );
+      }
+      if ( ::repo_write( repo_r, fp ) != 0 )
+	throwSolvError( repo_r->pool, "Can't write solv-file " + solvfile_r.asString() );
+
+      FILE * closeme = fp;
+      fp.resetDispose();
+      if ( ::fclose( closeme ) != 0 )
+	ZYPP_THROW( Exception( str::Str() << "Can't write solv-file " << solvfile_r ) );
+    }
+
+  } // namespace repo
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
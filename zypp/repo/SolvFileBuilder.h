@@ -0,0 +1,92 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/repo/SolvFileBuilder.h
+ *
+*/
+#ifndef ZYPP_REPO_SOLVFILEBUILDER_H
+#define ZYPP_REPO_SOLVFILEBUILDER_H
+
+#include <iosfwd>
+#include <string>
+
+#include "zypp/Pathname.h"
+#include "zypp/repo/RepoType.h"
+#include "zypp/sat/detail/PoolMember.h"
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace repo
+  {
+    ///////////////////////////////////////////////////////////////////
+    /// \class SolvFileBuilder
+    /// \brief In-process replacement for \c repo2solv.
+    ///
+    /// Parses the raw metadata of a repository using the libsolv parsers
+    /// and writes the solv-file and its \c solv.idx in one pass, without
+    /// spawning \c repo2solv and re-reading the freshly written solv-file.
+    /// The result is the same as <tt>repo2solv -X -A</tt> would produce
+    /// (pattern and application pseudo packages are autogenerated).
+    ///
+    /// Parsing happens in a private pool, so the builder neither touches
+    /// nor requires the global \ref sat::Pool.
+    ///
+    /// \code
+    ///   SolvFileBuilder( RepoType::RPMMD, "/var/cache/zypp/raw/foo" ).build( solvfile );
+    /// \endcode
+    ///////////////////////////////////////////////////////////////////
+    class SolvFileBuilder
+    {
+      friend std::ostream & operator<<( std::ostream & str, const SolvFileBuilder & obj );
+
+    public:
+      /** Ctor taking the metadata \a type_r and the directory \a metadata_r holding it.
+       * For \ref RepoType::RPMPLAINDIR \a metadata_r is scanned recursively for rpms.
+       */
+      SolvFileBuilder( const RepoType & type_r, const Pathname & metadata_r );
+
+    public:
+      /** Metadata type. */
+      const RepoType & type() const
+      { return _type; }
+
+      /** Metadata directory. */
+      const Pathname & metadataPath() const
+      { return _metadata; }
+
+    public:
+      /** Parse the metadata and write \a solvfile_r and \a solvfile_r<tt>.idx</tt>.
+       * \throws Exception if the metadata can not be parsed or the solv-file can not be written.
+       * A partially written solv-file is not removed; that's up to the caller.
+       */
+      void build( const Pathname & solvfile_r ) const;
+
+    private:
+      RepoType _type;
+      Pathname _metadata;
+    };
+
+    /** \relates SolvFileBuilder Stream output */
+    std::ostream & operator<<( std::ostream & str, const SolvFileBuilder & obj );
+
+    /** \relates SolvFileBuilder Throw an Exception stating \a what_r and libsolvs last error. */
+    void throwSolvError( sat::detail::CPool * pool_r, const std::string & what_r );
+
+    /** \relates SolvFileBuilder Tag \a repo_r with libsolvs toolversion and write it to \a solvfile_r.
+     * The final step of \ref SolvFileBuilder::build, also used to build the \c @System solv-file.
+     * \throws Exception if the solv-file can not be written.
+     */
+    void writeSolvFile( sat::detail::CRepo * repo_r, const Pathname & solvfile_r );
+
+  } // namespace repo
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_REPO_SOLVFILEBUILDER_H
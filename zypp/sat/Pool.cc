@@ -12,6 +12,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 extern "C"
 {
@@ -29,8 +30,10 @@ extern "C"
 #include "zypp/base/Exception.h"
 
 #include "zypp/AutoDispose.h"
+#include "zypp/PathInfo.h"
 
 #include "zypp/sat/detail/PoolImpl.h"
+#include "zypp/sat/detail/SearchIndex.h"
 #include "zypp/sat/Pool.h"
 #include "zypp/sat/LookupAttr.h"
 
@@ -260,41 +263,37 @@ namespace zypp
     #undef ZYPP_BASE_LOGGER_LOGGROUP
     #define ZYPP_BASE_LOGGER_LOGGROUP "solvidx"
 
-    void updateSolvFileIndex( const Pathname & solvfile_r )
+    namespace
     {
-      AutoDispose<FILE*> solv( ::fopen( solvfile_r.c_str(), "re" ), ::fclose );
-      if ( solv == NULL )
-      {
-	solv.resetDispose();
-	ERR << "Can't open solv-file: " << solv << endl;
-	return;
-      }
-
-      std::string solvidxfile( solvfile_r.extend(".idx").asString() );
-      if ( ::unlink( solvidxfile.c_str() ) == -1 && errno != ENOENT )
+      /** Create an empty solv-idx file for \a solvfile_r (0644, O_EXCL). */
+      bool createSolvFileIndex( const Pathname & solvfile_r, std::ofstream & idx_r )
       {
-	ERR << "Can't unlink solv-idx: " << Errno() << endl;
-	return;
-      }
-      {
-	int fd = ::open( solvidxfile.c_str(), O_CREAT|O_EXCL|O_WRONLY|O_TRUNC, 0644 );
-	if ( fd == -1 )
+	std::string solvidxfile( solvfile_r.extend(".idx").asString() );
+	if ( ::unlink( solvidxfile.c_str() ) == -1 && errno != ENOENT )
 	{
-	  ERR << "Can't create solv-idx: " << Errno() << endl;
-	  return;
+	  ERR << "Can't unlink solv-idx: " << Errno() << endl;
+	  return false;
 	}
-	::close( fd );
+	{
+	  int fd = ::open( solvidxfile.c_str(), O_CREAT|O_EXCL|O_WRONLY|O_TRUNC, 0644 );
+	  if ( fd == -1 )
+	  {
+	    ERR << "Can't create solv-idx: " << Errno() << endl;
+	    return false;
+	  }
+	  ::close( fd );
+	}
+	idx_r.open( solvidxfile.c_str() );
+	return true;
       }
-      std::ofstream idx( solvidxfile.c_str() );
 
-
-      detail::CPool * _pool = ::pool_create();
-      detail::CRepo * _repo = ::repo_create( _pool, "" );
-      if ( ::repo_add_solv( _repo, solv, 0 ) == 0 )
+      /** Write the solv-idx lines for all solvables in \a repo_r. */
+      void writeSolvFileIndex( detail::CRepo * repo_r, std::ostream & idx )
       {
+	detail::CPool * _pool = repo_r->pool;
 	int _id = 0;
 	detail::CSolvable * _solv = nullptr;
-	FOR_REPO_SOLVABLES( _repo, _id, _solv )
+	FOR_REPO_SOLVABLES( repo_r, _id, _solv )
 	{
 	  if ( _solv )
 	  {
@@ -304,9 +303,34 @@ namespace zypp
 	      idx << "srcpackage:" << idstr(name) << SEP << idstr(evr) << SEP << "noarch" << endl;
 	    else
 	      idx << idstr(name) << SEP << idstr(evr) << SEP << idstr(arch) << endl;
+#undef idstr
+#undef SEP
 	  }
 	}
       }
+    } // namespace
+
+    void updateSolvFileIndex( const Pathname & solvfile_r )
+    {
+      AutoDispose<FILE*> solv( ::fopen( solvfile_r.c_str(), "re" ), ::fclose );
+      if ( solv == NULL )
+      {
+	solv.resetDispose();
+	ERR << "Can't open solv-file: " << solv << endl;
+	return;
+      }
+
+      std::ofstream idx;
+      if ( ! createSolvFileIndex( solvfile_r, idx ) )
+	return;
+
+      detail::CPool * _pool = ::pool_create();
+      detail::CRepo * _repo = ::repo_create( _pool, "" );
+      if ( ::repo_add_solv( _repo, solv, 0 ) == 0 )
+      {
+	writeSolvFileIndex( _repo, idx );
+	detail::SearchIndex::write( solvfile_r, _repo );
+      }
       else
       {
 	ERR << "Can't read solv-file: " << ::pool_errstr( _pool ) << endl;
@@ -315,6 +339,34 @@ namespace zypp
       ::pool_free( _pool );
     }
 
+    void ensureSolvFileIndex( const Pathname & solvfile_r )
+    {
+      if ( PathInfo( solvfile_r.extend(".idx") ).isExist() && detail::SearchIndex::upToDate( solvfile_r ) )
+	return;
+      if ( ::access( solvfile_r.dirname().c_str(), W_OK ) != 0 )
+      {
+	DBG << "Not writable, can't update the solv-idx of " << solvfile_r << endl;
+	return;
+      }
+      updateSolvFileIndex( solvfile_r );
+    }
+
+    void updateSolvFileIndex( const Pathname & solvfile_r, detail::CRepo * repo_r )
+    {
+      if ( ! repo_r )
+      {
+	updateSolvFileIndex( solvfile_r );
+	return;
+      }
+
+      std::ofstream idx;
+      if ( createSolvFileIndex( solvfile_r, idx ) )
+      {
+	writeSolvFileIndex( repo_r, idx );
+	detail::SearchIndex::write( solvfile_r, repo_r );
+      }
+    }
+
     /////////////////////////////////////////////////////////////////
   } // namespace sat
   ///////////////////////////////////////////////////////////////////
@@ -285,9 +285,21 @@ namespace zypp
     inline bool operator!=( const Pool & lhs, const Pool & rhs )
     { return lhs.get() != rhs.get(); }
 
-    /** Create solv file content digest for zypper bash completion */
+    /** Create solv file content digest for zypper bash completion
+     * and the \ref detail::SearchIndex used by \ref PoolQuery.
+     */
     void updateSolvFileIndex( const Pathname & solvfile_r );
 
+    /** \overload Create the index from \a repo_r, the repo just written to \a solvfile_r.
+     * Avoids re-reading the solv-file if the caller still has its content at hand.
+     */
+    void updateSolvFileIndex( const Pathname & solvfile_r, detail::CRepo * repo_r );
+
+    /** Create missing or outdated solv file indexes, if the solv files directory is writable
+     * (e.g. not for a non-root user looking at the system cache).
+     */
+    void ensureSolvFileIndex( const Pathname & solvfile_r );
+
     /////////////////////////////////////////////////////////////////
   } // namespace sat
   ///////////////////////////////////////////////////////////////////
@@ -14,6 +14,7 @@ extern "C"
 #include <solv/solver.h>
 }
 #include <iostream>
+#include <vector>
 #include "zypp/base/LogTools.h"
 #include "zypp/base/SerialNumber.h"
 #include "zypp/base/DefaultIntegral.h"
@@ -50,8 +51,17 @@ namespace zypp
       friend std::ostream & operator<<( std::ostream & str, const Impl & obj );
 
       public:
-	typedef std::unordered_set<detail::IdType> set_type;
 	typedef std::unordered_map<detail::IdType,detail::IdType> map_type;
+	/** Solvable id to step position + 1 (0 if not a step). */
+	typedef std::vector<unsigned> index_type;
+	/** Per solvable id: StepType, StepStage and whether it's an @System solvable to be erased. */
+	typedef std::vector<unsigned char> state_type;
+	enum : unsigned char
+	{
+	  STAGE_MASK	= STEP_DONE|STEP_ERROR,	// STEP_TODO is 0
+	  TYPE_MASK	= TRANSACTION_MULTIINSTALL,
+	  SYSTEM_ERASE	= 0x40,
+	};
 
 	struct PostMortem
 	{
@@ -99,9 +109,11 @@ namespace zypp
 	  // so we also link the buddies stepStages. This assumes
 	  // only one buddy is acting during commit (package is installed,
 	  // but no extra operation for the product).
+	  detail::IdType maxId = 0;
 	  for_( it, _trans->steps.elements, _trans->steps.elements + _trans->steps.count )
 	  {
 	    sat::Solvable solv( *it );
+	    maxId = std::max( maxId, *it );
 	    // buddy list:
 	    if ( ! solv.isKind<Package>() )
 	    {
@@ -109,19 +121,29 @@ namespace zypp
 	      if ( pi.buddy() )
 	      {
 		_linkMap[*it] = pi.buddy().id();
+		maxId = std::max( maxId, detail::IdType(pi.buddy().id()) );
 	      }
 	    }
+	  }
+
+	  _state.resize( maxId + 1, 0 );
+	  for_( it, _trans->steps.elements, _trans->steps.elements + _trans->steps.count )
+	  {
+	    sat::Solvable solv( *it );
+	    StepType type( satStepType( solv ) );
+	    _state[*it] = type;
 	    if ( solv.isSystem() )
 	    {
 	      // to delete list:
-	      if ( stepType( solv ) == TRANSACTION_ERASE )
+	      if ( type == TRANSACTION_ERASE )
 	      {
-		_systemErase.insert( *it );
+		_state[*it] |= SYSTEM_ERASE;
 	      }
 	      // post mortem data
 	      _pmMap[*it] = solv;
 	    }
 	  }
+	  buildIndex();
 	}
 
 	~Impl()
@@ -159,6 +181,7 @@ namespace zypp
 	  {
 	    ::transaction_order( _trans, 0 );
 	    _ordered = true;
+	    buildIndex();	// steps were reordered
 	  }
 	  return true;
 	}
@@ -200,16 +223,11 @@ namespace zypp
 	  if ( ! solv_r )
 	  {
 	    // post mortem @System solvable
-	    return isIn( _systemErase, solv_r.id() ) ? TRANSACTION_ERASE : TRANSACTION_IGNORE;
+	    return ( state( solv_r.id() ) & SYSTEM_ERASE ) ? TRANSACTION_ERASE : TRANSACTION_IGNORE;
 	  }
-
-	  switch( ::transaction_type( _trans, solv_r.id(), SOLVER_TRANSACTION_RPM_ONLY ) )
-	  {
-	    case SOLVER_TRANSACTION_ERASE: return TRANSACTION_ERASE; break;
-	    case SOLVER_TRANSACTION_INSTALL: return TRANSACTION_INSTALL; break;
-	    case SOLVER_TRANSACTION_MULTIINSTALL: return TRANSACTION_MULTIINSTALL; break;
-	  }
-	  return TRANSACTION_IGNORE;
+	  if ( valid() )
+	    return StepType( state( solv_r.id() ) & TYPE_MASK );	// remembered when the transaction was created
+	  return satStepType( solv_r );
 	}
 
 	StepStage stepStage( Solvable solv_r ) const
@@ -226,51 +244,62 @@ namespace zypp
 	}
 
       private:
+	StepType satStepType( Solvable solv_r ) const
+	{
+	  switch( ::transaction_type( _trans, solv_r.id(), SOLVER_TRANSACTION_RPM_ONLY ) )
+	  {
+	    case SOLVER_TRANSACTION_ERASE: return TRANSACTION_ERASE; break;
+	    case SOLVER_TRANSACTION_INSTALL: return TRANSACTION_INSTALL; break;
+	    case SOLVER_TRANSACTION_MULTIINSTALL: return TRANSACTION_MULTIINSTALL; break;
+	  }
+	  return TRANSACTION_IGNORE;
+	}
+
 	detail::IdType resolve( const Solvable & solv_r ) const
 	{
 	  map_type::const_iterator res( _linkMap.find( solv_r.id() ) );
 	  return( res == _linkMap.end() ? solv_r.id() : res->second );
 	}
 
-	bool isIn( const set_type & set_r, detail::IdType sid_r ) const
-	{ return( set_r.find( sid_r ) != set_r.end() ); }
+	unsigned char state( detail::IdType sid_r ) const
+	{ return( sid_r >= 0 && unsigned(sid_r) < _state.size() ? _state[sid_r] : 0 ); }
 
 	StepStage stepStage( detail::IdType sid_r ) const
 	{
-	  if ( isIn( _doneSet, sid_r ) )
-	    return STEP_DONE;
-	  if ( isIn( _errSet, sid_r ) )
-	    return STEP_ERROR;
-	  return STEP_TODO;
+	  unsigned char stage = state( sid_r ) & STAGE_MASK;
+	  return stage ? StepStage( stage ) : STEP_TODO;
 	}
 
 	void stepStage( detail::IdType sid_r, StepStage newval_r )
 	{
-	  StepStage stage( stepStage( sid_r ) );
-	  if ( stage != newval_r )
+	  if ( sid_r < 0 )
+	    return;
+	  if ( unsigned(sid_r) >= _state.size() )
 	  {
-	    // reset old stage
-	    if ( stage != STEP_TODO )
-	    {
-	      (stage == STEP_DONE ? _doneSet : _errSet).erase( sid_r );
-	    }
-	    if ( newval_r != STEP_TODO )
-	    {
-	      (newval_r == STEP_DONE ? _doneSet : _errSet).insert( sid_r );
-	    }
+	    if ( newval_r == STEP_TODO )
+	      return;
+	    _state.resize( sid_r + 1, 0 );
 	  }
+	  unsigned char & state( _state[sid_r] );
+	  state = ( state & ~STAGE_MASK ) | ( newval_r == STEP_TODO ? 0 : newval_r );
 	}
 
       private:
+	/** (Re)build the index after the steps were created or ordered. */
+	void buildIndex()
+	{
+	  _index.assign( _state.size(), 0 );
+	  for ( unsigned pos = 0; pos < unsigned(_trans->steps.count); ++pos )
+	    _index[_trans->steps.elements[pos]] = pos + 1;
+	}
+
 	detail::IdType * _find( const sat::Solvable & solv_r ) const
 	{
-	  if ( solv_r && _trans->steps.elements )
+	  if ( solv_r && _trans->steps.elements && solv_r.id() < _index.size() )
 	  {
-	    for_( it, _trans->steps.elements, _trans->steps.elements + _trans->steps.count )
-	    {
-	      if ( *it == detail::IdType(solv_r.id()) )
-		return it;
-	    }
+	    unsigned pos = _index[solv_r.id()];
+	    if ( pos )
+	      return _trans->steps.elements + pos - 1;
 	  }
 	  return 0;
 	}
@@ -280,10 +309,9 @@ namespace zypp
 	mutable ::Transaction * _trans;
 	DefaultIntegral<bool,false> _ordered;
 	//
-	set_type	_doneSet;
-	set_type	_errSet;
+	state_type	_state;		// StepType, StepStage and @System packages to be eased (by solvable id)
+	index_type	_index;		// step position (by solvable id)
 	map_type	_linkMap;	// buddy map to adopt buddies StepResult
-	set_type	_systemErase;	// @System packages to be eased (otherse are TRANSACTION_IGNORE)
 	pmmap_type	_pmMap;		// Post mortem data of deleted @System solvables
 
 	StringQueue	_autoInstalled;	// ident strings of all packages that would be auto-installed after the transaction is run.
@@ -309,6 +309,7 @@ namespace zypp
 	if ( isSystemRepo( repo_r ) )
 	  _autoinstalled.clear();
         eraseRepoInfo( repo_r );
+        setSearchIndex( repo_r, nullptr );
         ::repo_free( repo_r, /*resusePoolIDs*/false );
 	// If the last repo is removed clear the pool to actually reuse all IDs.
 	// NOTE: the explicit ::repo_free above asserts all solvables are memset(0)!
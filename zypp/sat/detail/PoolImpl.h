@@ -42,6 +42,7 @@ namespace zypp
     ///////////////////////////////////////////////////////////////////
     namespace detail
     { /////////////////////////////////////////////////////////////////
+      class SearchIndex;
 
       ///////////////////////////////////////////////////////////////////
       //
@@ -210,6 +211,22 @@ namespace zypp
           void eraseRepoInfo( RepoIdType id_r )
           { _repoinfos.erase( id_r ); }
 
+        public:
+          /** The \ref SearchIndex loaded along with the repos solv-file (or \c nullptr). */
+          shared_ptr<SearchIndex> searchIndex( RepoIdType id_r ) const
+          {
+            auto it( _searchIndexes.find( id_r ) );
+            return( it == _searchIndexes.end() ? shared_ptr<SearchIndex>() : it->second );
+          }
+          /** Remember \a index_r for repo \a id_r (\c nullptr removes it). */
+          void setSearchIndex( RepoIdType id_r, const shared_ptr<SearchIndex> & index_r )
+          {
+            if ( index_r )
+              _searchIndexes[id_r] = index_r;
+            else
+              _searchIndexes.erase( id_r );
+          }
+
         public:
           /** Returns the id stored at \c offset_r in the internal
            * whatprovidesdata array.
@@ -323,6 +340,8 @@ namespace zypp
           SerialNumberWatcher _watcher;
           /** Additional \ref RepoInfo. */
           std::map<RepoIdType,RepoInfo> _repoinfos;
+          /** Search indexes of the repos. */
+          std::map<RepoIdType,shared_ptr<SearchIndex> > _searchIndexes;
 
           /**  */
 	  base::SetTracker<LocaleSet> _requestedLocalesTracker;
@@ -0,0 +1,606 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/sat/detail/SearchIndex.cc
+ *
+*/
+extern "C"
+{
+#include <solv/pool.h>
+#include <solv/repo.h>
+#include <solv/knownid.h>
+}
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+
+#include "zypp/base/LogTools.h"
+#include "zypp/base/String.h"
+#include "zypp/PathInfo.h"
+#include "zypp/Repository.h"
+#include "zypp/sat/Pool.h"
+#include "zypp/sat/Solvable.h"
+#include "zypp/sat/detail/PoolImpl.h"
+#include "zypp/sat/detail/SearchIndex.h"
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace sat
+  {
+    ///////////////////////////////////////////////////////////////////
+    namespace detail
+    {
+      ///////////////////////////////////////////////////////////////////
+      namespace
+      {
+	// File layout (host byte order, it's a local cache):
+	//   Header
+	//   AttrDir[nattrs]
+	//   per attr: Key[nkeys] sorted by trigram, followed by the postings
+	//   (varint encoded deltas of the solvables position in the solv-file).
+	const char     magic[8] = { 'Z', 'Y', 'P', 'P', 'S', 'R', 'I', '1' };
+	const uint32_t byteOrder = 0x01020304;
+
+	struct Header
+	{
+	  char     magic[8];
+	  uint32_t byteOrder;
+	  uint32_t nsolvables;
+	  uint32_t nattrs;
+	  uint32_t reserved;
+	  uint64_t solvSize;	///< stat of the solv-file the index belongs to
+	  uint64_t solvIno;
+	  int64_t  solvMtime;
+	};
+
+	struct AttrDir
+	{
+	  uint32_t attr;	///< index into indexedAttrs
+	  uint32_t nkeys;
+	  uint64_t keys;	///< file offset of the Keys
+	  uint64_t postings;	///< file offset of the postings
+	  uint64_t postingsSize;
+	};
+
+	struct Key
+	{
+	  uint32_t trigram;
+	  uint32_t count;
+	  uint32_t offset;	///< relative to AttrDir::postings
+	  uint32_t size;
+	};
+
+	/** The attributes indexed (their position is stored in the file). */
+	const SolvAttr & indexedAttr( unsigned idx_r )
+	{
+	  static const SolvAttr _attrs[] = { SolvAttr::name, SolvAttr::summary, SolvAttr::description };
+	  return _attrs[idx_r];
+	}
+	const unsigned indexedAttrs = 3;
+
+	inline int indexedAttrIdx( const SolvAttr & attr_r )
+	{
+	  for ( unsigned i = 0; i < indexedAttrs; ++i )
+	  {
+	    if ( attr_r == indexedAttr( i ) )
+	      return i;
+	  }
+	  return -1;
+	}
+
+	/** Locale independent, like the index file. */
+	inline SearchIndex::Trigram asciiLower( char ch_r )
+	{ return ( ch_r >= 'A' && ch_r <= 'Z' ) ? ch_r + ( 'a' - 'A' ) : (unsigned char)ch_r; }
+
+	inline SearchIndex::Trigram mkTrigram( const char * ch_r )
+	{ return ( asciiLower( ch_r[0] ) << 16 ) | ( asciiLower( ch_r[1] ) << 8 ) | asciiLower( ch_r[2] ); }
+
+	/** Append all trigrams of \a str_r to \a result_r (unsorted). */
+	inline void addTrigrams( const char * str_r, size_t len_r, std::vector<SearchIndex::Trigram> & result_r )
+	{
+	  for ( size_t i = 0; i + 3 <= len_r; ++i )
+	    result_r.push_back( mkTrigram( str_r + i ) );
+	}
+
+	inline void sortUnique( std::vector<SearchIndex::Trigram> & vec_r )
+	{
+	  std::sort( vec_r.begin(), vec_r.end() );
+	  vec_r.erase( std::unique( vec_r.begin(), vec_r.end() ), vec_r.end() );
+	}
+
+	/** The literal runs of a glob (\c fnmatch(3)) pattern.
+	 * Returns \c false if the pattern is not understood.
+	 */
+	bool globLiterals( const std::string & glob_r, std::vector<std::string> & result_r )
+	{
+	  std::string run;
+	  for ( std::string::size_type i = 0; i < glob_r.size(); ++i )
+	  {
+	    char ch = glob_r[i];
+	    switch ( ch )
+	    {
+	      case '*':
+	      case '?':
+		result_r.push_back( std::move( run ) );
+		run.clear();
+		break;
+
+	      case '\\':
+		if ( ++i == glob_r.size() )
+		  return false;
+		run += glob_r[i];
+		break;
+
+	      case '[':
+	      {
+		std::string::size_type j = i + 1;
+		if ( j < glob_r.size() && ( glob_r[j] == '!' || glob_r[j] == '^' ) )
+		  ++j;
+		if ( j < glob_r.size() && glob_r[j] == ']' )
+		  ++j;	// a leading ']' is a member
+		std::string::size_type end = glob_r.find( ']', j );
+		if ( end == std::string::npos )
+		  return false;
+		result_r.push_back( std::move( run ) );
+		run.clear();
+		i = end;
+	      }
+	      break;
+
+	      default:
+		run += ch;
+		break;
+	    }
+	  }
+	  result_r.push_back( std::move( run ) );
+	  return true;
+	}
+
+	inline void putVarint( std::string & buf_r, uint32_t val_r )
+	{
+	  while ( val_r >= 0x80 )
+	  {
+	    buf_r += char( ( val_r & 0x7f ) | 0x80 );
+	    val_r >>= 7;
+	  }
+	  buf_r += char( val_r );
+	}
+
+	inline bool getVarint( const unsigned char *& ptr_r, const unsigned char * end_r, uint32_t & val_r )
+	{
+	  val_r = 0;
+	  for ( unsigned shift = 0; ptr_r != end_r && shift < 35; shift += 7 )
+	  {
+	    unsigned char ch = *ptr_r++;
+	    val_r |= uint32_t( ch & 0x7f ) << shift;
+	    if ( ! ( ch & 0x80 ) )
+	      return true;
+	  }
+	  return false;
+	}
+
+	inline bool statSolvFile( const Pathname & solvfile_r, struct stat & st_r )
+	{ return ::stat( solvfile_r.c_str(), &st_r ) == 0 && S_ISREG( st_r.st_mode ); }
+      } // namespace
+      ///////////////////////////////////////////////////////////////////
+
+      SearchIndex::SearchIndex()
+      : _map( nullptr )
+      , _size( 0 )
+      , _base( 0 )
+      , _count( 0 )
+      {}
+
+      SearchIndex::~SearchIndex()
+      {
+	if ( _map )
+	  ::munmap( const_cast<char *>( _map ), _size );
+      }
+
+      bool SearchIndex::indexed( const SolvAttr & attr_r )
+      { return indexedAttrIdx( attr_r ) >= 0; }
+
+      std::vector<SearchIndex::Trigram> SearchIndex::trigrams( const StrMatcher & matcher_r )
+      {
+	std::vector<Trigram> ret;
+	if ( ! matcher_r )
+	  return ret;
+
+	const std::string & search( matcher_r.searchstring() );
+	switch ( matcher_r.flags().mode() )
+	{
+	  case Match::STRING:
+	  case Match::STRINGSTART:
+	  case Match::STRINGEND:
+	  case Match::SUBSTRING:
+	    addTrigrams( search.c_str(), search.size(), ret );
+	    break;
+
+	  case Match::GLOB:
+	  {
+	    std::vector<std::string> literals;
+	    if ( globLiterals( search, literals ) )
+	    {
+	      for ( const std::string & literal : literals )
+		addTrigrams( literal.c_str(), literal.size(), ret );
+	    }
+	  }
+	  break;
+
+	  default:	// regex and friends: no literals we could rely on
+	    break;
+	}
+
+	if ( matcher_r.flags().test( Match::NOCASE ) )
+	{
+	  // Just ASCII is folded when indexing.
+	  ret.erase( std::remove_if( ret.begin(), ret.end(), []( Trigram t ) { return t & 0x808080; } ), ret.end() );
+	}
+	sortUnique( ret );
+	return ret;
+      }
+
+      void SearchIndex::write( const Pathname & solvfile_r, CRepo * repo_r )
+      {
+	Pathname indexfile( indexFile( solvfile_r ) );
+	filesystem::unlink( indexfile );	// a stale index must not survive a failed write
+
+	struct stat st;
+	if ( ! repo_r || ! statSolvFile( solvfile_r, st ) )
+	  return;
+
+	// Collect the postings per attr and trigram.
+	typedef std::unordered_map<Trigram,std::vector<uint32_t> > Postings;
+	std::vector<Postings> postings( indexedAttrs );
+
+	CPool * pool = repo_r->pool;
+	uint32_t ordinal = 0;
+	std::vector<Trigram> trigrams;
+	for ( SolvableIdType id = repo_r->start; id < SolvableIdType(repo_r->end); ++id )
+	{
+	  CSolvable * s = pool->solvables + id;
+	  if ( s->repo != repo_r )
+	    continue;
+
+	  for ( unsigned attr = 0; attr < indexedAttrs; ++attr )
+	  {
+	    // The strings the LookupAttr iterator matches. (repo_r may live in a private
+	    // pool, but the attributes are libsolv known ids, the same in any pool).
+	    const char * str = nullptr;
+	    if ( indexedAttr( attr ) == SolvAttr::name )
+	      str = ::pool_id2str( pool, s->name );
+	    else
+	      str = ::repo_lookup_str( repo_r, id, indexedAttr( attr ).id() );
+	    if ( ! str || ! *str )
+	      continue;
+
+	    trigrams.clear();
+	    addTrigrams( str, ::strlen( str ), trigrams );
+	    sortUnique( trigrams );
+	    for ( Trigram trigram : trigrams )
+	      postings[attr][trigram].push_back( ordinal );
+	  }
+	  ++ordinal;
+	}
+
+	// Layout and encode.
+	Header header;
+	::memcpy( header.magic, magic, sizeof(magic) );
+	header.byteOrder  = byteOrder;
+	header.nsolvables = ordinal;
+	header.nattrs     = indexedAttrs;
+	header.reserved   = 0;
+	header.solvSize   = st.st_size;
+	header.solvIno    = st.st_ino;
+	header.solvMtime  = st.st_mtime;
+
+	std::vector<AttrDir> dirs( indexedAttrs );
+	std::vector<std::vector<Key> > keys( indexedAttrs );
+	std::vector<std::string> data( indexedAttrs );
+	uint64_t offset = sizeof(Header) + indexedAttrs * sizeof(AttrDir);
+	for ( unsigned attr = 0; attr < indexedAttrs; ++attr )
+	{
+	  std::vector<Trigram> sorted;
+	  sorted.reserve( postings[attr].size() );
+	  for ( const auto & entry : postings[attr] )
+	    sorted.push_back( entry.first );
+	  std::sort( sorted.begin(), sorted.end() );
+
+	  for ( Trigram trigram : sorted )
+	  {
+	    const std::vector<uint32_t> & ords( postings[attr][trigram] );
+	    Key key;
+	    key.trigram = trigram;
+	    key.count   = ords.size();
+	    key.offset  = data[attr].size();
+	    uint32_t last = 0;
+	    for ( uint32_t ord : ords )
+	    {
+	      putVarint( data[attr], ord - last );
+	      last = ord;
+	    }
+	    key.size = data[attr].size() - key.offset;
+	    keys[attr].push_back( key );
+	  }
+
+	  dirs[attr].attr         = attr;
+	  dirs[attr].nkeys        = keys[attr].size();
+	  dirs[attr].keys         = offset;
+	  offset                 += keys[attr].size() * sizeof(Key);
+	  dirs[attr].postings     = offset;
+	  dirs[attr].postingsSize = data[attr].size();
+	  data[attr].resize( ( data[attr].size() + 7 ) & ~size_t(7), '\0' );	// keep the next Keys aligned
+	  offset                 += data[attr].size();
+	}
+
+	Pathname tmpfile( indexfile.extend( ".new" ) );
+	{
+	  std::ofstream out( tmpfile.c_str(), std::ios::binary | std::ios::trunc );
+	  out.write( reinterpret_cast<const char *>( &header ), sizeof(Header) );
+	  out.write( reinterpret_cast<const char *>( dirs.data() ), dirs.size() * sizeof(AttrDir) );
+	  for ( unsigned attr = 0; attr < indexedAttrs; ++attr )
+	  {
+	    out.write( reinterpret_cast<const char *>( keys[attr].data() ), keys[attr].size() * sizeof(Key) );
+	    out.write( data[attr].data(), data[attr].size() );
+	  }
+	  out.close();
+	  if ( ! out )
+	  {
+	    WAR << "Can't write search index " << tmpfile << endl;
+	    filesystem::unlink( tmpfile );
+	    return;
+	  }
+	}
+	if ( filesystem::rename( tmpfile, indexfile ) != 0 )
+	{
+	  filesystem::unlink( tmpfile );
+	  return;
+	}
+	DBG << "Wrote search index " << indexfile << " (" << ordinal << " solvables, " << offset << " bytes)" << endl;
+      }
+
+      bool SearchIndex::upToDate( const Pathname & solvfile_r )
+      {
+	struct stat st;
+	if ( ! statSolvFile( solvfile_r, st ) )
+	  return false;
+
+	Header header;
+	std::ifstream in( indexFile( solvfile_r ).c_str() );
+	if ( ! in.read( reinterpret_cast<char *>( &header ), sizeof(Header) ) )
+	  return false;
+	return( ::memcmp( header.magic, magic, sizeof(magic) ) == 0
+		&& header.byteOrder == byteOrder
+		&& header.nattrs == indexedAttrs
+		&& header.solvSize == uint64_t(st.st_size)
+		&& header.solvIno == uint64_t(st.st_ino)
+		&& header.solvMtime == int64_t(st.st_mtime) );
+      }
+
+      shared_ptr<SearchIndex> SearchIndex::load( const Pathname & solvfile_r, SolvableIdType base_r, unsigned count_r )
+      {
+	shared_ptr<SearchIndex> ret;
+	Pathname indexfile( indexFile( solvfile_r ) );
+
+	struct stat st;
+	if ( ! statSolvFile( solvfile_r, st ) )
+	  return ret;
+
+	int fd = ::open( indexfile.c_str(), O_RDONLY|O_CLOEXEC );
+	if ( fd < 0 )
+	  return ret;	// no index
+
+	struct stat ist;
+	if ( ::fstat( fd, &ist ) != 0 || size_t(ist.st_size) < sizeof(Header) )
+	{
+	  ::close( fd );
+	  return ret;
+	}
+
+	void * map = ::mmap( 0, ist.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	::close( fd );
+	if ( map == MAP_FAILED )
+	{
+	  WAR << "Can't mmap " << indexfile << endl;
+	  return ret;
+	}
+
+	ret.reset( new SearchIndex );
+	ret->_map   = static_cast<const char *>( map );
+	ret->_size  = ist.st_size;
+	ret->_base  = base_r;
+	ret->_count = count_r;
+
+	// Validate the header and the offsets once, so lookups need not check.
+	const Header & header( *reinterpret_cast<const Header *>( ret->_map ) );
+	bool valid = ( ::memcmp( header.magic, magic, sizeof(magic) ) == 0
+		       && header.byteOrder == byteOrder
+		       && header.nsolvables == count_r
+		       && header.solvSize == uint64_t(st.st_size)
+		       && header.solvIno == uint64_t(st.st_ino)
+		       && header.solvMtime == int64_t(st.st_mtime)
+		       && header.nattrs == indexedAttrs
+		       && sizeof(Header) + header.nattrs * sizeof(AttrDir) <= ret->_size );
+	if ( valid )
+	{
+	  const AttrDir * dirs = reinterpret_cast<const AttrDir *>( ret->_map + sizeof(Header) );
+	  for ( unsigned attr = 0; valid && attr < header.nattrs; ++attr )
+	  {
+	    const AttrDir & dir( dirs[attr] );
+	    valid = ( dir.attr == attr
+		      && dir.keys % alignof(Key) == 0
+		      && dir.keys + uint64_t(dir.nkeys) * sizeof(Key) <= ret->_size
+		      && dir.postings + dir.postingsSize <= ret->_size );
+	    const Key * keys = reinterpret_cast<const Key *>( ret->_map + dir.keys );
+	    for ( unsigned i = 0; valid && i < dir.nkeys; ++i )
+	      valid = ( uint64_t(keys[i].offset) + keys[i].size <= dir.postingsSize );
+	  }
+	}
+	if ( ! valid )
+	{
+	  DBG << "Ignore outdated search index " << indexfile << endl;
+	  ret.reset();
+	  return ret;
+	}
+
+	DBG << "Loaded " << *ret << " " << indexfile << endl;
+	return ret;
+      }
+
+      bool SearchIndex::candidates( const SolvAttr & attr_r, const std::vector<Trigram> & trigrams_r, std::vector<SolvableIdType> & result_r ) const
+      {
+	int attr = indexedAttrIdx( attr_r );
+	if ( attr < 0 )
+	  return false;
+
+	const AttrDir & dir( reinterpret_cast<const AttrDir *>( _map + sizeof(Header) )[attr] );
+	const Key * kbegin = reinterpret_cast<const Key *>( _map + dir.keys );
+	const Key * kend   = kbegin + dir.nkeys;
+
+	// Look up the keys; start intersecting with the rarest trigram.
+	std::vector<const Key *> found;
+	for ( Trigram trigram : trigrams_r )
+	{
+	  const Key * key = std::lower_bound( kbegin, kend, trigram, []( const Key & lhs, Trigram rhs ) { return lhs.trigram < rhs; } );
+	  if ( key == kend || key->trigram != trigram )
+	    return true;	// no solvable contains this trigram
+	  found.push_back( key );
+	}
+	if ( found.empty() )
+	  return true;
+	std::sort( found.begin(), found.end(), []( const Key * lhs, const Key * rhs ) { return lhs->count < rhs->count; } );
+
+	const unsigned char * postings = reinterpret_cast<const unsigned char *>( _map + dir.postings );
+	auto decode = [&]( const Key * key_r, std::vector<uint32_t> & ords_r )
+	{
+	  ords_r.clear();
+	  ords_r.reserve( key_r->count );
+	  const unsigned char * ptr = postings + key_r->offset;
+	  const unsigned char * end = ptr + key_r->size;
+	  uint32_t ord = 0;
+	  uint32_t delta = 0;
+	  while ( ptr != end && getVarint( ptr, end, delta ) )
+	  {
+	    ord += delta;
+	    if ( ord >= _count )
+	      break;	// corrupt
+	    ords_r.push_back( ord );
+	  }
+	};
+
+	std::vector<uint32_t> ords;
+	std::vector<uint32_t> next;
+	std::vector<uint32_t> tmp;
+	decode( found.front(), ords );
+	for ( unsigned i = 1; i < found.size() && ! ords.empty(); ++i )
+	{
+	  decode( found[i], next );
+	  tmp.clear();
+	  std::set_intersection( ords.begin(), ords.end(), next.begin(), next.end(), std::back_inserter( tmp ) );
+	  ords.swap( tmp );
+	}
+
+	for ( uint32_t ord : ords )
+	  result_r.push_back( _base + ord );
+	return true;
+      }
+
+      std::ostream & operator<<( std::ostream & str, const SearchIndex & obj )
+      {
+	return str << "SearchIndex(" << obj._count << " solvables from " << obj._base << ", " << obj._size << " bytes)";
+      }
+
+      bool searchIndexOrder( const Solvable & lhs, const Solvable & rhs )
+      {
+	int lrepo = lhs.get()->repo->repoid;
+	int rrepo = rhs.get()->repo->repoid;
+	return( lrepo < rrepo || ( lrepo == rrepo && lhs.id() < rhs.id() ) );
+      }
+
+      bool searchIndexCandidates( const std::vector<std::pair<SolvAttr,StrMatcher> > & attrs_r,
+				  const std::set<Repository> & repos_r,
+				  std::vector<Solvable> & result_r )
+      {
+	if ( attrs_r.empty() )
+	  return false;
+
+	std::vector<std::vector<SearchIndex::Trigram> > trigrams;
+	for ( const auto & attr : attrs_r )
+	{
+	  if ( ! SearchIndex::indexed( attr.first ) )
+	    return false;
+	  trigrams.push_back( SearchIndex::trigrams( attr.second ) );
+	  if ( trigrams.back().empty() )
+	    return false;	// would match too much
+	}
+
+	PoolImpl & poolimpl( PoolMember::myPool() );
+	CPool * pool = poolimpl.getPool();
+	bool useful = false;
+	std::vector<Solvable> ret;
+	std::vector<SolvableIdType> ids;
+
+	for ( Repository repo : sat::Pool::instance().repos() )
+	{
+	  if ( ! repos_r.empty() && ! repos_r.count( repo ) )
+	    continue;
+
+	  CRepo * crepo = repo.get();
+	  shared_ptr<SearchIndex> index( poolimpl.searchIndex( crepo ) );
+	  ids.clear();
+	  if ( index )
+	  {
+	    useful = true;
+	    for ( unsigned i = 0; i < attrs_r.size(); ++i )
+	      index->candidates( attrs_r[i].first, trigrams[i], ids );
+	    // Solvables added to the repo later are not covered.
+	    for ( SolvableIdType id = crepo->start; id < SolvableIdType(crepo->end); ++id )
+	    {
+	      if ( pool->solvables[id].repo == crepo && ! index->covers( id ) )
+		ids.push_back( id );
+	    }
+	    std::sort( ids.begin(), ids.end() );
+	    ids.erase( std::unique( ids.begin(), ids.end() ), ids.end() );
+	  }
+	  else
+	  {
+	    for ( SolvableIdType id = crepo->start; id < SolvableIdType(crepo->end); ++id )
+	      ids.push_back( id );
+	  }
+
+	  for ( SolvableIdType id : ids )
+	  {
+	    // Filtered (e.g. by arch) solvables are no longer in the repo.
+	    if ( pool->solvables[id].repo == crepo )
+	      ret.push_back( Solvable( id ) );
+	  }
+	}
+
+	if ( ! useful )
+	  return false;
+	result_r.swap( ret );
+	return true;
+      }
+
+    } // namespace detail
+    ///////////////////////////////////////////////////////////////////
+  } // namespace sat
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
@@ -0,0 +1,137 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/sat/detail/SearchIndex.h
+ *
+*/
+#ifndef ZYPP_SAT_DETAIL_SEARCHINDEX_H
+#define ZYPP_SAT_DETAIL_SEARCHINDEX_H
+
+#include <stdint.h>
+#include <iosfwd>
+#include <vector>
+#include <set>
+
+#include "zypp/base/NonCopyable.h"
+#include "zypp/base/PtrTypes.h"
+#include "zypp/base/StrMatcher.h"
+#include "zypp/sat/detail/PoolMember.h"
+#include "zypp/sat/SolvAttr.h"
+#include "zypp/Pathname.h"
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  class Repository;
+
+  ///////////////////////////////////////////////////////////////////
+  namespace sat
+  {
+    class Solvable;
+
+    ///////////////////////////////////////////////////////////////////
+    namespace detail
+    {
+      ///////////////////////////////////////////////////////////////////
+      /// \class SearchIndex
+      /// \brief Trigram index of some solvable attributes, stored next to a solv-file.
+      ///
+      /// For the indexed attributes (name, summary and description) the
+      /// file \c solv.search lists for each trigram (3 bytes, ASCII
+      /// lowercased) the solvables containing it. A \ref PoolQuery looking
+      /// for a literal substring (or glob) thus just needs to verify the
+      /// solvables containing all of its trigrams, not to scan the pool.
+      ///
+      /// Dependencies (like provides) are not indexed, as the pool adds
+      /// file provides to the solvables after loading
+      /// (\c pool_addfileprovides). Neither is the filelist: a repos
+      /// filelist may be completed by an extension loaded on demand, and
+      /// the trigrams of all paths would make the index larger than the
+      /// solv-file. Queries on these attributes scan the pool.
+      ///
+      /// The index is written along with the \c solv.idx file (see
+      /// \ref sat::updateSolvFileIndex) and memory mapped when the
+      /// solv-file is loaded (\ref Repository::addSolv). It refers to the
+      /// solvables by their position in the solv-file and is ignored if
+      /// the solv-file changed since.
+      ///////////////////////////////////////////////////////////////////
+      class SearchIndex : private base::NonCopyable
+      {
+	friend std::ostream & operator<<( std::ostream & str, const SearchIndex & obj );
+
+      public:
+	typedef uint32_t Trigram;
+
+	/** The index file for \a solvfile_r. */
+	static Pathname indexFile( const Pathname & solvfile_r )
+	{ return solvfile_r.extend( ".search" ); }
+
+	/** Write the index for \a solvfile_r from \a repo_r, the repo the solv-file was written from. */
+	static void write( const Pathname & solvfile_r, CRepo * repo_r );
+
+	/** Whether \a solvfile_r has an index of the current format matching the file. */
+	static bool upToDate( const Pathname & solvfile_r );
+
+	/** Map the index of \a solvfile_r, just loaded into the pool as
+	 * \a count_r solvables starting at \a base_r.
+	 * Returns \c nullptr if there is no usable index.
+	 */
+	static shared_ptr<SearchIndex> load( const Pathname & solvfile_r, SolvableIdType base_r, unsigned count_r );
+
+	/** Whether \a attr_r is indexed. */
+	static bool indexed( const SolvAttr & attr_r );
+
+	/** The trigrams any string matched by \a matcher_r contains.
+	 * Empty if there are none (e.g. regex or too short).
+	 */
+	static std::vector<Trigram> trigrams( const StrMatcher & matcher_r );
+
+      public:
+	~SearchIndex();
+
+	/** Append the solvables whose \a attr_r contains all \a trigrams_r to \a result_r
+	 * (ids in the pool, not necessarily still in the repo). Returns \c false if
+	 * \a attr_r is not in the index.
+	 */
+	bool candidates( const SolvAttr & attr_r, const std::vector<Trigram> & trigrams_r, std::vector<SolvableIdType> & result_r ) const;
+
+	/** Whether solvable \a id_r was loaded along with the index. */
+	bool covers( SolvableIdType id_r ) const
+	{ return id_r >= _base && id_r < _base + _count; }
+
+      private:
+	SearchIndex();
+
+	const char *   _map;
+	size_t         _size;
+	SolvableIdType _base;
+	unsigned       _count;
+      };
+
+      /** \relates SearchIndex Stream output */
+      std::ostream & operator<<( std::ostream & str, const SearchIndex & obj );
+
+      /** Candidate solvables for a query on the \a attrs_r matchers (any of them),
+       * restricted to \a repos_r (unless empty), in pool order.
+       * Returns \c false if the query can not be answered using the indexes and
+       * the pool must be scanned.
+       */
+      bool searchIndexCandidates( const std::vector<std::pair<SolvAttr,StrMatcher> > & attrs_r,
+				  const std::set<Repository> & repos_r,
+				  std::vector<Solvable> & result_r );
+
+      /** \relates searchIndexCandidates The order of the result (the order a \ref LookupAttr visits the solvables). */
+      bool searchIndexOrder( const Solvable & lhs, const Solvable & rhs );
+
+    } // namespace detail
+    ///////////////////////////////////////////////////////////////////
+  } // namespace sat
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_SAT_DETAIL_SEARCHINDEX_H
@@ -80,6 +80,9 @@ namespace zypp
     RepoProvidePackage::~RepoProvidePackage()
     {}
 
+    void RepoProvidePackage::addCachePath( const Pathname & cacheRoot_r )
+    { _impl->_access.addCachePath( cacheRoot_r ); }
+
     ManagedFile RepoProvidePackage::operator()( const PoolItem & pi_r, bool fromCache_r )
     {
       ManagedFile ret;
@@ -44,6 +44,11 @@ namespace zypp
       /** Provide package optionally fron cache only. */
       ManagedFile operator()( const PoolItem & pi, bool fromCache_r );
 
+      /** Also look for packages downloaded in advance below \a cacheRoot_r.
+       * \see \ref repo::RepoMediaAccess::addCachePath
+       */
+      void addCachePath( const Pathname & cacheRoot_r );
+
     private:
       struct Impl;
       RW_pointer<Impl> _impl;
@@ -0,0 +1,323 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/target/CommitPackagePrefetcher.cc
+ *
+*/
+#include <iostream>
+#include <list>
+#include <map>
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+#include "zypp/base/LogTools.h"
+#include "zypp/base/ForkedWorkers_p.h"
+#include "zypp/target/CommitPackagePrefetcher.h"
+
+#include "zypp/ZConfig.h"
+#include "zypp/ZYppCallbacks.h"
+#include "zypp/ResPool.h"
+#include "zypp/Package.h"
+#include "zypp/SrcPackage.h"
+#include "zypp/TmpPath.h"
+#include "zypp/PathInfo.h"
+#include "zypp/Fetcher.h"
+#include "zypp/FileChecker.h"
+#include "zypp/MediaSetAccess.h"
+#include "zypp/repo/DeltaCandidates.h"
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace target
+  {
+    ///////////////////////////////////////////////////////////////////
+    namespace
+    {
+      /** Most packages a worker downloads via the same connection. */
+      const unsigned maxBatchSize = 16;
+
+      /** Download the files \a locs_r of \a info_r into \a destdir_r; returns the workers exit code.
+       * All files are downloaded using the same \ref MediaSetAccess, so the connection is reused.
+       * A file failing on one url is tried on the next one. The exit code is the number of failed files.
+       */
+      int prefetchWorker( const RepoInfo & info_r, const std::vector<OnMediaLocation> & locs_r, const Pathname & destdir_r )
+      {
+	// Downloads which would require interaction simply fail and the
+	// package is provided the usual way later.
+	ForkedWorkers::muteCallbacks();
+	media::ScopedDisableMediaChangeReport guard;
+
+	std::vector<bool> done( locs_r.size(), false );
+	unsigned todo = locs_r.size();
+	for ( const Url & url : info_r.baseUrls() )
+	{
+	  try
+	  {
+	    MediaSetAccess access( url );
+	    for ( unsigned i = 0; i < locs_r.size(); ++i )
+	    {
+	      if ( done[i] )
+		continue;
+	      try
+	      {
+		Fetcher fetcher;
+		fetcher.enqueue( locs_r[i], ChecksumFileChecker( locs_r[i].checksum() ) );
+		fetcher.start( destdir_r, access );
+		done[i] = true;
+		--todo;
+	      }
+	      catch ( const Exception & excpt )
+	      {
+		ZYPP_CAUGHT( excpt );
+	      }
+	    }
+	  }
+	  catch ( const Exception & excpt )
+	  {
+	    ZYPP_CAUGHT( excpt );
+	  }
+	  if ( ! todo )
+	    break;
+	}
+	return std::min( todo, 255U );
+      }
+    } // namespace
+    ///////////////////////////////////////////////////////////////////
+
+    ///////////////////////////////////////////////////////////////////
+    /// \class CommitPackagePrefetcher::Impl
+    /// \brief CommitPackagePrefetcher implementation.
+    ///////////////////////////////////////////////////////////////////
+    class CommitPackagePrefetcher::Impl : private base::NonCopyable
+    {
+    public:
+      enum State { QUEUED, RUNNING, DONE };
+
+    public:
+      Impl( unsigned maxParallel_r, const Pathname & tmpRoot_r )
+      : _workers( maxParallel_r )
+      {
+	if ( maxParallel_r > 1 )
+	{
+	  if ( ! tmpRoot_r.empty() && filesystem::assert_dir( tmpRoot_r ) == 0 )
+	    _cachePath = filesystem::TmpDir( tmpRoot_r, "TmpDir.prefetch." );
+	  if ( _cachePath.path().empty() )
+	    _cachePath = filesystem::TmpDir();
+	}
+	if ( enabled() )
+	{
+	  const ResPool & pool( ResPool::instance() );
+	  _repos.insert( _repos.begin(), pool.knownRepositoriesBegin(), pool.knownRepositoriesEnd() );
+	}
+      }
+
+      ~Impl()
+      {
+	_queue.clear();
+	_workers.waitAll();
+      }
+
+    public:
+      bool enabled() const
+      { return ! _cachePath.path().empty(); }
+
+      Pathname cachePath() const
+      { return _cachePath.path(); }
+
+      void enqueue( const PoolItem & pi_r )
+      {
+	if ( ! enabled() || _state.count( pi_r.satSolvable() ) || ! worthPrefetching( pi_r ) )
+	  return;
+	_state[pi_r.satSolvable()] = QUEUED;
+	_queue.push_back( pi_r );
+	startWorkers();
+      }
+
+      void waitFor( const PoolItem & pi_r )
+      {
+	std::map<sat::Solvable,State>::const_iterator it( _state.find( pi_r.satSolvable() ) );
+	if ( it == _state.end() )
+	  return;
+
+	_workers.reap();
+	startWorkers();
+	while ( it->second != DONE && _workers.running() )
+	{
+	  _workers.reap( /*block*/true );
+	  startWorkers();
+	}
+      }
+
+      void waitAll()
+      {
+	startWorkers();
+	while ( _workers.running() )
+	{
+	  _workers.reap( /*block*/true );
+	  startWorkers();
+	}
+      }
+
+      Pathname prefetched( const PoolItem & pi_r ) const
+      {
+	std::map<sat::Solvable,State>::const_iterator it( _state.find( pi_r.satSolvable() ) );
+	if ( it == _state.end() || it->second != DONE )
+	  return Pathname();
+	Pathname ret( prefetchedFile( pi_r ) );
+	return( PathInfo( ret ).isFile() ? ret : Pathname() );
+      }
+
+      void release( const PoolItem & pi_r )
+      {
+	std::map<sat::Solvable,State>::const_iterator it( _state.find( pi_r.satSolvable() ) );
+	if ( it == _state.end() || it->second != DONE )
+	  return;
+	filesystem::unlink( prefetchedFile( pi_r ) );
+      }
+
+    private:
+      /** Where a worker stores \a pi_r (the location as used by \ref Fetcher). */
+      Pathname prefetchedFile( const PoolItem & pi_r ) const
+      {
+	const RepoInfo & info( pi_r->repoInfo() );
+	return _cachePath.path() / info.alias() / info.path() / pi_r.satSolvable().lookupLocation().filename();
+      }
+
+      /** Whether downloading \a pi_r in advance is possible and useful. */
+      bool worthPrefetching( const PoolItem & pi_r ) const
+      {
+	OnMediaLocation loc;
+	if ( pi_r.isKind<Package>() )
+	{
+	  Package::constPtr pkg( pi_r->asKind<Package>() );
+	  if ( pkg->isCached() )
+	    return false;
+	  // A deltarpm is tried first; don't waste bandwidth on the full rpm.
+	  if ( ZConfig::instance().download_use_deltarpm()
+	    && ! repo::DeltaCandidates( _repos, pkg->name() ).deltaRpms( pkg ).empty() )
+	    return false;
+	  loc = pkg->location();
+	}
+	else if ( pi_r.isKind<SrcPackage>() )
+	{
+	  SrcPackage::constPtr pkg( pi_r->asKind<SrcPackage>() );
+	  if ( pkg->isCached() )
+	    return false;
+	  loc = pkg->location();
+	}
+	else
+	  return false;
+
+	// No checksum, no cache hit; see Fetcher.
+	if ( loc.checksum().empty() )
+	  return false;
+
+	// Local and mountable media are provided the usual way.
+	const RepoInfo & info( pi_r->repoInfo() );
+	if ( info.baseUrlsEmpty() )
+	  return false;
+	for ( const Url & url : info.baseUrls() )
+	{
+	  if ( ! url.schemeIsDownloading() )
+	    return false;
+	}
+	return true;
+      }
+
+      /** Fork workers for queued items until all slots are in use.
+       * Each worker gets a batch of consecutive items from the same repo,
+       * the queue being split evenly between the workers. Small batches
+       * keep the first packages available early.
+       */
+      void startWorkers()
+      {
+	while ( ! _queue.empty() && ! _workers.full() )
+	{
+	  unsigned batchSize = std::min( std::max( unsigned(_queue.size()) / _workers.maxParallel(), 1U ), maxBatchSize );
+
+	  RepoInfo info( _queue.front()->repoInfo() );
+	  Pathname destdir( _cachePath.path() / info.alias() );
+	  std::vector<sat::Solvable> batch;
+	  std::vector<OnMediaLocation> locs;
+	  while ( ! _queue.empty() && batch.size() < batchSize && _queue.front()->repoInfo().alias() == info.alias() )
+	  {
+	    sat::Solvable solv( _queue.front().satSolvable() );
+	    _queue.pop_front();
+
+	    OnMediaLocation loc( solv.lookupLocation() );
+	    loc.prependPath( info.path() );
+	    locs.push_back( loc );
+	    batch.push_back( solv );
+	    _state[solv] = RUNNING;
+	  }
+
+	  auto done = [this,batch]( int exitcode_r ) {
+	    if ( exitcode_r != 0 )
+	      WAR << "Prefetch failed for " << exitcode_r << " of " << batch.size() << " packages" << endl;
+	    for ( const sat::Solvable & solv : batch )
+	      _state[solv] = DONE;	// prefetched() checks whether the file is there
+	  };
+	  if ( ! _workers.start( [&]() { return prefetchWorker( info, locs, destdir ); }, done ) )
+	    done( 0 );
+	}
+      }
+
+    private:
+      filesystem::TmpPath		_cachePath;
+      std::list<Repository>		_repos;
+      std::map<sat::Solvable,State>	_state;
+      std::deque<PoolItem>		_queue;
+      ForkedWorkers			_workers;	///< last member: dtor must wait for workers first
+    };
+
+    ///////////////////////////////////////////////////////////////////
+    //
+    //	CLASS NAME : CommitPackagePrefetcher
+    //
+    ///////////////////////////////////////////////////////////////////
+
+    CommitPackagePrefetcher::CommitPackagePrefetcher( unsigned maxParallel_r, const Pathname & tmpRoot_r )
+    : _pimpl( new Impl( maxParallel_r, tmpRoot_r ) )
+    {}
+
+    CommitPackagePrefetcher::~CommitPackagePrefetcher()
+    {}
+
+    bool CommitPackagePrefetcher::enabled() const
+    { return _pimpl->enabled(); }
+
+    Pathname CommitPackagePrefetcher::cachePath() const
+    { return _pimpl->cachePath(); }
+
+    void CommitPackagePrefetcher::enqueue( const PoolItem & pi_r )
+    { _pimpl->enqueue( pi_r ); }
+
+    void CommitPackagePrefetcher::waitFor( const PoolItem & pi_r )
+    { _pimpl->waitFor( pi_r ); }
+
+    void CommitPackagePrefetcher::waitAll()
+    { _pimpl->waitAll(); }
+
+    Pathname CommitPackagePrefetcher::prefetched( const PoolItem & pi_r ) const
+    { return _pimpl->prefetched( pi_r ); }
+
+    void CommitPackagePrefetcher::release( const PoolItem & pi_r )
+    { _pimpl->release( pi_r ); }
+
+    std::ostream & operator<<( std::ostream & str, const CommitPackagePrefetcher & obj )
+    { return str << "CommitPackagePrefetcher(" << obj.cachePath() << ")"; }
+
+  } // namespace target
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
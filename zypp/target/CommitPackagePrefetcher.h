@@ -0,0 +1,126 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/target/CommitPackagePrefetcher.h
+ *
+*/
+#ifndef ZYPP_TARGET_COMMITPACKAGEPREFETCHER_H
+#define ZYPP_TARGET_COMMITPACKAGEPREFETCHER_H
+
+#include <iosfwd>
+
+#include "zypp/base/PtrTypes.h"
+#include "zypp/base/NonCopyable.h"
+#include "zypp/Pathname.h"
+#include "zypp/PoolItem.h"
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace target
+  {
+    ///////////////////////////////////////////////////////////////////
+    /// \class CommitPackagePrefetcher
+    /// \brief Target::commit helper downloading packages concurrently.
+    ///
+    /// Packages available via downloading urls are downloaded by up to
+    /// \c maxParallel_r forked worker processes into a private \ref cachePath.
+    /// Each worker downloads a batch of packages from the same repo via one
+    /// connection. Workers just download the files and verify their checksum.
+    /// They do not talk to the user.
+    ///
+    /// Pass the \ref cachePath to \ref RepoProvidePackage::addCachePath. The
+    /// \ref CommitPackageCache then finds the prefetched files instead of
+    /// downloading them. The usual workflow is not changed: the signature
+    /// checks and all callbacks are performed by the calling process when
+    /// the package is actually provided. Packages that were not prefetched
+    /// (failed, local media, deltarpm candidates, ...) are downloaded the
+    /// usual way.
+    ///
+    /// \code
+    ///   RepoProvidePackage repoProvidePackage;
+    ///   CommitPackageCache packageCache( repoProvidePackage );
+    ///   CommitPackagePrefetcher prefetcher( policy_r.downloadMaxParallel() );
+    ///   repoProvidePackage.addCachePath( prefetcher.cachePath() );
+    ///
+    ///   prefetcher.enqueue( steps );	// start downloading
+    ///   for ( const auto & step : steps )
+    ///   {
+    ///     prefetcher.waitFor( step );	// keep the workers busy
+    ///     packageCache.get( step );
+    ///     prefetcher.release( step );	// free the space
+    ///   }
+    /// \endcode
+    ///////////////////////////////////////////////////////////////////
+    class CommitPackagePrefetcher : private base::NonCopyable
+    {
+      friend std::ostream & operator<<( std::ostream & str, const CommitPackagePrefetcher & obj );
+
+    public:
+      /** Ctor taking the maximum number of concurrent downloads.
+       * Prefetching is disabled if \a maxParallel_r is less than \c 2.
+       * The \ref cachePath is created below \a tmpRoot_r (default: the global
+       * tmp space). It should be on the same filesystem as the package cache,
+       * so prefetched files can be hardlinked into it.
+       */
+      CommitPackagePrefetcher( unsigned maxParallel_r, const Pathname & tmpRoot_r = Pathname() );
+
+      /** Dtor waits for pending workers. */
+      ~CommitPackagePrefetcher();
+
+    public:
+      /** Whether prefetching is enabled. */
+      bool enabled() const;
+
+      /** Directory holding the prefetched files (below \c ALIAS subdirectories). */
+      Pathname cachePath() const;
+
+      /** Schedule \a pi for download if it is worth it and start the workers.
+       * Items which are not a Package or SrcPackage, are already cached,
+       * have no checksum, are available on local media or are candidates
+       * for a deltarpm are ignored.
+       */
+      void enqueue( const PoolItem & pi_r );
+
+      /** \overload for a range of items (e.g. \ref sat::Transaction steps). */
+      template <class TIterator>
+      void enqueue( TIterator begin_r, TIterator end_r )
+      { for ( ; begin_r != end_r; ++begin_r ) enqueue( PoolItem( *begin_r ) ); }
+
+      /** Block until \a pi_r is downloaded (or failed, or was never scheduled).
+       * Meanwhile finished workers are replaced by new ones.
+       */
+      void waitFor( const PoolItem & pi_r );
+
+      /** Block until all scheduled downloads are done. */
+      void waitAll();
+
+      /** The prefetched file of \a pi_r or an empty path if not (yet) available. */
+      Pathname prefetched( const PoolItem & pi_r ) const;
+
+      /** Remove the prefetched file of \a pi_r once it was provided.
+       * The provided file is hardlinked (or copied) into the package cache,
+       * the prefetched one is no longer needed.
+       */
+      void release( const PoolItem & pi_r );
+
+    public:
+      class Impl;	///< Implementation class.
+    private:
+      RW_pointer<Impl> _pimpl;	///< Pointer to implementation.
+    };
+
+    /** \relates CommitPackagePrefetcher Stream output */
+    std::ostream & operator<<( std::ostream & str, const CommitPackagePrefetcher & obj );
+
+  } // namespace target
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_TARGET_COMMITPACKAGEPREFETCHER_H
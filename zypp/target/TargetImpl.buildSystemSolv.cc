@@ -0,0 +1,107 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file zypp/target/TargetImpl.buildSystemSolv.cc
+ */
+extern "C"
+{
+#include <solv/pool.h>
+#include <solv/repo.h>
+#include <solv/repodata.h>
+#include <solv/repo_rpmdb.h>
+#include <solv/repo_products.h>
+#include <solv/repo_appdata.h>
+#include <solv/repo_autopattern.h>
+}
+#include <cstdio>
+#include <iostream>
+
+#include "zypp/base/LogTools.h"
+#include "zypp/base/String.h"
+#include "zypp/base/Exception.h"
+#include "zypp/AutoDispose.h"
+#include "zypp/PathInfo.h"
+
+#include "zypp/sat/Pool.h"
+#include "zypp/repo/SolvFileBuilder.h"
+
+#include "zypp/target/TargetImpl.h"
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace target
+  {
+    ///////////////////////////////////////////////////////////////////
+    namespace
+    {
+      typedef sat::detail::CPool CPool;
+      typedef sat::detail::CRepo CRepo;
+      using repo::throwSolvError;
+
+      /** Flags passed by \c rpmdb2solv: data below the pools rootdir, all in one Repodata. */
+      const int addFlags = REPO_USE_ROOTDIR | REPO_REUSE_REPODATA | REPO_NO_INTERNALIZE;
+    } // namespace
+    ///////////////////////////////////////////////////////////////////
+
+    void TargetImpl::buildSystemSolv( const Pathname & solvfile_r, const Pathname & tmpfile_r, const Pathname & oldSolvFile_r ) const
+    {
+      MIL << "Building " << solvfile_r << " from the rpm database at " << _root
+          << ( oldSolvFile_r.empty() ? "" : " reusing " ) << oldSolvFile_r << endl;
+
+      AutoDispose<CPool*> pool( ::pool_create(), ::pool_free );
+      if ( ! _root.empty() )
+	::pool_set_rootdir( pool, _root.c_str() );
+      CRepo * repo = ::repo_create( pool, "" );	// freed along with the pool
+      ::Repodata * data = ::repo_add_repodata( repo, 0 );
+
+      {
+	// Like rpmdb2solv, the whole rpm database is walked; the data of packages
+	// also in the old solv-file (matched by their rpmdbid) are copied from there.
+	AutoDispose<FILE*> reffp( oldSolvFile_r.empty() ? nullptr : ::fopen( oldSolvFile_r.c_str(), "re" ),
+				  []( FILE * fp_r ) { if ( fp_r ) ::fclose( fp_r ); } );
+	if ( ! oldSolvFile_r.empty() && reffp == nullptr )
+	  WAR << "Can't open " << oldSolvFile_r << "; reading all rpm headers" << endl;
+
+	if ( ::repo_add_rpmdb_reffp( repo, reffp, addFlags ) != 0 )
+	  throwSolvError( pool, "Can't read the rpm database" );
+      }
+
+      // rpmdb2solv -p /etc/products.d
+      if ( PathInfo( Pathname::assertprefix( _root, "/etc/products.d" ) ).isDir()
+	   && ::repo_add_products( repo, "/etc/products.d", addFlags ) != 0 )
+	throwSolvError( pool, "Can't read /etc/products.d" );
+
+      // rpmdb2solv -A: application pseudo packages
+      for ( const char * dir : { "/usr/share/metainfo", "/usr/share/appdata" } )
+	::repo_add_appdata_dir( repo, dir, addFlags | APPDATA_SEARCH_UNINTERNALIZED_FILELIST );
+
+      ::repodata_internalize( data );
+
+      // rpmdb2solv -X: autogenerate pattern pseudo packages (products come from /etc/products.d)
+      ::repo_add_autopattern( repo, ADD_NO_AUTOPRODUCTS );
+
+      repo::writeSolvFile( repo, tmpfile_r );
+
+      if ( filesystem::rename( tmpfile_r, solvfile_r ) != 0 )
+	ZYPP_THROW( Exception( "Failed to move cache to final destination" ) );
+      // if this fails, don't bother throwing exceptions
+      filesystem::chmod( solvfile_r, 0644 );
+
+      // content digest for zypper bash completion; the repo is still at hand
+      sat::updateSolvFileIndex( solvfile_r, repo );
+      MIL << "Built " << solvfile_r << " (" << repo->nsolvables << " solvables)" << endl;
+    }
+
+  } // namespace target
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
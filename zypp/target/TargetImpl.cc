@@ -15,6 +15,8 @@
 #include <string>
 #include <list>
 #include <set>
+#include <unordered_map>
+#include <memory>
 
 #include <sys/types.h>
 #include <dirent.h>
@@ -46,6 +48,7 @@
 #include "zypp/target/TargetCallbackReceiver.h"
 #include "zypp/target/rpm/librpmDb.h"
 #include "zypp/target/CommitPackageCache.h"
+#include "zypp/target/CommitPackagePrefetcher.h"
 #include "zypp/target/RpmPostTransCollector.h"
 
 #include "zypp/parser/ProductFileReader.h"
@@ -54,6 +57,7 @@
 #include "zypp/sat/Pool.h"
 #include "zypp/sat/detail/PoolImpl.h"
 #include "zypp/sat/Transaction.h"
+#include "zypp/sat/WhatProvides.h"
 
 #include "zypp/PluginExecutor.h"
 
@@ -73,6 +77,18 @@ namespace zypp
       sat::detail::PoolMember::myPool().multiversionSpecChanged();
     }
   } //namespace
+
+  ///////////////////////////////////////////////////////////////////
+  namespace env
+  {
+    /** To build the @System solv file using the external \c rpmdb2solv instead of \ref target::TargetImpl::buildSystemSolv */
+    inline bool ZYPP_EXTERNAL_RPMDB2SOLV()
+    {
+      const char * env = getenv("ZYPP_EXTERNAL_RPMDB2SOLV");
+      return( env && str::strToBool( env, true ) );
+    }
+  } // namespace env
+  ///////////////////////////////////////////////////////////////////
   /////////////////////////////////////////////////////////////////
 
   ///////////////////////////////////////////////////////////////////
@@ -908,54 +924,73 @@ namespace zypp
         // Take care we unlink the solvfile on exception
         ManagedFile guard( base, filesystem::recursive_rmdir );
 
-        ExternalProgram::Arguments cmd;
-        cmd.push_back( "rpmdb2solv" );
-        if ( ! _root.empty() ) {
-          cmd.push_back( "-r" );
-          cmd.push_back( _root.asString() );
+        bool built = false;
+        if ( ! env::ZYPP_EXTERNAL_RPMDB2SOLV() )
+        {
+          // No fork/exec, no reading the new solv-file again for the solv.idx.
+          try
+          {
+            buildSystemSolv( rpmsolv, tmpsolv.path(), oldSolvFile );
+            built = true;
+          }
+          catch ( const Exception & excpt )
+          {
+            ZYPP_CAUGHT( excpt );
+            WAR << "In-process cache build failed, falling back to rpmdb2solv: " << excpt.asUserString() << endl;
+          }
         }
-        cmd.push_back( "-X" );	// autogenerate pattern/product/... from -package
-        cmd.push_back( "-A" );	// autogenerate application pseudo packages
-        cmd.push_back( "-p" );
-        cmd.push_back( Pathname::assertprefix( _root, "/etc/products.d" ).asString() );
 
-        if ( ! oldSolvFile.empty() )
-          cmd.push_back( oldSolvFile.asString() );
+        if ( ! built )
+        {
+          ExternalProgram::Arguments cmd;
+          cmd.push_back( "rpmdb2solv" );
+          if ( ! _root.empty() ) {
+            cmd.push_back( "-r" );
+            cmd.push_back( _root.asString() );
+          }
+          cmd.push_back( "-X" );	// autogenerate pattern/product/... from -package
+          cmd.push_back( "-A" );	// autogenerate application pseudo packages
+          cmd.push_back( "-p" );
+          cmd.push_back( Pathname::assertprefix( _root, "/etc/products.d" ).asString() );
+
+          if ( ! oldSolvFile.empty() )
+            cmd.push_back( oldSolvFile.asString() );
 
-        cmd.push_back( "-o" );
-        cmd.push_back( tmpsolv.path().asString() );
+          cmd.push_back( "-o" );
+          cmd.push_back( tmpsolv.path().asString() );
 
-        ExternalProgram prog( cmd, ExternalProgram::Stderr_To_Stdout );
-	std::string errdetail;
+          ExternalProgram prog( cmd, ExternalProgram::Stderr_To_Stdout );
+	  std::string errdetail;
 
-        for ( std::string output( prog.receiveLine() ); output.length(); output = prog.receiveLine() ) {
-          WAR << "  " << output;
-          if ( errdetail.empty() ) {
-            errdetail = prog.command();
-            errdetail += '\n';
+          for ( std::string output( prog.receiveLine() ); output.length(); output = prog.receiveLine() ) {
+            WAR << "  " << output;
+            if ( errdetail.empty() ) {
+              errdetail = prog.command();
+              errdetail += '\n';
+            }
+            errdetail += output;
           }
-          errdetail += output;
-        }
 
-        int ret = prog.close();
-        if ( ret != 0 )
-        {
-          Exception ex(str::form("Failed to cache rpm database (%d).", ret));
-          ex.remember( errdetail );
-          ZYPP_THROW(ex);
-        }
+          int ret = prog.close();
+          if ( ret != 0 )
+          {
+            Exception ex(str::form("Failed to cache rpm database (%d).", ret));
+            ex.remember( errdetail );
+            ZYPP_THROW(ex);
+          }
 
-        ret = filesystem::rename( tmpsolv, rpmsolv );
-        if ( ret != 0 )
-          ZYPP_THROW(Exception("Failed to move cache to final destination"));
-        // if this fails, don't bother throwing exceptions
-        filesystem::chmod( rpmsolv, 0644 );
+          ret = filesystem::rename( tmpsolv, rpmsolv );
+          if ( ret != 0 )
+            ZYPP_THROW(Exception("Failed to move cache to final destination"));
+          // if this fails, don't bother throwing exceptions
+          filesystem::chmod( rpmsolv, 0644 );
+	  sat::updateSolvFileIndex( rpmsolv );	// content digest for zypper bash completion
+        }
 
         rpmstatus.saveToCookieFile(rpmsolvcookie);
 
         // We keep it.
         guard.resetDispose();
-	sat::updateSolvFileIndex( rpmsolv );	// content digest for zypper bash completion
 
 	// system-hook: Finally send notification to plugins
 	if ( root() == "/" )
@@ -969,8 +1004,7 @@ namespace zypp
       else
       {
 	// On the fly add missing solv.idx files for bash completion.
-	if ( ! PathInfo(base/"solv.idx").isExist() )
-	  sat::updateSolvFileIndex( rpmsolv );
+	sat::ensureSolvFileIndex( rpmsolv );
       }
       return build_rpm_solv;
     }
@@ -1087,6 +1121,114 @@ namespace zypp
       MIL << "Target loaded: " << system.solvablesSize() << " resolvables" << endl;
     }
 
+    ///////////////////////////////////////////////////////////////////
+    namespace
+    {
+      /** Download size of a step (\c 0 if nothing needs to be downloaded). */
+      inline ByteCount stepDownloadSize( const sat::Transaction::Step & step_r )
+      {
+	if ( step_r.stepType() != sat::Transaction::TRANSACTION_INSTALL
+	  && step_r.stepType() != sat::Transaction::TRANSACTION_MULTIINSTALL )
+	  return ByteCount();
+
+	PoolItem pi( step_r );
+	if ( pi->isKind<Package>() )
+	  return pi->asKind<Package>()->isCached() ? ByteCount() : pi->downloadSize();
+	if ( pi->isKind<SrcPackage>() )
+	  return pi->asKind<SrcPackage>()->isCached() ? ByteCount() : pi->downloadSize();
+	return ByteCount();
+      }
+
+      /** Split the ordered steps into heaps for \ref DownloadInHeaps.
+       *
+       * Returns the end index of each heap. A heap is closed as soon as the
+       * download size of its packages exceeds \a heapSize_r. But it is extended
+       * until each requirement of the packages it installs is provided by the
+       * system or by a package installed in this or a previous heap, so that at
+       * the end of each heap a consistent system state is reached.
+       *
+       * A \a heapSize_r of \c 0 results in a single heap.
+       */
+      std::vector<unsigned> commitHeapEnds( const ZYppCommitResult::TransactionStepList & steps_r, const ByteCount & heapSize_r )
+      {
+	std::vector<unsigned> ret;
+	unsigned size = steps_r.size();
+	if ( ! size )
+	  return ret;
+	if ( ! heapSize_r )
+	{
+	  ret.push_back( size );
+	  return ret;
+	}
+
+	// Index of the steps installing or erasing a solvable.
+	std::unordered_map<sat::detail::IdType,unsigned> installIdx;
+	std::unordered_map<sat::detail::IdType,unsigned> eraseIdx;
+	for ( unsigned idx = 0; idx < size; ++idx )
+	{
+	  switch ( steps_r[idx].stepType() )
+	  {
+	    case sat::Transaction::TRANSACTION_INSTALL:
+	    case sat::Transaction::TRANSACTION_MULTIINSTALL:
+	      installIdx[steps_r[idx].satSolvable().id()] = idx;
+	      break;
+	    case sat::Transaction::TRANSACTION_ERASE:
+	      eraseIdx[steps_r[idx].satSolvable().id()] = idx;
+	      break;
+	    case sat::Transaction::TRANSACTION_IGNORE:
+	      break;
+	  }
+	}
+
+	for ( unsigned begin = 0; begin < size; )
+	{
+	  unsigned end = begin;
+	  for ( ByteCount heapsize; end < size && heapsize < heapSize_r; ++end )
+	    heapsize += stepDownloadSize( steps_r[end] );
+
+	  // Extend the heap until the requirements of the new packages are met.
+	  // (end may grow while iterating)
+	  for ( unsigned idx = begin; idx < end; ++idx )
+	  {
+	    if ( ! installIdx.count( steps_r[idx].satSolvable().id() ) )
+	      continue;
+
+	    for ( const Capability & req : steps_r[idx].satSolvable().requires() )
+	    {
+	      bool satisfied = false;
+	      unsigned need = 0;	// heap end needed to satisfy req (0: not provided by the transaction)
+	      for ( const sat::Solvable & prov : sat::WhatProvides( req ) )
+	      {
+		if ( prov.isSystem() )
+		{
+		  auto it( eraseIdx.find( prov.id() ) );
+		  if ( it == eraseIdx.end() || it->second >= end )
+		  { satisfied = true; break; }
+		}
+		else
+		{
+		  auto it( installIdx.find( prov.id() ) );
+		  if ( it == installIdx.end() )
+		    continue;
+		  if ( it->second < end )
+		  { satisfied = true; break; }
+		  if ( ! need || it->second + 1 < need )
+		    need = it->second + 1;
+		}
+	      }
+	      // A requirement not provided at all (e.g. rpmlib) does not extend the heap.
+	      if ( ! satisfied && need > end )
+		end = need;
+	    }
+	  }
+	  ret.push_back( end );
+	  begin = end;
+	}
+	return ret;
+      }
+    } // namespace
+    ///////////////////////////////////////////////////////////////////
+
     ///////////////////////////////////////////////////////////////////
     //
     // COMMIT
@@ -1236,18 +1378,70 @@ namespace zypp
       if ( ! policy_r.dryRun() || policy_r.downloadMode() == DownloadOnly )
       {
 	// Prepare the package cache. Pass all items requiring download.
-        CommitPackageCache packageCache;
+	RepoProvidePackage repoProvidePackage;
+        CommitPackageCache packageCache( repoProvidePackage );
 	packageCache.setCommitList( steps.begin(), steps.end() );
 
-        bool miss = false;
-        if ( policy_r.downloadMode() != DownloadAsNeeded )
-        {
-          // Preload the cache. Until now this means pre-loading all packages.
-          // Once DownloadInHeaps is fully implemented, this will change and
-          // we may actually have more than one heap.
-          for_( it, steps.begin(), steps.end() )
-          {
-	    switch ( it->stepType() )
+	// Concurrently download the packages in advance. They are still
+	// provided (checked and reported) one after the other, but the
+	// files are then taken from the prefetcher instead of the media.
+	CommitPackagePrefetcher prefetcher( policy_r.downloadMode() != DownloadAsNeeded ? policy_r.downloadMaxParallel() : 0,
+					    ZConfig::instance().repoPackagesPath() );
+	if ( prefetcher.enabled() )
+	  repoProvidePackage.addCachePath( prefetcher.cachePath() );
+
+	// DownloadInHeaps: Only the 1st heap is provided in advance. The
+	// next heap is downloaded while the previous one is installed.
+	std::vector<unsigned> heapEnds( commitHeapEnds( steps, ( policy_r.downloadMode() == DownloadInHeaps && ! policy_r.dryRun() )
+								? policy_r.downloadHeapSize() : ByteCount() ) );
+
+	// Let the prefetcher download a heaps packages (if enabled)
+	auto prefetchHeap = [&]( unsigned heap_r )
+	{
+	  if ( ! prefetcher.enabled() || heap_r >= heapEnds.size() )
+	    return;
+	  for ( unsigned idx = ( heap_r ? heapEnds[heap_r-1] : 0 ); idx < heapEnds[heap_r]; ++idx )
+	  {
+	    const sat::Transaction::Step & step( steps[idx] );
+	    if ( step.stepType() == sat::Transaction::TRANSACTION_INSTALL
+	      || step.stepType() == sat::Transaction::TRANSACTION_MULTIINSTALL )
+	      prefetcher.enqueue( PoolItem( step ) );
+	  }
+	  MIL << prefetcher << " heap " << heap_r << endl;
+	};
+
+	// Check the signatures of a heaps prefetched packages concurrently.
+	// The results are used when the packages are provided (and the
+	// user is asked about problems) one after the other.
+	auto checkHeapSignatures = [&]( unsigned heap_r )
+	{
+	  if ( ! prefetcher.enabled() )
+	    return;
+	  std::vector<Pathname> files;
+	  for ( unsigned idx = ( heap_r ? heapEnds[heap_r-1] : 0 ); idx < heapEnds[heap_r]; ++idx )
+	  {
+	    PoolItem pi( steps[idx] );
+	    if ( ! pi.status().isToBeInstalled() || ! pi->repoInfo().pkgGpgCheck() )
+	      continue;
+	    prefetcher.waitFor( pi );
+	    Pathname file( prefetcher.prefetched( pi ) );
+	    if ( ! file.empty() )
+	      files.push_back( file );
+	  }
+	  rpm().checkPackagesSignature( files );
+	};
+
+	// Preload the cache with a heaps packages; returns whether some are missing
+	auto preloadHeap = [&]( unsigned heap_r )->bool
+	{
+	  bool miss = false;
+	  if ( heap_r >= heapEnds.size() )
+	    return miss;
+	  checkHeapSignatures( heap_r );
+	  for ( unsigned idx = ( heap_r ? heapEnds[heap_r-1] : 0 ); idx < heapEnds[heap_r]; ++idx )
+	  {
+	    sat::Transaction::Step & step( steps[idx] );
+	    switch ( step.stepType() )
 	    {
 	      case sat::Transaction::TRANSACTION_INSTALL:
 	      case sat::Transaction::TRANSACTION_MULTIINSTALL:
@@ -1260,18 +1454,20 @@ namespace zypp
 		break;
 	    }
 
-	    PoolItem pi( *it );
+	    PoolItem pi( step );
             if ( pi->isKind<Package>() || pi->isKind<SrcPackage>() )
             {
               ManagedFile localfile;
               try
               {
+		prefetcher.waitFor( pi );
 		localfile = packageCache.get( pi );
                 localfile.resetDispose(); // keep the package file in the cache
+		prefetcher.release( pi );
               }
               catch ( const AbortRequestException & exp )
               {
-		it->stepStage( sat::Transaction::STEP_ERROR );
+		step.stepStage( sat::Transaction::STEP_ERROR );
                 miss = true;
                 WAR << "commit cache preload aborted by the user" << endl;
                 ZYPP_THROW( TargetAbortedException( N_("Installation has been aborted as directed.") ) );
@@ -1280,7 +1476,7 @@ namespace zypp
               catch ( const SkipRequestException & exp )
               {
                 ZYPP_CAUGHT( exp );
-		it->stepStage( sat::Transaction::STEP_ERROR );
+		step.stepStage( sat::Transaction::STEP_ERROR );
                 miss = true;
                 WAR << "Skipping cache preload package " << pi->asKind<Package>() << " in commit" << endl;
                 continue;
@@ -1290,14 +1486,35 @@ namespace zypp
                 // bnc #395704: missing catch causes abort.
                 // TODO see if packageCache fails to handle errors correctly.
                 ZYPP_CAUGHT( exp );
-		it->stepStage( sat::Transaction::STEP_ERROR );
+		step.stepStage( sat::Transaction::STEP_ERROR );
                 miss = true;
                 INT << "Unexpected Error: Skipping cache preload package " << pi->asKind<Package>() << " in commit" << endl;
                 continue;
               }
             }
           }
-          packageCache.preloaded( true ); // try to avoid duplicate infoInCache CBs in commit
+	  return miss;
+	};
+
+	// The new packages of a heap (file conflicts check)
+	auto heapSolvables = [&]( unsigned heap_r )->sat::SolvableSet
+	{
+	  sat::SolvableSet ret;
+	  if ( heapEnds.size() > 1 )
+	  {
+	    for ( unsigned idx = ( heap_r ? heapEnds[heap_r-1] : 0 ); idx < heapEnds[heap_r]; ++idx )
+	      ret.insert( steps[idx].satSolvable() );
+	  }
+	  return ret;
+	};
+
+        bool miss = false;
+        if ( policy_r.downloadMode() != DownloadAsNeeded )
+        {
+	  prefetchHeap( 0 );
+	  prefetchHeap( 1 );
+	  miss = preloadHeap( 0 );
+	  packageCache.preloaded( true ); // try to avoid duplicate infoInCache CBs in commit
         }
 
         if ( miss )
@@ -1308,9 +1525,23 @@ namespace zypp
 	{
 	  if ( ! policy_r.dryRun() )
 	  {
+	    if ( heapEnds.size() > 1 )
+	      MIL << "Commit in " << heapEnds.size() << " heaps" << endl;
+
+	    // Provide a heap while the previous one was installed,
+	    // and download the following one while this is installed.
+	    auto prepareHeap = [&]( unsigned heap_r )->bool
+	    {
+	      if ( preloadHeap( heap_r ) )
+		return false;
+	      commitFindFileConflicts( policy_r, result, heapSolvables( heap_r ) );
+	      prefetchHeap( heap_r + 1 );
+	      return true;
+	    };
+
 	    // if cache is preloaded, check for file conflicts
-	    commitFindFileConflicts( policy_r, result );
-	    commit( policy_r, packageCache, result );
+	    commitFindFileConflicts( policy_r, result, heapSolvables( 0 ) );
+	    commit( policy_r, packageCache, result, heapEnds, prepareHeap );
 	  }
 	  else
 	  {
@@ -1358,17 +1589,270 @@ namespace zypp
 	TrueBool           _guard;
 	ZYppCommitResult & _result;
       };
+
+      ///////////////////////////////////////////////////////////////////
+      /// \class SingleRpmTransaction
+      /// \brief Commit the package steps of a heap within a single rpm transaction.
+      ///
+      /// The steps are passed to \ref rpm::RpmDb::TransactionSet in their
+      /// order. Steps committed are set to \c STEP_DONE or \c STEP_ERROR.
+      /// Steps left in \c STEP_TODO (non-packages, those the user wants to
+      /// retry, or all of them if the transaction failed) are committed one
+      /// by one as usual. Their package files are handed over to the serial
+      /// loop, so they are neither downloaded again nor kept in the cache
+      /// against \c keepPackages.
+      ///////////////////////////////////////////////////////////////////
+      class SingleRpmTransaction : private rpm::RpmDb::TransactionSet::ElementReceiver
+      {
+      public:
+	typedef ZYppCommitResult::TransactionStepList::iterator StepIterator;
+	/** The package files of steps left to the serial loop. */
+	typedef std::unordered_map<sat::Solvable,ManagedFile> PendingFiles;
+
+	SingleRpmTransaction( rpm::RpmDb & rpm_r, RpmPostTransCollector & postTransCollector_r,
+			      std::vector<sat::Solvable> & successfullyInstalledPackages_r,
+			      PendingFiles & pendingFiles_r )
+	: _rpm( rpm_r )
+	, _postTransCollector( postTransCollector_r )
+	, _successfullyInstalledPackages( successfullyInstalledPackages_r )
+	, _pendingFiles( pendingFiles_r )
+	, _collectPosttrans( true )
+	, _abort( false )
+	, _stop( false )
+	{}
+
+	/** Whether the user aborted the commit. */
+	bool aborted() const
+	{ return _abort; }
+
+	/** Commit the package steps in [\a begin_r, \a end_r).
+	 * Returns \c false if the commit must stop (aborted or an install failed).
+	 */
+	bool operator()( const ZYppCommitPolicy & policy_r, CommitPackageCache & packageCache_r,
+			 StepIterator begin_r, StepIterator end_r, NotifyAttemptToModify & attemptToModify_r )
+	{
+	  // All packages must be available before the transaction starts.
+	  for_( step, begin_r, end_r )
+	  {
+	    if ( step->stepType() == sat::Transaction::TRANSACTION_IGNORE )
+	      continue;	// obsoleted by rpm; done in the serial loop
+	    PoolItem citem( *step );
+	    if ( ! citem->isKind<Package>() )
+	      continue;
+
+	    if ( ! citem.status().isToBeInstalled() )
+	    {
+	      _elements.push_back( Element( step ) );
+	      continue;
+	    }
+
+	    ManagedFile localfile;
+	    try
+	    {
+	      localfile = packageCache_r.get( citem );
+	    }
+	    catch ( const AbortRequestException &e )
+	    {
+	      WAR << "commit aborted by the user" << endl;
+	      _abort = true;
+	      step->stepStage( sat::Transaction::STEP_ERROR );
+	      return false;
+	    }
+	    catch ( const SkipRequestException &e )
+	    {
+	      ZYPP_CAUGHT( e );
+	      WAR << "Skipping package " << citem << " in commit" << endl;
+	      step->stepStage( sat::Transaction::STEP_ERROR );
+	      continue;
+	    }
+	    catch ( const Exception &e )
+	    {
+	      ZYPP_CAUGHT( e );
+	      INT << "Unexpected Error: Skipping package " << citem << " in commit" << endl;
+	      step->stepStage( sat::Transaction::STEP_ERROR );
+	      continue;
+	    }
+
+	    // %posttrans are collected and executed after the commit, but by now
+	    // lua is left to rpm. So if there is one, rpm must run all of them.
+	    rpm::RpmHeader::constPtr hdr( rpm::RpmHeader::readPackage( localfile, rpm::RpmHeader::NOVERIFY ) );
+	    if ( hdr && hdr->tag_posttransprog() == "<lua>" )
+	      _collectPosttrans = false;
+	    _elements.push_back( Element( step, localfile ) );
+	  }
+	  if ( _elements.empty() )
+	    return true;
+
+	  // See the serial loop in TargetImpl::commit for force and nodeps.
+	  rpm::RpmInstFlags flags( policy_r.rpmInstFlags() & rpm::RPMINST_JUSTDB );
+	  flags |= rpm::RPMINST_NODEPS;
+	  flags |= rpm::RPMINST_FORCE;
+	  if ( policy_r.rpmExcludeDocs() ) flags |= rpm::RPMINST_EXCLUDEDOCS;
+	  if ( policy_r.rpmNoSignature() ) flags |= rpm::RPMINST_NOSIGNATURE;
+	  if ( _collectPosttrans )         flags |= rpm::RPMINST_NOPOSTTRANS;
+
+	  try
+	  {
+	    rpm::RpmDb::TransactionSet tset( _rpm, flags );
+	    for ( const Element & el : _elements )
+	    {
+	      Package::constPtr p( PoolItem( *el._step )->asKind<Package>() );
+	      if ( el._install )
+		tset.addInstall( el._localfile, p->multiversionInstall() ? rpm::RPMINST_NOUPGRADE : rpm::RPMINST_NONE );
+	      else
+		tset.addRemove( p );
+	    }
+
+	    MIL << "Commit " << tset.size() << " packages in a single rpm transaction" << endl;
+	    attemptToModify_r();
+	    if ( ! tset.run( *this ) )
+	      WAR << "The rpm transaction failed. Commit one by one." << endl;
+	  }
+	  catch ( const Exception & excpt_r )
+	  {
+	    ZYPP_CAUGHT( excpt_r );
+	    WAR << "The rpm transaction failed. Commit one by one." << endl;
+	  }
+
+	  // Whatever is left is committed one by one, using the files at hand.
+	  for ( Element & el : _elements )
+	  {
+	    if ( el._install && el._step->stepStage() == sat::Transaction::STEP_TODO )
+	      _pendingFiles[el._step->satSolvable()] = el._localfile;
+	  }
+	  return ! _stop;
+	}
+
+      private:
+	virtual void start( unsigned idx_r )
+	{
+	  const Element & el( _elements[idx_r] );
+	  PoolItem citem( *el._step );
+	  if ( el._install )
+	  {
+	    _installProgress.reset( new RpmInstallPackageReceiver( citem.resolvable() ) );
+	    _installProgress->connect();
+	    _installProgress->tryLevel( target::rpm::InstallResolvableReport::RPM_NODEPS_FORCE );
+	  }
+	  else
+	  {
+	    _removeProgress.reset( new RpmRemovePackageReceiver( citem.resolvable() ) );
+	    _removeProgress->connect();
+	  }
+	}
+
+	virtual bool finish( unsigned idx_r, Result result_r )
+	{
+	  Element & el( _elements[idx_r] );
+	  PoolItem citem( *el._step );
+	  bool aborted = false;
+	  bool ok = ( result_r == DONE );
+
+	  if ( result_r == RETRY )
+	  {
+	    // Left in STEP_TODO; the serial loop commits it again.
+	    MIL << "Retry after the rpm transaction: " << citem << endl;
+	    if ( el._install )
+	      _installProgress.reset();	// disconnect
+	    else
+	      _removeProgress.reset();	// disconnect
+	    return true;
+	  }
+
+	  if ( el._install )
+	  {
+	    aborted = _installProgress->aborted();
+	    _installProgress.reset();	// disconnect
+
+	    if ( ok )
+	    {
+	      if ( _collectPosttrans )
+		_postTransCollector.collectScriptFromPackage( el._localfile );
+	      HistoryLog().install( citem );
+	    }
+
+	    if ( ok && ! aborted )
+	    {
+	      citem.status().resetTransact( ResStatus::USER );
+	      _successfullyInstalledPackages.push_back( citem.satSolvable() );
+	      el._step->stepStage( sat::Transaction::STEP_DONE );
+	    }
+	    else
+	    {
+	      WAR << ( aborted ? "commit aborted by the user" : "Install failed" ) << endl;
+	      el._localfile.resetDispose(); // keep the package file in the cache
+	      el._step->stepStage( sat::Transaction::STEP_ERROR );
+	      _stop = true;
+	    }
+	  }
+	  else
+	  {
+	    aborted = _removeProgress->aborted();
+	    _removeProgress.reset();	// disconnect
+
+	    if ( ok )
+	      HistoryLog().remove( citem );
+
+	    if ( ok && ! aborted )
+	    {
+	      citem.status().resetTransact( ResStatus::USER );
+	      el._step->stepStage( sat::Transaction::STEP_DONE );
+	    }
+	    else
+	    {
+	      WAR << ( aborted ? "commit aborted by the user" : "removal failed" ) << ": " << citem << endl;
+	      el._step->stepStage( sat::Transaction::STEP_ERROR );
+	      if ( aborted )
+		_stop = true;
+	    }
+	  }
+
+	  if ( aborted )
+	    _abort = true;
+	  return ! _stop;
+	}
+
+      private:
+	struct Element
+	{
+	  Element( StepIterator step_r )
+	  : _step( step_r ), _install( false )
+	  {}
+	  Element( StepIterator step_r, const ManagedFile & localfile_r )
+	  : _step( step_r ), _install( true ), _localfile( localfile_r )
+	  {}
+
+	  StepIterator	_step;
+	  bool		_install;
+	  ManagedFile	_localfile;
+	};
+
+	rpm::RpmDb &					_rpm;
+	RpmPostTransCollector &				_postTransCollector;
+	std::vector<sat::Solvable> &			_successfullyInstalledPackages;
+	PendingFiles &					_pendingFiles;
+	std::vector<Element>				_elements;
+	bool						_collectPosttrans;	///< whether %posttrans are collected (no lua)
+	bool						_abort;
+	bool						_stop;
+	std::unique_ptr<RpmInstallPackageReceiver>	_installProgress;
+	std::unique_ptr<RpmRemovePackageReceiver>	_removeProgress;
+      };
     } // namespace
 
     void TargetImpl::commit( const ZYppCommitPolicy & policy_r,
 			     CommitPackageCache & packageCache_r,
-			     ZYppCommitResult & result_r )
+			     ZYppCommitResult & result_r,
+			     const std::vector<unsigned> & heapEnds_r,
+			     const function<bool(unsigned)> & prepareHeap_r )
     {
       // steps: this is our todo-list
       ZYppCommitResult::TransactionStepList & steps( result_r.rTransactionStepList() );
       MIL << "TargetImpl::commit(<list>" << policy_r << ")" << steps.size() << endl;
 
       HistoryLog().stampCommand();
+      // Write and sync the records at the end of each heap and when the commit stops.
+      HistoryLog::Batch historyBatch;
 
       // Send notification once upon 1st call to rpm
       NotifyAttemptToModify attemptToModify( result_r );
@@ -1379,8 +1863,59 @@ namespace zypp
       std::vector<sat::Solvable> successfullyInstalledPackages;
       TargetImpl::PoolItemList remaining;
 
+      // Commit the packages of each heap in a single rpm transaction?
+      bool singleRpmTransaction = ( policy_r.singleRpmTransaction()
+                                    && ! policy_r.dryRun()
+                                    && policy_r.downloadMode() != DownloadAsNeeded );
+      bool heapStarted = false;
+      SingleRpmTransaction::PendingFiles pendingFiles;	// package files left to the serial loop
+
+      unsigned heap = 0;	// the heap currently committed
       for_( step, steps.begin(), steps.end() )
       {
+	if ( heap + 1 < heapEnds_r.size() && unsigned(step - steps.begin()) == heapEnds_r[heap] )
+	{
+	  // End of heap: a consistent system state is reached.
+	  historyBatch.flush();
+	  ++heap;
+	  bool proceed = false;
+	  try
+	  {
+	    proceed = prepareHeap_r( heap );
+	  }
+	  catch ( const TargetAbortedException & excpt_r )
+	  {
+	    ZYPP_CAUGHT( excpt_r );
+	    WAR << "commit aborted by the user" << endl;
+	    abort = true;
+	    break;
+	  }
+	  if ( ! proceed )
+	  {
+	    ERR << "Some packages of heap " << heap << " could not be provided. Stop commit." << endl;
+	    break;
+	  }
+	  MIL << "Commit heap " << heap << " (" << heapEnds_r[heap-1] << "-" << heapEnds_r[heap] << ")" << endl;
+	  heapStarted = false;
+	}
+
+	if ( singleRpmTransaction )
+	{
+	  if ( ! heapStarted )
+	  {
+	    heapStarted = true;
+	    ZYppCommitResult::TransactionStepList::iterator heapEnd( heap < heapEnds_r.size() ? steps.begin() + heapEnds_r[heap] : steps.end() );
+	    SingleRpmTransaction singleTransaction( rpm(), postTransCollector, successfullyInstalledPackages, pendingFiles );
+	    bool proceed = singleTransaction( policy_r, packageCache_r, step, heapEnd, attemptToModify );
+	    if ( singleTransaction.aborted() )
+	      abort = true;
+	    if ( ! proceed )
+	      break;
+	  }
+	  if ( step->stepStage() != sat::Transaction::STEP_TODO )
+	    continue;	// done in the single rpm transaction
+	}
+
 	PoolItem citem( *step );
 	if ( step->stepType() == sat::Transaction::TRANSACTION_IGNORE )
 	{
@@ -1401,7 +1936,14 @@ namespace zypp
             ManagedFile localfile;
             try
             {
-	      localfile = packageCache_r.get( citem );
+	      auto pending( pendingFiles.find( citem.satSolvable() ) );
+	      if ( pending != pendingFiles.end() )
+	      {
+		localfile = pending->second;	// left by the single rpm transaction
+		pendingFiles.erase( pending );
+	      }
+	      else
+		localfile = packageCache_r.get( citem );
             }
             catch ( const AbortRequestException &e )
             {
@@ -1600,6 +2142,7 @@ namespace zypp
         }  // other resolvables
 
       } // for
+      historyBatch.flush();	// commit done or stopped
 
       // process all remembered posttrans scripts. If aborting,
       // at least log omitted scripts.
@@ -18,14 +18,21 @@ extern "C"
 #include <solv/repo_rpmdb.h>
 #include <solv/pool_fileconflicts.h>
 }
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <unordered_map>
 #include <unordered_set>
 #include <string>
+#include <vector>
+#include <thread>
+#include <system_error>
 
 #include "zypp/base/LogTools.h"
 #include "zypp/base/Gettext.h"
 #include "zypp/base/Exception.h"
 #include "zypp/base/UserRequestException.h"
+#include "zypp/base/ForkedWorkers_p.h"
 
 #include "zypp/sat/Queue.h"
 #include "zypp/sat/FileConflicts.h"
@@ -33,8 +40,10 @@ extern "C"
 
 #include "zypp/target/TargetImpl.h"
 #include "zypp/target/CommitPackageCache.h"
+#include "zypp/target/rpm/librpmDb.h"
 
 #include "zypp/ZYppCallbacks.h"
+#include "zypp/ByteCount.h"
 
 using std::endl;
 
@@ -47,11 +56,159 @@ namespace zypp
     ///////////////////////////////////////////////////////////////////
     namespace
     {
+      /** Memory budget for the rpm headers read in advance. */
+      const std::string::size_type headerPrefetchBudget = 256 * 1024 * 1024;
+
+      inline unsigned getu32( const unsigned char * dp_r )
+      { return dp_r[0] << 24 | dp_r[1] << 16 | dp_r[2] << 8 | dp_r[3]; }
+
+      /** Read the leading part of an rpm file up to the end of the header (lead, signature and header).
+       * This is what libsolvs \c rpm_byfp reads. Returns an empty string on error.
+       */
+      std::string readRpmHeaderData( const Pathname & file_r )
+      {
+	std::string ret;
+	AutoDispose<FILE*> fp( ::fopen( file_r.c_str(), "re" ), ::fclose );
+	if ( ! fp )
+	  return ret;
+
+	// lead and signature header intro
+	unsigned char intro[96 + 16];
+	if ( ::fread( intro, sizeof(intro), 1, fp ) != 1 || getu32( intro ) != 0xedabeedb || getu32( intro + 96 ) != 0x8eade801 )
+	  return ret;
+	unsigned il = getu32( intro + 96 + 8 );
+	unsigned dl = getu32( intro + 96 + 12 );
+	if ( il >= 0x10000 || dl >= 0x10000000 )
+	  return ret;
+	std::string::size_type size = sizeof(intro) + ( ( il * 16 + dl + 7 ) & ~7 );
+
+	// header intro
+	ret.resize( size + 16 );
+	::memcpy( &ret[0], intro, sizeof(intro) );
+	if ( ::fread( &ret[sizeof(intro)], size + 16 - sizeof(intro), 1, fp ) != 1
+	  || getu32( (const unsigned char *)&ret[size] ) != 0x8eade801 )
+	  return std::string();
+	il = getu32( (const unsigned char *)&ret[size + 8] );
+	dl = getu32( (const unsigned char *)&ret[size + 12] );
+	if ( il >= 0x100000 || dl >= 0x10000000 )
+	  return std::string();
+
+	// header
+	std::string::size_type hsize = il * 16 + dl;
+	size += 16;
+	ret.resize( size + hsize );
+	if ( hsize && ::fread( &ret[size], hsize, 1, fp ) != 1 )
+	  return std::string();
+	return ret;
+      }
+
+      ///////////////////////////////////////////////////////////////////
+      /// \class HeaderPrefetch
+      /// \brief The rpm headers of the packages to check, read and parsed in advance.
+      ///
+      /// The files are read and parsed (\c rpm_byfp) concurrently by worker
+      /// threads, each using an \c rpm_state of its own per header and a
+      /// private pool (just used for error messages). The parsed headers are
+      /// kept (up to \ref headerPrefetchBudget), so the callbacks repeated
+      /// visits don't need to open or parse the rpm files again.
+      ///////////////////////////////////////////////////////////////////
+      class HeaderPrefetch : private base::NonCopyable
+      {
+      public:
+	typedef std::vector<std::pair<sat::detail::IdType,Pathname>> FileList;
+
+	HeaderPrefetch()
+	{}
+
+	/** Read and parse the headers of \a files_r using up to \a maxParallel_r threads. */
+	void prefetch( const FileList & files_r, unsigned maxParallel_r )
+	{
+	  if ( files_r.size() < 2 || maxParallel_r < 2 )
+	    return;	// nothing to gain
+	  if ( maxParallel_r > files_r.size() )
+	    maxParallel_r = files_r.size();
+
+	  typedef std::vector<std::pair<sat::detail::IdType,Head>> Result;
+	  std::vector<Result> results( maxParallel_r );
+	  std::vector<std::string::size_type> totals( maxParallel_r, 0 );
+	  std::vector<std::thread> workers;
+	  for ( unsigned worker = 0; worker < maxParallel_r; ++worker )
+	  {
+	    _pools.push_back( AutoDispose<sat::detail::CPool*>( ::pool_create(), ::pool_free ) );
+	    sat::detail::CPool * pool = _pools.back();
+	    try
+	    {
+	      workers.push_back( std::thread( [&files_r,&results,&totals,pool,worker,maxParallel_r]() {
+		// n-th worker reads every n-th file; each fits into the budget share
+		std::string::size_type budget = headerPrefetchBudget / maxParallel_r;
+		for ( unsigned idx = worker; idx < files_r.size() && budget; idx += maxParallel_r )
+		{
+		  std::string data( readRpmHeaderData( files_r[idx].second ) );
+		  if ( data.empty() || data.size() > budget )
+		    continue;
+		  AutoDispose<FILE*> fp( ::fmemopen( &data[0], data.size(), "r" ), ::fclose );
+		  if ( ! fp )
+		    continue;
+		  Head head( pool );
+		  head._head = ::rpm_byfp( head._state, fp, files_r[idx].second.c_str() );
+		  if ( ! head._head )
+		    continue;
+		  budget -= data.size();
+		  totals[worker] += data.size();
+		  results[worker].push_back( std::make_pair( files_r[idx].first, head ) );
+		}
+	      } ) );
+	    }
+	    catch ( const std::system_error & excpt_r )
+	    {
+	      WAR << "Can't start header prefetch thread: " << excpt_r.what() << endl;
+	      break;	// files of missing workers are read by the callback
+	    }
+	  }
+
+	  std::string::size_type total = 0;
+	  for ( unsigned worker = 0; worker < workers.size(); ++worker )
+	  {
+	    workers[worker].join();
+	    for ( const auto & res : results[worker] )
+	      _headers.insert( res );
+	    total += totals[worker];
+	  }
+	  MIL << "Prefetched " << _headers.size() << " of " << files_r.size() << " rpm headers (" << ByteCount( total ) << ")" << endl;
+	}
+
+	/** The parsed header of \a id_r or \c nullptr if not prefetched. */
+	void * find( sat::detail::IdType id_r ) const
+	{
+	  std::unordered_map<sat::detail::IdType,Head>::const_iterator it( _headers.find( id_r ) );
+	  return( it == _headers.end() ? nullptr : it->second._head );
+	}
+
+      private:
+	/** A parsed header; \c rpm_byfp returns a buffer owned by the \c rpm_state. */
+	struct Head
+	{
+	  Head( sat::detail::CPool * pool_r )
+	  : _state( ::rpm_state_create( pool_r, ::pool_get_rootdir( pool_r ) ), ::rpm_state_free )
+	  , _head( nullptr )
+	  {}
+	  AutoDispose<void*> _state;
+	  void * _head;
+	};
+
+      private:
+	std::vector<AutoDispose<sat::detail::CPool*>> _pools;	///< must outlive the headers
+	std::unordered_map<sat::detail::IdType,Head> _headers;
+      };
+
       /** libsolv::pool_findfileconflicts callback providing package header. */
       struct FileConflictsCB
       {
-	FileConflictsCB( sat::detail::CPool * pool_r, ProgressData & progress_r )
+	FileConflictsCB( sat::detail::CPool * pool_r, ProgressData & progress_r, const HeaderPrefetch & headers_r,
+			 const sat::SolvableSet & pending_r = sat::SolvableSet() )
 	: _progress( progress_r )
+	, _headers( headers_r )
+	, _pending( pending_r )
 	, _state( ::rpm_state_create( pool_r, ::pool_get_rootdir(pool_r) ), ::rpm_state_free )
 	{}
 
@@ -65,7 +222,8 @@ namespace zypp
 	  {
 	    //DBG << "FCCB: " << sat::Solvable( id_r ) << " " << ret << endl;
 	    _visited.insert( id_r );
-	    if ( ! ret && sat::Solvable( id_r ).isKind<Package>() )	// only packages have filelists
+	    // only packages have filelists; those of later heaps are not yet downloaded
+	    if ( ! ret && sat::Solvable( id_r ).isKind<Package>() && ! _pending.contains( sat::Solvable( id_r ) ) )
 	      _noFilelist.push( id_r );
 	    _progress.incr();
 	  }
@@ -103,14 +261,30 @@ namespace zypp
 	      return nullptr;
 	    Pathname localfile( pkg->cachedLocation() );
 	    if ( localfile.empty() )
-	      return nullptr;
+	      return lookupInstalled( pkg );
+	    if ( void * head = _headers.find( id_r ) )
+	      return head;
 	    AutoDispose<FILE*> fp( ::fopen( localfile.c_str(), "re" ), ::fclose );
 	    return ::rpm_byfp( _state, fp, localfile.c_str() );
 	  }
 	}
 
+	/** A package installed in a previous heap (DownloadInHeaps) is in the rpmdb but not yet in @System. */
+	void * lookupInstalled( const Package::constPtr & pkg_r )
+	{
+	  rpm::librpmDb::db_const_iterator it;
+	  for ( it.findByName( pkg_r->name() ); *it; ++it )
+	  {
+	    if ( (*it)->tag_edition() == pkg_r->edition() && (*it)->tag_arch() == pkg_r->arch() )
+	      return ::rpm_byrpmdbid( _state, it.dbHdrNum() );
+	  }
+	  return nullptr;
+	}
+
       private:
 	ProgressData & _progress;
+	const HeaderPrefetch & _headers;
+	const sat::SolvableSet & _pending;	///< new packages of later heaps
 	AutoDispose<void*> _state;
 	std::unordered_set<sat::detail::IdType> _visited;
 	sat::Queue _noFilelist;
@@ -119,11 +293,45 @@ namespace zypp
     } // namespace
     ///////////////////////////////////////////////////////////////////
 
-    void TargetImpl::commitFindFileConflicts( const ZYppCommitPolicy & policy_r, ZYppCommitResult & result_r )
+    void TargetImpl::commitFindFileConflicts( const ZYppCommitPolicy & policy_r, ZYppCommitResult & result_r, const sat::SolvableSet & heap_r )
     {
       sat::Queue todo;
       sat::FileConflicts conflicts;
+      sat::SolvableSet pending;	// new packages of later heaps
       int newpkgs = result_r.transaction().installedResult( todo );
+      if ( ! heap_r.empty() )
+      {
+	// Check the new packages of this heap against the end state of the
+	// whole transaction: the new packages of all heaps plus the installed
+	// ones no heap erases or replaces. Only conflicts involving a package
+	// of this heap are reported; those of the other heaps are reported
+	// when their heap is committed. Packages of later heaps are checked
+	// by their filelist if it is available, as they are not downloaded yet.
+	sat::Queue newtodo;
+	sat::Queue othertodo;
+	for ( unsigned i = 0; i < todo.size(); ++i )
+	{
+	  sat::Solvable solv( todo[i] );
+	  if ( i < unsigned(newpkgs) && heap_r.contains( solv ) )
+	    newtodo.push( todo[i] );
+	  else
+	  {
+	    othertodo.push( todo[i] );
+	    if ( i < unsigned(newpkgs) )
+	    {
+	      sat::Transaction::const_iterator step( result_r.transaction().find( solv ) );
+	      if ( step == result_r.transaction().end() || step->stepStage() != sat::Transaction::STEP_DONE )
+		pending.insert( solv );
+	    }
+	  }
+	}
+	newpkgs = newtodo.size();
+	todo.clear();
+	for ( sat::Queue::value_type id : newtodo )
+	  todo.push( id );
+	for ( sat::Queue::value_type id : othertodo )
+	  todo.push( id );
+      }
       MIL << "Checking for file conflicts in " << newpkgs << " new packages..." << endl;
       if ( ! newpkgs )
 	return;
@@ -134,7 +342,23 @@ namespace zypp
 	if ( ! report->start( progress ) )
 	  ZYPP_THROW( AbortRequestException() );
 
-	FileConflictsCB cb( sat::Pool::instance().get(), progress );
+	// Read and parse the headers of the new packages concurrently; they are visited repeatedly.
+	HeaderPrefetch headers;
+	{
+	  HeaderPrefetch::FileList files;
+	  for ( int i = 0; i < newpkgs; ++i )
+	  {
+	    Package::Ptr pkg( make<Package>( sat::Solvable( todo[i] ) ) );
+	    if ( ! pkg )
+	      continue;
+	    Pathname localfile( pkg->cachedLocation() );
+	    if ( ! localfile.empty() )
+	      files.push_back( std::make_pair( todo[i], localfile ) );
+	  }
+	  headers.prefetch( files, ForkedWorkers::onlineCPUs() );
+	}
+
+	FileConflictsCB cb( sat::Pool::instance().get(), progress, headers, pending );
 	// lambda receives progress trigger and translates into report
 	auto sendProgress = [&]( const ProgressData & progress_r )->bool {
 	  if ( ! report->progress( progress_r, cb.noFilelist() ) )
@@ -14,10 +14,12 @@
 
 #include <iosfwd>
 #include <set>
+#include <vector>
 
 #include "zypp/base/ReferenceCounted.h"
 #include "zypp/base/NonCopyable.h"
 #include "zypp/base/PtrTypes.h"
+#include "zypp/base/Function.h"
 #include "zypp/PoolItem.h"
 #include "zypp/ZYppCommit.h"
 
@@ -30,6 +32,7 @@
 #include "zypp/target/SolvIdentFile.h"
 #include "zypp/target/HardLocksFile.h"
 #include "zypp/ManagedFile.h"
+#include "zypp/sat/SolvableSet.h"
 
 ///////////////////////////////////////////////////////////////////
 namespace zypp
@@ -110,6 +113,16 @@ namespace zypp
       bool buildCache();
       //@}
 
+    private:
+      /** In-process \c rpmdb2solv: write the @System solv-file to \a tmpfile_r and move it to \a solvfile_r.
+       * Like \c rpmdb2solv, the whole rpm database is walked, but the data of packages
+       * also in \a oldSolvFile_r (if not empty) are taken from there. Compared to running
+       * \c rpmdb2solv this saves the fork/exec, and the \c solv.idx is written from the repo
+       * still in memory instead of reading the new solv-file again.
+       * \throws Exception if the rpm database can't be read or the solv-file can't be written.
+       */
+      void buildSystemSolv( const Pathname & solvfile_r, const Pathname & tmpfile_r, const Pathname & oldSolvFile_r ) const;
+
     public:
 
       /** The root set for this target */
@@ -201,13 +214,23 @@ namespace zypp
       static std::string anonymousUniqueId( const Pathname & root_r );
 
     private:
-      /** Commit ordered changes (internal helper) */
+      /** Commit ordered changes (internal helper)
+       * If the steps are split into heaps (\ref DownloadInHeaps), \a heapEnds_r
+       * holds the end index of each heap. \a prepareHeap_r is called with the
+       * heaps index before the steps of each but the 1st heap are committed.
+       * If it returns \c false, the commit stops.
+       */
       void commit( const ZYppCommitPolicy & policy_r,
 		   CommitPackageCache & packageCache_r,
-		   ZYppCommitResult & result_r );
+		   ZYppCommitResult & result_r,
+		   const std::vector<unsigned> & heapEnds_r,
+		   const function<bool(unsigned)> & prepareHeap_r );
 
-      /** Commit helper checking for file conflicts after download. */
-      void commitFindFileConflicts( const ZYppCommitPolicy & policy_r, ZYppCommitResult & result_r );
+      /** Commit helper checking for file conflicts after download.
+       * If a \a heap_r is passed (\ref DownloadInHeaps), just its new packages are checked.
+       */
+      void commitFindFileConflicts( const ZYppCommitPolicy & policy_r, ZYppCommitResult & result_r,
+				    const sat::SolvableSet & heap_r = sat::SolvableSet() );
     protected:
       /** Path to the target */
       Pathname _root;
@@ -28,11 +28,13 @@ extern "C"
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <memory>
 
 #include "zypp/base/Logger.h"
 #include "zypp/base/String.h"
 #include "zypp/base/Gettext.h"
 #include "zypp/base/LocaleGuard.h"
+#include "zypp/base/ForkedWorkers_p.h"
 
 #include "zypp/Date.h"
 #include "zypp/Pathname.h"
@@ -71,6 +73,24 @@ namespace rpm
 {
 namespace
 {
+  /** Signature check result remembered by \ref RpmDb::checkPackagesSignature. */
+  struct PrecheckedSignature
+  {
+    std::string                 _fileId;	///< identifies the unchanged file (device, inode, size, mtime)
+    RpmDb::CheckPackageResult   _result;	///< as returned by \ref RpmDb::checkPackageSignature
+    RpmDb::CheckPackageDetail   _detail;
+  };
+  typedef std::map<Pathname,PrecheckedSignature> PrecheckedSignatures;
+
+  /** The remembered results of each RpmDb (kept aside, not to change the RpmDb layout). */
+  std::map<const RpmDb *,PrecheckedSignatures> _precheckedSignaturesOf;
+
+  inline PrecheckedSignatures & precheckedSignatures( const RpmDb * rpmdb_r )
+  { return _precheckedSignaturesOf[rpmdb_r]; }
+
+  inline void clearPrecheckedSignatures( const RpmDb * rpmdb_r )
+  { _precheckedSignaturesOf.erase( rpmdb_r ); }
+
 #if 1 // No more need to escape whitespace since rpm-4.4.2.3
 const char* quoteInFilename_m = "\'\"";
 #else
@@ -252,6 +272,7 @@ RpmDb::RpmDb()
 RpmDb::~RpmDb()
 {
   MIL << "~RpmDb()" << endl;
+  clearPrecheckedSignatures( this );
   closeDatabase();
   delete process;
   MIL  << "~RpmDb() end" << endl;
@@ -1047,6 +1068,7 @@ void RpmDb::exportTrustedKeysInZyppKeyRing()
 void RpmDb::importPubkey( const PublicKey & pubkey_r )
 {
   FAILIFNOTINITIALIZED;
+  clearPrecheckedSignatures( this );	// results may change
 
   // bnc#828672: On the fly key import in READONLY
   if ( zypp_readonly_hack::IGotIt() )
@@ -1165,6 +1187,7 @@ void RpmDb::importPubkey( const PublicKey & pubkey_r )
 void RpmDb::removePubkey( const PublicKey & pubkey_r )
 {
   FAILIFNOTINITIALIZED;
+  clearPrecheckedSignatures( this );	// results may change
 
   // check if the key is in the rpm database and just
   // return if it does not.
@@ -1617,13 +1640,129 @@ namespace
 //	METHOD TYPE : RpmDb::CheckPackageResult
 //
 RpmDb::CheckPackageResult RpmDb::checkPackage( const Pathname & path_r, CheckPackageDetail & detail_r )
-{ return doCheckPackageSig( path_r, root(), false/*requireGPGSig_r*/, detail_r ); }
+{
+  CheckPackageResult ret;
+  if ( takePrecheckedSignature( path_r, ret, detail_r ) )
+    return( ret == CHK_NOSIG ? CHK_OK : ret );	// legacy: unsigned is OK
+  return doCheckPackageSig( path_r, root(), false/*requireGPGSig_r*/, detail_r );
+}
 
 RpmDb::CheckPackageResult RpmDb::checkPackage( const Pathname & path_r )
 { CheckPackageDetail dummy; return checkPackage( path_r, dummy ); }
 
 RpmDb::CheckPackageResult RpmDb::checkPackageSignature( const Pathname & path_r, RpmDb::CheckPackageDetail & detail_r )
-{ return doCheckPackageSig( path_r, root(), true/*requireGPGSig_r*/, detail_r ); }
+{
+  CheckPackageResult ret;
+  if ( takePrecheckedSignature( path_r, ret, detail_r ) )
+    return ret;
+  return doCheckPackageSig( path_r, root(), true/*requireGPGSig_r*/, detail_r );
+}
+
+namespace
+{
+  /** Identify an unchanged file by device, inode, size and mtime. */
+  inline std::string precheckedFileId( const PathInfo & file_r )
+  {
+    return str::form( "%llu:%llu:%llu:%lld",
+		      (unsigned long long)file_r.dev(), (unsigned long long)file_r.ino(),
+		      (unsigned long long)file_r.size(), (long long)file_r.mtime() );
+  }
+
+  /** Pass a check result from the worker to the calling process. */
+  bool writeCheckResult( const Pathname & file_r, RpmDb::CheckPackageResult result_r, const RpmDb::CheckPackageDetail & detail_r )
+  {
+    std::ofstream out( file_r.c_str() );
+    out << int(result_r) << '\n';
+    for ( const auto & el : detail_r )
+      out << int(el.first) << ' ' << el.second.size() << '\n' << el.second << '\n';
+    out.close();
+    return ! out.fail();
+  }
+
+  /** Read the check result written by \ref writeCheckResult. */
+  bool readCheckResult( const Pathname & file_r, RpmDb::CheckPackageResult & result_r, RpmDb::CheckPackageDetail & detail_r )
+  {
+    std::ifstream in( file_r.c_str() );
+    int res = 0;
+    if ( ! ( in >> res ) )
+      return false;
+
+    int lineres = 0;
+    std::string::size_type len = 0;
+    while ( in >> lineres >> len )
+    {
+      in.get();	// '\n'
+      std::string line( len, '\0' );
+      if ( len && ! in.read( &line[0], len ) )
+	return false;
+      in.get();	// '\n'
+      detail_r.push_back( RpmDb::CheckPackageDetail::value_type( RpmDb::CheckPackageResult(lineres), std::move(line) ) );
+    }
+    result_r = RpmDb::CheckPackageResult(res);
+    return true;
+  }
+} // namespace
+
+void RpmDb::checkPackagesSignature( const std::vector<Pathname> & files_r, unsigned maxParallel_r )
+{
+  if ( ! maxParallel_r )
+    maxParallel_r = ForkedWorkers::onlineCPUs();
+  if ( files_r.size() < 2 || maxParallel_r < 2 )
+    return;	// nothing to gain
+
+  MIL << "Checking " << files_r.size() << " package signatures (" << maxParallel_r << " parallel)" << endl;
+  filesystem::TmpDir resultDir;
+  const Pathname & root( this->root() );
+  unsigned checked = 0;
+  {
+    ForkedWorkers workers( maxParallel_r );
+    for ( unsigned idx = 0; idx < files_r.size(); ++idx )
+    {
+      const Pathname & file( files_r[idx] );
+      PathInfo fileInfo( file );
+      if ( ! fileInfo.isFile() )
+	continue;
+
+      std::string fileId( precheckedFileId( fileInfo ) );
+      Pathname resultFile( resultDir.path() / str::numstring( idx ) );
+      workers.start( [&file,&root,&resultFile]() {
+		       RpmDb::CheckPackageDetail detail;
+		       RpmDb::CheckPackageResult res = doCheckPackageSig( file, root, true/*requireGPGSig_r*/, detail );
+		       return writeCheckResult( resultFile, res, detail ) ? 0 : 1;
+		     },
+		     [this,file,fileId,resultFile,&checked]( int exitcode_r ) {
+		       PrecheckedSignature entry;
+		       if ( exitcode_r == 0 && readCheckResult( resultFile, entry._result, entry._detail ) )
+		       {
+			 entry._fileId = fileId;
+			 precheckedSignatures( this )[file] = std::move( entry );
+			 ++checked;
+		       }
+		       filesystem::unlink( resultFile );
+		     } );
+    }
+    workers.waitAll();
+  }
+  MIL << "Checked " << checked << " package signatures in advance" << endl;
+}
+
+bool RpmDb::takePrecheckedSignature( const Pathname & path_r, CheckPackageResult & result_r, CheckPackageDetail & detail_r )
+{
+  PrecheckedSignatures & prechecked( precheckedSignatures( this ) );
+  PrecheckedSignatures::iterator it( prechecked.find( path_r ) );
+  if ( it == prechecked.end() )
+    return false;
+
+  PrecheckedSignature entry( std::move( it->second ) );
+  prechecked.erase( it );	// once: a retry must check again
+  if ( entry._fileId != precheckedFileId( PathInfo( path_r ) ) )
+    return false;
+
+  result_r = entry._result;
+  detail_r.insert( detail_r.end(), entry._detail.begin(), entry._detail.end() );
+  DBG << path_r << " checked in advance: " << result_r << endl;
+  return true;
+}
 
 
 // determine changed files of installed package
@@ -2253,6 +2392,639 @@ void RpmDb::doRemovePackage( const std::string & name_r, RpmInstFlags flags, cal
   }
 }
 
+///////////////////////////////////////////////////////////////////
+//
+//	CLASS NAME : RpmDb::TransactionSet::Impl
+//
+///////////////////////////////////////////////////////////////////
+class RpmDb::TransactionSet::Impl : private base::NonCopyable
+{
+public:
+  /** An element of the transaction set. */
+  struct Element
+  {
+    Element( bool install_r, const std::string & name_r, const Pathname & filename_r = Pathname() )
+    : _install( install_r ), _name( name_r ), _filename( filename_r )
+    , _pending( 0 ), _started( false ), _finished( false ), _failed( false )
+    {}
+
+    bool	_install;
+    std::string	_name;		///< the name used in reports and history
+    Pathname	_filename;	///< the rpm file to install
+    unsigned	_pending;	///< rpm transaction elements not yet done (remove --allmatches)
+    bool	_started;
+    bool	_finished;
+    bool	_failed;
+    std::string	_error;		///< failure reported by rpm
+  };
+
+public:
+  Impl( RpmDb & rpmdb_r, RpmInstFlags flags_r )
+  : _rpmdb( rpmdb_r )
+  , _flags( flags_r )
+  , _ts( nullptr )
+  , _fd( nullptr )
+  , _receiver( nullptr )
+  , _current( -1 )
+  , _stop( false )
+  , _rpmlog( nullptr )
+  , _scriptOffset( 0 )
+  {
+    if ( ! _rpmdb.initialized() )
+      ZYPP_THROW(RpmDbNotOpenException());
+
+    librpmDb::globalInit();
+    librpmDb::dbRelease( true );	// we need exclusive write access
+
+    ::addMacro( NULL, "_dbpath", NULL, _rpmdb.dbPath().c_str(), RMIL_CMDLINE );
+    _ts = ::rpmtsCreate();
+    ::rpmtsSetRootDir( _ts, _rpmdb.root().c_str() );
+
+    unsigned vsflag = RPMVSF_DEFAULT;
+    if ( _flags & RPMINST_NODIGEST )
+      vsflag |= _RPMVSF_NODIGESTS;
+    if ( _flags & RPMINST_NOSIGNATURE )
+      vsflag |= _RPMVSF_NOSIGNATURES;
+    ::rpmtsSetVSFlags( _ts, rpmVSFlags(vsflag) );
+
+    if ( ::rpmtsOpenDB( _ts, ( _flags & RPMINST_TEST ) ? O_RDONLY : O_RDWR ) != 0 )
+    {
+      ERR << "Can't open rpmdb for writing: " << _rpmdb.root() << _rpmdb.dbPath() << endl;
+      ::rpmtsFree( _ts );
+      _ts = nullptr;
+      ZYPP_THROW(RpmDbOpenException( _rpmdb.root(), _rpmdb.dbPath() ));
+    }
+  }
+
+  ~Impl()
+  {
+    if ( _fd )
+      ::Fclose( _fd );
+    if ( _ts )
+      ::rpmtsFree( _ts );
+  }
+
+public:
+  unsigned addInstall( const Pathname & filename_r, RpmInstFlags flags_r )
+  {
+    Pathname filename( workaroundRpmPwdBug( filename_r ) );
+    FD_t fd = ::Fopen( filename.c_str(), "r.ufdio" );
+    if ( fd == 0 || ::Ferror( fd ) )
+    {
+      if ( fd )
+	::Fclose( fd );
+      ZYPP_THROW(RpmException( str::form( "Can't open %s for reading", filename.c_str() ) ));
+    }
+
+    Header h = 0;
+    int res = ::rpmReadPackageFile( _ts, fd, filename.c_str(), &h );
+    ::Fclose( fd );
+    if ( ! h )
+      ZYPP_THROW(RpmException( str::form( "Error reading header from %s (%d)", filename.c_str(), res ) ));
+
+    unsigned idx = _elements.size();
+    res = ::rpmtsAddInstallElement( _ts, h, fnpyKey( uintptr_t( idx + 1 ) ), ( flags_r & RPMINST_NOUPGRADE ) ? 0 : 1, NULL );
+    ::headerFree( h );
+    if ( res != 0 )
+      ZYPP_THROW(RpmException( str::form( "Can't add %s to the transaction (%d)", filename.c_str(), res ) ));
+
+    _elements.push_back( Element( true, filename_r.basename(), filename ) );
+    _elements.back()._pending = 1;
+    return idx;
+  }
+
+  unsigned addRemove( const std::string & name_r )
+  {
+    unsigned idx = _elements.size();
+    unsigned pending = 0;
+
+    rpmdbMatchIterator mi = ::rpmtsInitIterator( _ts, RPMDBI_LABEL, name_r.c_str(), 0 );
+    while ( Header h = ::rpmdbNextIterator( mi ) )
+    {
+      unsigned offset = ::rpmdbGetIteratorOffset( mi );
+      if ( erasing( offset ) )
+      {
+	// updated or obsoleted by an install element; rpm erases it anyway
+	MIL << "RpmDb::TransactionSet " << name_r << " is already erased by the set" << endl;
+	_eraseIdx[offset] = idx;
+	++pending;
+      }
+      else if ( ::rpmtsAddEraseElement( _ts, h, offset ) == 0 )
+      {
+	_eraseIdx[offset] = idx;
+	++pending;
+      }
+    }
+    ::rpmdbFreeIterator( mi );
+    if ( ! pending )
+      ZYPP_THROW(RpmException( str::form( "Can't add %s to the transaction (not installed)", name_r.c_str() ) ));
+
+    _elements.push_back( Element( false, name_r ) );
+    _elements.back()._pending = pending;
+    return idx;
+  }
+
+  unsigned size() const
+  { return _elements.size(); }
+
+  /** Whether the set already erases the installed package at rpmdb \a offset_r.
+   * rpm adds erase elements for the packages an install element updates or
+   * obsoletes. (Adding an install element after an explicit erase of the
+   * same package is deduplicated by rpm itself.)
+   */
+  bool erasing( unsigned offset_r ) const
+  {
+    bool ret = false;
+    rpmtsi pi = ::rpmtsiInit( _ts );
+    while ( rpmte te = ::rpmtsiNext( pi, TR_REMOVED ) )
+    {
+      if ( unsigned(::rpmteDBOffset( te )) == offset_r )
+      {
+	ret = true;
+	break;
+      }
+    }
+    ::rpmtsiFree( pi );
+    return ret;
+  }
+
+  bool run( ElementReceiver & receiver_r )
+  {
+    if ( _elements.empty() )
+      return true;
+
+    // backup
+    if ( _rpmdb._packagebackups )
+    {
+      for ( const Element & el : _elements )
+      {
+	if ( ! ( el._install ? _rpmdb.backupPackage( el._filename ) : _rpmdb.backupPackage( el._name ) ) )
+	  ERR << "backup of " << el._name << " failed" << endl;
+      }
+    }
+
+    unsigned tflags = RPMTRANS_FLAG_NONE;
+    if ( _flags & RPMINST_TEST )
+      tflags |= RPMTRANS_FLAG_TEST;
+    if ( _flags & RPMINST_JUSTDB )
+      tflags |= RPMTRANS_FLAG_JUSTDB;
+    if ( _flags & RPMINST_NOSCRIPTS )
+      tflags |= RPMTRANS_FLAG_NOSCRIPTS;
+    if ( _flags & RPMINST_EXCLUDEDOCS )
+      tflags |= RPMTRANS_FLAG_NODOCS;
+    if ( _flags & RPMINST_NOPOSTTRANS )
+      tflags |= RPMTRANS_FLAG_NOPOSTTRANS;
+    ::rpmtsSetFlags( _ts, rpmtransFlags(tflags) );
+
+    unsigned probFilter = RPMPROB_FILTER_NONE;
+    if ( _flags & RPMINST_FORCE )
+      probFilter |= RPMPROB_FILTER_REPLACEPKG | RPMPROB_FILTER_REPLACEOLDFILES | RPMPROB_FILTER_REPLACENEWFILES | RPMPROB_FILTER_OLDPACKAGE;
+    if ( _flags & RPMINST_IGNORESIZE )
+      probFilter |= RPMPROB_FILTER_DISKSPACE | RPMPROB_FILTER_DISKNODES;
+    // ZConfig defines cross-arch installation
+    if ( ! ZConfig::instance().systemArchitecture().compatibleWith( ZConfig::instance().defaultSystemArchitecture() ) )
+      probFilter |= RPMPROB_FILTER_IGNOREARCH;
+
+    // %script output is collected in a file and assigned to the current element.
+    filesystem::TmpFile scriptOut;
+    _scriptOut = scriptOut.path();
+    _scriptOffset = 0;
+    FD_t scriptFd = ::Fopen( _scriptOut.c_str(), "w.ufdio" );
+    if ( scriptFd && ! ::Ferror( scriptFd ) )
+      ::rpmtsSetScriptFd( _ts, scriptFd );
+
+    RpmlogCapture rpmlog;
+    _rpmlog = &rpmlog;
+    _receiver = &receiver_r;
+
+    MIL << "RpmDb::TransactionSet::run(" << _elements.size() << " elements," << _flags << ")" << endl;
+    _rpmdb.modifyDatabase(); // BEFORE rpmtsRun
+    ::rpmtsSetNotifyCallback( _ts, notifyCB, this );
+    int res = ::rpmtsRun( _ts, NULL, rpmprobFilterFlags(probFilter) );
+    ::rpmtsSetNotifyCallback( _ts, NULL, NULL );
+    MIL << "RpmDb::TransactionSet::run returned " << res << endl;
+
+    if ( _current >= 0 )	// rpm stopped within an element
+      finishElement( _current );
+
+    bool processed = false;
+    for ( const Element & el : _elements )
+    {
+      if ( el._started )
+      {
+	processed = true;
+	break;
+      }
+    }
+
+    if ( res != 0 )
+      logProblems();
+
+    if ( processed || res == 0 )
+    {
+      // Elements rpm did not tell us about: OK if the transaction succeeded.
+      for ( unsigned idx = 0; idx < _elements.size() && ! _stop; ++idx )
+      {
+	if ( _elements[idx]._started )
+	  continue;
+	startElement( idx );
+	if ( res != 0 )
+	  failElement( idx, "Not processed by rpm" );
+	finishElement( idx );
+      }
+    }
+    logUnassignedOutput();
+
+    _rpmlog = nullptr;
+    _receiver = nullptr;
+    if ( scriptFd )
+    {
+      ::rpmtsSetScriptFd( _ts, NULL );
+      ::Fclose( scriptFd );
+    }
+    return( processed || res == 0 );
+  }
+
+private:
+  static void * notifyCB( const void * h_r, const rpmCallbackType what_r,
+			  const rpm_loff_t amount_r, const rpm_loff_t total_r,
+			  fnpyKey key_r, rpmCallbackData data_r )
+  { return reinterpret_cast<Impl*>(data_r)->notify( h_r, what_r, amount_r, total_r, key_r ); }
+
+  void * notify( const void * h_r, rpmCallbackType what_r, rpm_loff_t amount_r, rpm_loff_t total_r, fnpyKey key_r )
+  {
+    switch ( what_r )
+    {
+      case RPMCALLBACK_INST_OPEN_FILE:
+      {
+	int idx = installIdx( key_r );
+	if ( idx < 0 || _stop )
+	  return nullptr;	// rpm skips the element
+
+	startElement( idx );
+	_fd = ::Fopen( _elements[idx]._filename.c_str(), "r.ufdio" );
+	if ( _fd == 0 || ::Ferror( _fd ) )
+	{
+	  ERR << "Can't open file for reading: " << _elements[idx]._filename << " (" << ::Fstrerror( _fd ) << ")" << endl;
+	  if ( _fd )
+	    ::Fclose( _fd );
+	  _fd = nullptr;
+	  failElement( idx, str::form( "Can't open %s for reading", _elements[idx]._filename.c_str() ) );
+	  finishElement( idx );
+	}
+	return _fd;
+      }
+      break;
+
+      case RPMCALLBACK_INST_CLOSE_FILE:
+      {
+	if ( _fd )
+	{
+	  ::Fclose( _fd );
+	  _fd = nullptr;
+	}
+	int idx = installIdx( key_r );
+	if ( idx >= 0 )
+	  finishElement( idx );
+      }
+      break;
+
+      case RPMCALLBACK_INST_PROGRESS:
+	if ( _installReport )
+	  (*_installReport)->progress( percent( amount_r, total_r ) );
+	break;
+
+      case RPMCALLBACK_UNINST_START:
+      {
+	// Erasing the old version of an updated package is not an element of its own.
+	int idx = eraseIdx( h_r );
+	if ( idx >= 0 )
+	  startElement( idx );
+      }
+      break;
+
+      case RPMCALLBACK_UNINST_PROGRESS:
+	if ( _removeReport && eraseIdx( h_r ) == _current )
+	  (*_removeReport)->progress( percent( amount_r, total_r ) );
+	break;
+
+      case RPMCALLBACK_UNINST_STOP:
+      {
+	int idx = eraseIdx( h_r );
+	if ( idx >= 0 && --_elements[idx]._pending == 0 )
+	  finishElement( idx );
+      }
+      break;
+
+      case RPMCALLBACK_SCRIPT_ERROR:
+	// amount: the %script tag, total: its result (non critical %scripts report RPMRC_OK)
+	if ( total_r != RPMRC_OK )
+	{
+	  int idx = key_r ? installIdx( key_r ) : eraseIdx( h_r );
+	  if ( idx >= 0 )
+	    failElement( idx, "%script failed" );
+	  else
+	    WAR << "%script failed in a package which is not an element of the set" << endl;
+	}
+	break;
+
+      case RPMCALLBACK_UNPACK_ERROR:
+      case RPMCALLBACK_CPIO_ERROR:
+      {
+	int idx = installIdx( key_r );
+	if ( idx >= 0 )
+	  failElement( idx, what_r == RPMCALLBACK_UNPACK_ERROR ? "unpacking failed" : "cpio error" );
+      }
+      break;
+
+      default:
+	break;
+    }
+    return nullptr;
+  }
+
+  static unsigned percent( rpm_loff_t amount_r, rpm_loff_t total_r )
+  { return total_r ? unsigned( amount_r * 100 / total_r ) : 100; }
+
+  /** Element index from the key passed to \c rpmtsAddInstallElement or \c -1 */
+  int installIdx( fnpyKey key_r ) const
+  {
+    uintptr_t key = reinterpret_cast<uintptr_t>( key_r );
+    return( key && key <= _elements.size() ? int( key - 1 ) : -1 );
+  }
+
+  /** Element index from the header passed to \c rpmtsAddEraseElement or \c -1 */
+  int eraseIdx( const void * h_r ) const
+  {
+    if ( ! h_r )
+      return -1;
+    std::map<unsigned,unsigned>::const_iterator it( _eraseIdx.find( ::headerGetInstance( Header( const_cast<void*>( h_r ) ) ) ) );
+    return( it == _eraseIdx.end() ? -1 : int( it->second ) );
+  }
+
+  void startElement( unsigned idx_r )
+  {
+    Element & el( _elements[idx_r] );
+    if ( el._started )
+      return;
+    if ( _current >= 0 )
+      finishElement( _current );
+
+    logUnassignedOutput();
+    el._started = true;
+    _current = idx_r;
+    MIL << "RpmDb::TransactionSet " << ( el._install ? "install " : "remove " ) << el._name << endl;
+
+    _receiver->start( idx_r );
+    if ( el._install )
+    {
+      _installReport.reset( new callback::SendReport<RpmInstallReport> );
+      (*_installReport)->start( el._filename );
+    }
+    else
+    {
+      _removeReport.reset( new callback::SendReport<RpmRemoveReport> );
+      (*_removeReport)->start( el._name );
+    }
+  }
+
+  void failElement( unsigned idx_r, const std::string & error_r )
+  {
+    Element & el( _elements[idx_r] );
+    ERR << "RpmDb::TransactionSet " << el._name << ": " << error_r << endl;
+    if ( ! el._failed )
+    {
+      el._failed = true;
+      el._error = error_r;
+    }
+  }
+
+  void finishElement( unsigned idx_r )
+  {
+    Element & el( _elements[idx_r] );
+    if ( el._finished || _current != int(idx_r) )
+      return;
+    el._finished = true;
+    _current = -1;
+
+    // rpm log messages (w/o priority prefix) and %script output
+    std::string logmsg;
+    logmsg.swap( *_rpmlog );
+    std::string output( logmsg + readScriptOutput() );
+
+    std::string rpmmsg;
+    std::vector<std::string> lines;
+    str::split( output, std::back_inserter( lines ), "\n" );
+    unsigned linecnt = 0;
+    for ( const std::string & line : lines )
+    {
+      if ( linecnt < MAXRPMMESSAGELINES )
+	++linecnt;
+      else if ( line.find( " scriptlet failed, " ) == std::string::npos )	// always log %script errors
+	continue;
+      rpmmsg += line+'\n';
+    }
+    if ( linecnt >= MAXRPMMESSAGELINES )
+      rpmmsg += "[truncated]\n";
+
+    if ( el._install )
+    {
+      lines.clear();
+      str::split( logmsg, std::back_inserter( lines ), "\n" );
+      for ( const std::string & line : lines )
+      {
+	_rpmdb.processConfigFiles( "warning: "+line, el._name, " saved as ",
+				   // %s = filenames
+				   _("rpm saved %s as %s, but it was impossible to determine the difference"),
+				   // %s = filenames
+				   _("rpm saved %s as %s.\nHere are the first 25 lines of difference:\n"));
+	_rpmdb.processConfigFiles( "warning: "+line, el._name, " created as ",
+				   // %s = filenames
+				   _("rpm created %s as %s, but it was impossible to determine the difference"),
+				   // %s = filenames
+				   _("rpm created %s as %s.\nHere are the first 25 lines of difference:\n"));
+      }
+    }
+
+    HistoryLog historylog;
+    ElementReceiver::Result result = ElementReceiver::DONE;
+    if ( el._failed )
+    {
+      historylog.comment(
+          str::form( el._install ? "%s install failed" : "%s remove failed", el._name.c_str() ),
+          true /*timestamp*/);
+      std::ostringstream sstr;
+      sstr << "rpm output:" << endl << rpmmsg << endl;
+      historylog.comment(sstr.str());
+
+      // TranslatorExplanation the colon is followed by an error message
+      RpmSubprocessException excpt( _("RPM failed: ") + (rpmmsg.empty() ? el._error : rpmmsg) );
+      // A single element can not be retried within the transaction; the
+      // receiver commits it again afterwards (the report is not finished,
+      // like in installPackage).
+      if ( el._install )
+      {
+	switch ( (*_installReport)->problem( excpt ) )
+	{
+	  case RpmInstallReport::ABORT:
+	    (*_installReport)->finish( excpt );
+	    result = ElementReceiver::FAILED;
+	    break;
+	  case RpmInstallReport::RETRY:
+	    result = ElementReceiver::RETRY;
+	    break;
+	  case RpmInstallReport::IGNORE:
+	    break;
+	}
+      }
+      else
+      {
+	switch ( (*_removeReport)->problem( excpt ) )
+	{
+	  case RpmRemoveReport::ABORT:
+	    (*_removeReport)->finish( excpt );
+	    result = ElementReceiver::FAILED;
+	    break;
+	  case RpmRemoveReport::RETRY:
+	    result = ElementReceiver::RETRY;
+	    break;
+	  case RpmRemoveReport::IGNORE:
+	    break;
+	}
+      }
+    }
+    else
+    {
+      if ( ! rpmmsg.empty() )
+      {
+	historylog.comment(
+	    str::form( el._install ? "%s installed ok" : "%s removed ok", el._name.c_str() ),
+	    true /*timestamp*/);
+	std::ostringstream sstr;
+	sstr << "Additional rpm output:" << endl << rpmmsg << endl;
+	historylog.comment(sstr.str());
+      }
+
+      // report additional rpm output in finish
+      // TranslatorExplanation Text is followed by a ':'  and the actual output.
+      std::string info( rpmmsg.empty() ? std::string() : str::form( "%s:\n%s\n", _("Additional rpm output"),  rpmmsg.c_str() ) );
+      if ( el._install )
+      {
+	if ( ! info.empty() )
+	  (*_installReport)->finishInfo( info );
+	(*_installReport)->finish();
+      }
+      else
+      {
+	if ( ! info.empty() )
+	  (*_removeReport)->finishInfo( info );
+	(*_removeReport)->finish();
+      }
+    }
+    _installReport.reset();
+    _removeReport.reset();
+
+    if ( ! _receiver->finish( idx_r, result ) )
+    {
+      MIL << "RpmDb::TransactionSet stops after " << el._name << endl;
+      _stop = true;
+    }
+  }
+
+  /** Return the %script output written since the last call. */
+  std::string readScriptOutput()
+  {
+    std::string ret;
+    if ( _scriptOut.empty() )
+      return ret;
+    std::ifstream in( _scriptOut.c_str() );
+    in.seekg( _scriptOffset );
+    if ( in )
+    {
+      ret.assign( std::istreambuf_iterator<char>( in ), std::istreambuf_iterator<char>() );
+      _scriptOffset += ret.size();
+    }
+    return ret;
+  }
+
+  /** Log output which does not belong to an element (e.g. %pretrans, erasing an updated package). */
+  void logUnassignedOutput()
+  {
+    std::string output;
+    output.swap( *_rpmlog );
+    output += readScriptOutput();
+    if ( ! output.empty() )
+      MIL << "rpm output:" << endl << output << endl;
+  }
+
+  /** Log the problems rpm reported. */
+  void logProblems()
+  {
+    rpmps ps = ::rpmtsProblems( _ts );
+    rpmpsi psi = ::rpmpsInitIterator( ps );
+    while ( rpmProblem p = ::rpmpsiNext( psi ) )
+    {
+      char * msg = ::rpmProblemString( p );
+      ERR << "rpm problem: " << msg << endl;
+      ::free( msg );
+    }
+    ::rpmpsFreeIterator( psi );
+    ::rpmpsFree( ps );
+  }
+
+private:
+  RpmDb &			_rpmdb;
+  RpmInstFlags			_flags;
+  rpmts				_ts;
+  FD_t				_fd;		///< the rpm file currently installed
+  std::vector<Element>		_elements;
+  std::map<unsigned,unsigned>	_eraseIdx;	///< rpmdb offset to element index
+
+  ElementReceiver *		_receiver;
+  int				_current;	///< the element currently processed or -1
+  bool				_stop;		///< do not start further elements
+  std::unique_ptr<callback::SendReport<RpmInstallReport>> _installReport;
+  std::unique_ptr<callback::SendReport<RpmRemoveReport>>  _removeReport;
+
+  std::string *			_rpmlog;	///< collecting rpm log messages while running
+  Pathname			_scriptOut;	///< collecting %script output while running
+  std::streamoff		_scriptOffset;	///< %script output already consumed
+};
+
+///////////////////////////////////////////////////////////////////
+//
+//	CLASS NAME : RpmDb::TransactionSet
+//
+///////////////////////////////////////////////////////////////////
+
+RpmDb::TransactionSet::TransactionSet( RpmDb & rpmdb_r, RpmInstFlags flags_r )
+  : _pimpl( new Impl( rpmdb_r, flags_r ) )
+{}
+
+RpmDb::TransactionSet::~TransactionSet()
+{}
+
+unsigned RpmDb::TransactionSet::addInstall( const Pathname & filename_r, RpmInstFlags flags_r )
+{ return _pimpl->addInstall( filename_r, flags_r ); }
+
+unsigned RpmDb::TransactionSet::addRemove( const std::string & name_r )
+{ return _pimpl->addRemove( name_r ); }
+
+unsigned RpmDb::TransactionSet::addRemove( Package::constPtr package_r )
+{
+  // like 'rpm -e' we don't use epochs
+  return addRemove( package_r->name()
+                    + "-" + package_r->edition().version()
+                    + "-" + package_r->edition().release()
+                    + "." + package_r->arch().asString() );
+}
+
+unsigned RpmDb::TransactionSet::size() const
+{ return _pimpl->size(); }
+
+bool RpmDb::TransactionSet::run( ElementReceiver & receiver_r )
+{ return _pimpl->run( receiver_r ); }
+
 ///////////////////////////////////////////////////////////////////
 //
 //
@@ -17,6 +17,7 @@
 
 #include <iosfwd>
 #include <list>
+#include <map>
 #include <vector>
 #include <string>
 
@@ -470,6 +471,26 @@ public:
    */
   CheckPackageResult checkPackageSignature( const Pathname & path_r, CheckPackageDetail & detail_r );
 
+  /**
+   * Check the signatures of \a files_r concurrently (in advance of providing them).
+   *
+   * The files are checked in up to \a maxParallel_r forked worker processes
+   * (default: the number of online CPUs). Nothing is reported to the user.
+   * The results are remembered, and a subsequent \ref checkPackage or
+   * \ref checkPackageSignature of an unchanged file returns the same
+   * result and details without checking it again (once). So the user
+   * interaction is still done when the package is actually provided.
+   *
+   * Remembered results are discarded if public keys are imported or removed.
+   */
+  void checkPackagesSignature( const std::vector<Pathname> & files_r, unsigned maxParallel_r = 0 );
+
+private:
+  /** Take the remembered result for \a path_r if the file is unchanged. */
+  bool takePrecheckedSignature( const Pathname & path_r, CheckPackageResult & result_r, CheckPackageDetail & detail_r );
+
+public:
+
   /** install rpm package
    *
    * @param filename file to install
@@ -495,6 +516,9 @@ public:
   void removePackage( const std::string & name_r, RpmInstFlags flags = RPMINST_NONE );
   void removePackage( Package::constPtr package, RpmInstFlags flags = RPMINST_NONE );
 
+  /** Install and remove packages within a single rpm transaction. */
+  class TransactionSet;
+
   /**
    * get backup dir for rpm config files
    *
@@ -564,6 +588,111 @@ protected:
   void doRebuildDatabase(callback::SendReport<RebuildDBReport> & report);
 };
 
+///////////////////////////////////////////////////////////////////
+/// \class RpmDb::TransactionSet
+/// \brief Install and remove packages within a single rpm transaction.
+///
+/// Instead of running \c rpm once per package (\ref RpmDb::installPackage,
+/// \ref RpmDb::removePackage), the elements are passed to librpm as one
+/// transaction set. They are processed in the order they were added (no
+/// dependency check, no reordering by rpm). Per element the same
+/// \ref RpmInstallReport / \ref RpmRemoveReport callbacks are sent and the
+/// same history log comments are written as by the per package methods.
+///
+/// An \ref ElementReceiver is told when an element is started and finished.
+/// If an element fails, the user is asked via \c problem. A single element
+/// can not be retried within the transaction, so on \c RETRY the receiver
+/// is told to commit it again after the transaction. \c ABORT (or
+/// \ref ElementReceiver::finish returning \c false) stops the transaction:
+/// subsequent packages are not installed, but rpm may still remove packages
+/// already in the set.
+///
+/// Installed packages rpm already erases because an install element updates
+/// or obsoletes them are not added as erase elements of their own; they are
+/// reported as part of the remove element that asked for them.
+///
+/// \note Config file warnings (".rpmnew", ".rpmorig") are detected in rpms
+/// log output, which (like rpms own output) is expected in the C locale.
+///
+/// \code
+///   RpmDb::TransactionSet tset( rpmdb, flags );
+///   tset.addInstall( localfile );	// element 0
+///   tset.addRemove( package );		// element 1
+///   if ( ! tset.run( receiver ) )
+///     ...	// nothing was done; install and remove one by one
+/// \endcode
+///////////////////////////////////////////////////////////////////
+class RpmDb::TransactionSet : private base::NonCopyable
+{
+public:
+  /** Notified about each element of the transaction. */
+  struct ElementReceiver
+  {
+    virtual ~ElementReceiver() {}
+    /** Element \a idx_r is about to be processed (before the reports \c start). */
+    virtual void start( unsigned idx_r ) {}
+    /** How an element ended. */
+    enum Result
+    {
+      DONE,	///< done (or the user ignored a failure)
+      FAILED,	///< failed and the user chose to abort
+      RETRY	///< failed and the user wants to retry it; to be committed again after the transaction
+    };
+    /** Element \a idx_r is done (after the reports \c finish, unless \c RETRY).
+     * Return \c false to stop the transaction.
+     */
+    virtual bool finish( unsigned idx_r, Result result_r ) { return true; }
+  };
+
+public:
+  /** Ctor opening the \ref RpmDb for writing.
+   * \a flags_r are applied to all elements: \c RPMINST_NODIGEST,
+   * \c RPMINST_NOSIGNATURE, \c RPMINST_EXCLUDEDOCS, \c RPMINST_NOSCRIPTS,
+   * \c RPMINST_FORCE, \c RPMINST_IGNORESIZE, \c RPMINST_JUSTDB,
+   * \c RPMINST_TEST and \c RPMINST_NOPOSTTRANS are supported. Dependencies
+   * are never checked (like \c RPMINST_NODEPS).
+   * \throws RpmException
+   */
+  TransactionSet( RpmDb & rpmdb_r, RpmInstFlags flags_r = RPMINST_NONE );
+
+  /** Dtor */
+  ~TransactionSet();
+
+public:
+  /** Add a package to install; returns the elements index.
+   * \c RPMINST_NOUPGRADE installs without removing older versions (\c rpm \c -i).
+   * \throws RpmException if the package can not be read
+   */
+  unsigned addInstall( const Pathname & filename_r, RpmInstFlags flags_r = RPMINST_NONE );
+
+  /** Add all installed packages matching \a name_r to remove (like \c rpm \c -e \c --allmatches); returns the elements index.
+   * \throws RpmException if no such package is installed
+   */
+  unsigned addRemove( const std::string & name_r );
+  /** \overload */
+  unsigned addRemove( Package::constPtr package_r );
+
+  /** Number of elements in the set. */
+  unsigned size() const;
+
+  /** Whether the set is empty. */
+  bool empty() const
+  { return size() == 0; }
+
+  /** Run the transaction.
+   * Returns \c false if rpm did not process any element (e.g. problems
+   * reported by rpm like insufficient disk space). The caller may then
+   * install and remove the packages one by one.
+   * \throws RpmException
+   */
+  bool run( ElementReceiver & receiver_r );
+
+public:
+  class Impl;	///< Implementation class.
+private:
+  RW_pointer<Impl> _pimpl;	///< Pointer to implementation.
+};
+
 /** \relates RpmDb::CheckPackageResult Stream output */
 std::ostream & operator<<( std::ostream & str, RpmDb::CheckPackageResult obj );
 